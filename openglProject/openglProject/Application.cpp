@@ -3,6 +3,9 @@
 // and initialise the application.
 
 // Include headers
+#include <thread>
+#include <chrono>
+
 #include "Application.h"
 
 namespace applicationFramework
@@ -10,18 +13,28 @@ namespace applicationFramework
 	// Set constants
 	const double Application::FRAME_TIME = 1.0 /
 		Application::FPS * 1000.0; // Milliseconds
+	const float Application::FIELD_OF_VIEW = 60.0f;
+	const float Application::NEAR_PLANE = 1.0f;
+	const float Application::FAR_PLANE = 500.0f;
+	const char *Application::FRAME_STATISTICS_CSV = "frame_statistics.csv";
+	const char *Application::FRAME_STATISTICS_JSON = "frame_statistics.json";
 
 	Application *Application::instance = NULL;
 
 	// Class constructor
 	Application::Application() 
+		: framePacer(FPS), frameStatistics(FRAME_TIME)
 	{
 		elapsedTimeInSeconds = 0;
-		frameTimeElapsed = 0;
+		headless = false;
 		title = "OpenGL Demo";
 		eyeVector = Vector<float>(0.0, 0.0, -10.0); // move the eye position back
 		position = 0.0f;
-		direction = 1.0 / FRAME_TIME;
+		previousPosition = 0.0f;
+		direction = FPS / FRAME_TIME;		// The speed the demo had at FPS, moving 1 / FRAME_TIME a frame
+		updateTime = 1.0 / UPDATES_PER_SECOND;
+		updateAccumulator = 0.0;
+		frameAlpha = 0.0f;
 	}
 
 	// Class Destructor
@@ -32,6 +45,7 @@ namespace applicationFramework
 	void Application::startApplication(int argc, char *argv[])
 	{
 		setInstance();	// Sets the instance to self, used in the callback wrapper functions
+		ThreadPool::getSharedPool();	// Built before exitWrapper is registered, so it is destroyed after it
 
 		// Initialize GLUT
 		glutInit(&argc, argv);
@@ -51,6 +65,7 @@ namespace applicationFramework
 		glutSpecialUpFunc(specialKeyboardUpWrapper);
 
 		init();						// Initialize
+		atexit(exitWrapper);		// GLUT only leaves its loop by exiting
 		glutIdleFunc(runWrapper); 	// The program run loop
 		glutMainLoop();				// Start the main GLUT thread
 	}
@@ -60,23 +75,51 @@ namespace applicationFramework
 		// Subclass and override this method
 	}
 
+	void Application::update(double dt)
+	{
+		// Subclass and override this method
+		// DEMO: Move the teapot back and forth on the x-axis
+		previousPosition = position;
+		if (position > 4 && direction > 0) {
+			direction = -FPS / FRAME_TIME;
+		}
+		else if (position < -4 && direction < 0) {
+			direction = FPS / FRAME_TIME;
+		}
+		position += (float)(direction * dt);
+	}
+
 	void Application::render(float dTime) 
 	{
 		// Subclass and override this method
 		static int frame = 0;
-		std::cout << "GlutFramework Display: Frame: " << frame << ", dt(sec): " << dTime << ", Position: " << position << std::endl;
+		float drawnPosition = previousPosition + (position - previousPosition) * frameAlpha;
+		LOG_TRACE("GlutFramework Display: Frame: %d, dt(sec): %g, alpha: %g, Position: %g", frame, dTime, frameAlpha, drawnPosition);
 		++frame;
 
-		// DEMO: Create a teapot and move it back and forth on the x-axis
-		glTranslatef(position, 0.0f, 0.0f);
-		glutSolidTeapot(2.5);
-		if (position > 4 && direction > 0) {
-			direction = -1.0 / FRAME_TIME;
+		// DEMO: Create a teapot between its last two simulated positions
+		if (!headless) {
+			glTranslatef(drawnPosition, 0.0f, 0.0f);
+			glutSolidTeapot(2.5);
 		}
-		else if (position < -4 && direction < 0) {
-			direction = 1.0 / FRAME_TIME;
-		}
-		position += direction;
+	}
+
+	void Application::render(float dTime, float alpha)
+	{
+		// Subclass and override this method, or render(float)
+		(void)alpha;
+		render(dTime);
+	}
+
+	float Application::getFrameAlpha() const
+	{
+		return frameAlpha;
+	}
+
+	void Application::setUpdateRate(double ticksPerSecond)
+	{
+		updateTime = ticksPerSecond > 0.0 ? 1.0 / ticksPerSecond : 1.0 / UPDATES_PER_SECOND;
+		updateAccumulator = 0.0;
 	}
 
 	void Application::reshape(int width, int height) 
@@ -86,19 +129,20 @@ namespace applicationFramework
 
 	void Application::mouseButtonPress(int button, int state, int x, int y) 
 	{
-		printf("MouseButtonPress: x: %d y: %d\n", x, y);
+		LOG_DEBUG("MouseButtonPress: x: %d y: %d", x, y);
 	}
 
 	void Application::mouseMove(int x, int y) 
 	{
-		printf("MouseMove: x: %d y: %d\n", x, y);
+		LOG_DEBUG("MouseMove: x: %d y: %d", x, y);
 	}
 
 	void Application::keyboardDown(unsigned char key, int x, int y)
 	{
 		// Subclass and override this method
-		printf("KeyboardDown: %c = %d\n", key, (int)key);
+		LOG_DEBUG("KeyboardDown: %c = %d", key, (int)key);
 		if (key == 27) { //27 =- ESC key
+			framePacer.printReport();
 			exit(0);
 		}
 
@@ -108,20 +152,20 @@ namespace applicationFramework
 	void Application::keyboardUp(unsigned char key, int x, int y)
 	{
 		// Subclass and override this method
-		printf("KeyboardUp: %c \n", key);
+		LOG_DEBUG("KeyboardUp: %c", key);
 		keyStates.keyUp((int)key);
 	}
 
 	void Application::specialKeyboardDown(int key, int x, int y)
 	{
 		// Subclass and override this method
-		printf("SpecialKeyboardDown: %d\n", key);
+		LOG_DEBUG("SpecialKeyboardDown: %d", key);
 	}
 
 	void Application::specialKeyboardUp(int key, int x, int y)
 	{
 		// Subclass and override this method	
-		printf("SpecialKeyboardUp: %d \n", key);
+		LOG_DEBUG("SpecialKeyboardUp: %d", key);
 	}
 
 	// ******************************
@@ -131,14 +175,15 @@ namespace applicationFramework
 	// Initialize the projection/view matricies.
 	void Application::setDisplayMatricies() 
 	{
+		PROFILE_ZONE("Application::setDisplayMatricies");
 		/* Setup the projection and model view matricies */
-		int width = glutGet(GLUT_WINDOW_WIDTH);
-		int height = glutGet(GLUT_WINDOW_HEIGHT);
-		float aspectRatio = width / height;
+		int width = getWindowWidth();
+		int height = getWindowHeight();
+		float aspectRatio = height > 0 ? (float)width / height : 1.0f;
 		glViewport(0, 0, width, height);
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity();
-		gluPerspective(60, aspectRatio, 1, 500.0);
+		gluPerspective(FIELD_OF_VIEW, aspectRatio, NEAR_PLANE, FAR_PLANE);
 
 		glMatrixMode(GL_MODELVIEW);
 		glLoadIdentity();
@@ -149,6 +194,7 @@ namespace applicationFramework
 
 	void Application::setupLights() 
 	{
+		PROFILE_ZONE("Application::setupLights");
 		GLfloat light1_position[] = { 0.0, 1.0, 1.0, 0.0 };
 		GLfloat white_light[] = { 1.0, 1.0, 1.0, 1.0 };
 		GLfloat lmodel_ambient[] = { 0.4, 0.4, 0.4, 1.0 };
@@ -185,6 +231,77 @@ namespace applicationFramework
 		return upVector;
 	}
 
+	int Application::selectLod(const MeshLodChain &lodChain, const Vector<float> &position, float maxPixelError) const
+	{
+		return lodChain.selectLod(eyeVector, centerVector, position, FIELD_OF_VIEW,
+			getWindowHeight(), maxPixelError);
+	}
+
+	Frustum Application::getFrustum() const
+	{
+		int width = getWindowWidth();
+		int height = getWindowHeight();
+		Frustum frustum;
+		frustum.setPerspective(eyeVector, centerVector, upVector, FIELD_OF_VIEW,
+			height > 0 ? (float)width / height : 1.0f, NEAR_PLANE, FAR_PLANE);
+		return frustum;
+	}
+
+	void Application::getPickRay(int x, int y, Vector<float> &origin, Vector<float> &direction) const
+	{
+		getPickRay(x, y, getWindowWidth(), getWindowHeight(), origin, direction);
+	}
+
+	void Application::getPickRay(int x, int y, int width, int height, Vector<float> &origin, Vector<float> &direction) const
+	{
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+
+		// Camera basis as gluLookAt builds it, scaled to the image plane at distance 1
+		Vector<float> forward = centerVector - eyeVector;
+		forward.normalize();
+		Vector<float> right = forward.cross(upVector);
+		right.normalize();
+		Vector<float> cameraUp = right.cross(forward);
+		float halfHeight = tanf(FIELD_OF_VIEW * 0.5f * 3.14159265f / 180.0f);
+		float halfWidth = halfHeight * width / height;
+
+		float ndcX = 2.0f * (x + 0.5f) / width - 1.0f;
+		float ndcY = 1.0f - 2.0f * (y + 0.5f) / height;			// Window y grows downwards
+		origin = eyeVector;
+		direction = forward + right * (ndcX * halfWidth) + cameraUp * (ndcY * halfHeight);
+		direction.normalize();
+	}
+
+	bool Application::pick(const TriangleBvh &bvh, int x, int y, RayHit &hit) const
+	{
+		Vector<float> origin, direction;
+		getPickRay(x, y, origin, direction);
+		float rayOrigin[3] = { origin.x, origin.y, origin.z };
+		float rayDirection[3] = { direction.x, direction.y, direction.z };
+		return bvh.intersect(rayOrigin, rayDirection, hit, FAR_PLANE);
+	}
+
+	AssetLoader& Application::getAssetLoader()
+	{
+		return assetLoader;
+	}
+
+	FramePacer& Application::getFramePacer()
+	{
+		return framePacer;
+	}
+
+	Scene& Application::getScene()
+	{
+		return scene;
+	}
+
+	FrameStatistics& Application::getFrameStatistics()
+	{
+		return frameStatistics;
+	}
+
 	void Application::setTitle(std::string theTitle) 
 	{
 		title = theTitle;
@@ -195,42 +312,35 @@ namespace applicationFramework
 	// **************************
 	void Application::init() 
 	{
-		glClearColor(0.0, 0.0, 0.0, 1.0);
+		if (!headless) {			// There is no GL context to set up when headless
+			glClearColor(0.0, 0.0, 0.0, 1.0);
 
-		glEnable(GL_LIGHTING);
-		glEnable(GL_LIGHT0);
-		glShadeModel(GL_SMOOTH);
-		glEnable(GL_DEPTH_TEST);
+			glEnable(GL_LIGHTING);
+			glEnable(GL_LIGHT0);
+			glShadeModel(GL_SMOOTH);
+			glEnable(GL_DEPTH_TEST);
+		}
 
 		load();
 	}
 
 	void Application::setInstance() 
 	{
-		std::cout << "GlutFramework::setInstance()" << std::endl;
+		LOG_DEBUG("GlutFramework::setInstance()");
 		instance = this;
 	}
 
 	void Application::run() 
 	{
-		if (frameRateTimer.isStopped()) {	// The initial frame has the timer stopped, start it once
-			frameRateTimer.start();
-		}
-
-		frameRateTimer.stop();			// stop the timer and calculate time since last frame
-		double milliseconds = frameRateTimer.getElapsedMilliseconds();
-		frameTimeElapsed += milliseconds;
-
-		if (frameTimeElapsed >= FRAME_TIME) {	// If the time exceeds a certain "frame rate" then show the next frame
-			glutPostRedisplay();
-			frameTimeElapsed -= FRAME_TIME;		// remove a "frame" and start counting up again
-		}
-		frameRateTimer.start();			// start the timer
+		framePacer.waitForNextFrame();	// Sleep, then spin, until the next frame is due
+		glutPostRedisplay();
 	}
 
 	void Application::renderApplication() 
 	{
-		if (displayTimer.isStopped()) {			// Start the timer on the initial frame
+		PROFILE_ZONE("Application::renderApplication");
+		bool isFirstFrame = displayTimer.isStopped();
+		if (isFirstFrame) {			// Start the timer on the initial frame
 			displayTimer.start();
 		}
 
@@ -239,16 +349,143 @@ namespace applicationFramework
 
 		displayTimer.stop();		// Stop the timer and get the elapsed time in seconds
 		elapsedTimeInSeconds = displayTimer.getElapsedSeconds(); // seconds
+		if (!isFirstFrame) {
+			frameStatistics.recordFrame(elapsedTimeInSeconds);
+		}
 
-		setupLights();
-		setDisplayMatricies();
-
-		render(elapsedTimeInSeconds);
+		renderFrame((float)elapsedTimeInSeconds);
 
 		glutSwapBuffers();
 		displayTimer.start();		// reset the timer to calculate the time for the next frame
 	}
 
+	void Application::renderFrame(float dTime)
+	{
+		PROFILE_ZONE("Application::renderFrame");
+		{
+			PROFILE_ZONE("AssetLoader::commitFinished");
+			assetLoader.commitFinished();	// Models parsed in the background join the scene between frames
+		}
+
+		// Fixed ticks for the frame time, capped so a slow frame can't demand ever more
+		// ticks the next frame (the spiral of death), the simulation slows down instead
+		updateAccumulator += dTime > 0.0f ? dTime : 0.0f;
+		int tickCount = 0;
+		while (updateAccumulator >= updateTime && tickCount < MAX_UPDATES_PER_FRAME) {
+			PROFILE_ZONE("Application::update");
+			update(updateTime);
+			updateAccumulator -= updateTime;
+			tickCount++;
+		}
+		if (updateAccumulator >= updateTime) {
+			updateAccumulator = fmod(updateAccumulator, updateTime);
+		}
+		float alpha = (float)(updateAccumulator / updateTime);
+		frameAlpha = alpha;
+
+		if (headless) {
+			scene.cull(getFrustum(), headlessVisible);	// The CPU side of drawing the scene, without a GL context
+		}
+		else {
+			setupLights();
+			setDisplayMatricies();
+
+			scene.render(getFrustum());		// Instances outside the view volume are skipped
+		}
+		{
+			PROFILE_ZONE("Application::render");
+			render(dTime, alpha);
+		}
+	}
+
+	int Application::runHeadless(int frameCount, float frameTime, const char *filename)
+	{
+		setInstance();
+		headless = true;
+
+		// Load, then wait for the background loads so every run starts from the same scene
+		PerformanceTimer loadTimer;
+		loadTimer.start();
+		init();
+		while (assetLoader.getPendingCount() > 0) {
+			assetLoader.commitFinished();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		assetLoader.commitFinished();
+		loadTimer.stop();
+
+		// The frames run back to back, timed on the CPU, with a fixed simulated step
+		std::vector<double> frameMilliseconds(frameCount > 0 ? frameCount : 0);
+		elapsedTimeInSeconds = frameTime;
+		for (int frame = 0; frame < frameCount; frame++) {
+			PerformanceTimer frameTimer;
+			frameTimer.start();
+			renderFrame(frameTime);
+			frameTimer.stop();
+			frameMilliseconds[frame] = frameTimer.getElapsedMilliseconds();
+			frameStatistics.recordFrame(frameTimer.getElapsedSeconds());
+		}
+
+		FILE *file = fopen(filename, "w");
+		if (file == NULL) {
+			LOG_ERROR("Unable to write %s", filename);
+			return 1;
+		}
+		double totalMilliseconds = 0;
+		double minMilliseconds = frameCount > 0 ? frameMilliseconds[0] : 0;
+		double maxMilliseconds = minMilliseconds;
+		fprintf(file, "{\n\t\"title\": \"%s\",\n\t\"frameCount\": %d,\n\t\"dTime\": %.7g,\n\t\"loadMs\": %.6f,\n\t\"frames\": [",
+			title.c_str(), frameCount, frameTime, loadTimer.getElapsedMilliseconds());
+		for (int frame = 0; frame < frameCount; frame++) {
+			double milliseconds = frameMilliseconds[frame];
+			totalMilliseconds += milliseconds;
+			minMilliseconds = milliseconds < minMilliseconds ? milliseconds : minMilliseconds;
+			maxMilliseconds = milliseconds > maxMilliseconds ? milliseconds : maxMilliseconds;
+			fprintf(file, "%s\n\t\t{ \"frame\": %d, \"time\": %.7g, \"cpuMs\": %.6f }", frame > 0 ? "," : "",
+				frame, frame * (double)frameTime, milliseconds);
+		}
+		fprintf(file, "\n\t],\n\t\"totalMs\": %.6f,\n\t\"meanMs\": %.6f,\n\t\"minMs\": %.6f,\n\t\"maxMs\": %.6f\n}\n",
+			totalMilliseconds, frameCount > 0 ? totalMilliseconds / frameCount : 0.0, minMilliseconds, maxMilliseconds);
+		if (fclose(file) != 0) {
+			LOG_ERROR("Unable to write %s", filename);
+			return 1;
+		}
+
+		LOG_INFO("%d frames in %.3f ms (%.3f ms per frame), timings written to %s", frameCount, totalMilliseconds,
+			frameCount > 0 ? totalMilliseconds / frameCount : 0.0, filename);
+		return writeFrameStatistics() ? 0 : 1;
+	}
+
+	bool Application::writeFrameStatistics()
+	{
+		frameStatistics.printReport();
+		bool isWritten = true;
+		if (!frameStatistics.writeCsv(FRAME_STATISTICS_CSV)) {
+			LOG_ERROR("Unable to write %s", FRAME_STATISTICS_CSV);
+			isWritten = false;
+		}
+		if (!frameStatistics.writeJson(FRAME_STATISTICS_JSON)) {
+			LOG_ERROR("Unable to write %s", FRAME_STATISTICS_JSON);
+			isWritten = false;
+		}
+		return isWritten;
+	}
+
+	bool Application::isHeadless() const
+	{
+		return headless;
+	}
+
+	int Application::getWindowWidth() const
+	{
+		return headless ? WINDOW_WIDTH : glutGet(GLUT_WINDOW_WIDTH);
+	}
+
+	int Application::getWindowHeight() const
+	{
+		return headless ? WINDOW_HEIGHT : glutGet(GLUT_WINDOW_HEIGHT);
+	}
+
 	// ******************************************************************
 	// ** Static functions which are passed to Glut function callbacks **
 	// ******************************************************************
@@ -297,4 +534,10 @@ namespace applicationFramework
 	{
 		instance->specialKeyboardUp(key, x, y);
 	}
+
+	void Application::exitWrapper()
+	{
+		instance->assetLoader.stop();		// The loads may be running on the shared pool, which exit() destroys next
+		instance->writeFrameStatistics();
+	}
 }
@@ -26,19 +26,35 @@
 // Utility classes
 #include "Keyboard.h"
 #include "PerformanceTimer.h"
+#include "FramePacer.h"
+#include "FrameStatistics.h"
+#include "Profiler.h"
+#include "Logger.h"
 #include "Vector.h"
+#include "MeshLodChain.h"
+#include "Frustum.h"
+#include "TriangleBvh.h"
+#include "AssetLoader.h"
+#include "Scene.h"
 
 namespace applicationFramework
 {
 	class Application
 	{
 		private:
-			double frameTimeElapsed;
+			bool headless;				// Running without GLUT or a window, see runHeadless()
+			double updateTime;			// Seconds simulated by each update() tick
+			double updateAccumulator;	// Frame time not yet simulated, less than updateTime between frames
+			float frameAlpha;			// The alpha of the frame being rendered
 
 		protected:
 			Keyboard keyStates;
-			PerformanceTimer frameRateTimer;
+			FramePacer framePacer;			// Waits out each frame at FPS from the idle callback
 			PerformanceTimer displayTimer;
+			FrameStatistics frameStatistics;	// Every frame's time, written out when the application exits
+			AssetLoader assetLoader;		// Background model loads, committed at the start of each frame
+			Scene scene;					// Model instances, culled and drawn before render() each frame
+			std::vector<unsigned int> headlessVisible;	// Instances culled each headless frame, which draws nothing
 
 			std::string title;
 			double elapsedTimeInSeconds;
@@ -49,11 +65,14 @@ namespace applicationFramework
 			Vector<float> upVector;
 
 			float position;
-			float direction;
+			float previousPosition;		// Position at the previous update tick, for interpolation
+			float direction;			// Units per second
 
 		public:
 			// Constants
 			const static int FPS = 60;		// Frames per second
+			const static int UPDATES_PER_SECOND = 120;	// Default fixed update() tick rate
+			const static int MAX_UPDATES_PER_FRAME = 8;	// Ticks run per frame at most, the rest of a long frame is dropped
 			const static int WINDOW_WIDTH = 640;
 			const static int WINDOW_HEIGHT = 480;
 			const static int WINDOW_X_POSITION = 100;
@@ -61,6 +80,11 @@ namespace applicationFramework
 
 			const static double FRAME_TIME;		// Frame time is in milliseconds calculated
 												// using FPS.
+			const static float FIELD_OF_VIEW;	// Vertical field of view of the projection (degrees)
+			const static float NEAR_PLANE;		// Distance to the near clipping plane
+			const static float FAR_PLANE;		// Distance to the far clipping plane
+			const static char *FRAME_STATISTICS_CSV;	// Where the frame statistics are written on exit
+			const static char *FRAME_STATISTICS_JSON;
 
 		public:
 			// class constructor/destructor
@@ -72,18 +96,59 @@ namespace applicationFramework
 			// class is created to start the application.
 			void startApplication(int argc, char *argv[]);
 
+			/** Runs the frame loop without GLUT, a window or a GL context, for benchmarking the
+			application logic. Loads queued in load() are committed before the first frame, then
+			every frame gets the same simulated dTime, so runs are reproducible.
+			@param frameCount - the number of frames to run
+			@param frameTime - the dTime passed to render() (seconds)
+			@param filename - where the per-frame CPU timings are written as JSON
+			@return 0, or 1 if the file could not be written
+			*/
+			int runHeadless(int frameCount, float frameTime, const char *filename);
+
+			/** Checks if the application runs from runHeadless(), GLUT and GL calls must be skipped then */
+			bool isHeadless() const;
+
+			/** The size of the window, or of the window it would have when headless */
+			int getWindowWidth() const;
+			int getWindowHeight() const;
+
 			// ****************************
 			// ** Subclass and Implement ** 
 			// ****************************
 
-			/** Any loading logic can be down in this method when the application starts. */
+			/** Any loading logic can be down in this method when the application starts.
+			Large models should be queued with assetLoader.loadModel() so the first frame
+			is not held up, they are committed on the render thread once parsed.
+			*/
 			virtual void load();
 
+			/** The update function advances the simulation by one fixed tick. It is called zero
+			or more times before each frame, as many times as the frame time accumulated fits
+			whole ticks, so the simulation runs at the same speed whatever the frame rate.
+			@param dt - the tick length (seconds), 1 / UPDATES_PER_SECOND unless changed
+			*/
+			virtual void update(double dt);
+
 			// The render function is called at a specified frames-per-second (FPS). 
 			// Any animation drawing code can be run in the render function.
 			// @param dTime - the change in time (seconds)
 			virtual void render(float dTime);
 
+			// Same as render(float), with the update tick blend. By default it calls render(float),
+			// override one or the other.
+			// @param alpha - how far the frame is between the last two update ticks, 0 to 1,
+			// blend the previous and current simulation state by it to draw smoothly
+			virtual void render(float dTime, float alpha);
+
+			/** The alpha of the frame being rendered, for render(float) overrides */
+			float getFrameAlpha() const;
+
+			/** Changes how often update() runs.
+			@param ticksPerSecond - the fixed tick rate
+			*/
+			void setUpdateRate(double ticksPerSecond);
+
 			// Called when the window dimensions change.
 			// @param width - the width of the window in pixels
 			// @param height - the height of the window in pixels
@@ -162,6 +227,55 @@ namespace applicationFramework
 			*/
 			Vector<float> getUpVector() const;
 
+			/** Picks the level of detail to draw a model with from the current camera.
+			@param lodChain - the levels of the model
+			@param position - where the model is drawn
+			@param maxPixelError - the largest simplification error allowed on screen, in pixels
+			@return the level to draw
+			*/
+			int selectLod(const MeshLodChain &lodChain, const Vector<float> &position, float maxPixelError = 1.0f) const;
+
+			/** The view volume of the current camera and window, for culling models and meshlets
+			@return the frustum planes in world space
+			*/
+			Frustum getFrustum() const;
+
+			/** The ray from the camera through a pixel, unprojected as setDisplayMatricies() projects.
+			@param x, y - window coordinates as passed to mouseButtonPress (origin at the top left)
+			@param origin - set to the eye
+			@param direction - set to the unit direction through the center of the pixel
+			*/
+			void getPickRay(int x, int y, Vector<float> &origin, Vector<float> &direction) const;
+
+			/** Same as above for a viewport of a given size instead of the window's */
+			void getPickRay(int x, int y, int width, int height, Vector<float> &origin, Vector<float> &direction) const;
+
+			/** Finds the triangle of a model under a pixel, e.g. from mouseButtonPress.
+			@param bvh - the model's tree (Obj_Loader::bvh), the model drawn at the origin
+			@param x, y - window coordinates
+			@param hit - the triangle hit, its distance is in world units
+			@return true if a triangle is under the pixel
+			*/
+			bool pick(const TriangleBvh &bvh, int x, int y, RayHit &hit) const;
+
+			/** The frame rate scheduler, e.g. to change the target rate or read the jitter */
+			FramePacer& getFramePacer();
+
+			/** The background model loader, loads are committed before render() is called */
+			AssetLoader& getAssetLoader();
+
+			/** The model instances drawn every frame, culled against getFrustum() */
+			Scene& getScene();
+
+			/** The frame time percentiles and hitch counts, overall and per window */
+			FrameStatistics& getFrameStatistics();
+
+			/** Prints the frame statistics and writes them to FRAME_STATISTICS_CSV and
+			FRAME_STATISTICS_JSON. Called when the application exits.
+			@return false if a file could not be written
+			*/
+			bool writeFrameStatistics();
+
 			/** Sets the title of the window to a specific string. Invoke before startFramework()
 			@param title - the name of the window
 			*/
@@ -175,7 +289,8 @@ namespace applicationFramework
 			*/
 			void setInstance();
 
-			/** The run method is called by GLUT and contains the logic to set the framerate of the application. */
+			/** The run method is called by GLUT when idle, it waits for the next frame (sleeping
+			for most of it) and then asks GLUT to redisplay. */
 			void run();
 
 			/** The renderApplication() function sets up initial GLUT state and calculates the
@@ -184,6 +299,13 @@ namespace applicationFramework
 			*/
 			void renderApplication();
 
+			/** Commits finished loads, runs the update() ticks the frame time covers, sets up the
+			lights and matrices and draws the scene and render(). Shared by renderApplication()
+			and runHeadless().
+			@param dTime - the change in time (seconds)
+			*/
+			void renderFrame(float dTime);
+
 			// ** Static functions which are passed to GLUT function callbacks **
 			// http://www.parashift.com/c++-faq-lite/pointers-to-members.html#faq-33.1
 			static void displayWrapper();
@@ -195,6 +317,7 @@ namespace applicationFramework
 			static void keyboardUpWrapper(unsigned char key, int x, int y);
 			static void specialKeyboardDownWrapper(int key, int x, int y);
 			static void specialKeyboardUpWrapper(int key, int x, int y);
+			static void exitWrapper();
 	};
 }
 
@@ -0,0 +1,300 @@
+// AssetLoader.cpp is the file that
+// holds the implementation for the
+// background model loader.
+
+// Include headers
+#include "AssetLoader.h"
+#include "Profiler.h"
+
+namespace applicationFramework {
+
+	// ***************
+	// ** ModelLoad **
+	// ***************
+
+	// Class constructor
+	ModelLoad::ModelLoad(const std::string &filename, int priority, NormalMode normalMode, const ModelCommitCallback &onCommit)
+		: filename(filename), normalMode(normalMode), onCommit(onCommit), sequence(0), state(LOAD_QUEUED), priority(priority)
+	{
+		result = resultPromise.get_future().share();
+	}
+
+	// Class destructor
+	ModelLoad::~ModelLoad()
+	{
+		if (model) {
+			model->release();							// Obj_Loader does not free its buffers by itself
+		}
+	}
+
+	// Return the state of the load
+	LoadState ModelLoad::getState() const
+	{
+		return (LoadState)state.load();
+	}
+
+	// Return how far the load is
+	float ModelLoad::getProgress() const
+	{
+		return progress.fraction.load();
+	}
+
+	// Check if nothing more will happen to the load
+	bool ModelLoad::isFinished() const
+	{
+		int current = state.load();
+		return current == LOAD_COMMITTED || current == LOAD_FAILED || current == LOAD_CANCELLED;
+	}
+
+	// Stop the load wherever it is
+	void ModelLoad::cancel()
+	{
+		progress.isCancelled = true;						// Stops a running load between phases
+
+		int expected = LOAD_QUEUED;
+		if (state.compare_exchange_strong(expected, LOAD_CANCELLED)) {
+			resultPromise.set_value(LOAD_RESULT_CANCELLED);	// No thread will ever pick it up
+			return;
+		}
+
+		expected = LOAD_READY;
+		if (state.compare_exchange_strong(expected, LOAD_CANCELLED)) {
+			model->release();								// Parsed but never committed, the render thread won't touch it
+			model.reset();
+			resultPromise.set_value(LOAD_RESULT_CANCELLED);
+		}
+	}
+
+	// Change the priority of a queued load
+	void ModelLoad::setPriority(int priority)
+	{
+		this->priority = priority;
+	}
+
+	// Return the priority of the load
+	int ModelLoad::getPriority() const
+	{
+		return priority.load();
+	}
+
+	// Return the model once committed
+	Obj_Loader* ModelLoad::getModel() const
+	{
+		return state.load() == LOAD_COMMITTED ? model.get() : NULL;
+	}
+
+	// Return the result of the load
+	std::shared_future<int> ModelLoad::getResult() const
+	{
+		return result;
+	}
+
+	// Return the model file
+	const std::string& ModelLoad::getFilename() const
+	{
+		return filename;
+	}
+
+	// *****************
+	// ** AssetLoader **
+	// *****************
+
+	// Class constructor
+	AssetLoader::AssetLoader(unsigned int threadCount)
+	{
+		nextSequence = 0;
+		isStopping = false;
+		if (threadCount == 0) {
+			threadCount = 1;
+		}
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.push_back(std::thread(&AssetLoader::workerLoop, this));
+		}
+	}
+
+	// Class destructor
+	AssetLoader::~AssetLoader()
+	{
+		stop();
+	}
+
+	// Cancel everything and join the threads, once
+	void AssetLoader::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(loadsMutex);
+			isStopping = true;
+			for (size_t i = 0; i < queued.size(); i++) {
+				queued[i]->cancel();
+			}
+			queued.clear();
+			for (size_t i = 0; i < pending.size(); i++) {
+				pending[i]->progress.isCancelled = true;	// Cut running loads short
+			}
+		}
+		loadAvailable.notify_all();
+
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+		workers.clear();
+
+		// Loads parsed but never committed
+		std::lock_guard<std::mutex> lock(loadsMutex);
+		for (size_t i = 0; i < pending.size(); i++) {
+			pending[i]->cancel();
+		}
+		pending.clear();
+	}
+
+	// Queue a model
+	ModelLoadHandle AssetLoader::loadModel(const std::string &filename, int priority,
+		NormalMode normalMode, const ModelCommitCallback &onCommit)
+	{
+		ModelLoadHandle load(new ModelLoad(filename, priority, normalMode, onCommit));
+		{
+			std::lock_guard<std::mutex> lock(loadsMutex);
+			if (isStopping) {
+				load->cancel();								// No thread is left to run it
+				return load;
+			}
+			load->sequence = nextSequence++;
+			queued.push_back(load);
+			pending.push_back(load);
+		}
+		loadAvailable.notify_one();
+		return load;
+	}
+
+	// Hand the parsed models over on the render thread
+	int AssetLoader::commitFinished(int maxCommits)
+	{
+		std::vector<ModelLoadHandle> ready;
+		{
+			std::lock_guard<std::mutex> lock(loadsMutex);
+			for (size_t i = 0; i < pending.size(); i++) {
+				if (pending[i]->getState() == LOAD_READY) {
+					ready.push_back(pending[i]);
+				}
+			}
+		}
+
+		// Callbacks run without the lock, so they may queue more loads
+		int commitCount = 0;
+		for (size_t i = 0; i < ready.size() && (maxCommits < 0 || commitCount < maxCommits); i++) {
+			ModelLoad &load = *ready[i];
+			if (load.progress.isCancelRequested()) {
+				load.cancel();
+				continue;
+			}
+
+			int expected = LOAD_READY;
+			if (load.state.compare_exchange_strong(expected, LOAD_COMMITTED)) {
+				load.resultPromise.set_value(0);
+				if (load.onCommit) {
+					load.onCommit(*load.model);
+				}
+				commitCount++;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(loadsMutex);
+		size_t kept = 0;
+		for (size_t i = 0; i < pending.size(); i++) {
+			if (!pending[i]->isFinished()) {
+				pending[kept++] = pending[i];
+			}
+		}
+		pending.resize(kept);
+		return commitCount;
+	}
+
+	// Count the loads not finished
+	size_t AssetLoader::getPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock(loadsMutex);
+		size_t count = 0;
+		for (size_t i = 0; i < pending.size(); i++) {
+			count += pending[i]->isFinished() ? 0 : 1;
+		}
+		return count;
+	}
+
+	// Average the progress of the loads not finished
+	float AssetLoader::getProgress() const
+	{
+		std::lock_guard<std::mutex> lock(loadsMutex);
+		float total = 0.0f;
+		int count = 0;
+		for (size_t i = 0; i < pending.size(); i++) {
+			if (!pending[i]->isFinished()) {
+				total += pending[i]->getProgress();
+				count++;
+			}
+		}
+		return count > 0 ? total / count : 1.0f;
+	}
+
+	// Take the queued load with the highest priority, the oldest one among equals
+	ModelLoadHandle AssetLoader::takeNextLoad()
+	{
+		size_t best = 0;
+		for (size_t i = 1; i < queued.size(); i++) {
+			int priority = queued[i]->getPriority();
+			int bestPriority = queued[best]->getPriority();
+			if (priority > bestPriority || (priority == bestPriority && queued[i]->sequence < queued[best]->sequence)) {
+				best = i;
+			}
+		}
+
+		ModelLoadHandle load = queued[best];
+		queued.erase(queued.begin() + best);
+		return load;
+	}
+
+	// Parse loads until the loader is destroyed
+	void AssetLoader::workerLoop()
+	{
+		Profiler::setThreadName("AssetLoader");
+		for (;;)
+		{
+			ModelLoadHandle load;
+			{
+				std::unique_lock<std::mutex> lock(loadsMutex);
+				loadAvailable.wait(lock, [this]() { return isStopping || !queued.empty(); });
+				if (isStopping) {
+					return;
+				}
+				load = takeNextLoad();
+			}
+
+			int expected = LOAD_QUEUED;
+			if (!load->state.compare_exchange_strong(expected, LOAD_RUNNING)) {
+				continue;										// Cancelled while it was queued
+			}
+
+			std::unique_ptr<Obj_Loader> model(new Obj_Loader());
+			std::vector<char> filename(load->filename.begin(), load->filename.end());
+			filename.push_back('\0');							// Obj_Loader takes a mutable C string
+
+			model->setLoadProgress(&load->progress);
+			int result = model->loadCached(&filename[0], load->normalMode);
+			model->setLoadProgress(NULL);
+
+			if (result == 0 && load->progress.isCancelRequested()) {
+				result = LOAD_RESULT_CANCELLED;					// Cancelled after the last phase, the model is dropped all the same
+			}
+			if (result == 0) {
+				load->model.swap(model);
+				load->progress.report(1.0f);
+				load->state = LOAD_READY;						// Publishes the model, the result is set when it is committed or cancelled
+			}
+			else {
+				model->release();
+				load->state = result == LOAD_RESULT_CANCELLED ? LOAD_CANCELLED : LOAD_FAILED;
+				load->resultPromise.set_value(result);
+			}
+		}
+	}
+
+}	// namespace
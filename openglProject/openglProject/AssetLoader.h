@@ -0,0 +1,159 @@
+#pragma once
+// AssetLoader.h is the file that loads
+// models on background threads and hands
+// them to the render thread once parsed.
+
+// Header guards
+#ifndef ASSET_LOADER_H_
+#define ASSET_LOADER_H_
+
+// Include headers
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "Obj_Loader.h"
+#include "LoadProgress.h"
+
+namespace applicationFramework {
+
+	// Where a background load is
+	enum LoadState {
+		LOAD_QUEUED = 0,		// Waiting for a loader thread
+		LOAD_RUNNING = 1,		// Being parsed
+		LOAD_READY = 2,			// Parsed, waiting for the render thread to commit it
+		LOAD_COMMITTED = 3,		// Handed over on the render thread, getModel() is valid
+		LOAD_FAILED = 4,		// The file could not be loaded
+		LOAD_CANCELLED = 5		// Cancelled before it was committed
+	};
+
+	// Called on the render thread when a model is committed
+	typedef std::function<void(Obj_Loader &model)> ModelCommitCallback;
+
+	/* One model load queued on an AssetLoader. Handles are shared between
+	* the caller and the loader, any thread may query or cancel them.
+	*/
+	class ModelLoad
+	{
+	public:
+		ModelLoad(const std::string &filename, int priority, NormalMode normalMode, const ModelCommitCallback &onCommit);
+		~ModelLoad();
+
+		/** Where the load is */
+		LoadState getState() const;
+
+		/** 0 to 1, 1 once parsed */
+		float getProgress() const;
+
+		/** Checks if the load has finished for good (committed, failed or cancelled) */
+		bool isFinished() const;
+
+		/** Stops the load, a model already parsed is dropped instead of committed */
+		void cancel();
+
+		/** Changes the priority of a load that is still queued, higher loads first */
+		void setPriority(int priority);
+		int getPriority() const;
+
+		/** The loaded model once committed, NULL before */
+		Obj_Loader* getModel() const;
+
+		/** The result of the load, ready once it is finished: 0 once committed, -1 if the
+		file could not be loaded, LOAD_RESULT_CANCELLED if it was cancelled at any point
+		*/
+		std::shared_future<int> getResult() const;
+
+		const std::string& getFilename() const;
+
+	private:
+		friend class AssetLoader;
+
+		// Shared through handles only
+		ModelLoad(const ModelLoad &other);
+		ModelLoad& operator=(const ModelLoad &rhs);
+
+		std::string filename;
+		NormalMode normalMode;
+		ModelCommitCallback onCommit;
+		unsigned long sequence;					// Queue order among loads of the same priority
+
+		std::atomic<int> state;
+		std::atomic<int> priority;
+		LoadProgress progress;
+		std::unique_ptr<Obj_Loader> model;		// Written by the loader thread until LOAD_READY
+		std::promise<int> resultPromise;
+		std::shared_future<int> result;
+	};
+
+	typedef std::shared_ptr<ModelLoad> ModelLoadHandle;
+
+	/* Loads models through Obj_Loader::loadCached on its own threads, highest
+	* priority first. Finished loads wait until commitFinished() runs them on
+	* the render thread, so models never change under a frame being drawn.
+	*/
+	class AssetLoader
+	{
+	public:
+		/** Starts the loader threads.
+		@param threadCount - loads parsed at once, each load also spreads over the shared pool
+		*/
+		explicit AssetLoader(unsigned int threadCount = 1);
+
+		/** Cancels the queued loads and waits for the running ones */
+		~AssetLoader();
+
+		/** Same as the destructor, for loaders that outlive the shared pool (e.g. when the
+		program exits from a GLUT callback). Later loads are cancelled right away.
+		*/
+		void stop();
+
+		/** Queues a model load.
+		@param filename - the obj model, its cache is used (and written) as by Obj_Loader::loadCached
+		@param priority - higher loads start first
+		@param normalMode - the normals to build the indexed mesh with
+		@param onCommit - called on the render thread once the model is committed, may be empty
+		@return the handle to follow, cancel or wait on the load
+		*/
+		ModelLoadHandle loadModel(const std::string &filename, int priority = 0,
+			NormalMode normalMode = NORMALS_FLAT, const ModelCommitCallback &onCommit = ModelCommitCallback());
+
+		/** Commits the parsed loads, call from the render thread.
+		@param maxCommits - the most loads to commit this call, negative for all of them
+		@return the number of loads committed
+		*/
+		int commitFinished(int maxCommits = -1);
+
+		/** The loads not finished yet (queued, running or waiting to commit) */
+		size_t getPendingCount() const;
+
+		/** The progress of all pending loads together, 1 when nothing is pending */
+		float getProgress() const;
+
+	private:
+		// The threads belong to the loader
+		AssetLoader(const AssetLoader &other);
+		AssetLoader& operator=(const AssetLoader &rhs);
+
+		/** The loop each loader thread runs until the loader is destroyed */
+		void workerLoop();
+
+		/** Takes the highest priority queued load, the queue must not be empty (lock held) */
+		ModelLoadHandle takeNextLoad();
+
+		std::vector<std::thread> workers;
+		std::vector<ModelLoadHandle> queued;		// Waiting for a thread
+		std::vector<ModelLoadHandle> pending;		// Every load not finished yet, in queue order
+		mutable std::mutex loadsMutex;
+		std::condition_variable loadAvailable;
+		unsigned long nextSequence;
+		bool isStopping;
+	};
+
+}	// namespace
+
+#endif
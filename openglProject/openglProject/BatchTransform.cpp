@@ -0,0 +1,513 @@
+// BatchTransform.cpp is the file that
+// holds the implementation for the batch
+// point and vector transform kernels.
+
+// Include headers
+#include <stdlib.h>
+
+#include "BatchTransform.h"
+
+namespace applicationFramework {
+
+	// Blocks each thread takes when a batch is spread over a pool
+	static const long TRANSFORM_BLOCKS_PER_THREAD = 4;
+
+	// Batches smaller than this are not worth spreading over threads
+	static const long MIN_PARALLEL_TRANSFORM = 32768;
+
+	// Thread blocks start on a multiple of this many elements, so aligned arrays stay aligned
+	static const long TRANSFORM_BLOCK_GRANULE = 8;
+
+	/* One side of a transform. Arrays have a stride of 1, interleaved floats
+	* point x, y, z (and w) at consecutive floats of the first element and
+	* have a stride of 3 (or 4 with w).
+	*/
+	struct TransformStream
+	{
+		float *x;
+		float *y;
+		float *z;
+		float *w;
+		long stride;		// Floats from one element to the next
+	};
+
+	// A structure of arrays
+	static TransformStream getArrayStream(const SoaSpan &span)
+	{
+		TransformStream stream = { span.x, span.y, span.z, span.w, 1 };
+		return stream;
+	}
+
+	// Interleaved floats, stride 3 or 4
+	static TransformStream getInterleavedStream(const float *floats, long stride)
+	{
+		float *base = const_cast<float*>(floats);
+		TransformStream stream = { base, base + 1, base + 2, stride == 4 ? base + 3 : NULL, stride };
+		return stream;
+	}
+
+	// Class constructor
+	SoaSpan::SoaSpan()
+		: x(NULL), y(NULL), z(NULL), w(NULL)
+	{
+	}
+
+	// Class constructor
+	SoaSpan::SoaSpan(float *x, float *y, float *z, float *w)
+		: x(x), y(y), z(z), w(w)
+	{
+	}
+
+	// Scalar kernel, the same operations in the same order as Point<T>::transform
+	// (its m[i][3] * w is m[i][3] exactly for w = 1) and Vector<T>::transform
+	static void transformScalar(const float m[4][4], const TransformStream &input, const TransformStream &output,
+		long first, long last, TransformMode mode)
+	{
+		for (long i = first; i < last; i++) {
+			float x = input.x[i * input.stride];
+			float y = input.y[i * input.stride];
+			float z = input.z[i * input.stride];
+
+			float outX = m[0][0] * x + m[0][1] * y + m[0][2] * z;
+			float outY = m[1][0] * x + m[1][1] * y + m[1][2] * z;
+			float outZ = m[2][0] * x + m[2][1] * y + m[2][2] * z;
+			if (mode != TRANSFORM_VECTORS) {
+				outX += m[0][3];
+				outY += m[1][3];
+				outZ += m[2][3];
+			}
+			if (mode == TRANSFORM_POINTS_4X4) {
+				output.w[i * output.stride] = m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3];
+			}
+			output.x[i * output.stride] = outX;
+			output.y[i * output.stride] = outY;
+			output.z[i * output.stride] = outZ;
+		}
+	}
+
+#if defined(FRAMEWORK_X86)
+	/* The SIMD kernels splat every matrix element into a register and work on
+	* 4 (SSE2) or 8 (AVX2) elements at a time, one coordinate per register.
+	* Interleaved triples are loaded as 4 float vectors and shuffled into x, y
+	* and z registers (and back), 4 elements per 128 bits, so the arithmetic is
+	* the same for both layouts. Whatever is left of a range goes to the scalar
+	* kernel.
+	*/
+
+	// Load 4 interleaved triples a = (x0 y0 z0 x1), b = (y1 z1 x2 y2), c = (z2 x3 y3 z3) as x, y and z
+	static inline void deinterleaveSse2(__m128 a, __m128 b, __m128 c, __m128 &x, __m128 &y, __m128 &z)
+	{
+		__m128 xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));		// x2 y2 x3 y3
+		__m128 yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));		// y0 z0 y1 z1
+		x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+	// The inverse of deinterleaveSse2
+	static inline void interleaveSse2(__m128 x, __m128 y, __m128 z, __m128 &a, __m128 &b, __m128 &c)
+	{
+		__m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));		// x0 x2 y0 y2
+		__m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));		// y1 y3 z1 z3
+		__m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));		// z0 z2 x1 x3
+		a = _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+		b = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		c = _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+
+	// Array loads and stores
+	template <bool isAligned>
+	static inline __m128 loadSse2(const float *p)
+	{
+		return isAligned ? _mm_load_ps(p) : _mm_loadu_ps(p);
+	}
+
+	template <bool isAligned>
+	static inline void storeSse2(float *p, __m128 value)
+	{
+		if (isAligned) {
+			_mm_store_ps(p, value);
+		}
+		else {
+			_mm_storeu_ps(p, value);
+		}
+	}
+
+	// SSE2 kernel, 4 elements per block
+	template <bool isInterleavedInput, bool isInterleavedOutput, bool isAligned>
+	static void transformSse2(const float m[4][4], const TransformStream &input, const TransformStream &output,
+		long first, long last, TransformMode mode)
+	{
+		const long BLOCK = 4;
+		__m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]), m02 = _mm_set1_ps(m[0][2]), m03 = _mm_set1_ps(m[0][3]);
+		__m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]), m12 = _mm_set1_ps(m[1][2]), m13 = _mm_set1_ps(m[1][3]);
+		__m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]), m22 = _mm_set1_ps(m[2][2]), m23 = _mm_set1_ps(m[2][3]);
+		__m128 m30 = _mm_set1_ps(m[3][0]), m31 = _mm_set1_ps(m[3][1]), m32 = _mm_set1_ps(m[3][2]), m33 = _mm_set1_ps(m[3][3]);
+		bool isPoint = mode != TRANSFORM_VECTORS;
+		bool hasW = mode == TRANSFORM_POINTS_4X4;
+
+		long i = first;
+		for (; i + BLOCK <= last; i += BLOCK) {
+			__m128 x, y, z;
+			if (isInterleavedInput) {
+				const float *in = input.x + i * input.stride;
+				deinterleaveSse2(_mm_loadu_ps(in), _mm_loadu_ps(in + 4), _mm_loadu_ps(in + 8), x, y, z);
+			}
+			else {
+				x = loadSse2<isAligned>(input.x + i);
+				y = loadSse2<isAligned>(input.y + i);
+				z = loadSse2<isAligned>(input.z + i);
+			}
+
+			__m128 outX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m01, y)), _mm_mul_ps(m02, z));
+			__m128 outY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, x), _mm_mul_ps(m11, y)), _mm_mul_ps(m12, z));
+			__m128 outZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, x), _mm_mul_ps(m21, y)), _mm_mul_ps(m22, z));
+			__m128 outW = _mm_setzero_ps();
+			if (isPoint) {
+				outX = _mm_add_ps(outX, m03);
+				outY = _mm_add_ps(outY, m13);
+				outZ = _mm_add_ps(outZ, m23);
+			}
+			if (hasW) {
+				outW = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m30, x), _mm_mul_ps(m31, y)), _mm_mul_ps(m32, z)), m33);
+			}
+
+			if (isInterleavedOutput) {
+				float *out = output.x + i * output.stride;
+				if (hasW) {
+					_MM_TRANSPOSE4_PS(outX, outY, outZ, outW);
+					_mm_storeu_ps(out, outX);
+					_mm_storeu_ps(out + 4, outY);
+					_mm_storeu_ps(out + 8, outZ);
+					_mm_storeu_ps(out + 12, outW);
+				}
+				else {
+					__m128 a, b, c;
+					interleaveSse2(outX, outY, outZ, a, b, c);
+					_mm_storeu_ps(out, a);
+					_mm_storeu_ps(out + 4, b);
+					_mm_storeu_ps(out + 8, c);
+				}
+			}
+			else {
+				storeSse2<isAligned>(output.x + i, outX);
+				storeSse2<isAligned>(output.y + i, outY);
+				storeSse2<isAligned>(output.z + i, outZ);
+				if (hasW) {
+					storeSse2<isAligned>(output.w + i, outW);
+				}
+			}
+		}
+
+		transformScalar(m, input, output, i, last, mode);
+	}
+
+	// Load 8 interleaved triples, the first 4 in the low halves and the next 4 in the high halves
+	FRAMEWORK_TARGET_AVX2 static inline void deinterleaveAvx2(const float *in, __m256 &x, __m256 &y, __m256 &z)
+	{
+		__m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in)), _mm_loadu_ps(in + 12), 1);
+		__m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in + 4)), _mm_loadu_ps(in + 16), 1);
+		__m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in + 8)), _mm_loadu_ps(in + 20), 1);
+		__m256 xy = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+		__m256 yz = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+		x = _mm256_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		z = _mm256_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+	// The inverse of deinterleaveAvx2
+	FRAMEWORK_TARGET_AVX2 static inline void interleaveAvx2(float *out, __m256 x, __m256 y, __m256 z)
+	{
+		__m256 xy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+		__m256 a = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 b = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		__m256 c = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm256_storeu_ps(out, _mm256_permute2f128_ps(a, b, 0x20));
+		_mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(c, a, 0x30));
+		_mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(b, c, 0x31));
+	}
+
+	// Write 8 (x,y,z,w) quadruples
+	FRAMEWORK_TARGET_AVX2 static inline void interleaveQuadsAvx2(float *out, __m256 x, __m256 y, __m256 z, __m256 w)
+	{
+		// 4x4 transpose inside each 128-bit half, like _MM_TRANSPOSE4_PS
+		__m256 t0 = _mm256_unpacklo_ps(x, y), t1 = _mm256_unpackhi_ps(x, y);
+		__m256 t2 = _mm256_unpacklo_ps(z, w), t3 = _mm256_unpackhi_ps(z, w);
+		__m256 r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));		// Elements 0 and 4
+		__m256 r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));		// 1 and 5
+		__m256 r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));		// 2 and 6
+		__m256 r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));		// 3 and 7
+		_mm256_storeu_ps(out, _mm256_permute2f128_ps(r0, r1, 0x20));
+		_mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(r2, r3, 0x20));
+		_mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(r0, r1, 0x31));
+		_mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(r2, r3, 0x31));
+	}
+
+	// Array loads and stores
+	template <bool isAligned>
+	FRAMEWORK_TARGET_AVX2 static inline __m256 loadAvx2(const float *p)
+	{
+		return isAligned ? _mm256_load_ps(p) : _mm256_loadu_ps(p);
+	}
+
+	template <bool isAligned>
+	FRAMEWORK_TARGET_AVX2 static inline void storeAvx2(float *p, __m256 value)
+	{
+		if (isAligned) {
+			_mm256_store_ps(p, value);
+		}
+		else {
+			_mm256_storeu_ps(p, value);
+		}
+	}
+
+	// AVX2 kernel, 8 elements per block. Multiplies and adds are kept apart,
+	// fused ones would round differently from the other kernels.
+	template <bool isInterleavedInput, bool isInterleavedOutput, bool isAligned>
+	FRAMEWORK_TARGET_AVX2 static void transformAvx2(const float m[4][4], const TransformStream &input, const TransformStream &output,
+		long first, long last, TransformMode mode)
+	{
+		const long BLOCK = 8;
+		__m256 m00 = _mm256_set1_ps(m[0][0]), m01 = _mm256_set1_ps(m[0][1]), m02 = _mm256_set1_ps(m[0][2]), m03 = _mm256_set1_ps(m[0][3]);
+		__m256 m10 = _mm256_set1_ps(m[1][0]), m11 = _mm256_set1_ps(m[1][1]), m12 = _mm256_set1_ps(m[1][2]), m13 = _mm256_set1_ps(m[1][3]);
+		__m256 m20 = _mm256_set1_ps(m[2][0]), m21 = _mm256_set1_ps(m[2][1]), m22 = _mm256_set1_ps(m[2][2]), m23 = _mm256_set1_ps(m[2][3]);
+		__m256 m30 = _mm256_set1_ps(m[3][0]), m31 = _mm256_set1_ps(m[3][1]), m32 = _mm256_set1_ps(m[3][2]), m33 = _mm256_set1_ps(m[3][3]);
+		bool isPoint = mode != TRANSFORM_VECTORS;
+		bool hasW = mode == TRANSFORM_POINTS_4X4;
+
+		long i = first;
+		for (; i + BLOCK <= last; i += BLOCK) {
+			__m256 x, y, z;
+			if (isInterleavedInput) {
+				deinterleaveAvx2(input.x + i * input.stride, x, y, z);
+			}
+			else {
+				x = loadAvx2<isAligned>(input.x + i);
+				y = loadAvx2<isAligned>(input.y + i);
+				z = loadAvx2<isAligned>(input.z + i);
+			}
+
+			__m256 outX = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, x), _mm256_mul_ps(m01, y)), _mm256_mul_ps(m02, z));
+			__m256 outY = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m10, x), _mm256_mul_ps(m11, y)), _mm256_mul_ps(m12, z));
+			__m256 outZ = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m20, x), _mm256_mul_ps(m21, y)), _mm256_mul_ps(m22, z));
+			__m256 outW = _mm256_setzero_ps();
+			if (isPoint) {
+				outX = _mm256_add_ps(outX, m03);
+				outY = _mm256_add_ps(outY, m13);
+				outZ = _mm256_add_ps(outZ, m23);
+			}
+			if (hasW) {
+				outW = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m30, x), _mm256_mul_ps(m31, y)), _mm256_mul_ps(m32, z)), m33);
+			}
+
+			if (isInterleavedOutput) {
+				float *out = output.x + i * output.stride;
+				if (hasW) {
+					interleaveQuadsAvx2(out, outX, outY, outZ, outW);
+				}
+				else {
+					interleaveAvx2(out, outX, outY, outZ);
+				}
+			}
+			else {
+				storeAvx2<isAligned>(output.x + i, outX);
+				storeAvx2<isAligned>(output.y + i, outY);
+				storeAvx2<isAligned>(output.z + i, outZ);
+				if (hasW) {
+					storeAvx2<isAligned>(output.w + i, outW);
+				}
+			}
+		}
+
+		transformScalar(m, input, output, i, last, mode);
+	}
+#endif
+
+	// Run the chosen kernel over [first, last)
+	static void transformRange(const float m[4][4], const TransformStream &input, const TransformStream &output,
+		long first, long last, TransformMode mode, SimdLevel level, bool isAligned)
+	{
+#if defined(FRAMEWORK_X86)
+		bool isInterleavedInput = input.stride != 1;
+		bool isInterleavedOutput = output.stride != 1;
+		if (level == SIMD_AVX2) {
+			if (!isInterleavedInput && !isInterleavedOutput) {
+				isAligned ? transformAvx2<false, false, true>(m, input, output, first, last, mode)
+					: transformAvx2<false, false, false>(m, input, output, first, last, mode);
+				return;
+			}
+			if (isInterleavedInput && isInterleavedOutput) {
+				transformAvx2<true, true, false>(m, input, output, first, last, mode);
+				return;
+			}
+			if (isInterleavedInput) {
+				isAligned ? transformAvx2<true, false, true>(m, input, output, first, last, mode)
+					: transformAvx2<true, false, false>(m, input, output, first, last, mode);
+				return;
+			}
+		}
+		if (level == SIMD_SSE2) {
+			if (!isInterleavedInput && !isInterleavedOutput) {
+				isAligned ? transformSse2<false, false, true>(m, input, output, first, last, mode)
+					: transformSse2<false, false, false>(m, input, output, first, last, mode);
+				return;
+			}
+			if (isInterleavedInput && isInterleavedOutput) {
+				transformSse2<true, true, false>(m, input, output, first, last, mode);
+				return;
+			}
+			if (isInterleavedInput) {
+				isAligned ? transformSse2<true, false, true>(m, input, output, first, last, mode)
+					: transformSse2<true, false, false>(m, input, output, first, last, mode);
+				return;
+			}
+		}
+#endif
+		transformScalar(m, input, output, first, last, mode);
+	}
+
+	// Run body(first, last) over [0, count) in blocks, on the pool when the work is large enough
+	template <typename Body>
+	static void forEachBlock(ThreadPool &pool, long count, const Body &body)
+	{
+		long blockCount = 1;
+		if (count >= MIN_PARALLEL_TRANSFORM) {
+			blockCount = (long)pool.getThreadCount() * TRANSFORM_BLOCKS_PER_THREAD;
+		}
+		long blockSize = (count + blockCount - 1) / blockCount;
+		blockSize = (blockSize + TRANSFORM_BLOCK_GRANULE - 1) / TRANSFORM_BLOCK_GRANULE * TRANSFORM_BLOCK_GRANULE;
+		blockCount = (count + blockSize - 1) / blockSize;
+		if (blockCount <= 1) {
+			body(0, count);
+			return;
+		}
+
+		pool.parallelFor(blockCount, [&](long block) {
+			long first = block * blockSize;
+			long last = first + blockSize < count ? first + blockSize : count;
+			body(first, last);
+		});
+	}
+
+	// Clamp the level to what the CPU has and run the range
+	static void transformStreams(const Mat4 &matrix, const TransformStream &input, const TransformStream &output,
+		long count, TransformMode mode, SimdLevel level, bool isAligned)
+	{
+		if (count <= 0) {
+			return;
+		}
+		SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		if (level > bestLevel) {
+			level = bestLevel;
+		}
+		float rows[4][4];
+		matrix.toRowMajor(rows);
+		transformRange(rows, input, output, 0, count, mode, level, isAligned);
+	}
+
+	// Same as transformStreams, in blocks over a pool
+	static void transformStreams(const Mat4 &matrix, const TransformStream &input, const TransformStream &output,
+		long count, TransformMode mode, bool isAligned, ThreadPool &pool)
+	{
+		if (count <= 0) {
+			return;
+		}
+		static const SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		float rows[4][4];
+		matrix.toRowMajor(rows);
+		forEachBlock(pool, count, [&](long first, long last) {
+			transformRange(rows, input, output, first, last, mode, bestLevel, isAligned);
+		});
+	}
+
+	// Check one array
+	static bool isAlignedArray(const float *array)
+	{
+		return array == NULL || ((size_t)array & (TRANSFORM_ALIGNMENT - 1)) == 0;
+	}
+
+	// Check every array of a span
+	bool isTransformAligned(const SoaSpan &span)
+	{
+		return isAlignedArray(span.x) && isAlignedArray(span.y) && isAlignedArray(span.z) && isAlignedArray(span.w);
+	}
+
+	// Transform arrays with the unaligned kernel
+	void transformSoa(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode)
+	{
+		static const SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		transformStreams(matrix, getArrayStream(input), getArrayStream(output), count, mode, bestLevel, false);
+	}
+
+	// Transform aligned arrays
+	void transformSoaAligned(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode)
+	{
+		static const SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		transformStreams(matrix, getArrayStream(input), getArrayStream(output), count, mode, bestLevel, true);
+	}
+
+	// Transform arrays on a pool
+	void transformSoa(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode, ThreadPool &pool)
+	{
+		bool isAligned = isTransformAligned(input) && isTransformAligned(output);
+		transformStreams(matrix, getArrayStream(input), getArrayStream(output), count, mode, isAligned, pool);
+	}
+
+	// Transform arrays with a chosen kernel
+	void transformSoa(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode,
+		SimdLevel level, bool isAligned)
+	{
+		isAligned = isAligned && isTransformAligned(input) && isTransformAligned(output);
+		transformStreams(matrix, getArrayStream(input), getArrayStream(output), count, mode, level, isAligned);
+	}
+
+	// Transform triples
+	void transformInterleaved(const Mat4 &matrix, const float *input, float *output, long count, TransformMode mode)
+	{
+		static const SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		transformInterleaved(matrix, input, output, count, mode, bestLevel);
+	}
+
+	// Transform triples on a pool
+	void transformInterleaved(const Mat4 &matrix, const float *input, float *output, long count, TransformMode mode, ThreadPool &pool)
+	{
+		transformStreams(matrix, getInterleavedStream(input, 3), getInterleavedStream(output, mode == TRANSFORM_POINTS_4X4 ? 4 : 3),
+			count, mode, false, pool);
+	}
+
+	// Transform triples with a chosen kernel
+	void transformInterleaved(const Mat4 &matrix, const float *input, float *output, long count, TransformMode mode, SimdLevel level)
+	{
+		transformStreams(matrix, getInterleavedStream(input, 3), getInterleavedStream(output, mode == TRANSFORM_POINTS_4X4 ? 4 : 3),
+			count, mode, level, false);
+	}
+
+	// Transform triples into arrays on a pool
+	void transformInterleavedToSoa(const Mat4 &matrix, const float *input, const SoaSpan &output, long count, TransformMode mode, ThreadPool &pool)
+	{
+		transformStreams(matrix, getInterleavedStream(input, 3), getArrayStream(output), count, mode, isTransformAligned(output), pool);
+	}
+
+	// Over-allocate and keep what malloc returned just below the aligned array
+	float* allocateTransformArray(long count)
+	{
+		void *block = malloc(count * sizeof(float) + TRANSFORM_ALIGNMENT + sizeof(void*));
+		if (block == NULL) {
+			return NULL;
+		}
+		size_t address = ((size_t)block + sizeof(void*) + TRANSFORM_ALIGNMENT - 1) & ~(TRANSFORM_ALIGNMENT - 1);
+		((void**)address)[-1] = block;
+		return (float*)address;
+	}
+
+	// Free what allocateTransformArray() returned
+	void freeTransformArray(float *array)
+	{
+		if (array != NULL) {
+			free(((void**)array)[-1]);
+		}
+	}
+
+}	// namespace
@@ -0,0 +1,100 @@
+#pragma once
+// BatchTransform.h is the file that holds
+// the kernels applying one matrix to large
+// sets of points and vectors at once.
+
+// Header guards
+#ifndef BATCH_TRANSFORM_H_
+#define BATCH_TRANSFORM_H_
+
+// Include headers
+#include <stddef.h>
+
+#include "CpuFeatures.h"
+#include "SimdMath.h"
+#include "ThreadPool.h"
+
+namespace applicationFramework {
+
+	// What part of the matrix is applied, and to what
+	enum TransformMode {
+		TRANSFORM_POINTS_4X4 = 0,	// (x,y,z,1) by the whole matrix, writes x, y, z and w
+		TRANSFORM_POINTS_3X4 = 1,	// (x,y,z,1) by the top three rows, as Point<T>::transform
+		TRANSFORM_VECTORS = 2		// (x,y,z,0) by the top left 3x3, as Vector<T>::transform
+	};
+
+	// Bytes the arrays given to the aligned kernels must be aligned to
+	static const size_t TRANSFORM_ALIGNMENT = 32;
+
+	/* Points or vectors as a structure of arrays, element i is (x[i], y[i], z[i]).
+	* Inputs never have a w (it is 1 for points and 0 for vectors), outputs only
+	* need one for TRANSFORM_POINTS_4X4. Input and output may be the same arrays.
+	*/
+	struct SoaSpan
+	{
+		SoaSpan();
+		SoaSpan(float *x, float *y, float *z, float *w = NULL);
+
+		float *x;
+		float *y;
+		float *z;
+		float *w;		// NULL unless written by TRANSFORM_POINTS_4X4
+	};
+
+	/** Transforms a structure of arrays with the best kernel for this CPU, on the calling
+	thread. Every kernel gives bit-identical results (the same multiplies and adds in the
+	same order as Point<T>::transform, no fused multiply-add).
+	@param matrix - the transform, e.g. Mat4::fromRowMajor of the matrix Point<T>::transform takes
+	@param input, output - the spans, any alignment
+	@param count - the number of elements
+	@param mode - which part of the matrix is applied
+	*/
+	void transformSoa(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode);
+
+	/** Same as transformSoa, with aligned loads and stores. Every array must start on
+	TRANSFORM_ALIGNMENT bytes, e.g. from allocateTransformArray().
+	*/
+	void transformSoaAligned(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode);
+
+	/** Same as transformSoa, spread over a pool for large counts. The aligned kernels are
+	used when every array is aligned, threads get blocks that keep that alignment.
+	*/
+	void transformSoa(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode, ThreadPool &pool);
+
+	/** Same as transformSoa, with the kernel chosen by the caller (used to benchmark).
+	Levels the CPU does not support fall back to the best one it does, and arrays that
+	are not aligned fall back to the unaligned loads.
+	*/
+	void transformSoa(const Mat4 &matrix, const SoaSpan &input, const SoaSpan &output, long count, TransformMode mode,
+		SimdLevel level, bool isAligned);
+
+	/** Transforms interleaved (x,y,z) triples, such as the Obj_Loader buffers. Blocks are
+	turned into structures of arrays in registers, so the same kernels do the math.
+	@param input - 3 floats per element
+	@param output - 3 floats per element, 4 (x,y,z,w) for TRANSFORM_POINTS_4X4, may be input when it is 3
+	*/
+	void transformInterleaved(const Mat4 &matrix, const float *input, float *output, long count, TransformMode mode);
+
+	/** Same as transformInterleaved, spread over a pool for large counts */
+	void transformInterleaved(const Mat4 &matrix, const float *input, float *output, long count, TransformMode mode, ThreadPool &pool);
+
+	/** Same as transformInterleaved, with the kernel chosen by the caller (used to benchmark) */
+	void transformInterleaved(const Mat4 &matrix, const float *input, float *output, long count, TransformMode mode, SimdLevel level);
+
+	/** Transforms interleaved (x,y,z) triples into a structure of arrays, spread over a pool
+	for large counts, e.g. to cull or pick against a model's vertices
+	*/
+	void transformInterleavedToSoa(const Mat4 &matrix, const float *input, const SoaSpan &output, long count, TransformMode mode, ThreadPool &pool);
+
+	/** Checks that every array of a span starts on TRANSFORM_ALIGNMENT bytes */
+	bool isTransformAligned(const SoaSpan &span);
+
+	/** Allocates an array of floats aligned for the aligned kernels, NULL if there is no memory.
+	Free it with freeTransformArray().
+	*/
+	float* allocateTransformArray(long count);
+	void freeTransformArray(float *array);
+
+}	// namespace
+
+#endif
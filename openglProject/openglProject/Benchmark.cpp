@@ -0,0 +1,1498 @@
+// Benchmark.cpp is the file that holds
+// the implementation for the command
+// line benchmarks.
+
+// Include headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <time.h>
+#include <chrono>
+
+#include "Benchmark.h"
+#include "Application.h"
+#include "Obj_Loader.h"
+#include "PerformanceTimer.h"
+#include "ThreadPool.h"
+#include "MeshNormals.h"
+#include "ObjStreamReader.h"
+#include "MeshOptimizer.h"
+#include "MeshLodChain.h"
+#include "QuantizedMesh.h"
+#include "MeshletSet.h"
+#include "Frustum.h"
+#include "Scene.h"
+#include "SoftwareRasterizer.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "FrameStatistics.h"
+#include "Logger.h"
+#include "SimdMath.h"
+#include "BatchTransform.h"
+
+namespace applicationFramework {
+
+	// Number of times each benchmark is repeated, the best run is reported
+	static const int BENCHMARK_REPETITIONS = 3;
+
+	// Print the available benchmarks
+	static int printBenchmarkUsage()
+	{
+		printf("Usage: openglProject --benchmark <name> [arguments]\n");
+		printf("  obj <file.obj>    Obj_Loader load paths (MB/s), thread scaling and indexing\n");
+		printf("  cache <file.obj>  Obj_Loader::loadCached cold (parse + write) vs warm (mapped)\n");
+		printf("  normals [count]   Face normal kernels (triangles/sec)\n");
+		printf("  smooth <file.obj> Smooth vertex normals, thread scaling and determinism\n");
+		printf("  stream <file.obj> [budget MB]  ObjStreamReader throughput, memory and spilling\n");
+		printf("  vcache <file.obj> Vertex cache (ACMR/ATVR) and fetch optimization\n");
+		printf("  lod <file.obj>    Quadric simplification LOD chain and selection by distance\n");
+		printf("  quantize <file.obj>  Quantized vertex memory, error against its bound and decode speed\n");
+		printf("  meshlets <file.obj>  Meshlet build and frustum/back-face cluster culling throughput\n");
+		printf("  bvh <file.obj>    SAH BVH build and mouse picking rays (microseconds per pick)\n");
+		printf("  scene [count]     Instance frustum culling kernels (milliseconds per cull)\n");
+		printf("  raster <file.obj> [width height] [out.ppm]  CPU rasterizer frame time per SIMD level and thread count\n");
+		printf("  pacer [fps] [frames]  Frame pacing jitter and CPU use, busy wait vs sleep then spin\n");
+		printf("  profiler [count]  Cost of a profiler zone (nanoseconds per zone) idle and capturing\n");
+		printf("  timer [count]     PerformanceTimer clock read cost and resolution per clock source\n");
+		printf("  framestats [count]  FrameStatistics record cost and percentile error against sorting\n");
+		printf("  logger [count]    Caller cost of a log line, flushed fprintf vs the async Logger\n");
+		printf("  math [count]      Vec4/Mat4 transforms, products and inverses vs the scalar templates\n");
+		printf("  transform [count] Batch point transforms per SIMD level, alignment, layout and thread count\n");
+		return 1;
+	}
+
+	int runBenchmark(int argc, char *argv[])
+	{
+		if (argc >= 2 && strcmp(argv[0], "obj") == 0) {
+			return benchmarkObjLoader(argv[1]);
+		}
+		if (argc >= 2 && strcmp(argv[0], "cache") == 0) {
+			return benchmarkMeshCache(argv[1]);
+		}
+		if (argc >= 1 && strcmp(argv[0], "normals") == 0) {
+			return benchmarkFaceNormals(argc >= 2 ? atol(argv[1]) : 1000000);
+		}
+		if (argc >= 2 && strcmp(argv[0], "smooth") == 0) {
+			return benchmarkVertexNormals(argv[1]);
+		}
+		if (argc >= 2 && strcmp(argv[0], "stream") == 0) {
+			return benchmarkObjStream(argv[1], argc >= 3 ? atol(argv[2]) : 64);
+		}
+		if (argc >= 2 && strcmp(argv[0], "vcache") == 0) {
+			return benchmarkVertexCache(argv[1]);
+		}
+		if (argc >= 2 && strcmp(argv[0], "lod") == 0) {
+			return benchmarkLodChain(argv[1]);
+		}
+		if (argc >= 2 && strcmp(argv[0], "quantize") == 0) {
+			return benchmarkQuantizedMesh(argv[1]);
+		}
+		if (argc >= 2 && strcmp(argv[0], "meshlets") == 0) {
+			return benchmarkMeshlets(argv[1]);
+		}
+		if (argc >= 2 && strcmp(argv[0], "bvh") == 0) {
+			return benchmarkTriangleBvh(argv[1]);
+		}
+		if (argc >= 1 && strcmp(argv[0], "scene") == 0) {
+			return benchmarkSceneCulling(argc >= 2 ? atol(argv[1]) : 100000);
+		}
+		if (argc >= 1 && strcmp(argv[0], "pacer") == 0) {
+			return benchmarkFramePacer(argc >= 2 ? atof(argv[1]) : Application::FPS, argc >= 3 ? atol(argv[2]) : 300);
+		}
+		if (argc >= 1 && strcmp(argv[0], "profiler") == 0) {
+			return benchmarkProfiler(argc >= 2 ? atol(argv[1]) : 1000000);
+		}
+		if (argc >= 1 && strcmp(argv[0], "framestats") == 0) {
+			return benchmarkFrameStatistics(argc >= 2 ? atol(argv[1]) : 1000000);
+		}
+		if (argc >= 1 && strcmp(argv[0], "logger") == 0) {
+			return benchmarkLogger(argc >= 2 ? atol(argv[1]) : 100000);
+		}
+		if (argc >= 1 && strcmp(argv[0], "math") == 0) {
+			return benchmarkSimdMath(argc >= 2 ? atol(argv[1]) : 1000000);
+		}
+		if (argc >= 1 && strcmp(argv[0], "transform") == 0) {
+			return benchmarkBatchTransform(argc >= 2 ? atol(argv[1]) : 1000000);
+		}
+		if (argc >= 1 && strcmp(argv[0], "timer") == 0) {
+			return benchmarkTimer(argc >= 2 ? atol(argv[1]) : 10000000);
+		}
+		if (argc >= 2 && strcmp(argv[0], "raster") == 0) {
+			return benchmarkSoftwareRasterizer(argv[1], argc >= 4 ? atoi(argv[2]) : Application::WINDOW_WIDTH,
+				argc >= 4 ? atoi(argv[3]) : Application::WINDOW_HEIGHT, argc >= 5 ? argv[4] : NULL);
+		}
+		return printBenchmarkUsage();
+	}
+
+	int benchmarkObjLoader(char *filename)
+	{
+		FILE *file = fopen(filename, "rb");
+		if (file == NULL) {
+			printf("Unable to open %s\n", filename);
+			return 1;
+		}
+		fseek(file, 0, SEEK_END);
+		double megabytes = ftell(file) / (1024.0 * 1024.0);
+		fclose(file);
+
+		const char *names[] = { "Obj_Loader::load", "Obj_Loader::loadMapped", "Obj_Loader::loadParallel" };
+		for (int loader = 0; loader < 3; loader++) {
+			double bestSeconds = 0;
+			long triangles = 0;
+			size_t peakBytes = 0;
+
+			for (int run = 0; run < BENCHMARK_REPETITIONS; run++) {
+				Obj_Loader model;
+				PerformanceTimer timer;
+
+				timer.start();
+				if (loader == 0) {
+					model.load(filename);
+				}
+				else if (loader == 1) {
+					model.loadMapped(filename);
+				}
+				else {
+					model.loadParallel(filename);
+				}
+				timer.stop();
+
+				double seconds = timer.getElapsedSeconds();
+				if (run == 0 || seconds < bestSeconds) {
+					bestSeconds = seconds;
+				}
+				triangles = model.TotalConnectedTriangles / TOTAL_FLOATS_IN_TRIANGLE;
+				peakBytes = model.getPeakBytes();
+				model.release();
+			}
+
+			printf("%-24s %10.2f ms %10.2f MB/s %12ld triangles %10.2f MB peak\n", names[loader],
+				bestSeconds * 1000.0, bestSeconds > 0 ? megabytes / bestSeconds : 0.0, triangles,
+				peakBytes / (1024.0 * 1024.0));
+		}
+
+		Obj_Loader model;
+		model.loadMapped(filename);
+
+		unsigned int maxThreads = ThreadPool::getSharedPool().getThreadCount();
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {	// Scaling, checked against loadMapped
+			Obj_Loader parallelModel;
+			PerformanceTimer timer;
+			timer.start();
+			parallelModel.loadParallel(filename, threads);
+			timer.stop();
+
+			bool isIdentical = parallelModel.TotalConnectedTriangles == model.TotalConnectedTriangles &&
+				memcmp(parallelModel.Faces_Triangles, model.Faces_Triangles, model.TotalConnectedTriangles * sizeof(float)) == 0 &&
+				memcmp(parallelModel.normals, model.normals, model.TotalConnectedTriangles * sizeof(float)) == 0;
+			printf("loadParallel %3u threads %10.2f ms %10.2f MB/s %s\n", threads, timer.getElapsedMilliseconds(),
+				megabytes / timer.getElapsedSeconds(), isIdentical ? "identical" : "MISMATCH");
+			parallelModel.release();
+		}
+
+		size_t triangleBytes = 2 * model.TotalConnectedTriangles * sizeof(float);	// Report what indexing saves on this model
+		PerformanceTimer timer;
+		timer.start();
+		model.buildIndexedMesh();
+		timer.stop();
+		printf("%-24s %10.2f ms %10ld vertices %12.2f MB (triangles %.2f MB)\n", "Obj_Loader::buildIndexedMesh",
+			timer.getElapsedMilliseconds(), model.indexedMesh.vertexCount,
+			model.indexedMesh.getSizeInBytes() / (1024.0 * 1024.0), triangleBytes / (1024.0 * 1024.0));
+		model.release();
+		return 0;
+	}
+
+	int benchmarkMeshCache(char *filename)
+	{
+		remove(MeshCache::getCachePath(filename).c_str());			// Start cold
+		const char *names[] = { "loadCached (cold)", "loadCached (warm)" };
+
+		for (int run = 0; run < 2; run++) {
+			Obj_Loader model;
+			PerformanceTimer timer;
+			timer.start();
+			int result = model.loadCached(filename);
+			timer.stop();
+
+			if (result != 0) {
+				return 1;
+			}
+			printf("%-24s %10.3f ms %12ld triangles %10.2f MB\n", names[run], timer.getElapsedMilliseconds(),
+				model.indexedMesh.indexCount / 3, model.indexedMesh.getSizeInBytes() / (1024.0 * 1024.0));
+			model.release();
+		}
+		return 0;
+	}
+
+	int benchmarkFaceNormals(long triangleCount)
+	{
+		if (triangleCount <= 0) {
+			return printBenchmarkUsage();
+		}
+
+		std::vector<float> triangles(triangleCount * 9);
+		srand(1);
+		for (size_t i = 0; i < triangles.size(); i++) {
+			triangles[i] = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+		}
+		for (long i = 0; i < triangleCount; i += 100) {				// 1% degenerate faces
+			for (int k = 3; k < 9; k++) {
+				triangles[i * 9 + k] = triangles[i * 9 + k % 3];
+			}
+		}
+
+		std::vector<float> reference(triangleCount * 9);
+		std::vector<float> normals(triangleCount * 9);
+		computeFaceNormals(&triangles[0], &reference[0], triangleCount, SIMD_SCALAR);
+
+		for (int level = SIMD_SCALAR; level <= CpuFeatures::getSimdLevel(); level++) {
+			double bestSeconds = 0;
+			for (int run = 0; run < BENCHMARK_REPETITIONS; run++) {
+				PerformanceTimer timer;
+				timer.start();
+				computeFaceNormals(&triangles[0], &normals[0], triangleCount, (SimdLevel)level);
+				timer.stop();
+				if (run == 0 || timer.getElapsedSeconds() < bestSeconds) {
+					bestSeconds = timer.getElapsedSeconds();
+				}
+			}
+
+			bool isIdentical = memcmp(&normals[0], &reference[0], normals.size() * sizeof(float)) == 0;
+			printf("computeFaceNormals %-6s %10.2f ms %10.2f Mtriangles/s %s\n", CpuFeatures::getSimdLevelName((SimdLevel)level),
+				bestSeconds * 1000.0, bestSeconds > 0 ? triangleCount / bestSeconds / 1e6 : 0.0,
+				isIdentical ? "identical" : "MISMATCH");
+		}
+		return 0;
+	}
+
+	int benchmarkVertexNormals(char *filename)
+	{
+		Obj_Loader model;
+		if (model.loadMapped(filename) != 0) {
+			return 1;
+		}
+		model.buildIndexedMesh(NORMALS_SMOOTH_AREA);		// Welded on position, so faces share vertices
+		IndexedMesh &mesh = model.indexedMesh;
+		printf("%ld vertices, %ld triangles\n", mesh.vertexCount, mesh.indexCount / 3);
+		if (mesh.vertexCount == 0) {
+			model.release();
+			return 1;
+		}
+
+		const char *names[] = { "area", "angle" };
+		const NormalMode modes[] = { NORMALS_SMOOTH_AREA, NORMALS_SMOOTH_ANGLE };
+		std::vector<float> reference(mesh.vertexCount * 3);
+		unsigned int maxThreads = ThreadPool::getSharedPool().getThreadCount();
+
+		for (int mode = 0; mode < 2; mode++) {
+			for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+				ThreadPool pool(threads);
+				double bestSeconds = 0;
+				for (int run = 0; run < BENCHMARK_REPETITIONS; run++) {
+					PerformanceTimer timer;
+					timer.start();
+					computeVertexNormals(mesh, modes[mode], pool);
+					timer.stop();
+
+					double seconds = timer.getElapsedSeconds();
+					if (run == 0 || seconds < bestSeconds) {
+						bestSeconds = seconds;
+					}
+				}
+
+				bool isIdentical = true;
+				if (threads == 1) {
+					memcpy(&reference[0], mesh.normals, reference.size() * sizeof(float));
+				}
+				else {
+					isIdentical = memcmp(&reference[0], mesh.normals, reference.size() * sizeof(float)) == 0;
+				}
+				printf("%-6s %3u threads %10.2f ms %10.2f Mvertices/s %s\n", names[mode], threads, bestSeconds * 1000.0,
+					bestSeconds > 0 ? mesh.vertexCount / bestSeconds / 1e6 : 0.0, isIdentical ? "identical" : "MISMATCH");
+			}
+		}
+
+		model.release();
+		return 0;
+	}
+
+	int benchmarkObjStream(char *filename, long budgetMegabytes)
+	{
+		if (budgetMegabytes <= 0) {
+			return printBenchmarkUsage();
+		}
+
+		FILE *file = fopen(filename, "rb");
+		if (file == NULL) {
+			printf("Unable to open %s\n", filename);
+			return 1;
+		}
+		fseek(file, 0, SEEK_END);
+		double megabytes = ftell(file) / (1024.0 * 1024.0);
+		fclose(file);
+
+		ObjStreamReader reader((size_t)budgetMegabytes << 20);
+		long batches = 0;
+		PerformanceTimer timer;
+		timer.start();
+		int result = reader.read(filename, [&](const float*, const float*, long) {
+			batches++;
+			return true;
+		});
+		timer.stop();
+		if (result != 0) {
+			printf("ObjStreamReader::read failed (%d)\n", result);
+			return 1;
+		}
+
+		printf("%-24s %10.2f ms %10.2f MB/s %12ld triangles %8ld batches\n", "ObjStreamReader::read",
+			timer.getElapsedMilliseconds(), megabytes / timer.getElapsedSeconds(), reader.getTriangleCount(), batches);
+		size_t budgetBytes = (size_t)budgetMegabytes << 20;
+		printf("%-24s %10.2f MB budget %7.2f MB peak (%5.1f%% of budget%s) %7.2f MB spilled %8ld page reads\n", "",
+			(double)budgetMegabytes, reader.getPeakBytes() / (1024.0 * 1024.0), 100.0 * reader.getPeakBytes() / budgetBytes,
+			reader.getPeakBytes() > budgetBytes ? ", OVER" : "", reader.getSpilledBytes() / (1024.0 * 1024.0), reader.getPageReads());
+
+		Obj_Loader model;												// Check every batch against the in-memory loader
+		model.loadMapped(filename);
+		long checked = 0;
+		bool isIdentical = true;
+		reader.read(filename, [&](const float *triangles, const float *normals, long triangleCount) {
+			size_t offset = checked * TOTAL_FLOATS_IN_TRIANGLE;
+			size_t bytes = triangleCount * TOTAL_FLOATS_IN_TRIANGLE * sizeof(float);
+			checked += triangleCount;
+			isIdentical = isIdentical && checked * TOTAL_FLOATS_IN_TRIANGLE <= model.TotalConnectedTriangles &&
+				memcmp(triangles, model.Faces_Triangles + offset, bytes) == 0 &&
+				memcmp(normals, model.normals + offset, bytes) == 0;
+			return true;
+		});
+		isIdentical = isIdentical && checked * TOTAL_FLOATS_IN_TRIANGLE == model.TotalConnectedTriangles;
+		printf("%-24s %s\n", "against loadMapped", isIdentical ? "identical" : "MISMATCH");
+		model.release();
+		return 0;
+	}
+
+	// Print the cache statistics of a mesh for a few cache sizes
+	static void printVertexCacheStats(const char *name, const IndexedMesh &mesh)
+	{
+		const int cacheSizes[] = { 16, VERTEX_CACHE_SIZE };
+		for (int i = 0; i < 2; i++) {
+			VertexCacheStats stats = analyzeVertexCache(mesh, cacheSizes[i]);
+			printf("%-24s cache %2d  ACMR %6.3f  ATVR %6.3f\n", name, cacheSizes[i], stats.acmr, stats.atvr);
+		}
+	}
+
+	int benchmarkVertexCache(char *filename)
+	{
+		Obj_Loader model;
+		if (model.loadMapped(filename) != 0) {
+			return 1;
+		}
+		model.buildIndexedMesh(NORMALS_SMOOTH_AREA);		// Shared vertices, or there is nothing to reuse
+		model.releaseTriangles();
+		IndexedMesh &mesh = model.indexedMesh;
+		printf("%ld vertices, %ld triangles\n", mesh.vertexCount, mesh.indexCount / 3);
+		printVertexCacheStats("file order", mesh);
+
+		PerformanceTimer timer;
+		timer.start();
+		optimizeVertexCache(mesh);
+		timer.stop();
+		printf("%-24s %10.2f ms %10.2f Mtriangles/s\n", "optimizeVertexCache", timer.getElapsedMilliseconds(),
+			mesh.indexCount / 3 / timer.getElapsedSeconds() / 1e6);
+		printVertexCacheStats("optimized", mesh);
+
+		timer.start();
+		optimizeVertexFetch(mesh);
+		timer.stop();
+		printf("%-24s %10.2f ms\n", "optimizeVertexFetch", timer.getElapsedMilliseconds());
+		printVertexCacheStats("optimized + fetch", mesh);
+
+		model.release();
+		return 0;
+	}
+
+	int benchmarkLodChain(char *filename)
+	{
+		Obj_Loader model;
+		if (model.loadMapped(filename) != 0) {
+			return 1;
+		}
+		model.buildIndexedMesh(NORMALS_SMOOTH_AREA);
+		model.releaseTriangles();
+
+		const float ratios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+		PerformanceTimer timer;
+		timer.start();
+		model.buildLods(ratios, 4);
+		timer.stop();
+		printf("%-24s %10.2f ms %10d levels\n", "Obj_Loader::buildLods", timer.getElapsedMilliseconds(), model.lodChain.getLodCount());
+
+		for (int lod = 0; lod < model.lodChain.getLodCount(); lod++) {
+			printf("LOD %d %12ld triangles %12.6f error\n", lod,
+				(long)model.lodChain.getIndices(lod).size() / 3, model.lodChain.getError(lod));
+		}
+
+		// Walk the camera back from the model, as Application would see it
+		float radius = model.lodChain.getBoundingRadius();
+		Vector<float> center(0.0f, 0.0f, 0.0f);
+		for (float distance = 2.0f; distance <= 256.0f; distance *= 2.0f) {
+			Vector<float> eye(0.0f, 0.0f, -distance * radius);
+			int lod = model.lodChain.selectLod(eye, center, center, Application::FIELD_OF_VIEW, Application::WINDOW_HEIGHT);
+			printf("distance %8.1f radii %10.1f pixels  LOD %d\n", distance,
+				model.lodChain.getProjectedSize(eye, center, center, Application::FIELD_OF_VIEW, Application::WINDOW_HEIGHT), lod);
+		}
+
+		model.release();
+		return 0;
+	}
+
+	int benchmarkQuantizedMesh(char *filename)
+	{
+		Obj_Loader model;
+		if (model.loadMapped(filename) != 0) {
+			return 1;
+		}
+		model.buildIndexedMesh(NORMALS_SMOOTH_AREA);
+		model.releaseTriangles();
+		const IndexedMesh &mesh = model.indexedMesh;
+		size_t floatVertexBytes = mesh.vertexCount * 6 * sizeof(float);
+		printf("%ld vertices, %ld triangles\n", mesh.vertexCount, mesh.indexCount / 3);
+		printf("%-24s %10.2f MB vertices %10.2f MB total\n", "float", floatVertexBytes / 1048576.0,
+			mesh.getSizeInBytes() / 1048576.0);
+
+		const NormalPrecision precisions[] = { NORMAL_OCT16, NORMAL_OCT8 };
+		const char *names[] = { "16-bit oct normals", "8-bit oct normals" };
+		for (int i = 0; i < 2; i++) {
+			QuantizedMesh quantized;
+			PerformanceTimer timer;
+			timer.start();
+			quantized.build(mesh, precisions[i]);
+			timer.stop();
+			double buildMs = timer.getElapsedMilliseconds();
+
+			IndexedMesh decoded;
+			timer.start();
+			quantized.decode(decoded);
+			timer.stop();
+			double decodeMs = timer.getElapsedMilliseconds();
+
+			size_t vertexBytes = quantized.getSizeInBytes() - mesh.indexCount * mesh.indexSize;
+			QuantizationError error = quantized.measureError(mesh);
+			printf("%-24s %10.2f MB vertices %10.2f MB total %6.2fx smaller vertices\n", names[i],
+				vertexBytes / 1048576.0, quantized.getSizeInBytes() / 1048576.0, (double)floatVertexBytes / vertexBytes);
+			printf("%-24s %10.2f ms build %10.2f ms decode\n", "", buildMs, decodeMs);
+			printf("%-24s %12.3g position error (bound %.3g, %s) %8.4f degrees normal error\n", "",
+				error.maxPositionError, error.positionErrorBound,
+				error.maxPositionError <= error.positionErrorBound ? "within" : "EXCEEDED", error.maxNormalDegrees);
+		}
+
+		model.release();
+		return 0;
+	}
+
+	// Center and radius of the box around a mesh
+	static float getModelBounds(const IndexedMesh &mesh, Vector<float> &center)
+	{
+		float minimum[3] = { mesh.positions[0], mesh.positions[1], mesh.positions[2] };
+		float maximum[3] = { mesh.positions[0], mesh.positions[1], mesh.positions[2] };
+		for (long vertex = 1; vertex < mesh.vertexCount; vertex++) {
+			for (int axis = 0; axis < 3; axis++) {
+				float value = mesh.positions[vertex * 3 + axis];
+				minimum[axis] = value < minimum[axis] ? value : minimum[axis];
+				maximum[axis] = value > maximum[axis] ? value : maximum[axis];
+			}
+		}
+		center = Vector<float>((minimum[0] + maximum[0]) * 0.5f, (minimum[1] + maximum[1]) * 0.5f, (minimum[2] + maximum[2]) * 0.5f);
+		Vector<float> extent(maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2]);
+		return extent.length() * 0.5f;
+	}
+
+	// One of cameraCount eyes around a model, alternately inside and outside its sphere
+	static Vector<float> getOrbitEye(const Vector<float> &center, float radius, int camera, int cameraCount)
+	{
+		float yaw = camera * 2.0f * 3.14159265f / cameraCount;
+		float pitch = (camera % 8 - 3.5f) * 0.35f;
+		float distance = radius * (camera % 2 == 0 ? 0.8f : 2.0f);
+		return center + Vector<float>(cosf(yaw) * cosf(pitch), sinf(pitch), sinf(yaw) * cosf(pitch)) * distance;
+	}
+
+	// Count culled meshlets that hold a triangle the camera could see, a back-face culled
+	// one must face away everywhere, a frustum culled one must be behind a single plane
+	static long countWrongCulls(const MeshletSet &meshlets, const IndexedMesh &mesh, const Frustum &frustum,
+		const Vector<float> &eye, const std::vector<unsigned int> &visible)
+	{
+		std::vector<bool> isVisible(meshlets.getMeshletCount(), false);
+		for (size_t i = 0; i < visible.size(); i++) {
+			isVisible[visible[i]] = true;
+		}
+
+		long wrongCount = 0;
+		for (long m = 0; m < meshlets.getMeshletCount(); m++) {
+			if (isVisible[m]) {
+				continue;
+			}
+			const Meshlet &meshlet = meshlets.meshlets[m];
+			bool isBehindPlane = false;
+			for (int plane = 0; plane < FRUSTUM_PLANE_COUNT && !isBehindPlane; plane++) {
+				const float *p = frustum.getPlane(plane);
+				isBehindPlane = true;
+				for (unsigned int i = 0; i < meshlet.vertexCount && isBehindPlane; i++) {
+					const float *v = &mesh.positions[meshlets.meshletVertices[meshlet.vertexOffset + i] * 3];
+					isBehindPlane = p[0] * v[0] + p[1] * v[1] + p[2] * v[2] + p[3] < 0.0f;
+				}
+			}
+			if (isBehindPlane) {
+				continue;
+			}
+
+			bool isBackFacing = true;
+			for (unsigned int triangle = 0; triangle < meshlet.triangleCount && isBackFacing; triangle++) {
+				const unsigned char *local = &meshlets.meshletTriangles[meshlet.triangleOffset + triangle * 3];
+				const float *a = &mesh.positions[meshlets.meshletVertices[meshlet.vertexOffset + local[0]] * 3];
+				const float *b = &mesh.positions[meshlets.meshletVertices[meshlet.vertexOffset + local[1]] * 3];
+				const float *c = &mesh.positions[meshlets.meshletVertices[meshlet.vertexOffset + local[2]] * 3];
+				float normal[3];
+				Obj_Loader().calculateNormal(a, b, c, normal);
+				isBackFacing = normal[0] * (a[0] - eye.x) + normal[1] * (a[1] - eye.y) + normal[2] * (a[2] - eye.z) >= -1e-6f;
+			}
+			wrongCount += isBackFacing ? 0 : 1;
+		}
+		return wrongCount;
+	}
+
+	int benchmarkMeshlets(char *filename)
+	{
+		Obj_Loader model;
+		if (model.loadMapped(filename) != 0) {
+			return 1;
+		}
+		model.buildIndexedMesh(NORMALS_SMOOTH_AREA);
+		model.releaseTriangles();
+		model.optimizeIndexedMesh();						// Cache order keeps each meshlet's triangles together
+		const IndexedMesh &mesh = model.indexedMesh;
+
+		PerformanceTimer timer;
+		timer.start();
+		model.buildMeshlets();
+		timer.stop();
+		const MeshletSet &meshlets = model.meshletSet;
+		long meshletCount = meshlets.getMeshletCount();
+		printf("%ld vertices, %ld triangles\n", mesh.vertexCount, mesh.indexCount / 3);
+		printf("%-24s %10.2f ms %10ld meshlets %6.1f vertices %6.1f triangles each %8.2f MB\n", "Obj_Loader::buildMeshlets",
+			timer.getElapsedMilliseconds(), meshletCount, (double)meshlets.meshletVertices.size() / meshletCount,
+			(double)meshlets.meshletTriangles.size() / 3 / meshletCount, meshlets.getSizeInBytes() / 1048576.0);
+
+		// Orbit the camera around the model's bounding sphere, looking at its center
+		Vector<float> center;
+		float radius = getModelBounds(mesh, center);
+		const int cameraCount = 64;
+		const int passCount = 20;
+		std::vector<Frustum> frustums(cameraCount);
+		std::vector<Vector<float> > eyes(cameraCount);
+		for (int camera = 0; camera < cameraCount; camera++) {
+			eyes[camera] = getOrbitEye(center, radius, camera, cameraCount);
+			frustums[camera].setPerspective(eyes[camera], center, Vector<float>(0.0f, 1.0f, 0.0f), Application::FIELD_OF_VIEW,
+				(float)Application::WINDOW_WIDTH / Application::WINDOW_HEIGHT, radius * 0.01f, radius * 10.0f);
+		}
+
+		std::vector<unsigned int> visible;
+		MeshletCullStats total = { 0, 0, 0 };
+		long wrongCount = 0;
+		for (int camera = 0; camera < cameraCount; camera++) {
+			MeshletCullStats stats = meshlets.cull(frustums[camera], eyes[camera], visible);
+			total.visibleCount += stats.visibleCount;
+			total.frustumCulledCount += stats.frustumCulledCount;
+			total.backfaceCulledCount += stats.backfaceCulledCount;
+			wrongCount += countWrongCulls(meshlets, mesh, frustums[camera], eyes[camera], visible);
+		}
+		double tested = (double)meshletCount * cameraCount;
+		printf("%-24s %9.1f%% visible %9.1f%% frustum culled %9.1f%% back-face culled\n", "over the orbit",
+			100.0 * total.visibleCount / tested, 100.0 * total.frustumCulledCount / tested, 100.0 * total.backfaceCulledCount / tested);
+		printf("%-24s %10ld meshlets culled with a visible triangle\n", "brute force check", wrongCount);
+
+		double bestSeconds = 1e30;
+		for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+			timer.start();
+			for (int pass = 0; pass < passCount; pass++) {
+				for (int camera = 0; camera < cameraCount; camera++) {
+					meshlets.cull(frustums[camera], eyes[camera], visible);
+				}
+			}
+			timer.stop();
+			bestSeconds = timer.getElapsedSeconds() < bestSeconds ? timer.getElapsedSeconds() : bestSeconds;
+		}
+		printf("%-24s %10.3f ms per cull %10.2f Mmeshlets/s %10.2f Mtriangles/s\n", "MeshletSet::cull",
+			bestSeconds * 1000.0 / (passCount * cameraCount), tested * passCount / bestSeconds / 1e6,
+			tested * passCount / bestSeconds / 1e6 * meshlets.meshletTriangles.size() / 3 / meshletCount);
+
+		model.release();
+		return 0;
+	}
+
+	// Closest hit of a ray by testing every triangle, the reference for the BVH
+	static float intersectAllTriangles(const IndexedMesh &mesh, const float *origin, const float *direction)
+	{
+		float closest = FLT_MAX;
+		for (long triangle = 0; triangle < mesh.indexCount / 3; triangle++) {
+			const float *a = &mesh.positions[mesh.getIndex(triangle * 3) * 3];
+			const float *b = &mesh.positions[mesh.getIndex(triangle * 3 + 1) * 3];
+			const float *c = &mesh.positions[mesh.getIndex(triangle * 3 + 2) * 3];
+			Vector<float> edge1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+			Vector<float> edge2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+			Vector<float> rayDirection(direction[0], direction[1], direction[2]);
+			Vector<float> p = rayDirection.cross(edge2);
+			float determinant = edge1.dot(p);
+			if (determinant == 0.0f) {
+				continue;
+			}
+			Vector<float> t(origin[0] - a[0], origin[1] - a[1], origin[2] - a[2]);
+			float u = t.dot(p) / determinant;
+			Vector<float> q = t.cross(edge1);
+			float v = rayDirection.dot(q) / determinant;
+			float distance = edge2.dot(q) / determinant;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < closest) {
+				closest = distance;
+			}
+		}
+		return closest;
+	}
+
+	int benchmarkTriangleBvh(char *filename)
+	{
+		Obj_Loader model;
+		if (model.loadMapped(filename) != 0) {
+			return 1;
+		}
+		model.buildIndexedMesh(NORMALS_FLAT);
+		model.releaseTriangles();
+		const IndexedMesh &mesh = model.indexedMesh;
+		long triangleCount = mesh.indexCount / 3;
+
+		PerformanceTimer timer;
+		double bestSeconds = 1e30;
+		for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+			timer.start();
+			model.buildBvh();
+			timer.stop();
+			bestSeconds = timer.getElapsedSeconds() < bestSeconds ? timer.getElapsedSeconds() : bestSeconds;
+		}
+		const TriangleBvh &bvh = model.bvh;
+		printf("%ld triangles, %u threads\n", triangleCount, ThreadPool::getSharedPool().getThreadCount());
+		printf("%-24s %10.2f ms %10.2f Mtriangles/s %10ld nodes %8.2f MB\n", "Obj_Loader::buildBvh", bestSeconds * 1000.0,
+			triangleCount / bestSeconds / 1e6, bvh.getNodeCount(), bvh.getSizeInBytes() / 1048576.0);
+
+		// Pick through a grid of pixels from cameras around the model, as Application would
+		Vector<float> center;
+		float radius = getModelBounds(mesh, center);
+		const int cameraCount = 16;
+		const int pixelStep = 8;
+		Application camera;
+		std::vector<float> rays;
+		for (int i = 0; i < cameraCount; i++) {
+			Vector<float> eye = getOrbitEye(center, radius, i, cameraCount);
+			camera.setLookAt(eye.x, eye.y, eye.z, center.x, center.y, center.z, 0.0f, 1.0f, 0.0f);
+			for (int y = 0; y < Application::WINDOW_HEIGHT; y += pixelStep) {
+				for (int x = 0; x < Application::WINDOW_WIDTH; x += pixelStep) {
+					Vector<float> origin, direction;
+					camera.getPickRay(x, y, Application::WINDOW_WIDTH, Application::WINDOW_HEIGHT, origin, direction);
+					float ray[6] = { origin.x, origin.y, origin.z, direction.x, direction.y, direction.z };
+					rays.insert(rays.end(), ray, ray + 6);
+				}
+			}
+		}
+		long rayCount = (long)rays.size() / 6;
+
+		long hitCount = 0;
+		bestSeconds = 1e30;
+		for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+			hitCount = 0;
+			timer.start();
+			for (long ray = 0; ray < rayCount; ray++) {
+				RayHit hit;
+				hitCount += bvh.intersect(&rays[ray * 6], &rays[ray * 6 + 3], hit) ? 1 : 0;
+			}
+			timer.stop();
+			bestSeconds = timer.getElapsedSeconds() < bestSeconds ? timer.getElapsedSeconds() : bestSeconds;
+		}
+		printf("%-24s %10.3f us per pick %10.2f Mrays/s %9.1f%% hit\n", "TriangleBvh::intersect",
+			bestSeconds * 1e6 / rayCount, rayCount / bestSeconds / 1e6, 100.0 * hitCount / rayCount);
+
+		// Check a sample of the rays against every triangle
+		const long checkStep = rayCount / 200 > 0 ? rayCount / 200 : 1;
+		long checkedCount = 0, mismatchCount = 0;
+		for (long ray = 0; ray < rayCount; ray += checkStep) {
+			RayHit hit;
+			float distance = bvh.intersect(&rays[ray * 6], &rays[ray * 6 + 3], hit) ? hit.distance : FLT_MAX;
+			float expected = intersectAllTriangles(mesh, &rays[ray * 6], &rays[ray * 6 + 3]);
+			bool isSame = distance == expected || fabsf(distance - expected) <= 1e-5f * (expected > 1.0f ? expected : 1.0f);
+			mismatchCount += isSame ? 0 : 1;
+			checkedCount++;
+		}
+		printf("%-24s %10ld rays %10ld mismatches\n", "against brute force", checkedCount, mismatchCount);
+
+		model.release();
+		return 0;
+	}
+
+	int benchmarkSceneCulling(long instanceCount)
+	{
+		if (instanceCount <= 0) {
+			return printBenchmarkUsage();
+		}
+
+		// Unit boxes turned about a random axis, scaled and scattered through a cube
+		// reaching past the far plane, so every plane culls some of them
+		const float worldRadius = Application::FAR_PLANE * 0.6f;
+		const float boxMin[3] = { -0.5f, -0.5f, -0.5f };
+		const float boxMax[3] = { 0.5f, 0.5f, 0.5f };
+		Scene scene;
+		srand(1);
+		for (long i = 0; i < instanceCount; i++) {
+			Vector<float> axis(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX + 0.1f);
+			axis.normalize();
+			float angle = rand() / (float)RAND_MAX * 6.2831853f;
+			float scale = 0.5f + rand() / (float)RAND_MAX * 4.0f;
+			float c = cosf(angle), s = sinf(angle), t = 1.0f - c;
+			float x = axis.x, y = axis.y, z = axis.z;
+			float transform[16] = {
+				(t * x * x + c) * scale, (t * x * y + s * z) * scale, (t * x * z - s * y) * scale, 0.0f,
+				(t * x * y - s * z) * scale, (t * y * y + c) * scale, (t * y * z + s * x) * scale, 0.0f,
+				(t * x * z + s * y) * scale, (t * y * z - s * x) * scale, (t * z * z + c) * scale, 0.0f,
+				(rand() / (float)RAND_MAX * 2.0f - 1.0f) * worldRadius, (rand() / (float)RAND_MAX * 2.0f - 1.0f) * worldRadius,
+				(rand() / (float)RAND_MAX * 2.0f - 1.0f) * worldRadius, 1.0f };
+			scene.addInstance(NULL, boxMin, boxMax, transform);
+		}
+
+		// The application's projection, from cameras orbiting inside the cube
+		Vector<float> center(0.0f, 0.0f, 0.0f);
+		const int cameraCount = 64;
+		const int passCount = 10;
+		std::vector<Frustum> frustums(cameraCount);
+		for (int camera = 0; camera < cameraCount; camera++) {
+			frustums[camera].setPerspective(getOrbitEye(center, worldRadius * 0.5f, camera, cameraCount), center,
+				Vector<float>(0.0f, 1.0f, 0.0f), Application::FIELD_OF_VIEW,
+				(float)Application::WINDOW_WIDTH / Application::WINDOW_HEIGHT, Application::NEAR_PLANE, Application::FAR_PLANE);
+		}
+
+		// The scalar kernel is the reference, no box with its center in view may be culled
+		std::vector<std::vector<unsigned int> > reference(cameraCount);
+		long visibleTotal = 0;
+		long wrongCount = 0;
+		for (int camera = 0; camera < cameraCount; camera++) {
+			visibleTotal += scene.cull(frustums[camera], reference[camera], SIMD_SCALAR);
+			std::vector<bool> isVisible(instanceCount, false);
+			for (size_t i = 0; i < reference[camera].size(); i++) {
+				isVisible[reference[camera][i]] = true;
+			}
+			for (long i = 0; i < instanceCount; i++) {
+				const float *transform = scene.getInstance((unsigned int)i).transform;
+				if (!isVisible[i] && frustums[camera].isSphereVisible(&transform[12], 0.0f)) {
+					wrongCount++;
+				}
+			}
+		}
+		printf("%ld instances\n", instanceCount);
+		printf("%-24s %9.1f%% visible %10ld culled with their center in view\n", "over the orbit",
+			100.0 * visibleTotal / ((double)instanceCount * cameraCount), wrongCount);
+
+		std::vector<unsigned int> visible;
+		for (int level = SIMD_SCALAR; level <= CpuFeatures::getSimdLevel(); level++) {
+			bool isIdentical = true;
+			double bestSeconds = 1e30;
+			for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+				PerformanceTimer timer;
+				timer.start();
+				for (int pass = 0; pass < passCount; pass++) {
+					for (int camera = 0; camera < cameraCount; camera++) {
+						scene.cull(frustums[camera], visible, (SimdLevel)level);
+					}
+				}
+				timer.stop();
+				bestSeconds = timer.getElapsedSeconds() < bestSeconds ? timer.getElapsedSeconds() : bestSeconds;
+			}
+			for (int camera = 0; camera < cameraCount; camera++) {
+				scene.cull(frustums[camera], visible, (SimdLevel)level);
+				isIdentical = isIdentical && visible == reference[camera];
+			}
+
+			double cullSeconds = bestSeconds / (passCount * cameraCount);
+			printf("Scene::cull %-12s %10.3f ms per cull %10.2f Minstances/s %s\n", CpuFeatures::getSimdLevelName((SimdLevel)level),
+				cullSeconds * 1000.0, instanceCount / cullSeconds / 1e6, isIdentical ? "identical" : "MISMATCH");
+		}
+		return 0;
+	}
+
+	// FNV-1a over the color and depth buffers, to compare frames
+	static unsigned int hashFramebuffer(const SoftwareRasterizer &rasterizer)
+	{
+		unsigned int hash = 2166136261u;
+		for (int y = 0; y < rasterizer.getHeight(); y++) {
+			const unsigned char *colors = (const unsigned char*)(rasterizer.getColorBuffer() + (size_t)y * rasterizer.getStride());
+			const unsigned char *depths = (const unsigned char*)(rasterizer.getDepthBuffer() + (size_t)y * rasterizer.getStride());
+			for (int i = 0; i < rasterizer.getWidth() * 4; i++) {
+				hash = (hash ^ colors[i]) * 16777619u;
+				hash = (hash ^ depths[i]) * 16777619u;
+			}
+		}
+		return hash;
+	}
+
+	// Draw one frame per camera, returning the best time of a frame over the repetitions
+	static double renderOrbit(SoftwareRasterizer &rasterizer, const Obj_Loader &model, const std::vector<Vector<float> > &eyes,
+		const Vector<float> &center, float radius, std::vector<unsigned int> &hashes, long &triangleCount)
+	{
+		double bestSeconds = 1e30;
+		hashes.resize(eyes.size());
+		for (int run = 0; run < BENCHMARK_REPETITIONS; run++) {
+			double seconds = 0;
+			triangleCount = 0;
+			for (size_t camera = 0; camera < eyes.size(); camera++) {
+				PerformanceTimer timer;
+				timer.start();
+				rasterizer.setCamera(eyes[camera], center, Vector<float>(0.0f, 1.0f, 0.0f), Application::FIELD_OF_VIEW,
+					(float)rasterizer.getWidth() / rasterizer.getHeight(), radius * 0.01f, radius * 10.0f);
+				rasterizer.clear();
+				triangleCount += rasterizer.draw(model);
+				timer.stop();
+				seconds += timer.getElapsedSeconds();
+				hashes[camera] = hashFramebuffer(rasterizer);
+			}
+			bestSeconds = seconds < bestSeconds ? seconds : bestSeconds;
+		}
+		return bestSeconds / eyes.size();
+	}
+
+	int benchmarkSoftwareRasterizer(char *filename, int width, int height, const char *imageFilename)
+	{
+		Obj_Loader model;
+		if (model.loadMapped(filename) != 0) {
+			return 1;
+		}
+		model.buildIndexedMesh(NORMALS_SMOOTH_AREA);
+		model.releaseTriangles();
+		model.optimizeIndexedMesh();
+		const IndexedMesh &mesh = model.indexedMesh;
+		printf("%ld vertices, %ld triangles, %dx%d\n", mesh.vertexCount, mesh.indexCount / 3, width, height);
+
+		SoftwareRasterizer rasterizer;
+		if (mesh.vertexCount == 0 || !rasterizer.resize(width, height)) {
+			model.release();
+			return 1;
+		}
+
+		// Cameras orbiting the model, inside and outside its sphere
+		Vector<float> center;
+		float radius = getModelBounds(mesh, center);
+		const int cameraCount = 16;
+		std::vector<Vector<float> > eyes(cameraCount);
+		for (int camera = 0; camera < cameraCount; camera++) {
+			eyes[camera] = getOrbitEye(center, radius, camera, cameraCount);
+		}
+
+		// Every SIMD level must draw the same frames as the scalar kernel
+		std::vector<unsigned int> reference, hashes;
+		long triangleCount = 0;
+		for (int level = SIMD_SCALAR; level <= CpuFeatures::getSimdLevel(); level++) {
+			rasterizer.setSimdLevel((SimdLevel)level);
+			double seconds = renderOrbit(rasterizer, model, eyes, center, radius, hashes, triangleCount);
+			if (level == SIMD_SCALAR) {
+				reference = hashes;
+			}
+			printf("SoftwareRasterizer %-6s %10.2f ms per frame %8.1f fps %10.2f Mtriangles/s %s\n",
+				CpuFeatures::getSimdLevelName((SimdLevel)level), seconds * 1000.0, 1.0 / seconds,
+				(double)triangleCount / cameraCount / seconds / 1e6, hashes == reference ? "identical" : "MISMATCH");
+		}
+
+		// Thread scaling at the best level, the frames must not depend on the thread count
+		unsigned int maxThreads = ThreadPool::getSharedPool().getThreadCount();
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			ThreadPool pool(threads);
+			SoftwareRasterizer threaded(pool);
+			threaded.resize(width, height);
+			double seconds = renderOrbit(threaded, model, eyes, center, radius, hashes, triangleCount);
+			printf("SoftwareRasterizer %2u threads %7.2f ms per frame %8.1f fps %s\n", threads,
+				seconds * 1000.0, 1.0 / seconds, hashes == reference ? "identical" : "MISMATCH");
+		}
+
+		if (imageFilename != NULL) {
+			rasterizer.setCamera(eyes[1], center, Vector<float>(0.0f, 1.0f, 0.0f), Application::FIELD_OF_VIEW,
+				(float)width / height, radius * 0.01f, radius * 10.0f);
+			rasterizer.clear();
+			rasterizer.draw(model);
+			printf("%s %s\n", rasterizer.writePpm(imageFilename) ? "Wrote" : "Unable to write", imageFilename);
+		}
+
+		model.release();
+		return 0;
+	}
+
+	int benchmarkFramePacer(double framesPerSecond, long frameCount)
+	{
+		if (framesPerSecond <= 0 || frameCount <= 1) {
+			return printBenchmarkUsage();
+		}
+
+		// The busy wait is what the GLUT idle loop used to do, then sleeping with two step sizes
+		const char *names[] = { "busy wait", "sleep 1 ms + spin", "sleep 0.25 ms + spin" };
+		const bool sleeps[] = { false, true, true };
+		const double steps[] = { 1.0, 1.0, 0.25 };
+		for (int mode = 0; mode < 3; mode++) {
+			FramePacer pacer(framesPerSecond);
+			pacer.setSleepEnabled(sleeps[mode]);
+			pacer.setSleepStep(steps[mode]);
+
+			PerformanceTimer wallTimer;
+			wallTimer.start();
+			clock_t cpuStart = clock();			// Process CPU time on POSIX (wall time on Windows)
+			for (long frame = 0; frame < frameCount; frame++) {
+				pacer.waitForNextFrame();
+			}
+			double cpuSeconds = (double)(clock() - cpuStart) / CLOCKS_PER_SEC;
+			wallTimer.stop();
+
+			FramePacerStats stats = pacer.getStats();
+			printf("%-22s %8.3f ms interval %8.3f ms jitter %8.3f ms max %8.3f ms late %6.1f%% CPU\n", names[mode],
+				stats.meanIntervalMs, stats.jitterMs, stats.maxIntervalMs, stats.meanLatenessMs,
+				100.0 * cpuSeconds / wallTimer.getElapsedSeconds());
+		}
+		return 0;
+	}
+
+	// Open and close zones in a loop, the count keeps the loop from being removed
+	static long runProfileZones(long zoneCount)
+	{
+		volatile long counter = 0;
+		for (long zone = 0; zone < zoneCount; zone++) {
+			PROFILE_ZONE("benchmarkProfiler");
+			counter = counter + 1;
+		}
+		return counter;
+	}
+
+	int benchmarkProfiler(long zoneCount)
+	{
+		if (zoneCount <= 0) {
+			return printBenchmarkUsage();
+		}
+		bool wasCapturing = Profiler::isCapturing();
+
+		// Idle, capturing on one thread, then capturing on every pool thread at once
+		const char *names[] = { "idle", "capturing", "capturing, all threads" };
+		ThreadPool &pool = ThreadPool::getSharedPool();
+		unsigned int threadCount = pool.getThreadCount() + 1;
+		for (int mode = 0; mode < 3; mode++) {
+			if (mode == 0) {
+				Profiler::stopCapture();
+			}
+			else {
+				Profiler::startCapture();
+			}
+
+			double best = DBL_MAX;
+			for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+				PerformanceTimer timer;
+				timer.start();
+				if (mode < 2) {
+					runProfileZones(zoneCount);
+				}
+				else {
+					pool.parallelFor(threadCount, [zoneCount](long) { runProfileZones(zoneCount); });
+				}
+				timer.stop();
+				best = timer.getElapsedSeconds() < best ? timer.getElapsedSeconds() : best;
+			}
+			long zones = mode < 2 ? zoneCount : zoneCount * (long)threadCount;
+			printf("PROFILE_ZONE %-24s %8.2f ns per zone %10.1f M zones/sec\n", names[mode],
+				best * 1e9 / zoneCount, zones / best / 1e6);
+		}
+
+#if !FRAMEWORK_PROFILER
+		printf("Profiling is compiled out (FRAMEWORK_PROFILER is 0)\n");
+#endif
+		Profiler::stopCapture();
+		Profiler::clear();
+		if (wasCapturing) {
+			Profiler::startCapture();
+		}
+		return 0;
+	}
+
+	// Read the standard library's monotonic clock in nanoseconds, for comparison
+	static long long readSteadyClock()
+	{
+		return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int benchmarkTimer(long readCount)
+	{
+		if (readCount <= 1) {
+			return printBenchmarkUsage();
+		}
+		TimerSource previous = PerformanceTimer::getSource();
+
+		// Each clock reads back to back, the smallest step between reads is its resolution
+		const TimerSource sources[] = { TIMER_SOURCE_OS, TIMER_SOURCE_TSC };
+		for (int source = 0; source < 3; source++) {
+			const char *name = source < 2 ? PerformanceTimer::getSourceName(sources[source]) : "std::chrono::steady_clock";
+			if (source < 2 && !PerformanceTimer::setSource(sources[source])) {
+				printf("%-26s not available on this machine\n", name);
+				continue;
+			}
+
+			double best = DBL_MAX;
+			long long resolution = 0;
+			long backwardCount = 0;
+			for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+				long long last = source < 2 ? PerformanceTimer::getTimestamp() : readSteadyClock();
+				long long first = last;
+				for (long read = 1; read < readCount; read++) {
+					long long now = source < 2 ? PerformanceTimer::getTimestamp() : readSteadyClock();
+					if (now > last && (resolution == 0 || now - last < resolution)) {
+						resolution = now - last;
+					}
+					backwardCount += now < last ? 1 : 0;
+					last = now;
+				}
+				double seconds = (last - first) / 1e9;
+				best = seconds < best ? seconds : best;
+			}
+			printf("%-26s %7.2f ns per read, resolution %lld ns, %ld backward steps\n", name,
+				best * 1e9 / (readCount - 1), resolution, backwardCount);
+		}
+
+		if (PerformanceTimer::getTscFrequency() > 0.0) {
+			printf("TSC calibrated at %.3f MHz\n", PerformanceTimer::getTscFrequency() / 1e6);
+		}
+		PerformanceTimer::setSource(previous);
+		return 0;
+	}
+
+	int benchmarkFrameStatistics(long frameCount)
+	{
+		if (frameCount <= 0) {
+			return printBenchmarkUsage();
+		}
+
+		// Frames around the target with noise and a tail of hitches, as a loaded machine gives
+		double target = Application::FRAME_TIME / 1000.0;
+		std::vector<double> frames(frameCount);
+		srand(1);
+		for (long frame = 0; frame < frameCount; frame++) {
+			double noise = (rand() / (double)RAND_MAX - 0.5) * 0.2;
+			double hitch = rand() % 1000 == 0 ? (double)(2 + rand() % 10) : (rand() % 50 == 0 ? 1.6 : 1.0);
+			frames[frame] = target * (1.0 + noise) * hitch;
+		}
+
+		FrameStatistics statistics(Application::FRAME_TIME);
+		double best = DBL_MAX;
+		for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+			statistics.reset();
+			PerformanceTimer timer;
+			timer.start();
+			for (long frame = 0; frame < frameCount; frame++) {
+				statistics.recordFrame(frames[frame]);
+			}
+			timer.stop();
+			best = timer.getElapsedSeconds() < best ? timer.getElapsedSeconds() : best;
+		}
+		printf("FrameStatistics::recordFrame %8.2f ns per frame, %u windows\n", best * 1e9 / frameCount,
+			(unsigned int)statistics.getWindows().size());
+
+		// The histogram against the exact percentiles of the rounded frame times
+		std::vector<double> sorted(frameCount);
+		for (long frame = 0; frame < frameCount; frame++) {
+			sorted[frame] = floor(frames[frame] * 1e6 + 0.5) / 1000.0;
+		}
+		std::sort(sorted.begin(), sorted.end());
+		FrameWindowStats total = statistics.getTotal();
+		const double percentiles[] = { 50.0, 95.0, 99.0, 99.9 };
+		const double measured[] = { total.p50Ms, total.p95Ms, total.p99Ms, total.p999Ms };
+		for (int i = 0; i < 4; i++) {
+			long rank = (long)(percentiles[i] / 100.0 * frameCount + 0.5);
+			double exact = sorted[rank < 1 ? 0 : (rank > frameCount ? frameCount - 1 : rank - 1)];
+			printf("p%-5g %9.3f ms histogram %9.3f ms exact %6.2f%% error\n", percentiles[i], measured[i], exact,
+				100.0 * fabs(measured[i] - exact) / exact);
+		}
+		statistics.printReport();
+		return 0;
+	}
+
+	int benchmarkLogger(long messageCount)
+	{
+		if (messageCount <= 0) {
+			return printBenchmarkUsage();
+		}
+		FILE *file = tmpfile();
+		if (file == NULL) {
+			printf("Unable to create a temporary file\n");
+			return 1;
+		}
+
+		// What the framework did before: format, write and flush on the calling thread (std::endl)
+		double best = DBL_MAX;
+		for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+			PerformanceTimer timer;
+			timer.start();
+			for (long message = 0; message < messageCount; message++) {
+				fprintf(file, "MouseMove: x: %ld y: %ld\n", message, messageCount - message);
+				fflush(file);
+			}
+			timer.stop();
+			best = timer.getElapsedSeconds() < best ? timer.getElapsedSeconds() : best;
+		}
+		printf("%-28s %8.1f ns per message\n", "fprintf + fflush", best * 1e9 / messageCount);
+
+		// The caller only formats into the queue, then the writer catches up
+		Logger::setOutput(file);
+		ThreadPool &pool = ThreadPool::getSharedPool();
+		unsigned int threadCount = pool.getThreadCount() + 1;
+		for (int mode = 0; mode < 2; mode++) {
+			best = DBL_MAX;
+			double flushSeconds = 0.0;
+			unsigned long long dropped = Logger::getDroppedCount();
+			for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+				PerformanceTimer timer;
+				timer.start();
+				if (mode == 0) {
+					for (long message = 0; message < messageCount; message++) {
+						Logger::write(LOG_LEVEL_INFO, "MouseMove: x: %ld y: %ld", message, messageCount - message);
+					}
+				}
+				else {
+					pool.parallelFor(threadCount, [messageCount, threadCount](long thread) {
+						for (long message = thread; message < messageCount; message += threadCount) {
+							Logger::write(LOG_LEVEL_INFO, "MouseMove: x: %ld y: %ld", message, messageCount - message);
+						}
+					});
+				}
+				timer.stop();
+				PerformanceTimer flushTimer;
+				flushTimer.start();
+				Logger::flush();
+				flushTimer.stop();
+				if (timer.getElapsedSeconds() < best) {
+					best = timer.getElapsedSeconds();
+					flushSeconds = flushTimer.getElapsedSeconds();
+				}
+			}
+			dropped = Logger::getDroppedCount() - dropped;
+			printf("%-28s %8.1f ns per message, %.2f ms to drain, %llu of %ld dropped\n",
+				mode == 0 ? "Logger" : "Logger, all threads", best * 1e9 / messageCount, flushSeconds * 1000.0,
+				dropped, messageCount * BENCHMARK_REPETITIONS);
+		}
+
+		Logger::flush();
+		Logger::setOutput(NULL);
+		fclose(file);
+		return 0;
+	}
+
+	// A random row major matrix, an affine transform unless it is made projective
+	static void getRandomMatrix(float matrix[4][4], bool isProjective)
+	{
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 4; column++) {
+				matrix[row][column] = rand() / (float)RAND_MAX * 2.0f - 1.0f + (row == column ? 3.0f : 0.0f);	// Kept well conditioned
+			}
+		}
+		if (!isProjective) {
+			matrix[3][0] = matrix[3][1] = matrix[3][2] = 0.0f;
+			matrix[3][3] = 1.0f;
+		}
+	}
+
+	// Multiply row major matrices the way a scalar template would
+	static void multiplyScalar(const float a[4][4], const float b[4][4], float result[4][4])
+	{
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 4; column++) {
+				result[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] + a[row][2] * b[2][column] + a[row][3] * b[3][column];
+			}
+		}
+	}
+
+	// Time a loop, keeping the best of the repetitions
+	template <class Body> static double timeBest(const Body &body)
+	{
+		double best = DBL_MAX;
+		for (int repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+			PerformanceTimer timer;
+			timer.start();
+			body();
+			timer.stop();
+			best = timer.getElapsedSeconds() < best ? timer.getElapsedSeconds() : best;
+		}
+		return best;
+	}
+
+	int benchmarkSimdMath(long count)
+	{
+		if (count <= 0) {
+			return printBenchmarkUsage();
+		}
+#if defined(FRAMEWORK_SIMD_SSE)
+		const char *backend = "sse";
+#elif defined(FRAMEWORK_SIMD_NEON)
+		const char *backend = "neon";
+#else
+		const char *backend = "scalar";
+#endif
+		printf("Vec4/Mat4 backend: %s\n", backend);
+
+		srand(1);
+		float rows[4][4];
+		getRandomMatrix(rows, false);
+		Mat4 matrix = Mat4::fromRowMajor(rows);
+
+		std::vector<Point<float> > points(count);
+		std::vector<Vector<float> > vectors(count);
+		for (long i = 0; i < count; i++) {
+			points[i] = Point<float>(rand() / (float)RAND_MAX * 10.0f, rand() / (float)RAND_MAX * 10.0f, rand() / (float)RAND_MAX * 10.0f);
+			vectors[i] = Vector<float>(points[i].x, points[i].y, points[i].z);
+		}
+
+		// Points and directions through the templates and through Mat4
+		std::vector<Point<float> > scalarPoints(count), simdPoints(count);
+		std::vector<Vector<float> > scalarVectors(count), simdVectors(count);
+		double scalarSeconds = timeBest([&]() {
+			for (long i = 0; i < count; i++) {
+				scalarPoints[i] = points[i];
+				scalarPoints[i].transform(rows);
+			}
+		});
+		double simdSeconds = timeBest([&]() {
+			for (long i = 0; i < count; i++) {
+				simdPoints[i] = matrix.transformPoint(points[i]);
+			}
+		});
+		float pointError = 0.0f;
+		for (long i = 0; i < count; i++) {
+			pointError = std::max(pointError, (float)fabs(scalarPoints[i].distance(simdPoints[i])));
+		}
+		printf("Point transform   scalar %7.2f ns  Mat4 %7.2f ns  %5.2fx  max difference %g\n", scalarSeconds * 1e9 / count,
+			simdSeconds * 1e9 / count, scalarSeconds / simdSeconds, pointError);
+
+		// The same points kept as four floats each, so they go straight into registers
+		std::vector<float> packed(count * 4), packedResult(count * 4);
+		for (long i = 0; i < count; i++) {
+			Vec4(points[i]).store(&packed[i * 4]);
+		}
+		simdSeconds = timeBest([&]() {
+			for (long i = 0; i < count; i++) {
+				(matrix * Vec4::load(&packed[i * 4])).store(&packedResult[i * 4]);
+			}
+		});
+		printf("Point, Vec4 array scalar %7.2f ns  Mat4 %7.2f ns  %5.2fx\n", scalarSeconds * 1e9 / count,
+			simdSeconds * 1e9 / count, scalarSeconds / simdSeconds);
+
+		scalarSeconds = timeBest([&]() {
+			for (long i = 0; i < count; i++) {
+				scalarVectors[i] = vectors[i];
+				scalarVectors[i].transform(rows);
+			}
+		});
+		simdSeconds = timeBest([&]() {
+			for (long i = 0; i < count; i++) {
+				simdVectors[i] = matrix.transformVector(vectors[i]);
+			}
+		});
+		float vectorError = 0.0f;
+		for (long i = 0; i < count; i++) {
+			vectorError = std::max(vectorError, (scalarVectors[i] - simdVectors[i]).length());
+		}
+		printf("Vector transform  scalar %7.2f ns  Mat4 %7.2f ns  %5.2fx  max difference %g\n", scalarSeconds * 1e9 / count,
+			simdSeconds * 1e9 / count, scalarSeconds / simdSeconds, vectorError);
+
+		// Products of one matrix with many, through a scalar loop and through Mat4. The
+		// matrices stay in cache and are passed over again, the arithmetic is what is timed
+		long productCount = count / 4 < 4096 ? (count / 4 > 0 ? count / 4 : 1) : 4096;
+		long passCount = count / 4 / productCount > 0 ? count / 4 / productCount : 1;
+		std::vector<float> rowMatrices(productCount * 16), scalarProducts(productCount * 16);
+		std::vector<Mat4> matrices(productCount), simdProducts(productCount);
+		for (long i = 0; i < productCount; i++) {
+			float random[4][4];
+			getRandomMatrix(random, true);
+			memcpy(&rowMatrices[i * 16], random, sizeof(random));
+			matrices[i] = Mat4::fromRowMajor(random);
+		}
+		scalarSeconds = timeBest([&]() {
+			for (long pass = 0; pass < passCount; pass++) {
+				for (long i = 0; i < productCount; i++) {
+					multiplyScalar(rows, (const float(*)[4])&rowMatrices[i * 16], (float(*)[4])&scalarProducts[i * 16]);
+				}
+			}
+		}) / passCount;
+		simdSeconds = timeBest([&]() {
+			for (long pass = 0; pass < passCount; pass++) {
+				for (long i = 0; i < productCount; i++) {
+					simdProducts[i] = matrix * matrices[i];
+				}
+			}
+		}) / passCount;
+		float productError = 0.0f;
+		for (long i = 0; i < productCount; i++) {
+			float product[4][4];
+			simdProducts[i].toRowMajor(product);
+			for (int element = 0; element < 16; element++) {
+				productError = std::max(productError, (float)fabs(product[element / 4][element % 4] - scalarProducts[i * 16 + element]));
+			}
+		}
+		printf("Matrix multiply   scalar %7.2f ns  Mat4 %7.2f ns  %5.2fx  max difference %g\n", scalarSeconds * 1e9 / productCount,
+			simdSeconds * 1e9 / productCount, scalarSeconds / simdSeconds, productError);
+
+		// Inverses of random (projective) matrices, checked by M * inverse(M) = I
+		long inverseCount = productCount;
+		std::vector<Mat4> inverses(inverseCount);
+		simdSeconds = timeBest([&]() {
+			for (long pass = 0; pass < passCount; pass++) {
+				for (long i = 0; i < inverseCount; i++) {
+					inverses[i] = matrices[i].inverse();
+				}
+			}
+		}) / passCount;
+		float inverseError = 0.0f;
+		for (long i = 0; i < inverseCount; i++) {
+			float identity[16];
+			(matrices[i] * inverses[i]).store(identity);
+			for (int element = 0; element < 16; element++) {
+				inverseError = std::max(inverseError, (float)fabs(identity[element] - (element % 5 == 0 ? 1.0f : 0.0f)));
+			}
+		}
+		printf("Matrix inverse                    Mat4 %7.2f ns           max |M * inverse - I| %g\n",
+			simdSeconds * 1e9 / inverseCount, inverseError);
+
+		// The camera: the eye goes to the origin, the center onto -z, near and far onto -1 and 1
+		Vector<float> eye(3.0f, 2.0f, 10.0f), center(0.0f, 1.0f, 0.0f), up(0.0f, 1.0f, 0.0f);
+		Mat4 camera;
+		simdSeconds = timeBest([&]() {
+			for (long i = 0; i < productCount; i++) {
+				camera = Mat4::perspective(Application::FIELD_OF_VIEW, 4.0f / 3.0f, Application::NEAR_PLANE, Application::FAR_PLANE + i * 1e-9f) *
+					Mat4::lookAt(eye, center, up);
+			}
+		});
+		Mat4 view = Mat4::lookAt(eye, center, up);
+		Vec4 eyeInView = view * Vec4(eye, 1.0f);
+		Vec4 centerInView = view * Vec4(center, 1.0f);
+		float distance = (center - eye).length();
+		Vec4 nearPoint = camera * Vec4(eye + (center - eye) * (Application::NEAR_PLANE / distance), 1.0f);
+		Vec4 farPoint = camera * Vec4(eye + (center - eye) * (Application::FAR_PLANE / distance), 1.0f);
+		float cameraError = std::max(eyeInView.length3(), (centerInView - Vec4(0.0f, 0.0f, -distance, 1.0f)).length3());
+		cameraError = std::max(cameraError, (float)fabs(nearPoint.getZ() / nearPoint.getW() + 1.0f));
+		cameraError = std::max(cameraError, (float)fabs(farPoint.getZ() / farPoint.getW() - 1.0f));
+		printf("lookAt * perspective              Mat4 %7.2f ns           max camera error %g\n",
+			simdSeconds * 1e9 / productCount, cameraError);
+		return 0;
+	}
+
+	int benchmarkBatchTransform(long count)
+	{
+		if (count <= 0) {
+			return printBenchmarkUsage();
+		}
+		srand(1);
+		float rows[4][4];
+		getRandomMatrix(rows, false);
+		Mat4 matrix = Mat4::fromRowMajor(rows);
+
+		// The same points as Point<float>s, as aligned arrays, as arrays one float past an
+		// alignment and as triples
+		std::vector<Point<float> > points(count), expected(count);
+		float *arrays[14];
+		for (int array = 0; array < 14; array++) {
+			arrays[array] = allocateTransformArray(count + 1);
+		}
+		SoaSpan aligned(arrays[0], arrays[1], arrays[2]);
+		SoaSpan alignedResult(arrays[3], arrays[4], arrays[5], arrays[6]);
+		SoaSpan unaligned(arrays[7] + 1, arrays[8] + 1, arrays[9] + 1);
+		SoaSpan unalignedResult(arrays[10] + 1, arrays[11] + 1, arrays[12] + 1, arrays[13] + 1);
+		std::vector<float> triples(count * 3), tripleResult(count * 4);
+		for (long i = 0; i < count; i++) {
+			points[i] = Point<float>(rand() / (float)RAND_MAX * 10.0f, rand() / (float)RAND_MAX * 10.0f, rand() / (float)RAND_MAX * 10.0f);
+			aligned.x[i] = unaligned.x[i] = triples[i * 3] = points[i].x;
+			aligned.y[i] = unaligned.y[i] = triples[i * 3 + 1] = points[i].y;
+			aligned.z[i] = unaligned.z[i] = triples[i * 3 + 2] = points[i].z;
+		}
+
+		double scalarSeconds = timeBest([&]() {
+			for (long i = 0; i < count; i++) {
+				expected[i] = points[i];
+				expected[i].transform(rows);
+			}
+		});
+		printf("%ld points, Point<float>::transform %.2f ns per point\n", count, scalarSeconds * 1e9 / count);
+
+		// Differences from Point<float>::transform, a 4 float stride reads the 4x4 results
+		auto getError = [&](const float *x, const float *y, const float *z, long stride) {
+			float error = 0.0f;
+			for (long i = 0; i < count; i++) {
+				error = std::max(error, (float)fabs(x[i * stride] - expected[i].x));
+				error = std::max(error, (float)fabs(y[i * stride] - expected[i].y));
+				error = std::max(error, (float)fabs(z[i * stride] - expected[i].z));
+			}
+			return error;
+		};
+		auto printRow = [&](const char *layout, const char *kernel, double seconds, float error) {
+			printf("%-12s %-16s %7.2f ns %8.2f Mpoints/s %6.2fx  max difference %g\n", layout, kernel, seconds * 1e9 / count,
+				count / seconds / 1e6, scalarSeconds / seconds, error);
+		};
+
+		// Every kernel on the calling thread, the 4x4 mode also writes w
+		const TransformMode modes[] = { TRANSFORM_POINTS_3X4, TRANSFORM_POINTS_4X4 };
+		for (int modeIndex = 0; modeIndex < 2; modeIndex++) {
+			TransformMode mode = modes[modeIndex];
+			Mat4 modeMatrix = matrix;
+			if (mode == TRANSFORM_POINTS_4X4) {		// A bottom row of (0,0,0,1), so x, y, z still match Point<T>::transform
+				modeMatrix = Mat4(Vec4(rows[0][0], rows[1][0], rows[2][0], 0.0f), Vec4(rows[0][1], rows[1][1], rows[2][1], 0.0f),
+					Vec4(rows[0][2], rows[1][2], rows[2][2], 0.0f), Vec4(rows[0][3], rows[1][3], rows[2][3], 1.0f));
+			}
+			printf("%s\n", mode == TRANSFORM_POINTS_3X4 ? "3x4 (x,y,z)" : "4x4 (x,y,z,w)");
+			for (int level = SIMD_SCALAR; level <= (int)CpuFeatures::getSimdLevel(); level++) {
+				const char *name = CpuFeatures::getSimdLevelName((SimdLevel)level);
+				double seconds = timeBest([&]() {
+					transformSoa(modeMatrix, unaligned, unalignedResult, count, mode, (SimdLevel)level, false);
+				});
+				printRow("arrays", name, seconds, getError(unalignedResult.x, unalignedResult.y, unalignedResult.z, 1));
+
+				seconds = timeBest([&]() {
+					transformSoa(modeMatrix, aligned, alignedResult, count, mode, (SimdLevel)level, true);
+				});
+				char kernel[32];
+				sprintf(kernel, "%s aligned", name);
+				printRow("arrays", kernel, seconds, getError(alignedResult.x, alignedResult.y, alignedResult.z, 1));
+
+				seconds = timeBest([&]() {
+					transformInterleaved(modeMatrix, &triples[0], &tripleResult[0], count, mode, (SimdLevel)level);
+				});
+				long stride = mode == TRANSFORM_POINTS_4X4 ? 4 : 3;
+				printRow("interleaved", name, seconds, getError(&tripleResult[0], &tripleResult[1], &tripleResult[2], stride));
+			}
+		}
+
+		// Thread scaling of the best kernels
+		unsigned int maxThreads = ThreadPool::getSharedPool().getThreadCount();
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			ThreadPool pool(threads);
+			char kernel[32];
+			sprintf(kernel, "%u threads", threads);
+			double seconds = timeBest([&]() {
+				transformSoa(matrix, aligned, alignedResult, count, TRANSFORM_POINTS_3X4, pool);
+			});
+			printRow("arrays", kernel, seconds, getError(alignedResult.x, alignedResult.y, alignedResult.z, 1));
+			seconds = timeBest([&]() {
+				transformInterleaved(matrix, &triples[0], &tripleResult[0], count, TRANSFORM_POINTS_3X4, pool);
+			});
+			printRow("interleaved", kernel, seconds, getError(&tripleResult[0], &tripleResult[1], &tripleResult[2], 3));
+		}
+
+		for (int array = 0; array < 14; array++) {
+			freeTransformArray(arrays[array]);
+		}
+		return 0;
+	}
+
+}	// namespace
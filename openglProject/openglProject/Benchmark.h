@@ -0,0 +1,140 @@
+#pragma once
+// Benchmark.h is the file that holds
+// the command line benchmarks used to
+// measure the framework's hot paths.
+
+// Header guards
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+namespace applicationFramework {
+
+	/** Runs the benchmark named by the first argument and prints the results.
+	Usage: openglProject --benchmark <name> [arguments]
+	@param argc - the number of arguments after --benchmark
+	@param argv - the arguments after --benchmark
+	@return the process exit code
+	*/
+	int runBenchmark(int argc, char *argv[]);
+
+	/** Compares the throughput (MB/s) of Obj_Loader::load and Obj_Loader::loadMapped.
+	@param filename - the obj model to load
+	*/
+	int benchmarkObjLoader(char *filename);
+
+	/** Times Obj_Loader::loadCached without a cache (parse and write it) and with one (map it).
+	@param filename - the obj model to load, its cache is deleted first
+	*/
+	int benchmarkMeshCache(char *filename);
+
+	/** Measures the face normal kernels in triangles per second and checks them against the scalar one.
+	@param triangleCount - the number of random triangles to generate
+	*/
+	int benchmarkFaceNormals(long triangleCount);
+
+	/** Times smooth vertex normals (area and angle weighted) over 1..N threads and checks
+	every thread count gives the same normals as one thread.
+	@param filename - the obj model to load
+	*/
+	int benchmarkVertexNormals(char *filename);
+
+	/** Streams a model through ObjStreamReader under a memory budget, reporting MB/s, peak
+	memory and spilling, and checks the batches against Obj_Loader::loadMapped.
+	@param filename - the obj model to stream
+	@param budgetMegabytes - the memory budget of the reader
+	*/
+	int benchmarkObjStream(char *filename, long budgetMegabytes);
+
+	/** Reports ACMR/ATVR of a model before and after the vertex cache and vertex fetch passes.
+	@param filename - the obj model to load
+	*/
+	int benchmarkVertexCache(char *filename);
+
+	/** Builds a LOD chain with quadric simplification and prints each level's triangles and error,
+	and the level picked as the camera moves away.
+	@param filename - the obj model to load
+	*/
+	int benchmarkLodChain(char *filename);
+
+	/** Quantizes a model with 8 and 16-bit octahedral normals and prints the vertex memory
+	against floats, the measured position and normal errors, and the build and decode times.
+	@param filename - the obj model to load
+	*/
+	int benchmarkQuantizedMesh(char *filename);
+
+	/** Builds meshlets, culls them from cameras orbiting the model and reports the culled share,
+	the cull time and a brute force check that no culled meshlet had a visible triangle.
+	@param filename - the obj model to load
+	*/
+	int benchmarkMeshlets(char *filename);
+
+	/** Builds a SAH BVH over a model, times pick rays unprojected through Application's camera
+	from around the model and checks a sample of them against every triangle.
+	@param filename - the obj model to load
+	*/
+	int benchmarkTriangleBvh(char *filename);
+
+	/** Culls scattered instance boxes against Application's projection from orbiting cameras,
+	timing each SIMD level and checking it against the scalar result.
+	@param instanceCount - the number of instances
+	*/
+	int benchmarkSceneCulling(long instanceCount);
+
+	/** Draws a model on the CPU from orbiting cameras, timing each SIMD level and thread
+	count and checking that all of them draw the same frames.
+	@param filename - the obj model to load
+	@param width, height - the framebuffer size
+	@param imageFilename - a PPM of one frame is written here, NULL for none
+	*/
+	int benchmarkSoftwareRasterizer(char *filename, int width, int height, const char *imageFilename);
+
+	/** Paces frames with FramePacer as a busy wait and with sleeping, reporting the
+	achieved interval, jitter and the process CPU use of each.
+	@param framesPerSecond - the target rate
+	@param frameCount - the number of frames to pace
+	*/
+	int benchmarkFramePacer(double framesPerSecond, long frameCount);
+
+	/** Times PROFILE_ZONE while not capturing, while capturing on one thread and while
+	every pool thread captures at once, reporting the nanoseconds each zone costs.
+	@param zoneCount - the number of zones each thread opens
+	*/
+	int benchmarkProfiler(long zoneCount);
+
+	/** Reads each PerformanceTimer clock source (and std::chrono::steady_clock) back to
+	back, reporting the nanoseconds per read, the resolution and any backward steps.
+	@param readCount - the number of reads per clock
+	*/
+	int benchmarkTimer(long readCount);
+
+	/** Records synthetic frame times (noise around FRAME_TIME with occasional hitches)
+	into FrameStatistics, reporting the cost per frame and the error of each
+	percentile against sorting the frames.
+	@param frameCount - the number of frames
+	*/
+	int benchmarkFrameStatistics(long frameCount);
+
+	/** Writes log lines to a temporary file with fprintf and fflush on the calling thread,
+	then through Logger from one thread and from every pool thread, reporting the
+	caller's cost per message, the time the writer takes to catch up and the drops.
+	@param messageCount - the number of messages per run
+	*/
+	int benchmarkLogger(long messageCount);
+
+	/** Transforms points and directions with Point<float>/Vector<float>::transform and
+	with Mat4, chains matrix products against a scalar loop, and times Mat4's inverse,
+	lookAt and perspective, reporting the speedup and the largest difference of each.
+	@param count - the number of points (a quarter as many matrices)
+	*/
+	int benchmarkSimdMath(long count);
+
+	/** Transforms points with Point<float>::transform and with the batch kernels, as
+	aligned and unaligned arrays and as interleaved triples, for every SIMD level and
+	thread count, reporting the speedup and the largest difference of each.
+	@param count - the number of points
+	*/
+	int benchmarkBatchTransform(long count);
+
+}	// namespace
+
+#endif
@@ -0,0 +1,133 @@
+// CpuFeatures.cpp is the file that
+// holds the implementation for the
+// CPU feature detection.
+
+// Include headers
+#include "CpuFeatures.h"
+
+#if defined(FRAMEWORK_X86)
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+namespace applicationFramework {
+
+#if defined(FRAMEWORK_X86)
+	// Read a cpuid leaf into eax, ebx, ecx, edx
+	static void readCpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+	{
+#ifdef _MSC_VER
+		int values[4];
+		__cpuidex(values, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; i++) {
+			registers[i] = (unsigned int)values[i];
+		}
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	// Read the register state the operating system saves on a context switch
+	static unsigned long long readXcr0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((unsigned long long)edx << 32) | eax;
+#endif
+	}
+#endif
+
+	// Check for SSE2
+	bool CpuFeatures::hasSse2()
+	{
+#if defined(FRAMEWORK_X86)
+		static const bool isSupported = []() {
+			unsigned int registers[4];
+			readCpuid(1, 0, registers);
+			return (registers[3] & (1u << 26)) != 0;		// edx bit 26
+		}();
+		return isSupported;
+#else
+		return false;
+#endif
+	}
+
+	// Check for AVX2
+	bool CpuFeatures::hasAvx2()
+	{
+#if defined(FRAMEWORK_X86)
+		static const bool isSupported = []() {
+			unsigned int registers[4];
+			readCpuid(0, 0, registers);
+			if (registers[0] < 7) {
+				return false;
+			}
+
+			readCpuid(1, 0, registers);
+			bool hasOsxsave = (registers[2] & (1u << 27)) != 0;	// ecx bit 27
+			bool hasAvx = (registers[2] & (1u << 28)) != 0;		// ecx bit 28
+			if (!hasOsxsave || !hasAvx || (readXcr0() & 0x6) != 0x6) {	// XMM and YMM state enabled
+				return false;
+			}
+
+			readCpuid(7, 0, registers);
+			return (registers[1] & (1u << 5)) != 0;				// ebx bit 5
+		}();
+		return isSupported;
+#else
+		return false;
+#endif
+	}
+
+	// Check for an invariant TSC
+	bool CpuFeatures::hasInvariantTsc()
+	{
+#if defined(FRAMEWORK_X86)
+		static const bool isSupported = []() {
+			unsigned int registers[4];
+			readCpuid(0x80000000, 0, registers);
+			if (registers[0] < 0x80000007) {
+				return false;
+			}
+
+			readCpuid(0x80000007, 0, registers);
+			return (registers[3] & (1u << 8)) != 0;				// edx bit 8
+		}();
+		return isSupported;
+#else
+		return false;
+#endif
+	}
+
+	// Return the best instruction set
+	SimdLevel CpuFeatures::getSimdLevel()
+	{
+		if (hasAvx2()) {
+			return SIMD_AVX2;
+		}
+		if (hasSse2()) {
+			return SIMD_SSE2;
+		}
+		return SIMD_SCALAR;
+	}
+
+	// Return the name of an instruction set
+	const char* CpuFeatures::getSimdLevelName(SimdLevel level)
+	{
+		switch (level) {
+		case SIMD_AVX2:
+			return "avx2";
+		case SIMD_SSE2:
+			return "sse2";
+		default:
+			return "scalar";
+		}
+	}
+
+}	// namespace
@@ -0,0 +1,53 @@
+#pragma once
+// CpuFeatures.h is the file that detects
+// which SIMD instruction sets the CPU and
+// operating system support, so kernels
+// can be picked at runtime.
+
+// Header guards
+#ifndef CPU_FEATURES_H_
+#define CPU_FEATURES_H_
+
+// x86 builds get the SSE/AVX2 kernels, other targets use the scalar ones
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define FRAMEWORK_X86 1
+	#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it,
+// MSVC emits any intrinsic it is given
+#if defined(FRAMEWORK_X86) && defined(__GNUC__)
+	#define FRAMEWORK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define FRAMEWORK_TARGET_AVX2
+#endif
+
+namespace applicationFramework {
+
+	// Instruction sets a kernel can be written for, in increasing order
+	enum SimdLevel { SIMD_SCALAR = 0, SIMD_SSE2 = 1, SIMD_AVX2 = 2 };
+
+	class CpuFeatures
+	{
+	public:
+		/** Checks for SSE2 */
+		static bool hasSse2();
+
+		/** Checks for AVX2, including operating system support for the YMM registers */
+		static bool hasAvx2();
+
+		/** Checks for a time stamp counter that ticks at a constant rate in every
+		power state (invariant TSC), so it can be used as a clock
+		*/
+		static bool hasInvariantTsc();
+
+		/** The best instruction set available on this machine */
+		static SimdLevel getSimdLevel();
+
+		/** A readable name for an instruction set, e.g. "avx2" */
+		static const char* getSimdLevelName(SimdLevel level);
+	};
+
+}	// namespace
+
+#endif
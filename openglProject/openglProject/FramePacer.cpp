@@ -0,0 +1,156 @@
+// FramePacer.cpp is the file that holds
+// the implementation for the frame
+// pacing scheduler.
+
+// Include headers
+#include <stdio.h>
+#include <math.h>
+#include <thread>
+#include <chrono>
+
+#include "FramePacer.h"
+#include "Logger.h"
+
+namespace applicationFramework {
+
+	// Weight of each new sleep in the running estimate, recent sleeps count most
+	static const double SLEEP_ESTIMATE_WEIGHT = 0.05;
+
+	// Class constructor
+	FramePacer::FramePacer(double framesPerSecond)
+	{
+		clock.start();
+		sleepStep = 0.001;
+		isSleepEnabled = true;
+		sleepEstimate = sleepStep;
+		sleepVariance = sleepStep * sleepStep * 0.25;
+		setTargetRate(framesPerSecond);
+		resetStats();
+	}
+
+	// Class destructor
+	FramePacer::~FramePacer()
+	{
+	}
+
+	// Set the frame rate
+	void FramePacer::setTargetRate(double framesPerSecond)
+	{
+		frameTime = framesPerSecond > 0.0 ? 1.0 / framesPerSecond : 0.0;
+		nextDeadline = -1.0;
+	}
+
+	// Return the frame rate
+	double FramePacer::getTargetRate() const
+	{
+		return frameTime > 0.0 ? 1.0 / frameTime : 0.0;
+	}
+
+	// Set the sleep step
+	void FramePacer::setSleepStep(double milliseconds)
+	{
+		sleepStep = milliseconds > 0.0 ? milliseconds / 1000.0 : 0.001;
+		sleepEstimate = sleepStep;
+		sleepVariance = sleepStep * sleepStep * 0.25;
+	}
+
+	// Allow or forbid sleeping
+	void FramePacer::setSleepEnabled(bool isEnabled)
+	{
+		isSleepEnabled = isEnabled;
+	}
+
+	// Read the clock
+	double FramePacer::now()
+	{
+		return clock.getElapsedSeconds();
+	}
+
+	// Sleep, then spin, up to the next deadline
+	double FramePacer::waitForNextFrame()
+	{
+		double time = now();
+		if (frameTime > 0.0 && nextDeadline >= 0.0) {
+			if (time > nextDeadline + frameTime) {	// Too far behind, start a new schedule
+				nextDeadline = time;
+			}
+
+			// Sleep while a whole step (as long as steps have been taking) still fits
+			while (isSleepEnabled && nextDeadline - time > sleepEstimate + sqrt(sleepVariance)) {
+				std::this_thread::sleep_for(std::chrono::microseconds((long long)(sleepStep * 1e6)));
+				double woken = now();
+				double slept = woken - time;
+				double difference = slept - sleepEstimate;
+				sleepEstimate += difference * SLEEP_ESTIMATE_WEIGHT;
+				sleepVariance = (1.0 - SLEEP_ESTIMATE_WEIGHT) * (sleepVariance + difference * difference * SLEEP_ESTIMATE_WEIGHT);
+				sleepSum += slept;
+				time = woken;
+			}
+
+			// Spin out the rest
+			double spinStart = time;
+			while (time < nextDeadline) {
+				time = now();
+			}
+			spinSum += time - spinStart;
+			latenessSum += time - nextDeadline;
+		}
+		nextDeadline = (nextDeadline >= 0.0 ? nextDeadline : time) + frameTime;
+
+		// Record the interval since the previous frame start
+		double interval = 0.0;
+		if (frameCount > 0) {
+			interval = time - lastFrameStart;
+			intervalSum += interval;
+			intervalSquareSum += interval * interval;
+			minInterval = intervalCount == 0 || interval < minInterval ? interval : minInterval;
+			maxInterval = intervalCount == 0 || interval > maxInterval ? interval : maxInterval;
+			intervalCount++;
+		}
+		lastFrameStart = time;
+		frameCount++;
+		return interval;
+	}
+
+	// Summarize the recorded frames
+	FramePacerStats FramePacer::getStats() const
+	{
+		FramePacerStats stats;
+		stats.frameCount = frameCount;
+		stats.meanIntervalMs = intervalCount > 0 ? intervalSum / intervalCount * 1000.0 : 0.0;
+		stats.minIntervalMs = minInterval * 1000.0;
+		stats.maxIntervalMs = maxInterval * 1000.0;
+		double variance = intervalCount > 0 ? intervalSquareSum / intervalCount - (intervalSum / intervalCount) * (intervalSum / intervalCount) : 0.0;
+		stats.jitterMs = variance > 0.0 ? sqrt(variance) * 1000.0 : 0.0;
+		stats.meanLatenessMs = frameCount > 1 ? latenessSum / (frameCount - 1) * 1000.0 : 0.0;
+		stats.sleepMs = sleepSum * 1000.0;
+		stats.spinMs = spinSum * 1000.0;
+		return stats;
+	}
+
+	// Clear the recorded frames
+	void FramePacer::resetStats()
+	{
+		frameCount = 0;
+		intervalCount = 0;
+		intervalSum = 0.0;
+		intervalSquareSum = 0.0;
+		minInterval = 0.0;
+		maxInterval = 0.0;
+		latenessSum = 0.0;
+		sleepSum = 0.0;
+		spinSum = 0.0;
+		lastFrameStart = 0.0;
+		nextDeadline = -1.0;
+	}
+
+	// Print the stats
+	void FramePacer::printReport() const
+	{
+		FramePacerStats stats = getStats();
+		LOG_INFO("FramePacer: %ld frames at %.1f fps target, interval %.3f ms (min %.3f, max %.3f), jitter %.3f ms, late %.3f ms, slept %.0f ms, spun %.0f ms",
+			stats.frameCount, getTargetRate(), stats.meanIntervalMs, stats.minIntervalMs, stats.maxIntervalMs,
+			stats.jitterMs, stats.meanLatenessMs, stats.sleepMs, stats.spinMs);
+	}
+
+}	// namespace
@@ -0,0 +1,98 @@
+#pragma once
+// FramePacer.h is the file that holds
+// the scheduler which waits out the rest
+// of each frame at a target frame rate.
+
+// Header guards
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+// Include headers
+#include "PerformanceTimer.h"
+
+namespace applicationFramework {
+
+	// How evenly the frames were paced since the last reset
+	struct FramePacerStats
+	{
+		long frameCount;				// Frames started
+		double meanIntervalMs;			// Average time from one frame start to the next
+		double minIntervalMs;
+		double maxIntervalMs;
+		double jitterMs;				// Standard deviation of the intervals
+		double meanLatenessMs;			// Average time a frame started after its deadline
+		double sleepMs;					// Total time spent asleep
+		double spinMs;					// Total time spent spinning on the clock
+	};
+
+	/* Paces frames to a target rate without pinning a core. The wait before each
+	* frame sleeps in short steps while the time left is more than a sleep has been
+	* seen to take (a running mean plus one standard deviation of the sleeps, so it
+	* adapts to the OS timer resolution), then spins on the clock for the rest.
+	* Deadlines advance by a fixed frame time, so a late frame is caught up by the
+	* next one, but a frame more than one frame late restarts the schedule instead
+	* of bursting through the missed ones.
+	*/
+	class FramePacer
+	{
+	public:
+		/** Creates a pacer.
+		@param framesPerSecond - the target rate, 0 or less does not wait at all
+		*/
+		explicit FramePacer(double framesPerSecond = 60.0);
+		~FramePacer();
+
+		/** Changes the target rate, the schedule restarts from the next frame */
+		void setTargetRate(double framesPerSecond);
+		double getTargetRate() const;
+
+		/** The sleep step, the last step before a deadline is spun instead.
+		Shorter steps spin less on systems with a fine timer (1 ms by default).
+		*/
+		void setSleepStep(double milliseconds);
+
+		/** Sets whether the wait may sleep, false spins the whole wait as a busy loop does */
+		void setSleepEnabled(bool isEnabled);
+
+		/** Waits until the next frame's deadline, then records the frame start.
+		@return the time since the previous frame started (seconds), 0 for the first frame
+		*/
+		double waitForNextFrame();
+
+		/** How evenly the frames were paced */
+		FramePacerStats getStats() const;
+
+		/** Forgets the recorded frames */
+		void resetStats();
+
+		/** Prints the stats on one line */
+		void printReport() const;
+
+	private:
+		/** Seconds since the pacer was created */
+		double now();
+
+		PerformanceTimer clock;			// Runs from construction, read as a monotonic clock
+		double frameTime;				// Seconds per frame, 0 when not pacing
+		double sleepStep;				// Seconds per sleep
+		bool isSleepEnabled;
+		double nextDeadline;			// Seconds on clock, negative before the first frame
+		double lastFrameStart;
+
+		double sleepEstimate;			// Running mean of how long a sleep step takes (seconds)
+		double sleepVariance;			// And its variance
+
+		long frameCount;
+		long intervalCount;
+		double intervalSum;				// Seconds
+		double intervalSquareSum;
+		double minInterval;
+		double maxInterval;
+		double latenessSum;
+		double sleepSum;
+		double spinSum;
+	};
+
+}	// namespace
+
+#endif
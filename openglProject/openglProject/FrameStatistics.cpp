@@ -0,0 +1,313 @@
+// FrameStatistics.cpp is the file that holds
+// the implementation for the frame time
+// histogram and the window summaries.
+
+// Include headers
+#include <stdio.h>
+#include <string.h>
+
+#include "FrameStatistics.h"
+#include "Logger.h"
+
+namespace applicationFramework {
+
+	// Class constructor
+	FrameHistogram::FrameHistogram()
+	{
+		clear();
+	}
+
+	// Count a frame
+	void FrameHistogram::record(long long microseconds)
+	{
+		microseconds = microseconds < 0 ? 0 : microseconds;
+		microseconds = microseconds > FRAME_HISTOGRAM_MAX_MICROSECONDS ? FRAME_HISTOGRAM_MAX_MICROSECONDS : microseconds;
+		counts[getBucket(microseconds)]++;
+		min = count == 0 || microseconds < min ? microseconds : min;
+		max = count == 0 || microseconds > max ? microseconds : max;
+		sum += (double)microseconds;
+		count++;
+	}
+
+	// Forget the frames
+	void FrameHistogram::clear()
+	{
+		memset(counts, 0, sizeof(counts));
+		count = 0;
+		min = 0;
+		max = 0;
+		sum = 0.0;
+	}
+
+	long long FrameHistogram::getCount() const
+	{
+		return count;
+	}
+
+	long long FrameHistogram::getMin() const
+	{
+		return min;
+	}
+
+	long long FrameHistogram::getMax() const
+	{
+		return max;
+	}
+
+	double FrameHistogram::getMean() const
+	{
+		return count > 0 ? sum / count : 0.0;
+	}
+
+	// Walk the buckets until the percentile's rank is reached
+	long long FrameHistogram::getValueAtPercentile(double percentile) const
+	{
+		if (count == 0) {
+			return 0;
+		}
+		long long rank = (long long)(percentile / 100.0 * count + 0.5);
+		rank = rank < 1 ? 1 : (rank > count ? count : rank);
+
+		long long seen = 0;
+		for (int bucket = 0; bucket < FRAME_HISTOGRAM_BUCKETS; bucket++) {
+			seen += counts[bucket];
+			if (seen >= rank) {
+				long long value = getBucketValue(bucket);
+				return value < min ? min : (value > max ? max : value);
+			}
+		}
+		return max;
+	}
+
+	long long FrameHistogram::getBucketFrequency(int bucket) const
+	{
+		return counts[bucket];
+	}
+
+	// The largest value of a bucket, the inverse of getBucket()
+	long long FrameHistogram::getBucketValue(int bucket)
+	{
+		if (bucket < FRAME_HISTOGRAM_LINEAR_LIMIT) {
+			return bucket;
+		}
+		int shift = (bucket - (int)FRAME_HISTOGRAM_LINEAR_LIMIT) / FRAME_HISTOGRAM_BUCKETS_PER_OCTAVE + 1;
+		int subBucket = (bucket - (int)FRAME_HISTOGRAM_LINEAR_LIMIT) % FRAME_HISTOGRAM_BUCKETS_PER_OCTAVE;
+		return ((long long)(FRAME_HISTOGRAM_BUCKETS_PER_OCTAVE + subBucket + 1) << shift) - 1;
+	}
+
+	// Shift the value down until it fits the top half of the linear range, the shift picks the octave
+	int FrameHistogram::getBucket(long long microseconds)
+	{
+		if (microseconds < FRAME_HISTOGRAM_LINEAR_LIMIT) {
+			return (int)microseconds;
+		}
+		int shift = 1;
+		while ((microseconds >> shift) >= FRAME_HISTOGRAM_LINEAR_LIMIT) {
+			shift++;
+		}
+		return (int)FRAME_HISTOGRAM_LINEAR_LIMIT + (shift - 1) * FRAME_HISTOGRAM_BUCKETS_PER_OCTAVE +
+			(int)(microseconds >> shift) - FRAME_HISTOGRAM_BUCKETS_PER_OCTAVE;
+	}
+
+	// Class constructor
+	FrameStatistics::FrameStatistics(double targetFrameMilliseconds, double windowSeconds)
+	{
+		setTargetFrameTime(targetFrameMilliseconds);
+		setWindowLength(windowSeconds);
+		reset();
+	}
+
+	// Class destructor
+	FrameStatistics::~FrameStatistics()
+	{
+	}
+
+	// Set the target frame time
+	void FrameStatistics::setTargetFrameTime(double milliseconds)
+	{
+		targetFrameTime = milliseconds;
+	}
+
+	// Return the target frame time
+	double FrameStatistics::getTargetFrameTime() const
+	{
+		return targetFrameTime;
+	}
+
+	// Set the window length
+	void FrameStatistics::setWindowLength(double seconds)
+	{
+		windowLength = seconds > 0.0 ? seconds : 1.0;
+	}
+
+	// Count a frame in the total and the window, closing the window once it is full
+	void FrameStatistics::recordFrame(double seconds)
+	{
+		seconds = seconds > 0.0 ? seconds : 0.0;
+		long long microseconds = (long long)(seconds * 1e6 + 0.5);
+		total.record(microseconds);
+		window.record(microseconds);
+
+		double milliseconds = seconds * 1000.0;
+		double threshold = targetFrameTime * 2.0;
+		for (int level = 0; level < FRAME_HITCH_LEVELS && targetFrameTime > 0.0 && milliseconds > threshold; level++) {
+			totalHitches[level]++;
+			windowHitches[level]++;
+			threshold *= 2.0;
+		}
+
+		totalSeconds += seconds;
+		windowSeconds += seconds;
+		if (windowSeconds >= windowLength) {
+			closeWindow();
+		}
+	}
+
+	// Summarize the window and start the next
+	void FrameStatistics::closeWindow()
+	{
+		windows.push_back(summarize(window, windowHitches, windowStart, windowSeconds));
+		if (windows.size() > FRAME_STATISTICS_MAX_WINDOWS) {
+			windows.pop_front();
+		}
+		window.clear();
+		memset(windowHitches, 0, sizeof(windowHitches));
+		windowStart += windowSeconds;
+		windowSeconds = 0.0;
+	}
+
+	// Summarize a histogram
+	FrameWindowStats FrameStatistics::summarize(const FrameHistogram &histogram, const long long hitches[FRAME_HITCH_LEVELS],
+		double startSeconds, double durationSeconds) const
+	{
+		FrameWindowStats stats;
+		stats.startSeconds = startSeconds;
+		stats.durationSeconds = durationSeconds;
+		stats.frameCount = histogram.getCount();
+		stats.minMs = histogram.getMin() / 1000.0;
+		stats.maxMs = histogram.getMax() / 1000.0;
+		stats.meanMs = histogram.getMean() / 1000.0;
+		memcpy(stats.hitchCounts, hitches, sizeof(stats.hitchCounts));
+
+		stats.p50Ms = histogram.getValueAtPercentile(50.0) / 1000.0;
+		stats.p95Ms = histogram.getValueAtPercentile(95.0) / 1000.0;
+		stats.p99Ms = histogram.getValueAtPercentile(99.0) / 1000.0;
+		stats.p999Ms = histogram.getValueAtPercentile(99.9) / 1000.0;
+		return stats;
+	}
+
+	// Return the whole run
+	FrameWindowStats FrameStatistics::getTotal() const
+	{
+		return summarize(total, totalHitches, 0.0, totalSeconds);
+	}
+
+	// Return the open window
+	FrameWindowStats FrameStatistics::getCurrentWindow() const
+	{
+		return summarize(window, windowHitches, windowStart, windowSeconds);
+	}
+
+	// Return the closed windows
+	const std::deque<FrameWindowStats>& FrameStatistics::getWindows() const
+	{
+		return windows;
+	}
+
+	// Return the histogram of the run
+	const FrameHistogram& FrameStatistics::getHistogram() const
+	{
+		return total;
+	}
+
+	// Forget everything
+	void FrameStatistics::reset()
+	{
+		total.clear();
+		memset(totalHitches, 0, sizeof(totalHitches));
+		totalSeconds = 0.0;
+		window.clear();
+		memset(windowHitches, 0, sizeof(windowHitches));
+		windowStart = 0.0;
+		windowSeconds = 0.0;
+		windows.clear();
+	}
+
+	// Write one CSV row
+	static void writeCsvRow(FILE *file, const char *label, const FrameWindowStats &stats)
+	{
+		fprintf(file, "%s,%.6f,%.6f,%lld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%lld,%lld,%lld\n", label,
+			stats.startSeconds, stats.durationSeconds, stats.frameCount, stats.minMs, stats.maxMs, stats.meanMs,
+			stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.p999Ms, stats.hitchCounts[0], stats.hitchCounts[1], stats.hitchCounts[2]);
+	}
+
+	// Write the windows as CSV
+	bool FrameStatistics::writeCsv(const char *filename) const
+	{
+		FILE *file = fopen(filename, "w");
+		if (file == NULL) {
+			return false;
+		}
+		fprintf(file, "window,startSeconds,durationSeconds,frames,minMs,maxMs,meanMs,p50Ms,p95Ms,p99Ms,p999Ms,hitches2x,hitches4x,hitches8x\n");
+		char label[32];
+		for (size_t i = 0; i < windows.size(); i++) {
+			sprintf(label, "%u", (unsigned int)i);
+			writeCsvRow(file, label, windows[i]);
+		}
+		if (window.getCount() > 0) {
+			writeCsvRow(file, "current", getCurrentWindow());
+		}
+		writeCsvRow(file, "total", getTotal());
+		return fclose(file) == 0;
+	}
+
+	// Write one window as a JSON object
+	static void writeJsonStats(FILE *file, const FrameWindowStats &stats)
+	{
+		fprintf(file, "{ \"startSeconds\": %.6f, \"durationSeconds\": %.6f, \"frames\": %lld, \"minMs\": %.3f, \"maxMs\": %.3f, "
+			"\"meanMs\": %.3f, \"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"p999Ms\": %.3f, \"hitches\": [%lld, %lld, %lld] }",
+			stats.startSeconds, stats.durationSeconds, stats.frameCount, stats.minMs, stats.maxMs, stats.meanMs,
+			stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.p999Ms, stats.hitchCounts[0], stats.hitchCounts[1], stats.hitchCounts[2]);
+	}
+
+	// Write the total, windows and histogram as JSON
+	bool FrameStatistics::writeJson(const char *filename) const
+	{
+		FILE *file = fopen(filename, "w");
+		if (file == NULL) {
+			return false;
+		}
+		fprintf(file, "{\n\t\"targetFrameMs\": %.6f,\n\t\"windowSeconds\": %.6f,\n\t\"hitchThresholdsMs\": [%.3f, %.3f, %.3f],\n\t\"total\": ",
+			targetFrameTime, windowLength, targetFrameTime * 2.0, targetFrameTime * 4.0, targetFrameTime * 8.0);
+		writeJsonStats(file, getTotal());
+		fprintf(file, ",\n\t\"current\": ");
+		writeJsonStats(file, getCurrentWindow());
+		fprintf(file, ",\n\t\"windows\": [");
+		for (size_t i = 0; i < windows.size(); i++) {
+			fprintf(file, "%s\n\t\t", i > 0 ? "," : "");
+			writeJsonStats(file, windows[i]);
+		}
+
+		// The buckets as [largest microseconds, frames] pairs
+		fprintf(file, "\n\t],\n\t\"histogram\": [");
+		bool isFirst = true;
+		for (int bucket = 0; bucket < FRAME_HISTOGRAM_BUCKETS; bucket++) {
+			if (total.getBucketFrequency(bucket) > 0) {
+				fprintf(file, "%s[%lld, %lld]", isFirst ? "" : ", ", FrameHistogram::getBucketValue(bucket), total.getBucketFrequency(bucket));
+				isFirst = false;
+			}
+		}
+		fprintf(file, "]\n}\n");
+		return fclose(file) == 0;
+	}
+
+	// Print the total
+	void FrameStatistics::printReport() const
+	{
+		FrameWindowStats stats = getTotal();
+		LOG_INFO("FrameStatistics: %lld frames, mean %.3f ms (min %.3f, max %.3f), p50 %.3f, p95 %.3f, p99 %.3f, p99.9 %.3f ms, hitches %lld/%lld/%lld (>2x/4x/8x %.1f ms)",
+			stats.frameCount, stats.meanMs, stats.minMs, stats.maxMs, stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.p999Ms,
+			stats.hitchCounts[0], stats.hitchCounts[1], stats.hitchCounts[2], targetFrameTime);
+	}
+
+}	// namespace
@@ -0,0 +1,168 @@
+#pragma once
+// FrameStatistics.h is the file that holds
+// the frame time histogram and the rolling
+// per-window percentiles and hitch counts.
+
+// Header guards
+#ifndef FRAME_STATISTICS_H_
+#define FRAME_STATISTICS_H_
+
+// Include headers
+#include <deque>
+
+namespace applicationFramework {
+
+	// Values below this many microseconds get a bucket each, above it every power of
+	// two is split into half as many buckets, so a bucket is within 1/64 of its values
+	static const long long FRAME_HISTOGRAM_LINEAR_LIMIT = 128;
+	static const int FRAME_HISTOGRAM_BUCKETS_PER_OCTAVE = 64;
+
+	// Frames longer than this (about 67 seconds) are counted as this long
+	static const long long FRAME_HISTOGRAM_MAX_MICROSECONDS = (1LL << 26) - 1;
+	static const int FRAME_HISTOGRAM_BUCKETS = (int)FRAME_HISTOGRAM_LINEAR_LIMIT + (26 - 7) * FRAME_HISTOGRAM_BUCKETS_PER_OCTAVE;
+
+	// Hitch levels, a frame is a hitch at level i when it takes more than 2^(i+1) target frame times
+	static const int FRAME_HITCH_LEVELS = 3;
+
+	// Closed windows kept, the oldest are dropped (an hour of one second windows)
+	static const unsigned int FRAME_STATISTICS_MAX_WINDOWS = 3600;
+
+	/* A log-linear (HDR style) histogram of frame times in microseconds. Recording
+	* is a few shifts and an increment, percentiles are read from the bucket counts
+	* with a relative error under 1.6%, however many frames were recorded.
+	*/
+	class FrameHistogram
+	{
+	public:
+		FrameHistogram();
+
+		/** Counts one frame */
+		void record(long long microseconds);
+
+		/** Forgets every frame */
+		void clear();
+
+		long long getCount() const;
+		long long getMin() const;
+		long long getMax() const;
+		double getMean() const;
+
+		/** The frame time (microseconds) that percentile of the frames are no longer than,
+		e.g. 99.0 for the 99th percentile. It is the largest value the bucket holds,
+		clamped to the recorded range, 0 when empty.
+		*/
+		long long getValueAtPercentile(double percentile) const;
+
+		/** Frames counted by a bucket, and the largest value (microseconds) the bucket holds */
+		long long getBucketFrequency(int bucket) const;
+		static long long getBucketValue(int bucket);
+
+		/** The bucket a value is counted in */
+		static int getBucket(long long microseconds);
+
+	private:
+		long long counts[FRAME_HISTOGRAM_BUCKETS];
+		long long count;
+		long long min;
+		long long max;
+		double sum;
+	};
+
+	// The frame times over a window (or the whole run), in milliseconds
+	struct FrameWindowStats
+	{
+		double startSeconds;			// Frame time recorded before the window started
+		double durationSeconds;			// Frame time recorded in the window
+		long long frameCount;
+		double minMs;
+		double maxMs;
+		double meanMs;
+		double p50Ms;
+		double p95Ms;
+		double p99Ms;
+		double p999Ms;
+		long long hitchCounts[FRAME_HITCH_LEVELS];	// Frames over 2, 4 and 8 target frame times
+	};
+
+	/* Collects frame times into a histogram for the whole run and one for the current
+	* window. When a window's frames add up to the window length it is summarized
+	* (min, max, mean, p50/p95/p99/p99.9 and hitch counts) and a new one begins, so
+	* a latency regression shows up in the windows it happened in instead of being
+	* averaged away. Everything can be read while frames are recorded (from the same
+	* thread) and written out as CSV or JSON.
+	*/
+	class FrameStatistics
+	{
+	public:
+		/** Creates a collector.
+		@param targetFrameMilliseconds - the frame time hitches are measured against
+		@param windowSeconds - the frame time summarized by each window
+		*/
+		explicit FrameStatistics(double targetFrameMilliseconds = 1000.0 / 60.0, double windowSeconds = 1.0);
+		~FrameStatistics();
+
+		void setTargetFrameTime(double milliseconds);
+		double getTargetFrameTime() const;
+
+		/** Changes the window length, the current window is kept */
+		void setWindowLength(double seconds);
+
+		/** Records one frame.
+		@param seconds - how long the frame took
+		*/
+		void recordFrame(double seconds);
+
+		/** Every frame since the last reset */
+		FrameWindowStats getTotal() const;
+
+		/** The frames of the window still being recorded */
+		FrameWindowStats getCurrentWindow() const;
+
+		/** The closed windows, oldest first */
+		const std::deque<FrameWindowStats>& getWindows() const;
+
+		/** The histogram of every frame since the last reset */
+		const FrameHistogram& getHistogram() const;
+
+		/** Forgets every frame and window */
+		void reset();
+
+		/** Writes one row per closed window, then the current window and the total.
+		@return false if the file could not be written
+		*/
+		bool writeCsv(const char *filename) const;
+
+		/** Writes the total, the windows and the non-empty histogram buckets.
+		@return false if the file could not be written
+		*/
+		bool writeJson(const char *filename) const;
+
+		/** Prints the total on one line */
+		void printReport() const;
+
+	private:
+		/** Closes the current window and starts the next */
+		void closeWindow();
+
+		/** Summarizes a histogram */
+		FrameWindowStats summarize(const FrameHistogram &histogram, const long long hitches[FRAME_HITCH_LEVELS],
+			double startSeconds, double durationSeconds) const;
+
+		double targetFrameTime;			// Milliseconds
+		double windowLength;			// Seconds
+
+		FrameHistogram total;
+		long long totalHitches[FRAME_HITCH_LEVELS];
+		double totalSeconds;
+
+		FrameHistogram window;
+		long long windowHitches[FRAME_HITCH_LEVELS];
+		double windowStart;				// Seconds of frames before the window
+		double windowSeconds;
+
+		std::deque<FrameWindowStats> windows;
+	};
+
+}	// namespace
+
+#endif
@@ -0,0 +1,82 @@
+// Frustum.cpp is the file that
+// holds the implementation for the
+// camera frustum.
+
+// Include headers
+#include <math.h>
+
+#include "Frustum.h"
+
+namespace applicationFramework {
+
+	// Class constructor
+	Frustum::Frustum()
+	{
+		for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+			planes[plane][0] = planes[plane][1] = planes[plane][2] = 0.0f;
+			planes[plane][3] = 1.0f;							// 0x + 0y + 0z + 1 >= 0 holds everywhere
+		}
+	}
+
+	// Store a plane through a point
+	static void setPlane(float *plane, const Vector<float> &normal, const Vector<float> &point)
+	{
+		plane[0] = normal.x;
+		plane[1] = normal.y;
+		plane[2] = normal.z;
+		plane[3] = -normal.dot(point);
+	}
+
+	// Build the planes from the camera basis. The side planes go through the eye, their
+	// normals lean from the camera's right/up axes towards the view direction.
+	void Frustum::setPerspective(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &up,
+		float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
+	{
+		Vector<float> forward = center - eye;
+		forward.normalize();
+		Vector<float> right = forward.cross(up);
+		right.normalize();
+		Vector<float> cameraUp = right.cross(forward);
+
+		float halfHeight = tanf(fieldOfView * 0.5f * 3.14159265f / 180.0f);
+		float halfWidth = halfHeight * aspectRatio;
+
+		Vector<float> normal = right + forward * halfWidth;
+		normal.normalize();
+		setPlane(planes[FRUSTUM_LEFT], normal, eye);
+
+		normal = right * -1.0f + forward * halfWidth;
+		normal.normalize();
+		setPlane(planes[FRUSTUM_RIGHT], normal, eye);
+
+		normal = cameraUp + forward * halfHeight;
+		normal.normalize();
+		setPlane(planes[FRUSTUM_BOTTOM], normal, eye);
+
+		normal = cameraUp * -1.0f + forward * halfHeight;
+		normal.normalize();
+		setPlane(planes[FRUSTUM_TOP], normal, eye);
+
+		setPlane(planes[FRUSTUM_NEAR], forward, eye + forward * nearPlane);
+		setPlane(planes[FRUSTUM_FAR], forward * -1.0f, eye + forward * farPlane);
+	}
+
+	// A sphere is hidden when it is entirely behind one plane
+	bool Frustum::isSphereVisible(const float *center, float radius) const
+	{
+		for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+			const float *p = planes[plane];
+			if (p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Return one plane
+	const float* Frustum::getPlane(int plane) const
+	{
+		return planes[plane];
+	}
+
+}	// namespace
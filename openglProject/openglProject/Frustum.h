@@ -0,0 +1,56 @@
+#pragma once
+// Frustum.h is the file that holds
+// the planes of the camera's view volume
+// and the tests against them.
+
+// Header guards
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+// Include headers
+#include "Vector.h"
+
+namespace applicationFramework {
+
+	// The planes of a frustum
+	enum FrustumPlane {
+		FRUSTUM_LEFT = 0,
+		FRUSTUM_RIGHT = 1,
+		FRUSTUM_BOTTOM = 2,
+		FRUSTUM_TOP = 3,
+		FRUSTUM_NEAR = 4,
+		FRUSTUM_FAR = 5,
+		FRUSTUM_PLANE_COUNT = 6
+	};
+
+	/* The view volume of a perspective camera as six planes whose normals point
+	* inside, a point p is inside a plane when a*x + b*y + c*z + d >= 0.
+	*/
+	class Frustum
+	{
+	public:
+		// Class constructor, everything is inside until set
+		Frustum();
+
+		/** Builds the planes for a camera, as gluPerspective and gluLookAt would set it up.
+		@param eye, center, up - the camera (Application::getEyeVector/getCenterVector/getUpVector)
+		@param fieldOfView - vertical field of view in degrees
+		@param aspectRatio - width over height
+		@param nearPlane, farPlane - the distances to the clipping planes
+		*/
+		void setPerspective(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &up,
+			float fieldOfView, float aspectRatio, float nearPlane, float farPlane);
+
+		/** Checks if any part of a sphere may be inside (conservative near the edges) */
+		bool isSphereVisible(const float *center, float radius) const;
+
+		/** One plane as a, b, c, d with a unit normal */
+		const float* getPlane(int plane) const;
+
+	private:
+		float planes[FRUSTUM_PLANE_COUNT][4];
+	};
+
+}	// namespace
+
+#endif
@@ -0,0 +1,201 @@
+// IndexedMesh.cpp is the file that
+// holds the implementation for the
+// indexed mesh and vertex welding.
+
+// Include headers
+#include <stdlib.h>
+#include <string.h>
+
+#include "IndexedMesh.h"
+
+namespace applicationFramework {
+
+	// Marks an unused slot in the welding hash table
+	static const unsigned int EMPTY_SLOT = 0xFFFFFFFFu;
+
+	// Largest vertex number that fits in a 16-bit index
+	static const long MAX_16BIT_VERTICES = 65536;
+
+	// Hash the raw bits of a position/normal pair (FNV-1a over 32-bit words),
+	// a NULL normal hashes the position alone
+	static unsigned int hashVertex(const float *position, const float *normal)
+	{
+		unsigned int words[6];
+		int wordCount = normal != NULL ? 6 : 3;
+		memcpy(words, position, 3 * sizeof(float));
+		if (normal != NULL) {
+			memcpy(words + 3, normal, 3 * sizeof(float));
+		}
+
+		unsigned int hash = 2166136261u;
+		for (int i = 0; i < wordCount; i++) {
+			hash = (hash ^ words[i]) * 16777619u;
+		}
+		return hash ^ (hash >> 15);
+	}
+
+	// Class constructor
+	IndexedMesh::IndexedMesh()
+	{
+		positions = NULL;
+		normals = NULL;
+		indices = NULL;
+		vertexCount = 0;
+		indexCount = 0;
+		indexSize = sizeof(unsigned int);
+		ownsBuffers = true;
+	}
+
+	// Class destructor
+	IndexedMesh::~IndexedMesh()
+	{
+		release();
+	}
+
+	// Weld the triangle corners into unique vertices
+	bool IndexedMesh::build(const float *triangles, const float *cornerNormals, long cornerCount)
+	{
+		release();
+		if (cornerCount <= 0) {
+			return true;
+		}
+
+		size_t tableSize = 1;									// Keep the table at most half full
+		while (tableSize < (size_t)cornerCount * 2) {
+			tableSize <<= 1;
+		}
+		size_t mask = tableSize - 1;
+
+		unsigned int *table = (unsigned int*)malloc(tableSize * sizeof(unsigned int));
+		unsigned int *wideIndices = (unsigned int*)malloc(cornerCount * sizeof(unsigned int));
+		positions = (float*)malloc(cornerCount * 3 * sizeof(float));		// Worst case, every corner is unique
+		normals = (float*)calloc(cornerCount * 3, sizeof(float));			// Zero when welding on position alone
+		if (table == NULL || wideIndices == NULL || positions == NULL || normals == NULL) {
+			free(table);
+			free(wideIndices);
+			release();
+			return false;
+		}
+		memset(table, 0xFF, tableSize * sizeof(unsigned int));
+
+		for (long corner = 0; corner < cornerCount; corner++) {
+			const float *position = &triangles[corner * 3];
+			const float *normal = cornerNormals != NULL ? &cornerNormals[corner * 3] : NULL;
+
+			size_t slot = hashVertex(position, normal) & mask;
+			while (table[slot] != EMPTY_SLOT) {					// Linear probing until a match or a free slot
+				unsigned int candidate = table[slot];
+				if (memcmp(&positions[candidate * 3], position, 3 * sizeof(float)) == 0 &&
+					(normal == NULL || memcmp(&normals[candidate * 3], normal, 3 * sizeof(float)) == 0)) {
+					break;
+				}
+				slot = (slot + 1) & mask;
+			}
+
+			if (table[slot] == EMPTY_SLOT) {					// First time this vertex is seen
+				table[slot] = (unsigned int)vertexCount;
+				memcpy(&positions[vertexCount * 3], position, 3 * sizeof(float));
+				if (normal != NULL) {
+					memcpy(&normals[vertexCount * 3], normal, 3 * sizeof(float));
+				}
+				vertexCount++;
+			}
+			wideIndices[corner] = table[slot];
+		}
+		free(table);
+
+		// Give back the unused part of the worst case vertex buffers
+		float *shrunk = (float*)realloc(positions, vertexCount * 3 * sizeof(float));
+		if (shrunk != NULL) {
+			positions = shrunk;
+		}
+		shrunk = (float*)realloc(normals, vertexCount * 3 * sizeof(float));
+		if (shrunk != NULL) {
+			normals = shrunk;
+		}
+
+		indexCount = cornerCount;
+		if (vertexCount <= MAX_16BIT_VERTICES) {				// Halve the index buffer when it fits
+			unsigned short *narrowIndices = (unsigned short*)malloc(cornerCount * sizeof(unsigned short));
+			if (narrowIndices != NULL) {
+				for (long i = 0; i < cornerCount; i++) {
+					narrowIndices[i] = (unsigned short)wideIndices[i];
+				}
+				free(wideIndices);
+				indices = narrowIndices;
+				indexSize = sizeof(unsigned short);
+				return true;
+			}
+		}
+
+		indices = wideIndices;
+		indexSize = sizeof(unsigned int);
+		return true;
+	}
+
+	// Use buffers owned by someone else
+	void IndexedMesh::attach(float *positions, float *normals, void *indices,
+		long vertexCount, long indexCount, int indexSize)
+	{
+		release();
+
+		this->positions = positions;
+		this->normals = normals;
+		this->indices = indices;
+		this->vertexCount = vertexCount;
+		this->indexCount = indexCount;
+		this->indexSize = indexSize;
+		this->ownsBuffers = false;
+	}
+
+	// Free the mesh buffers
+	void IndexedMesh::release()
+	{
+		if (ownsBuffers) {
+			free(positions);
+			free(normals);
+			free(indices);
+		}
+
+		positions = NULL;
+		normals = NULL;
+		indices = NULL;
+		vertexCount = 0;
+		indexCount = 0;
+		indexSize = sizeof(unsigned int);
+		ownsBuffers = true;
+	}
+
+	// Return the vertex number at an index position
+	unsigned int IndexedMesh::getIndex(long i) const
+	{
+		if (indexSize == sizeof(unsigned short)) {
+			return ((const unsigned short*)indices)[i];
+		}
+		return ((const unsigned int*)indices)[i];
+	}
+
+	// Store one index
+	void IndexedMesh::setIndex(long i, unsigned int vertexNumber)
+	{
+		if (indexSize == sizeof(unsigned short)) {
+			((unsigned short*)indices)[i] = (unsigned short)vertexNumber;
+		}
+		else {
+			((unsigned int*)indices)[i] = vertexNumber;
+		}
+	}
+
+	// Check the index width
+	bool IndexedMesh::uses16BitIndices() const
+	{
+		return indexSize == sizeof(unsigned short);
+	}
+
+	// Return the bytes held by the mesh
+	size_t IndexedMesh::getSizeInBytes() const
+	{
+		return vertexCount * 6 * sizeof(float) + indexCount * indexSize;
+	}
+
+}	// namespace
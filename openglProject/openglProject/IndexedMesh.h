@@ -0,0 +1,69 @@
+#pragma once
+// IndexedMesh.h is the file that holds
+// a mesh stored as unique vertices and
+// an index buffer, ready for glDrawElements.
+
+// Header guards
+#ifndef INDEXED_MESH_H_
+#define INDEXED_MESH_H_
+
+// Include headers
+#include <stddef.h>
+
+namespace applicationFramework {
+
+	class IndexedMesh
+	{
+	public:
+		// Class constructor/destructor
+		IndexedMesh();
+		~IndexedMesh();
+
+		/** Builds the mesh from an unindexed triangle list, welding corners that
+		have bit-identical position and normal into a single vertex.
+		@param triangles - 3 floats (x,y,z) per corner, 3 corners per triangle
+		@param cornerNormals - 3 floats per corner, matching triangles. NULL welds on
+		position alone and leaves zero normals, to be generated per vertex afterwards.
+		@param cornerCount - the number of corners (3 per triangle)
+		@return false if the buffers could not be allocated
+		*/
+		bool build(const float *triangles, const float *cornerNormals, long cornerCount);
+
+		/** Points the mesh at buffers it does not own, e.g. a mapped cache file.
+		release() forgets them instead of freeing them.
+		*/
+		void attach(float *positions, float *normals, void *indices,
+			long vertexCount, long indexCount, int indexSize);
+
+		/** Frees the vertex and index buffers (if owned) */
+		void release();
+
+		/** Returns the vertex number stored at an index position */
+		unsigned int getIndex(long i) const;
+
+		/** Stores a vertex number at an index position, it must fit the index size */
+		void setIndex(long i, unsigned int vertexNumber);
+
+		/** Checks if the index buffer holds unsigned shorts (otherwise unsigned ints) */
+		bool uses16BitIndices() const;
+
+		/** The bytes held by the vertex and index buffers */
+		size_t getSizeInBytes() const;
+
+		float *positions;			// 3 floats per unique vertex
+		float *normals;				// 3 floats per unique vertex
+		void *indices;				// One unsigned short or unsigned int per corner
+		long vertexCount;			// Number of unique vertices
+		long indexCount;			// Number of indices (3 per triangle)
+		int indexSize;				// Bytes per index, 2 or 4
+		bool ownsBuffers;			// False when the buffers belong to someone else
+
+	private:
+		// The buffers are owned by the mesh and cannot be copied
+		IndexedMesh(const IndexedMesh &other);
+		IndexedMesh& operator=(const IndexedMesh &rhs);
+	};
+
+}	// namespace
+
+#endif
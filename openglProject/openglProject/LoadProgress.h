@@ -0,0 +1,46 @@
+#pragma once
+// LoadProgress.h is the file that holds
+// the progress shared between a model
+// being loaded on one thread and the
+// threads watching or cancelling it.
+
+// Header guards
+#ifndef LOAD_PROGRESS_H_
+#define LOAD_PROGRESS_H_
+
+// Include headers
+#include <atomic>
+
+namespace applicationFramework {
+
+	// Returned by the Obj_Loader load functions when a load was cancelled
+	static const int LOAD_RESULT_CANCELLED = -2;
+
+	struct LoadProgress
+	{
+		std::atomic<float> fraction;		// 0 to 1, only ever moves forwards
+		std::atomic<bool> isCancelled;		// Set by any thread to stop the load early
+
+		LoadProgress() : fraction(0.0f), isCancelled(false) {}
+
+		/** Moves the fraction forwards, reports from several threads may arrive out of order */
+		void report(float value) {
+			float current = fraction.load();
+			while (value > current && !fraction.compare_exchange_weak(current, value)) {
+			}
+		}
+
+		/** Checks if the load should stop */
+		bool isCancelRequested() const {
+			return isCancelled.load();
+		}
+
+	private:
+		// Shared by address between threads
+		LoadProgress(const LoadProgress &other);
+		LoadProgress& operator=(const LoadProgress &rhs);
+	};
+
+}	// namespace
+
+#endif
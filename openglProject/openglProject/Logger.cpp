@@ -0,0 +1,262 @@
+// Logger.cpp is the file that holds
+// the implementation for the message
+// queue and the thread writing it out.
+
+// Include headers
+#include <stdarg.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace applicationFramework {
+
+	// How long the writer sleeps when the queue is empty
+	static const int LOG_IDLE_MILLISECONDS = 1;
+
+	// Queued messages that wake a sleeping writer before its sleep is over
+	static const unsigned long long LOG_WAKE_THRESHOLD = LOG_QUEUE_CAPACITY / 8;
+
+	// One queued message. A slot is free for the producer claiming position p when its
+	// sequence is p, and holds a message for the writer once its sequence is p + 1.
+	struct LogSlot
+	{
+		std::atomic<unsigned long long> sequence;
+		LogLevel level;
+		char text[LOG_MESSAGE_SIZE];
+	};
+
+	static LogSlot slots[LOG_QUEUE_CAPACITY];
+	static std::atomic<unsigned long long> enqueuePosition(0);
+	static unsigned long long dequeuePosition = 0;				// Only the writer thread reads slots
+	static std::atomic<unsigned long long> writtenCount(0);		// Messages written and flushed
+	static std::atomic<unsigned long long> droppedCount(0);
+
+	static std::atomic<int> minimumLevel(LOG_LEVEL_TRACE);
+	static std::atomic<FILE*> output(NULL);
+
+	static std::once_flag started;
+	static std::thread *writerThread = NULL;
+	static std::atomic<bool> isRunning(false);
+	static std::atomic<bool> isStopped(false);			// Messages are written by their caller after stop()
+	static std::atomic<int> activeProducers(0);			// Callers between the isStopped check and publishing their slot
+
+	static std::mutex wakeMutex;
+	static std::condition_variable wakeUp;
+	static std::atomic<bool> isWriterSleeping(false);
+
+	// The stream a message goes to
+	static FILE* getStream(LogLevel level)
+	{
+		FILE *file = output.load(std::memory_order_relaxed);
+		if (file != NULL) {
+			return file;
+		}
+		return level >= LOG_LEVEL_WARNING ? stderr : stdout;
+	}
+
+	// Write the messages queued so far, then flush them
+	static unsigned long long drainQueue()
+	{
+		unsigned long long count = 0;
+		for (;;) {
+			LogSlot &slot = slots[dequeuePosition % LOG_QUEUE_CAPACITY];
+			if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+				break;
+			}
+			FILE *stream = getStream(slot.level);
+			fputs(slot.text, stream);
+			fputc('\n', stream);
+			slot.sequence.store(dequeuePosition + LOG_QUEUE_CAPACITY, std::memory_order_release);
+			dequeuePosition++;
+			count++;
+		}
+
+		// Say how many were lost since the last time
+		static unsigned long long reportedDropCount = 0;
+		unsigned long long dropCount = droppedCount.load(std::memory_order_relaxed);
+		if (dropCount != reportedDropCount) {
+			fprintf(getStream(LOG_LEVEL_WARNING), "Logger: %llu messages dropped, the queue was full\n", dropCount - reportedDropCount);
+			reportedDropCount = dropCount;
+		}
+
+		if (count > 0) {
+			fflush(getStream(LOG_LEVEL_INFO));
+			fflush(getStream(LOG_LEVEL_ERROR));
+			writtenCount.store(dequeuePosition, std::memory_order_release);
+		}
+		return count;
+	}
+
+	// Sleep until the idle time is over or a producer finds the queue filling up
+	static void waitForMessages()
+	{
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		isWriterSleeping.store(true);
+		LogSlot &next = slots[dequeuePosition % LOG_QUEUE_CAPACITY];
+		if (next.sequence.load() != dequeuePosition + 1 && isRunning.load()) {	// Checked after the flag, so a message published before it is not slept over
+			wakeUp.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_MILLISECONDS));
+		}
+		isWriterSleeping.store(false);
+	}
+
+	// Write messages as they arrive until stopped, then write the rest
+	static void writerLoop()
+	{
+		Profiler::setThreadName("Logger");
+		for (;;) {
+			bool isStopping = !isRunning.load(std::memory_order_acquire);
+			if (drainQueue() == 0) {
+				if (isStopping) {
+					break;
+				}
+				waitForMessages();
+			}
+		}
+	}
+
+	// Wake the writer early
+	static void wakeWriter()
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		wakeUp.notify_one();
+	}
+
+	// Free every slot and start the writer
+	static void startWriter()
+	{
+		for (unsigned int i = 0; i < LOG_QUEUE_CAPACITY; i++) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		isRunning.store(true);
+		writerThread = new std::thread(writerLoop);
+		atexit(Logger::stop);
+	}
+
+	// Claim a slot, format into it, then hand it to the writer
+	void Logger::write(LogLevel level, const char *format, ...)
+	{
+		if ((int)level < minimumLevel.load(std::memory_order_relaxed)) {
+			return;
+		}
+
+		va_list arguments;
+		va_start(arguments, format);
+		activeProducers.fetch_add(1);						// Before the check, stop() waits for it to drop back
+		if (isStopped.load()) {
+			activeProducers.fetch_sub(1);
+			FILE *stream = getStream(level);
+			vfprintf(stream, format, arguments);
+			fputc('\n', stream);
+			va_end(arguments);
+			return;
+		}
+		std::call_once(started, startWriter);
+
+		unsigned long long position = enqueuePosition.load(std::memory_order_relaxed);
+		LogSlot *slot;
+		for (;;) {
+			slot = &slots[position % LOG_QUEUE_CAPACITY];
+			long long difference = (long long)(slot->sequence.load(std::memory_order_acquire) - position);
+			if (difference == 0) {
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (difference < 0) {		// The writer has not freed the slot yet, the queue is full
+				droppedCount.fetch_add(1, std::memory_order_relaxed);
+				activeProducers.fetch_sub(1);
+				va_end(arguments);
+				return;
+			}
+			else {							// Another producer claimed it
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		vsnprintf(slot->text, LOG_MESSAGE_SIZE, format, arguments);
+		va_end(arguments);
+		slot->level = level;
+		slot->sequence.store(position + 1);
+		activeProducers.fetch_sub(1);
+
+		// Wake the writer once enough is waiting, rather than let the queue fill during its sleep
+		if (isWriterSleeping.load() && position + 1 - writtenCount.load(std::memory_order_relaxed) >= LOG_WAKE_THRESHOLD) {
+			wakeWriter();
+		}
+	}
+
+	// Set the runtime level
+	void Logger::setLevel(LogLevel level)
+	{
+		minimumLevel.store((int)level);
+	}
+
+	// Return the runtime level
+	LogLevel Logger::getLevel()
+	{
+		return (LogLevel)minimumLevel.load();
+	}
+
+	// Set the output file
+	void Logger::setOutput(FILE *file)
+	{
+		output.store(file);
+	}
+
+	// Wait for the writer to catch up
+	void Logger::flush()
+	{
+		unsigned long long target = enqueuePosition.load(std::memory_order_acquire);
+		while (isRunning.load(std::memory_order_acquire) && writtenCount.load(std::memory_order_acquire) < target) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(LOG_IDLE_MILLISECONDS));
+		}
+	}
+
+	// Drain and join the writer
+	void Logger::stop()
+	{
+		isStopped.store(true);
+		while (activeProducers.load() > 0) {				// Slots claimed before the flag was seen are published first
+			std::this_thread::yield();
+		}
+		if (writerThread != NULL) {
+			isRunning.store(false);
+			wakeWriter();
+			writerThread->join();
+			delete writerThread;
+			writerThread = NULL;
+		}
+		fflush(stdout);
+		fflush(stderr);
+	}
+
+	// Return the drop count
+	unsigned long long Logger::getDroppedCount()
+	{
+		return droppedCount.load();
+	}
+
+	// Return the name of a level
+	const char* Logger::getLevelName(LogLevel level)
+	{
+		switch (level) {
+		case LOG_LEVEL_TRACE:
+			return "trace";
+		case LOG_LEVEL_DEBUG:
+			return "debug";
+		case LOG_LEVEL_INFO:
+			return "info";
+		case LOG_LEVEL_WARNING:
+			return "warning";
+		default:
+			return "error";
+		}
+	}
+
+}	// namespace
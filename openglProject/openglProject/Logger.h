@@ -0,0 +1,117 @@
+#pragma once
+// Logger.h is the file that holds the
+// levelled log messages written to the
+// console from a background thread.
+
+// Header guards
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+// Include headers
+#include <stdio.h>
+
+// The least severe level compiled in, the macros below it expand to nothing:
+// 0 trace, 1 debug, 2 info, 3 warning, 4 error, 5 none.
+// Debug builds keep everything, release builds drop the per-frame and per-event messages.
+#ifndef FRAMEWORK_LOG_LEVEL
+	#if defined(_DEBUG)
+		#define FRAMEWORK_LOG_LEVEL 0
+	#else
+		#define FRAMEWORK_LOG_LEVEL 2
+	#endif
+#endif
+
+namespace applicationFramework {
+
+	// How severe a message is, matching the FRAMEWORK_LOG_LEVEL numbers
+	enum LogLevel
+	{
+		LOG_LEVEL_TRACE = 0,		// Every frame
+		LOG_LEVEL_DEBUG = 1,		// Every input event
+		LOG_LEVEL_INFO = 2,
+		LOG_LEVEL_WARNING = 3,
+		LOG_LEVEL_ERROR = 4
+	};
+
+	// Messages that can wait to be written, more are dropped (and counted) instead of blocking
+	static const unsigned int LOG_QUEUE_CAPACITY = 4096;
+
+	// Characters kept of a message, the rest is cut off
+	static const unsigned int LOG_MESSAGE_SIZE = 256;
+
+	/* Writes log messages without blocking the caller on the console. A message is
+	* formatted into a slot of a bounded lock-free queue (any number of threads may
+	* log at once, claiming slots with one compare and swap) and a background thread
+	* writes the slots out, warnings and errors to stderr and the rest to stdout.
+	* The thread starts with the first message and drains the queue when the
+	* program exits. Use the LOG_ macros so filtered levels cost nothing.
+	*/
+	class Logger
+	{
+	public:
+		/** Queues a message, formatted as printf does. A line break is added.
+		@param level - how severe the message is, below getLevel() it is ignored
+		*/
+		static void write(LogLevel level, const char *format, ...);
+
+		/** Ignores messages below a level at runtime, on top of FRAMEWORK_LOG_LEVEL */
+		static void setLevel(LogLevel level);
+		static LogLevel getLevel();
+
+		/** Writes every message to one file instead of stdout and stderr, NULL to go back.
+		Call before logging from other threads.
+		*/
+		static void setOutput(FILE *file);
+
+		/** Waits until the messages queued so far are written */
+		static void flush();
+
+		/** Writes the queued messages and stops the thread, later messages are written
+		by the caller. Runs when the program exits.
+		*/
+		static void stop();
+
+		/** Messages dropped because the queue was full */
+		static unsigned long long getDroppedCount();
+
+		/** A readable name for a level, e.g. "warning" */
+		static const char* getLevelName(LogLevel level);
+	};
+
+}	// namespace
+
+// The logging macros, levels below FRAMEWORK_LOG_LEVEL are compiled out. Their
+// arguments are still type-checked and count as used, but never evaluated.
+#define LOG_DISCARD(level, ...) do { if (0) { applicationFramework::Logger::write(level, __VA_ARGS__); } } while (0)
+
+#if FRAMEWORK_LOG_LEVEL <= 0
+	#define LOG_TRACE(...) applicationFramework::Logger::write(applicationFramework::LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+	#define LOG_TRACE(...) LOG_DISCARD(applicationFramework::LOG_LEVEL_TRACE, __VA_ARGS__)
+#endif
+
+#if FRAMEWORK_LOG_LEVEL <= 1
+	#define LOG_DEBUG(...) applicationFramework::Logger::write(applicationFramework::LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+	#define LOG_DEBUG(...) LOG_DISCARD(applicationFramework::LOG_LEVEL_DEBUG, __VA_ARGS__)
+#endif
+
+#if FRAMEWORK_LOG_LEVEL <= 2
+	#define LOG_INFO(...) applicationFramework::Logger::write(applicationFramework::LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+	#define LOG_INFO(...) LOG_DISCARD(applicationFramework::LOG_LEVEL_INFO, __VA_ARGS__)
+#endif
+
+#if FRAMEWORK_LOG_LEVEL <= 3
+	#define LOG_WARNING(...) applicationFramework::Logger::write(applicationFramework::LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+	#define LOG_WARNING(...) LOG_DISCARD(applicationFramework::LOG_LEVEL_WARNING, __VA_ARGS__)
+#endif
+
+#if FRAMEWORK_LOG_LEVEL <= 4
+	#define LOG_ERROR(...) applicationFramework::Logger::write(applicationFramework::LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+	#define LOG_ERROR(...) LOG_DISCARD(applicationFramework::LOG_LEVEL_ERROR, __VA_ARGS__)
+#endif
+
+#endif
@@ -0,0 +1,149 @@
+// MappedFile.cpp is the file that
+// holds the implementation for the
+// memory mapped file reader.
+
+// Include headers
+#include "MappedFile.h"
+
+namespace applicationFramework {
+
+// Class constructor
+MappedFile::MappedFile()
+{
+	_data = NULL;
+	_size = 0;
+	_isOpen = false;
+	_isCopyOnWrite = false;
+
+#ifdef WIN32
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+#else
+	_descriptor = -1;
+#endif
+}
+
+// Class destructor
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// Map the file into memory
+bool MappedFile::open(const char *filename, bool isCopyOnWrite)
+{
+	close();
+
+#ifdef WIN32
+	_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize)) {
+		close();
+		return false;
+	}
+	_size = (size_t)fileSize.QuadPart;
+
+	if (_size > 0) {
+		_mapping = CreateFileMappingA(_file, NULL, isCopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+		if (_mapping == NULL) {
+			close();
+			return false;
+		}
+
+		_data = (const char*)MapViewOfFile(_mapping, isCopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+		if (_data == NULL) {
+			close();
+			return false;
+		}
+	}
+#else
+	_descriptor = ::open(filename, O_RDONLY);
+	if (_descriptor < 0) {
+		return false;
+	}
+
+	struct stat fileInfo;
+	if (fstat(_descriptor, &fileInfo) != 0) {
+		close();
+		return false;
+	}
+	_size = (size_t)fileInfo.st_size;
+
+	if (_size > 0) {
+		int protection = isCopyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+		void *view = mmap(NULL, _size, protection, MAP_PRIVATE, _descriptor, 0);
+		if (view == MAP_FAILED) {
+			close();
+			return false;
+		}
+		madvise(view, _size, MADV_SEQUENTIAL);	// The parsers read front to back
+		_data = (const char*)view;
+	}
+#endif
+
+	_isOpen = true;
+	_isCopyOnWrite = isCopyOnWrite;
+	return true;
+}
+
+// Unmap the file
+void MappedFile::close()
+{
+#ifdef WIN32
+	if (_data != NULL) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != NULL) {
+		CloseHandle(_mapping);
+	}
+	if (_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(_file);
+	}
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = NULL;
+#else
+	if (_data != NULL) {
+		munmap((void*)_data, _size);
+	}
+	if (_descriptor >= 0) {
+		::close(_descriptor);
+	}
+	_descriptor = -1;
+#endif
+
+	_data = NULL;
+	_size = 0;
+	_isOpen = false;
+	_isCopyOnWrite = false;
+}
+
+// Check if a file is mapped
+bool MappedFile::isOpen() const
+{
+	return _isOpen;
+}
+
+// Return the mapped bytes
+const char* MappedFile::getData() const
+{
+	return _data;
+}
+
+// Return the mapped bytes if they can be written
+char* MappedFile::getWritableData() const
+{
+	return _isCopyOnWrite ? (char*)_data : NULL;
+}
+
+// Return the mapped size
+size_t MappedFile::getSize() const
+{
+	return _size;
+}
+
+}
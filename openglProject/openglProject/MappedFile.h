@@ -0,0 +1,73 @@
+#pragma once
+// MappedFile.h is the file that maps
+// a file on disk into memory so it
+// can be read without copying.
+
+// Header guards
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+// Include headers
+#include <stddef.h>
+
+#ifdef WIN32
+#include <windows.h>	// Windows
+#else
+#include <sys/mman.h>	// Mac/Unix
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace applicationFramework {
+
+	class MappedFile
+	{
+	public:
+		// Class constructor/destructor
+		MappedFile();
+		~MappedFile();
+
+		/** Maps the whole file into memory.
+		@param filename - the file to map
+		@param isCopyOnWrite - allow writes to the mapped bytes, they stay private to the process
+		@return true if the file was opened (an empty file maps to no data)
+		*/
+		bool open(const char *filename, bool isCopyOnWrite = false);
+
+		/** Unmaps the file and closes the handles */
+		void close();
+
+		/** Checks to see if a file is currently mapped */
+		bool isOpen() const;
+
+		/** The first byte of the mapped file, NULL for an empty file */
+		const char* getData() const;
+
+		/** The first byte of a copy-on-write mapping, NULL otherwise */
+		char* getWritableData() const;
+
+		/** The size of the mapped file in bytes */
+		size_t getSize() const;
+
+	private:
+		// Mappings own operating system handles and cannot be copied
+		MappedFile(const MappedFile &other);
+		MappedFile& operator=(const MappedFile &rhs);
+
+		const char *_data;
+		size_t _size;
+		bool _isOpen;
+		bool _isCopyOnWrite;
+
+#ifdef WIN32
+		HANDLE _file;
+		HANDLE _mapping;
+#else
+		int _descriptor;
+#endif
+
+	};
+}	// namespace
+
+#endif
@@ -0,0 +1,233 @@
+// MeshCache.cpp is the file that
+// holds the implementation for the
+// binary mesh cache.
+
+// Include headers
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <atomic>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "MeshCache.h"
+
+namespace applicationFramework {
+
+	// Identifies a cache file
+	static const char MESH_CACHE_MAGIC[8] = { 'O', 'B', 'J', 'C', 'A', 'C', 'H', 'E' };
+
+	// Written in native byte order, reads back differently on other machines
+	static const uint32_t MESH_CACHE_BYTE_ORDER = 0x01020304u;
+
+	// Round an offset up to the section alignment
+	static uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+	}
+
+	// Read the size and modification time of a source model, the time in nanoseconds
+	// so a model rewritten within the same second still invalidates its cache
+	static bool getSourceStamp(const char *sourceFile, uint64_t &size, int64_t &modifiedTime)
+	{
+#ifdef WIN32
+		WIN32_FILE_ATTRIBUTE_DATA fileInfo;
+		if (!GetFileAttributesExA(sourceFile, GetFileExInfoStandard, &fileInfo)) {
+			return false;
+		}
+		size = ((uint64_t)fileInfo.nFileSizeHigh << 32) | fileInfo.nFileSizeLow;
+		uint64_t ticks = ((uint64_t)fileInfo.ftLastWriteTime.dwHighDateTime << 32) | fileInfo.ftLastWriteTime.dwLowDateTime;
+		modifiedTime = (int64_t)ticks * 100;						// 100 nanosecond ticks
+#else
+		struct stat fileInfo;
+		if (stat(sourceFile, &fileInfo) != 0) {
+			return false;
+		}
+		size = (uint64_t)fileInfo.st_size;
+	#if defined(__APPLE__)
+		modifiedTime = (int64_t)fileInfo.st_mtimespec.tv_sec * 1000000000 + fileInfo.st_mtimespec.tv_nsec;
+	#else
+		modifiedTime = (int64_t)fileInfo.st_mtim.tv_sec * 1000000000 + fileInfo.st_mtim.tv_nsec;
+	#endif
+#endif
+		return true;
+	}
+
+	// Return a temporary path next to the cache that no other writer uses, the process id
+	// keeps processes apart and the counter keeps the threads of this one apart
+	static std::string getTemporaryPath(const std::string &cachePath)
+	{
+		static std::atomic<unsigned long> writeCount(0);
+#ifdef WIN32
+		unsigned long processId = (unsigned long)GetCurrentProcessId();
+#else
+		unsigned long processId = (unsigned long)getpid();
+#endif
+		char suffix[48];
+		snprintf(suffix, sizeof(suffix), ".%lu.%lu.tmp", processId, writeCount.fetch_add(1));
+		return cachePath + suffix;
+	}
+
+	// Check that every index names a vertex
+	template <typename Index>
+	static bool areIndicesInRange(const Index *indices, uint64_t indexCount, uint64_t vertexCount)
+	{
+		Index maxIndex = 0;
+		for (uint64_t i = 0; i < indexCount; i++) {
+			maxIndex = indices[i] > maxIndex ? indices[i] : maxIndex;
+		}
+		return indexCount == 0 || (uint64_t)maxIndex < vertexCount;
+	}
+
+	// Write zeros up to an aligned offset
+	static bool writePadding(FILE *file, uint64_t from, uint64_t to)
+	{
+		static const char zeros[MESH_CACHE_ALIGNMENT] = { 0 };
+		return to == from || fwrite(zeros, 1, (size_t)(to - from), file) == to - from;
+	}
+
+	// Class constructor
+	MeshCache::MeshCache()
+	{
+	}
+
+	// Class destructor
+	MeshCache::~MeshCache()
+	{
+		close();
+	}
+
+	// Map a valid cache and attach its sections to the mesh
+	bool MeshCache::open(const char *sourceFile, IndexedMesh &mesh, NormalMode normalMode)
+	{
+		close();
+
+		uint64_t sourceSize;
+		int64_t sourceModifiedTime;
+		if (!getSourceStamp(sourceFile, sourceSize, sourceModifiedTime)) {
+			return false;
+		}
+
+		// Copy-on-write, so later stages may edit the mesh in place
+		if (!cacheFile.open(getCachePath(sourceFile).c_str(), true)) {
+			return false;
+		}
+
+		uint64_t fileSize = cacheFile.getSize();
+		char *data = cacheFile.getWritableData();
+		if (fileSize < sizeof(MeshCacheHeader)) {
+			close();
+			return false;
+		}
+
+		MeshCacheHeader header;
+		memcpy(&header, data, sizeof(header));
+
+		bool isValid = memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+			header.version == MESH_CACHE_VERSION &&
+			(header.indexSize == sizeof(unsigned short) || header.indexSize == sizeof(unsigned int)) &&
+			header.vertexCount <= fileSize / (3 * sizeof(float)) &&				// Counts a damaged header could overflow the sizes with
+			header.indexCount <= fileSize / header.indexSize;
+		uint64_t vertexBytes = isValid ? header.vertexCount * 3 * sizeof(float) : 0;
+		uint64_t indexBytes = isValid ? header.indexCount * header.indexSize : 0;
+		isValid = isValid &&
+			header.byteOrder == MESH_CACHE_BYTE_ORDER &&
+			header.sourceSize == sourceSize &&									// Stale if the model changed
+			header.sourceModifiedTime == sourceModifiedTime &&
+			header.normalMode == (uint32_t)normalMode &&
+			header.indexCount % 3 == 0 &&
+			header.positionsOffset % MESH_CACHE_ALIGNMENT == 0 &&
+			header.normalsOffset % MESH_CACHE_ALIGNMENT == 0 &&
+			header.indicesOffset % MESH_CACHE_ALIGNMENT == 0 &&
+			header.positionsOffset <= fileSize && vertexBytes <= fileSize - header.positionsOffset &&
+			header.normalsOffset <= fileSize && vertexBytes <= fileSize - header.normalsOffset &&
+			header.indicesOffset <= fileSize && indexBytes <= fileSize - header.indicesOffset;
+
+		// A truncated or stale index section would make draws read past the vertices
+		if (isValid && header.indexSize == sizeof(unsigned short)) {
+			isValid = areIndicesInRange((const unsigned short*)(data + header.indicesOffset), header.indexCount, header.vertexCount);
+		}
+		else if (isValid) {
+			isValid = areIndicesInRange((const unsigned int*)(data + header.indicesOffset), header.indexCount, header.vertexCount);
+		}
+		if (!isValid) {
+			close();
+			return false;
+		}
+
+		mesh.attach((float*)(data + header.positionsOffset), (float*)(data + header.normalsOffset),
+			data + header.indicesOffset, (long)header.vertexCount, (long)header.indexCount, (int)header.indexSize);
+		return true;
+	}
+
+	// Unmap the cache
+	void MeshCache::close()
+	{
+		cacheFile.close();
+	}
+
+	// Check if a cache is mapped
+	bool MeshCache::isOpen() const
+	{
+		return cacheFile.isOpen();
+	}
+
+	// Save a mesh next to its source model
+	bool MeshCache::write(const char *sourceFile, const IndexedMesh &mesh, NormalMode normalMode)
+	{
+		MeshCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		if (!getSourceStamp(sourceFile, header.sourceSize, header.sourceModifiedTime)) {
+			return false;
+		}
+
+		memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+		header.version = MESH_CACHE_VERSION;
+		header.byteOrder = MESH_CACHE_BYTE_ORDER;
+		header.vertexCount = mesh.vertexCount;
+		header.indexCount = mesh.indexCount;
+		header.indexSize = mesh.indexSize;
+		header.normalMode = (uint32_t)normalMode;
+
+		uint64_t vertexBytes = header.vertexCount * 3 * sizeof(float);
+		uint64_t indexBytes = header.indexCount * header.indexSize;
+		header.positionsOffset = alignOffset(sizeof(header));
+		header.normalsOffset = alignOffset(header.positionsOffset + vertexBytes);
+		header.indicesOffset = alignOffset(header.normalsOffset + vertexBytes);
+
+		// Write to a temporary file first, so a crash never leaves a truncated cache
+		std::string cachePath = getCachePath(sourceFile);
+		std::string temporaryPath = getTemporaryPath(cachePath);
+		FILE *file = fopen(temporaryPath.c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+
+		bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			writePadding(file, sizeof(header), header.positionsOffset) &&
+			fwrite(mesh.positions, 1, (size_t)vertexBytes, file) == vertexBytes &&
+			writePadding(file, header.positionsOffset + vertexBytes, header.normalsOffset) &&
+			fwrite(mesh.normals, 1, (size_t)vertexBytes, file) == vertexBytes &&
+			writePadding(file, header.normalsOffset + vertexBytes, header.indicesOffset) &&
+			fwrite(mesh.indices, 1, (size_t)indexBytes, file) == indexBytes;
+		isWritten = fclose(file) == 0 && isWritten;
+
+		if (isWritten) {
+			remove(cachePath.c_str());						// rename() won't replace a file on Windows
+			isWritten = rename(temporaryPath.c_str(), cachePath.c_str()) == 0;
+		}
+		if (!isWritten) {
+			remove(temporaryPath.c_str());
+		}
+		return isWritten;
+	}
+
+	// Return the cache path of a source model
+	std::string MeshCache::getCachePath(const char *sourceFile)
+	{
+		return std::string(sourceFile) + ".cache";
+	}
+
+}	// namespace
@@ -0,0 +1,90 @@
+#pragma once
+// MeshCache.h is the file that saves
+// indexed meshes to a binary file next
+// to their source model and maps them
+// back in without any parsing.
+
+// Header guards
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+// Include headers
+#include <stdint.h>
+#include <string>
+
+#include "IndexedMesh.h"
+#include "MappedFile.h"
+#include "MeshNormals.h"
+
+namespace applicationFramework {
+
+	// Bump whenever the layout of the cache file changes
+	static const uint32_t MESH_CACHE_VERSION = 3;
+
+	// Every section starts on a cache line boundary
+	static const uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+	/* The header at the start of a cache file. Each section is stored at its
+	* offset from the start of the file, aligned to MESH_CACHE_ALIGNMENT.
+	*/
+	struct MeshCacheHeader
+	{
+		char magic[8];					// "OBJCACHE"
+		uint32_t version;				// MESH_CACHE_VERSION
+		uint32_t byteOrder;				// 0x01020304 as written by the machine that made the cache
+		uint64_t sourceSize;			// Size of the source model in bytes
+		int64_t sourceModifiedTime;		// Modification time of the source model (nanoseconds, as fine as the file system keeps it)
+		uint64_t vertexCount;			// Unique vertices
+		uint64_t indexCount;			// Indices, 3 per triangle
+		uint32_t indexSize;				// Bytes per index, 2 or 4
+		uint32_t normalMode;			// NormalMode the normals were generated with
+		uint64_t positionsOffset;		// 3 floats per vertex
+		uint64_t normalsOffset;			// 3 floats per vertex
+		uint64_t indicesOffset;			// indexSize bytes per index
+	};
+
+	class MeshCache
+	{
+	public:
+		// Class constructor/destructor
+		MeshCache();
+		~MeshCache();
+
+		/** Maps the cache of a source model if it is still valid (same size,
+		modification time and normal mode) and points the mesh at the mapped sections.
+		Every index is checked against the vertex count, so a damaged cache is never drawn.
+		@param sourceFile - the source model, the cache is looked up next to it
+		@param mesh - receives the mapped buffers, it does not own them
+		@param normalMode - the normals the caller wants, a cache built with others is stale
+		@return false if there is no valid cache
+		*/
+		bool open(const char *sourceFile, IndexedMesh &mesh, NormalMode normalMode = NORMALS_FLAT);
+
+		/** Unmaps the cache, meshes attached to it must be released first */
+		void close();
+
+		/** Checks to see if a cache is currently mapped */
+		bool isOpen() const;
+
+		/** Writes a mesh to the cache of a source model.
+		@param sourceFile - the source model the mesh was built from
+		@param mesh - the mesh to save
+		@param normalMode - how the normals of the mesh were generated
+		@return false if the cache could not be written
+		*/
+		static bool write(const char *sourceFile, const IndexedMesh &mesh, NormalMode normalMode = NORMALS_FLAT);
+
+		/** The cache file used for a source model, "<source>.cache" */
+		static std::string getCachePath(const char *sourceFile);
+
+	private:
+		// The mapping is owned by the cache
+		MeshCache(const MeshCache &other);
+		MeshCache& operator=(const MeshCache &rhs);
+
+		MappedFile cacheFile;
+	};
+
+}	// namespace
+
+#endif
@@ -0,0 +1,171 @@
+// MeshLodChain.cpp is the file that
+// holds the implementation for the
+// level of detail chain.
+
+// Include headers
+#include <math.h>
+
+#include "MeshLodChain.h"
+#include "MeshSimplifier.h"
+
+namespace applicationFramework {
+
+	// Closest distance used for projection, so models around the camera get full detail
+	static const float MIN_PROJECTION_DISTANCE = 1e-4f;
+
+	// Class constructor
+	MeshLodChain::MeshLodChain()
+	{
+		boundingCenter[0] = boundingCenter[1] = boundingCenter[2] = 0.0f;
+		boundingRadius = 0.0f;
+	}
+
+	// Class destructor
+	MeshLodChain::~MeshLodChain()
+	{
+	}
+
+	// Simplify the mesh level by level
+	bool MeshLodChain::build(const IndexedMesh &mesh, const float *ratios, int ratioCount)
+	{
+		release();
+		if (mesh.indexCount < 3) {
+			return false;
+		}
+
+		// Bounding sphere around the box of the vertices
+		float minimum[3] = { mesh.positions[0], mesh.positions[1], mesh.positions[2] };
+		float maximum[3] = { mesh.positions[0], mesh.positions[1], mesh.positions[2] };
+		for (long vertex = 1; vertex < mesh.vertexCount; vertex++) {
+			for (int axis = 0; axis < 3; axis++) {
+				float value = mesh.positions[vertex * 3 + axis];
+				minimum[axis] = value < minimum[axis] ? value : minimum[axis];
+				maximum[axis] = value > maximum[axis] ? value : maximum[axis];
+			}
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			boundingCenter[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+		}
+		for (long vertex = 0; vertex < mesh.vertexCount; vertex++) {
+			float dx = mesh.positions[vertex * 3] - boundingCenter[0];
+			float dy = mesh.positions[vertex * 3 + 1] - boundingCenter[1];
+			float dz = mesh.positions[vertex * 3 + 2] - boundingCenter[2];
+			float radius = sqrtf(dx * dx + dy * dy + dz * dz);
+			boundingRadius = radius > boundingRadius ? radius : boundingRadius;
+		}
+
+		lodIndices.resize(1);
+		lodIndices[0].resize(mesh.indexCount);
+		for (long i = 0; i < mesh.indexCount; i++) {
+			lodIndices[0][i] = mesh.getIndex(i);
+		}
+		lodErrors.push_back(0.0f);
+
+		long fullTriangleCount = mesh.indexCount / 3;
+		for (int level = 0; level < ratioCount; level++) {
+			long targetTriangleCount = (long)(fullTriangleCount * ratios[level]);
+			const std::vector<unsigned int> &previous = lodIndices.back();
+			if (targetTriangleCount >= (long)previous.size() / 3) {
+				continue;										// Not smaller than the level before
+			}
+
+			std::vector<unsigned int> indices;
+			float error = simplifyMesh(mesh, previous, targetTriangleCount, indices);
+			if (indices.size() >= previous.size() || indices.empty()) {
+				break;											// Nothing left to collapse
+			}
+
+			lodErrors.push_back(lodErrors.back() + error);		// Each level was simplified from the last, so errors add up
+			lodIndices.push_back(std::vector<unsigned int>());
+			lodIndices.back().swap(indices);
+		}
+		return true;
+	}
+
+	// Free the levels
+	void MeshLodChain::release()
+	{
+		std::vector<std::vector<unsigned int> >().swap(lodIndices);
+		std::vector<float>().swap(lodErrors);
+		boundingCenter[0] = boundingCenter[1] = boundingCenter[2] = 0.0f;
+		boundingRadius = 0.0f;
+	}
+
+	// Return the number of levels
+	int MeshLodChain::getLodCount() const
+	{
+		return (int)lodIndices.size();
+	}
+
+	// Return the triangles of a level
+	const std::vector<unsigned int>& MeshLodChain::getIndices(int lod) const
+	{
+		return lodIndices[lod];
+	}
+
+	// Return the error of a level
+	float MeshLodChain::getError(int lod) const
+	{
+		return lodErrors[lod];
+	}
+
+	// Return the bytes held by the levels
+	size_t MeshLodChain::getSizeInBytes() const
+	{
+		size_t bytes = 0;
+		for (size_t level = 0; level < lodIndices.size(); level++) {
+			bytes += lodIndices[level].size() * sizeof(unsigned int);
+		}
+		return bytes;
+	}
+
+	// Return the radius of the bounding sphere
+	float MeshLodChain::getBoundingRadius() const
+	{
+		return boundingRadius;
+	}
+
+	// Scale of one model unit on screen at the nearest point of the bounding sphere
+	float MeshLodChain::getPixelsPerUnit(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &position,
+		float fieldOfView, int viewportHeight) const
+	{
+		Vector<float> sphereCenter(position.x + boundingCenter[0], position.y + boundingCenter[1], position.z + boundingCenter[2]);
+		Vector<float> toSphere = sphereCenter - eye;
+		Vector<float> viewDirection = center - eye;
+
+		float distance = toSphere.length();
+		if (viewDirection.length() > 0.0f) {				// Depth along the view direction, as the projection sees it
+			viewDirection.normalize();
+			distance = toSphere.dot(viewDirection);
+		}
+		distance -= boundingRadius;
+		if (distance < MIN_PROJECTION_DISTANCE) {
+			distance = MIN_PROJECTION_DISTANCE;
+		}
+
+		float halfAngle = fieldOfView * 0.5f * 3.14159265f / 180.0f;
+		return viewportHeight / (2.0f * tanf(halfAngle) * distance);
+	}
+
+	// Size of the bounding sphere on screen
+	float MeshLodChain::getProjectedSize(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &position,
+		float fieldOfView, int viewportHeight) const
+	{
+		return 2.0f * boundingRadius * getPixelsPerUnit(eye, center, position, fieldOfView, viewportHeight);
+	}
+
+	// Pick the coarsest level that still looks right
+	int MeshLodChain::selectLod(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &position,
+		float fieldOfView, int viewportHeight, float maxPixelError) const
+	{
+		float pixelsPerUnit = getPixelsPerUnit(eye, center, position, fieldOfView, viewportHeight);
+		int lod = 0;
+		for (int level = 1; level < getLodCount(); level++) {
+			if (lodErrors[level] * pixelsPerUnit <= maxPixelError) {
+				lod = level;
+			}
+		}
+		return lod;
+	}
+
+}	// namespace
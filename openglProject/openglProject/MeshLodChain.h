@@ -0,0 +1,85 @@
+#pragma once
+// MeshLodChain.h is the file that holds
+// the levels of detail of a mesh and picks
+// the one to draw from the camera.
+
+// Header guards
+#ifndef MESH_LOD_CHAIN_H_
+#define MESH_LOD_CHAIN_H_
+
+// Include headers
+#include <vector>
+
+#include "IndexedMesh.h"
+#include "Vector.h"
+
+namespace applicationFramework {
+
+	/* Levels of detail of one indexed mesh. Every level is an index buffer
+	* over the vertices of the mesh, so only the indices are stored per level.
+	* Level 0 is the full mesh.
+	*/
+	class MeshLodChain
+	{
+	public:
+		// Class constructor/destructor
+		MeshLodChain();
+		~MeshLodChain();
+
+		/** Builds the chain, each level simplified from the one before it.
+		@param mesh - the full detail mesh, it must outlive the chain
+		@param ratios - triangles of each level after 0 relative to the full mesh, decreasing (e.g. 0.5, 0.25, 0.125)
+		@param ratioCount - the number of ratios
+		@return false if the mesh has no triangles
+		*/
+		bool build(const IndexedMesh &mesh, const float *ratios, int ratioCount);
+
+		/** Frees the levels */
+		void release();
+
+		/** The number of levels, 0 before build() */
+		int getLodCount() const;
+
+		/** The triangles of a level, 3 vertex numbers each */
+		const std::vector<unsigned int>& getIndices(int lod) const;
+
+		/** The simplification error of a level in model units, 0 for level 0 */
+		float getError(int lod) const;
+
+		/** The bytes held by the index buffers of the levels */
+		size_t getSizeInBytes() const;
+
+		/** The radius of the sphere around the mesh, centered on its bounding box */
+		float getBoundingRadius() const;
+
+		/** How many pixels one model unit covers at a distance from the camera.
+		@param eye, center - the camera, as passed to gluLookAt (Application::getEyeVector/getCenterVector)
+		@param position - where the model is drawn
+		@param fieldOfView - vertical field of view in degrees
+		@param viewportHeight - in pixels
+		*/
+		float getPixelsPerUnit(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &position,
+			float fieldOfView, int viewportHeight) const;
+
+		/** The diameter of the bounding sphere on screen, in pixels (same parameters as getPixelsPerUnit) */
+		float getProjectedSize(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &position,
+			float fieldOfView, int viewportHeight) const;
+
+		/** Picks the coarsest level whose error stays under a number of pixels on screen
+		(same parameters as getPixelsPerUnit).
+		@param maxPixelError - the largest visible error allowed, in pixels
+		@return the level to draw, 0 if the chain is empty
+		*/
+		int selectLod(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &position,
+			float fieldOfView, int viewportHeight, float maxPixelError = 1.0f) const;
+
+	private:
+		std::vector<std::vector<unsigned int> > lodIndices;
+		std::vector<float> lodErrors;
+		float boundingCenter[3];			// Relative to the model's origin
+		float boundingRadius;
+	};
+
+}	// namespace
+
+#endif
@@ -0,0 +1,397 @@
+// MeshNormals.cpp is the file that
+// holds the implementation for the
+// mesh normal generation kernels.
+
+// Include headers
+#include <math.h>
+#include <new>
+#include <vector>
+
+#include "MeshNormals.h"
+
+namespace applicationFramework {
+
+	// Floats per triangle in an unindexed triangle list
+	static const int FLOATS_PER_TRIANGLE = 9;
+
+	// Blocks each thread takes in the smooth normal passes
+	static const long VERTEX_NORMAL_BLOCKS_PER_THREAD = 4;
+
+	// Meshes smaller than this are not worth spreading over threads
+	static const long MIN_PARALLEL_VERTEX_NORMALS = 4096;
+
+	// Spread one normal over the three corners of a triangle
+	static inline void storeCornerNormals(float *cornerNormals, float x, float y, float z)
+	{
+		for (int corner = 0; corner < 3; corner++) {
+			cornerNormals[corner * 3] = x;
+			cornerNormals[corner * 3 + 1] = y;
+			cornerNormals[corner * 3 + 2] = z;
+		}
+	}
+
+	// Compute a face normal with plain floating point math
+	void computeFaceNormal(const float *coord1, const float *coord2, const float *coord3, float *normal)
+	{
+		/* calculate Vector1 and Vector2 */
+		float va0 = coord1[0] - coord2[0];
+		float va1 = coord1[1] - coord2[1];
+		float va2 = coord1[2] - coord2[2];
+
+		float vb0 = coord1[0] - coord3[0];
+		float vb1 = coord1[1] - coord3[1];
+		float vb2 = coord1[2] - coord3[2];
+
+		/* cross product */
+		float vr0 = va1 * vb2 - vb1 * va2;
+		float vr1 = vb0 * va2 - va0 * vb2;
+		float vr2 = va0 * vb1 - vb0 * va1;
+
+		/* normalization factor, zero area faces get a zero normal */
+		float lengthSquared = vr0 * vr0 + vr1 * vr1 + vr2 * vr2;
+		if (lengthSquared > 0.0f) {
+			float length = sqrtf(lengthSquared);
+			normal[0] = vr0 / length;
+			normal[1] = vr1 / length;
+			normal[2] = vr2 / length;
+		}
+		else {
+			normal[0] = normal[1] = normal[2] = 0.0f;
+		}
+	}
+
+	// Scalar kernel
+	static void computeFaceNormalsScalar(const float *triangles, float *cornerNormals, long triangleCount)
+	{
+		for (long i = 0; i < triangleCount; i++) {
+			const float *triangle = &triangles[i * FLOATS_PER_TRIANGLE];
+			float normal[3];
+			computeFaceNormal(&triangle[0], &triangle[3], &triangle[6], normal);
+			storeCornerNormals(&cornerNormals[i * FLOATS_PER_TRIANGLE], normal[0], normal[1], normal[2]);
+		}
+	}
+
+#if defined(FRAMEWORK_X86)
+	/* The SIMD kernels work on blocks of triangles in structure-of-arrays form.
+	* Each corner is read as 4 floats (x,y,z and the next float) and 4x4 transposes
+	* turn them into x, y and z vectors. Normals go back the same way and are
+	* written with overlapping 4 float stores, in order, so the 4th lane is always
+	* overwritten by the next store. That over-reads and over-writes one float,
+	* so the last triangle is always left to the scalar kernel.
+	*/
+
+	// SSE2 kernel, 4 triangles per block. Same operations in the same order
+	// as computeFaceNormal, so the results match it bit for bit.
+	static void computeFaceNormalsSse2(const float *triangles, float *cornerNormals, long triangleCount)
+	{
+		const long BLOCK = 4;
+		long i = 0;
+
+		for (; i + BLOCK < triangleCount; i += BLOCK) {
+			const float *t = &triangles[i * FLOATS_PER_TRIANGLE];
+			__m128 c1x = _mm_loadu_ps(t), c1y = _mm_loadu_ps(t + 9), c1z = _mm_loadu_ps(t + 18), c1w = _mm_loadu_ps(t + 27);
+			__m128 c2x = _mm_loadu_ps(t + 3), c2y = _mm_loadu_ps(t + 12), c2z = _mm_loadu_ps(t + 21), c2w = _mm_loadu_ps(t + 30);
+			__m128 c3x = _mm_loadu_ps(t + 6), c3y = _mm_loadu_ps(t + 15), c3z = _mm_loadu_ps(t + 24), c3w = _mm_loadu_ps(t + 33);
+			_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+			_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+			_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+			__m128 va0 = _mm_sub_ps(c1x, c2x), va1 = _mm_sub_ps(c1y, c2y), va2 = _mm_sub_ps(c1z, c2z);
+			__m128 vb0 = _mm_sub_ps(c1x, c3x), vb1 = _mm_sub_ps(c1y, c3y), vb2 = _mm_sub_ps(c1z, c3z);
+
+			__m128 vr0 = _mm_sub_ps(_mm_mul_ps(va1, vb2), _mm_mul_ps(vb1, va2));
+			__m128 vr1 = _mm_sub_ps(_mm_mul_ps(vb0, va2), _mm_mul_ps(va0, vb2));
+			__m128 vr2 = _mm_sub_ps(_mm_mul_ps(va0, vb1), _mm_mul_ps(vb0, va1));
+
+			__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vr0, vr0), _mm_mul_ps(vr1, vr1)), _mm_mul_ps(vr2, vr2));
+			__m128 isValid = _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps());	// Masks out degenerate faces
+			__m128 length = _mm_sqrt_ps(lengthSquared);
+
+			__m128 n0 = _mm_and_ps(_mm_div_ps(vr0, length), isValid);
+			__m128 n1 = _mm_and_ps(_mm_div_ps(vr1, length), isValid);
+			__m128 n2 = _mm_and_ps(_mm_div_ps(vr2, length), isValid);
+			__m128 n3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(n0, n1, n2, n3);							// n0..n3 now hold one triangle each
+
+			float *out = &cornerNormals[i * FLOATS_PER_TRIANGLE];
+			__m128 perTriangle[4] = { n0, n1, n2, n3 };
+			for (long k = 0; k < BLOCK; k++) {
+				for (int corner = 0; corner < 3; corner++) {
+					_mm_storeu_ps(out + k * FLOATS_PER_TRIANGLE + corner * 3, perTriangle[k]);
+				}
+			}
+		}
+
+		computeFaceNormalsScalar(&triangles[i * FLOATS_PER_TRIANGLE],
+			&cornerNormals[i * FLOATS_PER_TRIANGLE], triangleCount - i);
+	}
+
+	// Load corner 'offset' of triangles k and k + 4 into the two halves of a register
+	FRAMEWORK_TARGET_AVX2 static inline __m256 loadCornerPair(const float *t, int k, int offset)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(t + k * FLOATS_PER_TRIANGLE + offset)),
+			_mm_loadu_ps(t + (k + 4) * FLOATS_PER_TRIANGLE + offset), 1);
+	}
+
+	// 4x4 transpose inside each 128-bit half, like _MM_TRANSPOSE4_PS
+	FRAMEWORK_TARGET_AVX2 static inline void transposeHalves(__m256 &r0, __m256 &r1, __m256 &r2, __m256 &r3)
+	{
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+		r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+
+	// AVX2 kernel, 8 triangles per block
+	FRAMEWORK_TARGET_AVX2 static void computeFaceNormalsAvx2(const float *triangles, float *cornerNormals, long triangleCount)
+	{
+		const long BLOCK = 8;
+		long i = 0;
+
+		for (; i + BLOCK < triangleCount; i += BLOCK) {
+			const float *t = &triangles[i * FLOATS_PER_TRIANGLE];
+			__m256 c1x = loadCornerPair(t, 0, 0), c1y = loadCornerPair(t, 1, 0), c1z = loadCornerPair(t, 2, 0), c1w = loadCornerPair(t, 3, 0);
+			__m256 c2x = loadCornerPair(t, 0, 3), c2y = loadCornerPair(t, 1, 3), c2z = loadCornerPair(t, 2, 3), c2w = loadCornerPair(t, 3, 3);
+			__m256 c3x = loadCornerPair(t, 0, 6), c3y = loadCornerPair(t, 1, 6), c3z = loadCornerPair(t, 2, 6), c3w = loadCornerPair(t, 3, 6);
+			transposeHalves(c1x, c1y, c1z, c1w);
+			transposeHalves(c2x, c2y, c2z, c2w);
+			transposeHalves(c3x, c3y, c3z, c3w);
+
+			__m256 va0 = _mm256_sub_ps(c1x, c2x), va1 = _mm256_sub_ps(c1y, c2y), va2 = _mm256_sub_ps(c1z, c2z);
+			__m256 vb0 = _mm256_sub_ps(c1x, c3x), vb1 = _mm256_sub_ps(c1y, c3y), vb2 = _mm256_sub_ps(c1z, c3z);
+
+			__m256 vr0 = _mm256_sub_ps(_mm256_mul_ps(va1, vb2), _mm256_mul_ps(vb1, va2));
+			__m256 vr1 = _mm256_sub_ps(_mm256_mul_ps(vb0, va2), _mm256_mul_ps(va0, vb2));
+			__m256 vr2 = _mm256_sub_ps(_mm256_mul_ps(va0, vb1), _mm256_mul_ps(vb0, va1));
+
+			__m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vr0, vr0), _mm256_mul_ps(vr1, vr1)), _mm256_mul_ps(vr2, vr2));
+			__m256 isValid = _mm256_cmp_ps(lengthSquared, _mm256_setzero_ps(), _CMP_GT_OQ);
+			__m256 length = _mm256_sqrt_ps(lengthSquared);
+
+			__m256 n0 = _mm256_and_ps(_mm256_div_ps(vr0, length), isValid);
+			__m256 n1 = _mm256_and_ps(_mm256_div_ps(vr1, length), isValid);
+			__m256 n2 = _mm256_and_ps(_mm256_div_ps(vr2, length), isValid);
+			__m256 n3 = _mm256_setzero_ps();
+			transposeHalves(n0, n1, n2, n3);							// Halves of n0..n3 hold triangles k and k + 4
+
+			float *out = &cornerNormals[i * FLOATS_PER_TRIANGLE];
+			__m256 perTriangle[4] = { n0, n1, n2, n3 };
+			for (long k = 0; k < BLOCK; k++) {
+				__m128 normal = k < 4 ? _mm256_castps256_ps128(perTriangle[k]) : _mm256_extractf128_ps(perTriangle[k - 4], 1);
+				for (int corner = 0; corner < 3; corner++) {
+					_mm_storeu_ps(out + k * FLOATS_PER_TRIANGLE + corner * 3, normal);
+				}
+			}
+		}
+
+		computeFaceNormalsScalar(&triangles[i * FLOATS_PER_TRIANGLE],
+			&cornerNormals[i * FLOATS_PER_TRIANGLE], triangleCount - i);
+	}
+#endif
+
+	// Compute flat normals with the best kernel
+	void computeFaceNormals(const float *triangles, float *cornerNormals, long triangleCount)
+	{
+		static const SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		computeFaceNormals(triangles, cornerNormals, triangleCount, bestLevel);
+	}
+
+	// Compute flat normals with a chosen kernel
+	void computeFaceNormals(const float *triangles, float *cornerNormals, long triangleCount, SimdLevel level)
+	{
+		SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		if (level > bestLevel) {
+			level = bestLevel;
+		}
+
+#if defined(FRAMEWORK_X86)
+		if (level == SIMD_AVX2) {
+			computeFaceNormalsAvx2(triangles, cornerNormals, triangleCount);
+			return;
+		}
+		if (level == SIMD_SSE2) {
+			computeFaceNormalsSse2(triangles, cornerNormals, triangleCount);
+			return;
+		}
+#endif
+		computeFaceNormalsScalar(triangles, cornerNormals, triangleCount);
+	}
+
+	// Cross product of two triangle edges, its length is twice the area
+	static inline void computeFaceCross(const float *coord1, const float *coord2, const float *coord3, float *cross)
+	{
+		float va0 = coord2[0] - coord1[0];
+		float va1 = coord2[1] - coord1[1];
+		float va2 = coord2[2] - coord1[2];
+
+		float vb0 = coord3[0] - coord1[0];
+		float vb1 = coord3[1] - coord1[1];
+		float vb2 = coord3[2] - coord1[2];
+
+		cross[0] = va1 * vb2 - va2 * vb1;
+		cross[1] = va2 * vb0 - va0 * vb2;
+		cross[2] = va0 * vb1 - va1 * vb0;
+	}
+
+	// Angle at a corner between the edges to the other two corners, 0 for a degenerate corner
+	static inline float computeCornerAngle(const float *corner, const float *next, const float *previous)
+	{
+		float u0 = next[0] - corner[0];
+		float u1 = next[1] - corner[1];
+		float u2 = next[2] - corner[2];
+
+		float v0 = previous[0] - corner[0];
+		float v1 = previous[1] - corner[1];
+		float v2 = previous[2] - corner[2];
+
+		float lengths = sqrtf((u0 * u0 + u1 * u1 + u2 * u2) * (v0 * v0 + v1 * v1 + v2 * v2));
+		if (!(lengths > 0.0f)) {
+			return 0.0f;
+		}
+
+		float cosine = (u0 * v0 + u1 * v1 + u2 * v2) / lengths;
+		if (cosine > 1.0f) {
+			cosine = 1.0f;
+		}
+		else if (cosine < -1.0f) {
+			cosine = -1.0f;
+		}
+		return acosf(cosine);
+	}
+
+	// Run body(first, last) over [0, count) in blocks, on the pool when the work is large enough
+	template <typename Body>
+	static void forEachBlock(ThreadPool &pool, long count, const Body &body)
+	{
+		long blockCount = 1;
+		if (count >= MIN_PARALLEL_VERTEX_NORMALS) {
+			blockCount = (long)pool.getThreadCount() * VERTEX_NORMAL_BLOCKS_PER_THREAD;
+		}
+		if (blockCount > count) {
+			blockCount = count > 0 ? count : 1;
+		}
+
+		long blockSize = (count + blockCount - 1) / blockCount;
+		if (blockCount == 1) {
+			body(0, count);
+			return;
+		}
+
+		pool.parallelFor(blockCount, [&](long block) {
+			long first = block * blockSize;
+			long last = first + blockSize < count ? first + blockSize : count;
+			if (first < last) {
+				body(first, last);
+			}
+		});
+	}
+
+	// Scratch memory for the smooth normal passes
+	size_t getVertexNormalsScratchBytes(long vertexCount, long indexCount, NormalMode mode)
+	{
+		size_t bytes = (vertexCount + 1) * sizeof(unsigned int)			// Corner offsets per vertex
+			+ indexCount * sizeof(unsigned int)							// Corners grouped by vertex
+			+ indexCount * sizeof(float);								// Face vectors, 3 floats per triangle
+		if (mode == NORMALS_SMOOTH_ANGLE) {
+			bytes += indexCount * sizeof(float);						// Corner angles
+		}
+		return bytes;
+	}
+
+	// Compute smooth normals by gathering faces per vertex
+	bool computeVertexNormals(IndexedMesh &mesh, NormalMode mode, ThreadPool &pool)
+	{
+		if (mode == NORMALS_FLAT) {
+			return true;
+		}
+
+		const long vertexCount = mesh.vertexCount;
+		const long cornerCount = mesh.indexCount;
+		const long triangleCount = cornerCount / 3;
+		const float *positions = mesh.positions;
+		float *vertexNormals = mesh.normals;
+
+		std::vector<float> faceVectors;
+		std::vector<float> cornerAngles;
+		std::vector<unsigned int> vertexCorners;
+		std::vector<unsigned int> cornerOffsets;
+		try {
+			faceVectors.resize(triangleCount * 3);
+			cornerAngles.resize(mode == NORMALS_SMOOTH_ANGLE ? triangleCount * 3 : 0);
+			vertexCorners.resize(triangleCount * 3);
+			cornerOffsets.assign(vertexCount + 1, 0);
+		}
+		catch (const std::bad_alloc&) {
+			return false;
+		}
+
+		// Pass 1: per face vectors, the raw cross product for area weights (its length is
+		// twice the area) or the unit normal for angle weights, plus the corner angles
+		forEachBlock(pool, triangleCount, [&](long first, long last) {
+			for (long triangle = first; triangle < last; triangle++) {
+				const float *coord1 = &positions[mesh.getIndex(triangle * 3) * 3];
+				const float *coord2 = &positions[mesh.getIndex(triangle * 3 + 1) * 3];
+				const float *coord3 = &positions[mesh.getIndex(triangle * 3 + 2) * 3];
+				float *faceVector = &faceVectors[triangle * 3];
+
+				if (mode == NORMALS_SMOOTH_AREA) {
+					computeFaceCross(coord1, coord2, coord3, faceVector);
+				}
+				else {
+					computeFaceNormal(coord1, coord2, coord3, faceVector);
+					cornerAngles[triangle * 3] = computeCornerAngle(coord1, coord2, coord3);
+					cornerAngles[triangle * 3 + 1] = computeCornerAngle(coord2, coord3, coord1);
+					cornerAngles[triangle * 3 + 2] = computeCornerAngle(coord3, coord1, coord2);
+				}
+			}
+		});
+
+		// Pass 2: group the corners by vertex (compressed rows), in corner order so the
+		// sums below always add the faces in the same sequence
+		for (long corner = 0; corner < triangleCount * 3; corner++) {
+			cornerOffsets[mesh.getIndex(corner) + 1]++;
+		}
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			cornerOffsets[vertex + 1] += cornerOffsets[vertex];
+		}
+		{
+			std::vector<unsigned int> cursors(cornerOffsets.begin(), cornerOffsets.end() - 1);
+			for (long corner = 0; corner < triangleCount * 3; corner++) {
+				vertexCorners[cursors[mesh.getIndex(corner)]++] = (unsigned int)corner;
+			}
+		}
+
+		// Pass 3: every vertex sums its own faces, threads own disjoint vertex ranges
+		forEachBlock(pool, vertexCount, [&](long first, long last) {
+			for (long vertex = first; vertex < last; vertex++) {
+				float x = 0.0f;
+				float y = 0.0f;
+				float z = 0.0f;
+				for (unsigned int i = cornerOffsets[vertex]; i < cornerOffsets[vertex + 1]; i++) {
+					unsigned int corner = vertexCorners[i];
+					const float *faceVector = &faceVectors[(corner / 3) * 3];
+					float weight = mode == NORMALS_SMOOTH_AREA ? 1.0f : cornerAngles[corner];
+					x += faceVector[0] * weight;
+					y += faceVector[1] * weight;
+					z += faceVector[2] * weight;
+				}
+
+				float *normal = &vertexNormals[vertex * 3];
+				float lengthSquared = x * x + y * y + z * z;
+				if (lengthSquared > 0.0f) {
+					float length = sqrtf(lengthSquared);
+					normal[0] = x / length;
+					normal[1] = y / length;
+					normal[2] = z / length;
+				}
+				else {
+					normal[0] = normal[1] = normal[2] = 0.0f;
+				}
+			}
+		});
+		return true;
+	}
+
+}	// namespace
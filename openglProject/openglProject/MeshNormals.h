@@ -0,0 +1,60 @@
+#pragma once
+// MeshNormals.h is the file that holds
+// the normal generation stage run over
+// a whole mesh after it is parsed.
+
+// Header guards
+#ifndef MESH_NORMALS_H_
+#define MESH_NORMALS_H_
+
+// Include headers
+#include "CpuFeatures.h"
+#include "IndexedMesh.h"
+#include "ThreadPool.h"
+
+namespace applicationFramework {
+
+	// How normals are generated for a mesh
+	enum NormalMode {
+		NORMALS_FLAT = 0,			// One face normal per corner, corners only weld within a face plane
+		NORMALS_SMOOTH_AREA = 1,	// Per vertex, faces weighted by their area
+		NORMALS_SMOOTH_ANGLE = 2	// Per vertex, faces weighted by the corner angle at the vertex
+	};
+
+	/** Computes the unit normal of one triangle. Degenerate triangles (zero area)
+	get a (0,0,0) normal instead of dividing by zero.
+	@param coord1, coord2, coord3 - the corners of the triangle (x,y,z)
+	@param normal - receives the normal (x,y,z)
+	*/
+	void computeFaceNormal(const float *coord1, const float *coord2, const float *coord3, float *normal);
+
+	/** Computes flat normals for an unindexed triangle list, using the best
+	kernel for this CPU. Every kernel gives bit-identical results.
+	@param triangles - 9 floats per triangle (3 corners of x,y,z)
+	@param cornerNormals - receives 9 floats per triangle, the face normal once per corner
+	@param triangleCount - the number of triangles
+	*/
+	void computeFaceNormals(const float *triangles, float *cornerNormals, long triangleCount);
+
+	/** Same as computeFaceNormals, with the kernel chosen by the caller (used to benchmark).
+	Levels the CPU does not support fall back to the best one it does.
+	*/
+	void computeFaceNormals(const float *triangles, float *cornerNormals, long triangleCount, SimdLevel level);
+
+	/** Computes smooth per-vertex normals for an indexed mesh, overwriting mesh.normals.
+	Every vertex gathers its faces in triangle order, so the result does not depend
+	on how many threads run it and no two threads ever write the same vertex.
+	Vertices with no faces (or only degenerate ones) get a (0,0,0) normal.
+	@param mesh - the mesh, normally welded on position alone
+	@param mode - NORMALS_SMOOTH_AREA or NORMALS_SMOOTH_ANGLE, NORMALS_FLAT does nothing
+	@param pool - the threads to spread the work over
+	@return false if the scratch buffers could not be allocated
+	*/
+	bool computeVertexNormals(IndexedMesh &mesh, NormalMode mode, ThreadPool &pool);
+
+	/** The scratch memory computeVertexNormals needs for a mesh, in bytes */
+	size_t getVertexNormalsScratchBytes(long vertexCount, long indexCount, NormalMode mode);
+
+}	// namespace
+
+#endif
@@ -0,0 +1,256 @@
+// MeshOptimizer.cpp is the file that
+// holds the implementation for the
+// vertex cache and vertex fetch passes.
+
+// Include headers
+#include <math.h>
+#include <string.h>
+#include <new>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+namespace applicationFramework {
+
+	// Score tuning from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	static const float LAST_TRIANGLE_SCORE = 0.75f;
+	static const float CACHE_DECAY_POWER = 1.5f;
+	static const float VALENCE_BOOST_SCALE = 2.0f;
+	static const float VALENCE_BOOST_POWER = 0.5f;
+
+	// Valences above this share one score
+	static const int MAX_SCORED_VALENCE = 32;
+
+	// Marks a vertex that has not been renumbered yet
+	static const unsigned int UNASSIGNED_VERTEX = 0xFFFFFFFFu;
+
+	// Simulate a FIFO cache and count the vertices that miss it
+	VertexCacheStats analyzeVertexCache(const IndexedMesh &mesh, int cacheSize)
+	{
+		VertexCacheStats stats;
+		stats.acmr = 0.0f;
+		stats.atvr = 0.0f;
+		stats.transformCount = 0;
+		if (mesh.indexCount < 3 || mesh.vertexCount == 0 || cacheSize <= 0) {
+			return stats;
+		}
+
+		std::vector<long> cachedAt(mesh.vertexCount, -1);		// Transform time of each vertex, -1 if never
+		for (long i = 0; i < mesh.indexCount; i++) {
+			unsigned int vertex = mesh.getIndex(i);
+			if (cachedAt[vertex] < 0 || stats.transformCount - cachedAt[vertex] > cacheSize) {	// Pushed out by later misses
+				cachedAt[vertex] = stats.transformCount;
+				stats.transformCount++;
+			}
+		}
+
+		stats.acmr = (float)stats.transformCount / (mesh.indexCount / 3);
+		stats.atvr = (float)stats.transformCount / mesh.vertexCount;
+		return stats;
+	}
+
+	// Reorder the triangles with Forsyth's algorithm
+	bool optimizeVertexCache(IndexedMesh &mesh, int cacheSize)
+	{
+		const long triangleCount = mesh.indexCount / 3;
+		const long vertexCount = mesh.vertexCount;
+		if (triangleCount < 2 || cacheSize < 4) {
+			return true;
+		}
+
+		std::vector<unsigned int> indices;
+		std::vector<unsigned int> triangleOffsets;			// Compressed rows of the triangles using each vertex
+		std::vector<unsigned int> vertexTriangles;
+		std::vector<unsigned int> activeTriangleCount;		// Triangles not emitted yet per vertex, at the front of its row
+		std::vector<int> cachePosition;
+		std::vector<float> vertexScore;
+		std::vector<char> isTriangleEmitted;
+		try {
+			indices.resize(triangleCount * 3);
+			triangleOffsets.assign(vertexCount + 1, 0);
+			vertexTriangles.resize(triangleCount * 3);
+			activeTriangleCount.assign(vertexCount, 0);
+			cachePosition.assign(vertexCount, -1);
+			vertexScore.resize(vertexCount);
+			isTriangleEmitted.assign(triangleCount, 0);
+		}
+		catch (const std::bad_alloc&) {
+			return false;
+		}
+
+		// Score tables, by position in the cache and by remaining valence
+		std::vector<float> positionScores(cacheSize);
+		for (int position = 0; position < cacheSize; position++) {
+			if (position < 3) {
+				positionScores[position] = LAST_TRIANGLE_SCORE;	// The last triangle's vertices, no preference between them
+			}
+			else {
+				float scale = 1.0f - (position - 3) / (float)(cacheSize - 3);
+				positionScores[position] = powf(scale, CACHE_DECAY_POWER);
+			}
+		}
+		float valenceScores[MAX_SCORED_VALENCE + 1];
+		valenceScores[0] = 0.0f;
+		for (int valence = 1; valence <= MAX_SCORED_VALENCE; valence++) {
+			valenceScores[valence] = VALENCE_BOOST_SCALE * powf((float)valence, -VALENCE_BOOST_POWER);
+		}
+
+		for (long i = 0; i < triangleCount * 3; i++) {
+			indices[i] = mesh.getIndex(i);
+			activeTriangleCount[indices[i]]++;
+		}
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			triangleOffsets[vertex + 1] = triangleOffsets[vertex] + activeTriangleCount[vertex];
+			activeTriangleCount[vertex] = 0;
+		}
+		for (long triangle = 0; triangle < triangleCount; triangle++) {
+			for (int corner = 0; corner < 3; corner++) {
+				unsigned int vertex = indices[triangle * 3 + corner];
+				vertexTriangles[triangleOffsets[vertex] + activeTriangleCount[vertex]++] = (unsigned int)triangle;
+			}
+		}
+
+		// Score of a vertex from its cache position and how many triangles still use it
+		auto scoreVertex = [&](unsigned int vertex) {
+			unsigned int valence = activeTriangleCount[vertex];
+			if (valence == 0) {
+				return -1.0f;
+			}
+			float score = cachePosition[vertex] >= 0 ? positionScores[cachePosition[vertex]] : 0.0f;
+			return score + valenceScores[valence < (unsigned int)MAX_SCORED_VALENCE ? valence : MAX_SCORED_VALENCE];
+		};
+
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			vertexScore[vertex] = scoreVertex((unsigned int)vertex);
+		}
+
+		long bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (long triangle = 0; triangle < triangleCount; triangle++) {
+			const unsigned int *corners = &indices[triangle * 3];
+			float score = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+			if (score > bestScore) {
+				bestScore = score;
+				bestTriangle = triangle;
+			}
+		}
+
+		std::vector<unsigned int> cache;
+		std::vector<unsigned int> nextCache;
+		cache.reserve(cacheSize + 3);
+		nextCache.reserve(cacheSize + 3);
+		long scanCursor = 0;
+
+		for (long emitted = 0; emitted < triangleCount; emitted++)
+		{
+			if (bestTriangle < 0) {							// Nothing in the cache has triangles left, take the next in file order
+				while (isTriangleEmitted[scanCursor]) {
+					scanCursor++;
+				}
+				bestTriangle = scanCursor;
+			}
+
+			const unsigned int *corners = &indices[bestTriangle * 3];
+			isTriangleEmitted[bestTriangle] = 1;
+			for (int corner = 0; corner < 3; corner++) {
+				mesh.setIndex(emitted * 3 + corner, corners[corner]);
+
+				unsigned int vertex = corners[corner];		// Move the triangle out of the vertex's active rows
+				unsigned int *row = &vertexTriangles[triangleOffsets[vertex]];
+				for (unsigned int i = 0; i < activeTriangleCount[vertex]; i++) {
+					if (row[i] == (unsigned int)bestTriangle) {
+						row[i] = row[--activeTriangleCount[vertex]];
+						row[activeTriangleCount[vertex]] = (unsigned int)bestTriangle;
+						break;
+					}
+				}
+			}
+
+			// The triangle's vertices go to the front of the LRU cache
+			nextCache.clear();
+			for (int corner = 0; corner < 3; corner++) {
+				if ((corner < 1 || corners[corner] != corners[0]) && (corner < 2 || corners[corner] != corners[1])) {
+					nextCache.push_back(corners[corner]);	// Once each, degenerate triangles repeat vertices
+				}
+			}
+			for (size_t i = 0; i < cache.size(); i++) {
+				if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2]) {
+					nextCache.push_back(cache[i]);
+				}
+			}
+
+			for (size_t i = 0; i < nextCache.size(); i++) {
+				unsigned int vertex = nextCache[i];
+				cachePosition[vertex] = i < (size_t)cacheSize ? (int)i : -1;
+				vertexScore[vertex] = scoreVertex(vertex);
+			}
+
+			// Only triangles touching the cache changed score, the best of them goes next
+			bestTriangle = -1;
+			bestScore = -1.0f;
+			for (size_t i = 0; i < nextCache.size(); i++) {
+				unsigned int vertex = nextCache[i];
+				const unsigned int *row = &vertexTriangles[triangleOffsets[vertex]];
+				for (unsigned int k = 0; k < activeTriangleCount[vertex]; k++) {
+					unsigned int triangle = row[k];
+					const unsigned int *triangleCorners = &indices[triangle * 3];
+					float score = vertexScore[triangleCorners[0]] + vertexScore[triangleCorners[1]] + vertexScore[triangleCorners[2]];
+					if (score > bestScore) {
+						bestScore = score;
+						bestTriangle = triangle;
+					}
+				}
+			}
+
+			if (nextCache.size() > (size_t)cacheSize) {
+				nextCache.resize(cacheSize);
+			}
+			cache.swap(nextCache);
+		}
+		return true;
+	}
+
+	// Renumber the vertices in first-use order
+	bool optimizeVertexFetch(IndexedMesh &mesh)
+	{
+		const long vertexCount = mesh.vertexCount;
+		if (vertexCount == 0) {
+			return true;
+		}
+
+		std::vector<unsigned int> remap;
+		std::vector<float> scratch;
+		try {
+			remap.assign(vertexCount, UNASSIGNED_VERTEX);
+			scratch.resize(vertexCount * 3);
+		}
+		catch (const std::bad_alloc&) {
+			return false;
+		}
+
+		unsigned int nextVertex = 0;
+		for (long i = 0; i < mesh.indexCount; i++) {
+			unsigned int vertex = mesh.getIndex(i);
+			if (remap[vertex] == UNASSIGNED_VERTEX) {
+				remap[vertex] = nextVertex++;
+			}
+			mesh.setIndex(i, remap[vertex]);
+		}
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			if (remap[vertex] == UNASSIGNED_VERTEX) {
+				remap[vertex] = nextVertex++;
+			}
+		}
+
+		// Permute through the scratch copy, the buffers may belong to a mapped cache
+		float *buffers[2] = { mesh.positions, mesh.normals };
+		for (int buffer = 0; buffer < 2; buffer++) {
+			for (long vertex = 0; vertex < vertexCount; vertex++) {
+				memcpy(&scratch[remap[vertex] * 3], &buffers[buffer][vertex * 3], 3 * sizeof(float));
+			}
+			memcpy(buffers[buffer], &scratch[0], vertexCount * 3 * sizeof(float));
+		}
+		return true;
+	}
+
+}	// namespace
@@ -0,0 +1,47 @@
+#pragma once
+// MeshOptimizer.h is the file that holds
+// the passes that reorder an indexed mesh
+// so the GPU reuses more transformed
+// vertices and fetches them in order.
+
+// Header guards
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+// Include headers
+#include "IndexedMesh.h"
+
+namespace applicationFramework {
+
+	// Post-transform cache size the triangle order is tuned for
+	static const int VERTEX_CACHE_SIZE = 32;
+
+	// How well an index order uses a FIFO post-transform vertex cache
+	struct VertexCacheStats
+	{
+		float acmr;				// Average cache miss ratio, vertices transformed per triangle (0.5 - 3)
+		float atvr;				// Average transformed vertex ratio, vertices transformed per vertex (1 is ideal)
+		long transformCount;	// Vertices transformed in total
+	};
+
+	/** Simulates a FIFO vertex cache over the index buffer.
+	@param mesh - the mesh to analyze
+	@param cacheSize - the number of vertices the simulated cache holds
+	*/
+	VertexCacheStats analyzeVertexCache(const IndexedMesh &mesh, int cacheSize = VERTEX_CACHE_SIZE);
+
+	/** Reorders the triangles for vertex cache reuse (Forsyth's linear-speed algorithm).
+	The set of triangles and the winding of each one are kept.
+	@return false if the scratch buffers could not be allocated
+	*/
+	bool optimizeVertexCache(IndexedMesh &mesh, int cacheSize = VERTEX_CACHE_SIZE);
+
+	/** Renumbers the vertices in the order the index buffer first uses them, so vertex
+	fetches walk memory forwards. Vertices no triangle uses move to the end.
+	@return false if the scratch buffers could not be allocated
+	*/
+	bool optimizeVertexFetch(IndexedMesh &mesh);
+
+}	// namespace
+
+#endif
@@ -0,0 +1,439 @@
+// MeshSimplifier.cpp is the file that
+// holds the implementation for the
+// quadric error mesh simplifier.
+
+// Include headers
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "MeshSimplifier.h"
+
+namespace applicationFramework {
+
+	// Border planes count this many times more than the faces around them
+	static const double BORDER_WEIGHT = 10.0;
+
+	// Marks a vertex that has not been given a welded position yet
+	static const unsigned int UNASSIGNED_POSITION = 0xFFFFFFFFu;
+
+	// Sum of squared distances to a set of planes (ax + by + cz + d = 0), stored
+	// as the upper half of a symmetric 4x4 matrix, plus the total plane weight
+	struct Quadric
+	{
+		double a2, ab, ac, ad;
+		double b2, bc, bd;
+		double c2, cd;
+		double d2;
+		double weight;
+	};
+
+	// An edge collapse, vertex position "from" moves onto position "to"
+	struct Collapse
+	{
+		double error;
+		unsigned int from;
+		unsigned int to;
+	};
+
+	// The triangles around every welded position, in compressed rows
+	struct Adjacency
+	{
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+	};
+
+	// Add a weighted plane to a quadric
+	static void addPlane(Quadric &quadric, double a, double b, double c, double d, double weight)
+	{
+		quadric.a2 += weight * a * a;
+		quadric.ab += weight * a * b;
+		quadric.ac += weight * a * c;
+		quadric.ad += weight * a * d;
+		quadric.b2 += weight * b * b;
+		quadric.bc += weight * b * c;
+		quadric.bd += weight * b * d;
+		quadric.c2 += weight * c * c;
+		quadric.cd += weight * c * d;
+		quadric.d2 += weight * d * d;
+		quadric.weight += weight;
+	}
+
+	// Add one quadric to another
+	static void addQuadric(Quadric &quadric, const Quadric &other)
+	{
+		quadric.a2 += other.a2;
+		quadric.ab += other.ab;
+		quadric.ac += other.ac;
+		quadric.ad += other.ad;
+		quadric.b2 += other.b2;
+		quadric.bc += other.bc;
+		quadric.bd += other.bd;
+		quadric.c2 += other.c2;
+		quadric.cd += other.cd;
+		quadric.d2 += other.d2;
+		quadric.weight += other.weight;
+	}
+
+	// Mean squared distance from a point to the planes of two quadrics together
+	static double evaluateCollapse(const Quadric &q1, const Quadric &q2, const float *point)
+	{
+		Quadric quadric = q1;
+		addQuadric(quadric, q2);
+		if (quadric.weight <= 0.0) {
+			return 0.0;
+		}
+
+		double x = point[0];
+		double y = point[1];
+		double z = point[2];
+		double error = quadric.a2 * x * x + 2.0 * quadric.ab * x * y + 2.0 * quadric.ac * x * z + 2.0 * quadric.ad * x +
+			quadric.b2 * y * y + 2.0 * quadric.bc * y * z + 2.0 * quadric.bd * y +
+			quadric.c2 * z * z + 2.0 * quadric.cd * z + quadric.d2;
+		return error > 0.0 ? error / quadric.weight : 0.0;
+	}
+
+	// Cross product of the edges (p2 - p1) and (p3 - p1), in doubles
+	static void crossEdges(const float *p1, const float *p2, const float *p3, double *cross)
+	{
+		double u0 = p2[0] - p1[0], u1 = p2[1] - p1[1], u2 = p2[2] - p1[2];
+		double v0 = p3[0] - p1[0], v1 = p3[1] - p1[1], v2 = p3[2] - p1[2];
+		cross[0] = u1 * v2 - u2 * v1;
+		cross[1] = u2 * v0 - u0 * v2;
+		cross[2] = u0 * v1 - u1 * v0;
+	}
+
+	// Group the triangles by the welded positions of their corners
+	static void buildAdjacency(const std::vector<unsigned int> &indices, const std::vector<unsigned int> &positionOf,
+		long positionCount, Adjacency &adjacency)
+	{
+		adjacency.offsets.assign(positionCount + 1, 0);
+		adjacency.triangles.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacency.offsets[positionOf[indices[i]] + 1]++;
+		}
+		for (long position = 0; position < positionCount; position++) {
+			adjacency.offsets[position + 1] += adjacency.offsets[position];
+		}
+
+		std::vector<unsigned int> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacency.triangles[cursors[positionOf[indices[i]]]++] = (unsigned int)(i / 3);
+		}
+	}
+
+	// The corner (0-2) of a triangle at a welded position, -1 if it has none
+	static int findCorner(const std::vector<unsigned int> &indices, const std::vector<unsigned int> &positionOf,
+		unsigned int triangle, unsigned int position)
+	{
+		for (int corner = 0; corner < 3; corner++) {
+			if (positionOf[indices[triangle * 3 + corner]] == position) {
+				return corner;
+			}
+		}
+		return -1;
+	}
+
+	// Simplify with passes of independent edge collapses, cheapest first
+	float simplifyMesh(const IndexedMesh &mesh, const std::vector<unsigned int> &sourceIndices,
+		long targetTriangleCount, std::vector<unsigned int> &result)
+	{
+		const long vertexCount = mesh.vertexCount;
+		const float *positions = mesh.positions;
+
+		// Weld the vertices on position, seams split by normals share one position
+		std::vector<unsigned int> order(vertexCount);
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			order[vertex] = (unsigned int)vertex;
+		}
+		std::sort(order.begin(), order.end(), [positions](unsigned int a, unsigned int b) {
+			int compare = memcmp(&positions[a * 3], &positions[b * 3], 3 * sizeof(float));
+			return compare != 0 ? compare < 0 : a < b;
+		});
+
+		std::vector<unsigned int> positionOf(vertexCount, UNASSIGNED_POSITION);
+		std::vector<unsigned int> positionVertex;				// A vertex at every welded position
+		for (long i = 0; i < vertexCount; i++) {
+			if (i == 0 || memcmp(&positions[order[i] * 3], &positions[order[i - 1] * 3], 3 * sizeof(float)) != 0) {
+				positionVertex.push_back(order[i]);
+			}
+			positionOf[order[i]] = (unsigned int)(positionVertex.size() - 1);
+		}
+		const long positionCount = (long)positionVertex.size();
+
+		// Triangles that are already degenerate once welded add nothing
+		std::vector<unsigned int> indices;
+		indices.reserve(sourceIndices.size());
+		for (size_t i = 0; i + 2 < sourceIndices.size(); i += 3) {
+			unsigned int p1 = positionOf[sourceIndices[i]];
+			unsigned int p2 = positionOf[sourceIndices[i + 1]];
+			unsigned int p3 = positionOf[sourceIndices[i + 2]];
+			if (p1 != p2 && p2 != p3 && p1 != p3) {
+				indices.insert(indices.end(), &sourceIndices[i], &sourceIndices[i] + 3);
+			}
+		}
+		long triangleCount = (long)(indices.size() / 3);
+
+		// Face planes, weighted by area
+		Quadric emptyQuadric;
+		memset(&emptyQuadric, 0, sizeof(emptyQuadric));
+		std::vector<Quadric> quadrics(positionCount, emptyQuadric);
+		for (long triangle = 0; triangle < triangleCount; triangle++) {
+			const float *p1 = &positions[indices[triangle * 3] * 3];
+			double normal[3];
+			crossEdges(p1, &positions[indices[triangle * 3 + 1] * 3], &positions[indices[triangle * 3 + 2] * 3], normal);
+			double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length <= 0.0) {
+				continue;
+			}
+
+			double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+			double d = -(a * p1[0] + b * p1[1] + c * p1[2]);
+			for (int corner = 0; corner < 3; corner++) {
+				addPlane(quadrics[positionOf[indices[triangle * 3 + corner]]], a, b, c, d, length * 0.5);
+			}
+		}
+
+		Adjacency adjacency;
+		buildAdjacency(indices, positionOf, positionCount, adjacency);
+
+		// Count the triangles around a position that also use another one
+		auto countEdgeTriangles = [&](unsigned int from, unsigned int to) {
+			int count = 0;
+			for (unsigned int i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+				count += findCorner(indices, positionOf, adjacency.triangles[i], to) >= 0 ? 1 : 0;
+			}
+			return count;
+		};
+
+		// Border edges (one triangle) get a plane through the edge, square to the face, so borders hold their line
+		for (long from = 0; from < positionCount; from++) {
+			for (unsigned int i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+				unsigned int triangle = adjacency.triangles[i];
+				for (int corner = 0; corner < 3; corner++) {
+					unsigned int to = positionOf[indices[triangle * 3 + corner]];
+					if (to <= (unsigned int)from || countEdgeTriangles((unsigned int)from, to) != 1) {
+						continue;
+					}
+
+					const float *p1 = &positions[positionVertex[from] * 3];
+					const float *p2 = &positions[positionVertex[to] * 3];
+					double face[3];
+					crossEdges(&positions[indices[triangle * 3] * 3], &positions[indices[triangle * 3 + 1] * 3],
+						&positions[indices[triangle * 3 + 2] * 3], face);
+					double edge[3] = { (double)p2[0] - p1[0], (double)p2[1] - p1[1], (double)p2[2] - p1[2] };
+					double normal[3] = {
+						edge[1] * face[2] - edge[2] * face[1],
+						edge[2] * face[0] - edge[0] * face[2],
+						edge[0] * face[1] - edge[1] * face[0]
+					};
+					double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+					if (length <= 0.0) {
+						continue;
+					}
+
+					double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+					double d = -(a * p1[0] + b * p1[1] + c * p1[2]);
+					double weight = BORDER_WEIGHT * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+					addPlane(quadrics[from], a, b, c, d, weight);
+					addPlane(quadrics[to], a, b, c, d, weight);
+				}
+			}
+		}
+
+		// Checks if an edge separates two triangles with different vertices (normals) on it
+		auto isSeamEdge = [&](unsigned int from, unsigned int to) {
+			unsigned int edgeTriangles[2];
+			int count = 0;
+			for (unsigned int i = adjacency.offsets[from]; i < adjacency.offsets[from + 1] && count < 2; i++) {
+				if (findCorner(indices, positionOf, adjacency.triangles[i], to) >= 0) {
+					edgeTriangles[count++] = adjacency.triangles[i];
+				}
+			}
+			if (count != 2) {
+				return false;
+			}
+			for (int end = 0; end < 2; end++) {
+				unsigned int position = end == 0 ? from : to;
+				unsigned int v1 = indices[edgeTriangles[0] * 3 + findCorner(indices, positionOf, edgeTriangles[0], position)];
+				unsigned int v2 = indices[edgeTriangles[1] * 3 + findCorner(indices, positionOf, edgeTriangles[1], position)];
+				if (v1 != v2) {
+					return true;
+				}
+			}
+			return false;
+		};
+
+		float maxError = 0.0f;
+		std::vector<Collapse> collapses;
+		std::vector<char> isLocked;
+		std::vector<char> isRemoved;
+		std::vector<unsigned int> attributeFrom;
+		std::vector<unsigned int> attributeTo;
+
+		while (triangleCount > targetTriangleCount)
+		{
+			// Pick the cheapest valid collapse of every position
+			collapses.clear();
+			for (long from = 0; from < positionCount; from++) {
+				unsigned int first = adjacency.offsets[from];
+				unsigned int last = adjacency.offsets[from + 1];
+				if (first == last) {
+					continue;
+				}
+
+				bool isBorder = false;
+				bool isSeam = false;
+				bool isComplex = false;
+				unsigned int firstVertex = indices[adjacency.triangles[first] * 3 +
+					findCorner(indices, positionOf, adjacency.triangles[first], (unsigned int)from)];
+				for (unsigned int i = first; i < last; i++) {
+					unsigned int triangle = adjacency.triangles[i];
+					isSeam = isSeam || indices[triangle * 3 + findCorner(indices, positionOf, triangle, (unsigned int)from)] != firstVertex;
+					for (int corner = 0; corner < 3; corner++) {
+						unsigned int to = positionOf[indices[triangle * 3 + corner]];
+						if (to != (unsigned int)from) {
+							int count = countEdgeTriangles((unsigned int)from, to);
+							isBorder = isBorder || count == 1;
+							isComplex = isComplex || count > 2;
+						}
+					}
+				}
+				if (isComplex) {										// Non-manifold vertices stay where they are
+					continue;
+				}
+
+				Collapse best;
+				best.error = -1.0;
+				for (unsigned int i = first; i < last; i++) {
+					unsigned int triangle = adjacency.triangles[i];
+					for (int corner = 0; corner < 3; corner++) {
+						unsigned int to = positionOf[indices[triangle * 3 + corner]];
+						if (to == (unsigned int)from ||
+							(isBorder && countEdgeTriangles((unsigned int)from, to) != 1) ||	// Borders slide along the border
+							(isSeam && !isBorder && !isSeamEdge((unsigned int)from, to))) {		// Seams slide along the seam
+							continue;
+						}
+
+						double error = evaluateCollapse(quadrics[from], quadrics[to], &positions[positionVertex[to] * 3]);
+						if (best.error < 0.0 || error < best.error || (error == best.error && to < best.to)) {
+							best.error = error;
+							best.from = (unsigned int)from;
+							best.to = to;
+						}
+					}
+				}
+				if (best.error >= 0.0) {
+					collapses.push_back(best);
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+				return a.error != b.error ? a.error < b.error : a.from < b.from;
+			});
+
+			// Apply them in order, skipping any that touch a collapse made earlier in the pass
+			isLocked.assign(positionCount, 0);
+			isRemoved.assign(triangleCount, 0);
+			long trianglesToRemove = triangleCount - targetTriangleCount;
+			long removedCount = 0;
+			for (size_t c = 0; c < collapses.size() && removedCount < trianglesToRemove; c++) {
+				const Collapse &collapse = collapses[c];
+				if (isLocked[collapse.from] || isLocked[collapse.to]) {
+					continue;
+				}
+				unsigned int first = adjacency.offsets[collapse.from];
+				unsigned int last = adjacency.offsets[collapse.from + 1];
+
+				// Every vertex at "from" must map to the vertex at "to" it shares a triangle with
+				bool isValid = true;
+				attributeFrom.clear();
+				attributeTo.clear();
+				for (unsigned int i = first; i < last && isValid; i++) {
+					unsigned int triangle = adjacency.triangles[i];
+					unsigned int vertex = indices[triangle * 3 + findCorner(indices, positionOf, triangle, collapse.from)];
+					if (std::find(attributeFrom.begin(), attributeFrom.end(), vertex) != attributeFrom.end()) {
+						continue;
+					}
+
+					isValid = false;
+					for (unsigned int k = first; k < last; k++) {
+						unsigned int other = adjacency.triangles[k];
+						int toCorner = findCorner(indices, positionOf, other, collapse.to);
+						if (toCorner >= 0 && indices[other * 3 + findCorner(indices, positionOf, other, collapse.from)] == vertex) {
+							attributeFrom.push_back(vertex);
+							attributeTo.push_back(indices[other * 3 + toCorner]);
+							isValid = true;
+							break;
+						}
+					}
+				}
+
+				// Triangles that stay must not flip over
+				const float *target = &positions[positionVertex[collapse.to] * 3];
+				for (unsigned int i = first; i < last && isValid; i++) {
+					unsigned int triangle = adjacency.triangles[i];
+					if (findCorner(indices, positionOf, triangle, collapse.to) >= 0) {
+						continue;
+					}
+
+					const float *corners[3];
+					const float *movedCorners[3];
+					for (int corner = 0; corner < 3; corner++) {
+						corners[corner] = &positions[indices[triangle * 3 + corner] * 3];
+						movedCorners[corner] = positionOf[indices[triangle * 3 + corner]] == collapse.from ? target : corners[corner];
+					}
+					double before[3];
+					double after[3];
+					crossEdges(corners[0], corners[1], corners[2], before);
+					crossEdges(movedCorners[0], movedCorners[1], movedCorners[2], after);
+					isValid = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] > 0.0;
+				}
+				if (!isValid) {
+					continue;
+				}
+
+				for (unsigned int i = first; i < last; i++) {
+					unsigned int triangle = adjacency.triangles[i];
+					for (int corner = 0; corner < 3; corner++) {
+						isLocked[positionOf[indices[triangle * 3 + corner]]] = 1;
+					}
+					if (findCorner(indices, positionOf, triangle, collapse.to) >= 0) {
+						isRemoved[triangle] = 1;							// The collapsed edge's triangles vanish
+						removedCount++;
+						continue;
+					}
+
+					int corner = findCorner(indices, positionOf, triangle, collapse.from);
+					size_t mapping = std::find(attributeFrom.begin(), attributeFrom.end(), indices[triangle * 3 + corner]) - attributeFrom.begin();
+					indices[triangle * 3 + corner] = attributeTo[mapping];
+				}
+
+				addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+				float error = (float)sqrt(collapse.error);
+				if (error > maxError) {
+					maxError = error;
+				}
+			}
+
+			if (removedCount == 0) {									// No valid collapse is left
+				break;
+			}
+
+			long kept = 0;
+			for (long triangle = 0; triangle < triangleCount; triangle++) {
+				if (!isRemoved[triangle]) {
+					memmove(&indices[kept * 3], &indices[triangle * 3], 3 * sizeof(unsigned int));
+					kept++;
+				}
+			}
+			triangleCount = kept;
+			indices.resize(triangleCount * 3);
+			buildAdjacency(indices, positionOf, positionCount, adjacency);
+		}
+
+		result.swap(indices);
+		return maxError;
+	}
+
+}	// namespace
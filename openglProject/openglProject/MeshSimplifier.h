@@ -0,0 +1,34 @@
+#pragma once
+// MeshSimplifier.h is the file that holds
+// the quadric error mesh simplifier used
+// to build lower detail versions of a mesh.
+
+// Header guards
+#ifndef MESH_SIMPLIFIER_H_
+#define MESH_SIMPLIFIER_H_
+
+// Include headers
+#include <vector>
+
+#include "IndexedMesh.h"
+
+namespace applicationFramework {
+
+	/** Simplifies triangles over the vertices of a mesh with quadric error metrics
+	(Garland and Heckbert). Edges collapse onto one of their own vertices, so the
+	result only uses vertices of the mesh and their normals are kept as they are.
+	Vertices on a border only collapse along the border, and vertices split by an
+	attribute seam (same position, different normals) only collapse along the seam,
+	so holes and hard edges keep their outline.
+	@param mesh - the vertices the triangles index
+	@param sourceIndices - the triangles to simplify, 3 vertex numbers each
+	@param targetTriangleCount - stop once no more than this many triangles are left
+	@param result - receives the simplified triangles (stops early if no collapse is valid)
+	@return the largest collapse error, an area weighted RMS distance in model units
+	*/
+	float simplifyMesh(const IndexedMesh &mesh, const std::vector<unsigned int> &sourceIndices,
+		long targetTriangleCount, std::vector<unsigned int> &result);
+
+}	// namespace
+
+#endif
@@ -0,0 +1,218 @@
+// MeshletSet.cpp is the file that
+// holds the implementation for the
+// meshlet builder and culling.
+
+// Include headers
+#include <math.h>
+
+#include "MeshletSet.h"
+
+namespace applicationFramework {
+
+	// Local vertex numbers are stored in a byte
+	static const int MAX_LOCAL_VERTICES = 256;
+
+	// Marks a mesh vertex that is not in the meshlet being filled
+	static const int NOT_IN_MESHLET = -1;
+
+	// Class constructor
+	MeshletSet::MeshletSet()
+	{
+	}
+
+	// Class destructor
+	MeshletSet::~MeshletSet()
+	{
+	}
+
+	// Fill meshlets in index order, starting a new one when the next triangle doesn't fit
+	bool MeshletSet::build(const IndexedMesh &mesh, int maxVertices, int maxTriangles)
+	{
+		release();
+		if (maxVertices < 3 || maxVertices > MAX_LOCAL_VERTICES || maxTriangles < 1) {
+			return false;
+		}
+
+		std::vector<int> localVertex(mesh.vertexCount, NOT_IN_MESHLET);
+		Meshlet current = { 0, 0, 0, 0 };
+		long triangleCount = mesh.indexCount / 3;
+		for (long triangle = 0; triangle <= triangleCount; triangle++)
+		{
+			unsigned int corners[3] = { 0, 0, 0 };
+			bool isFull = triangle == triangleCount;			// One more pass to flush the last meshlet
+			if (!isFull) {
+				for (int corner = 0; corner < 3; corner++) {
+					corners[corner] = mesh.getIndex(triangle * 3 + corner);
+				}
+				int newVertices = (localVertex[corners[0]] == NOT_IN_MESHLET) +
+					(localVertex[corners[1]] == NOT_IN_MESHLET && corners[1] != corners[0]) +
+					(localVertex[corners[2]] == NOT_IN_MESHLET && corners[2] != corners[0] && corners[2] != corners[1]);
+				isFull = current.vertexCount + newVertices > (unsigned int)maxVertices ||
+					current.triangleCount + 1 > (unsigned int)maxTriangles;
+			}
+
+			if (isFull && current.triangleCount > 0) {
+				meshlets.push_back(current);
+				computeBounds(mesh);
+				for (unsigned int i = 0; i < current.vertexCount; i++) {
+					localVertex[meshletVertices[current.vertexOffset + i]] = NOT_IN_MESHLET;
+				}
+				current.vertexOffset = (unsigned int)meshletVertices.size();
+				current.triangleOffset = (unsigned int)meshletTriangles.size();
+				current.vertexCount = 0;
+				current.triangleCount = 0;
+			}
+			if (triangle == triangleCount) {
+				break;
+			}
+
+			for (int corner = 0; corner < 3; corner++) {
+				if (localVertex[corners[corner]] == NOT_IN_MESHLET) {
+					localVertex[corners[corner]] = (int)current.vertexCount++;
+					meshletVertices.push_back(corners[corner]);
+				}
+				meshletTriangles.push_back((unsigned char)localVertex[corners[corner]]);
+			}
+			current.triangleCount++;
+		}
+		return true;
+	}
+
+	// Bound the last meshlet. The cone holds every triangle normal, so if the eye sees
+	// the sphere from behind the cone, it sees the back of every triangle.
+	void MeshletSet::computeBounds(const IndexedMesh &mesh)
+	{
+		const Meshlet &meshlet = meshlets.back();
+		MeshletBounds result;
+
+		float minimum[3], maximum[3];
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++) {
+			const float *position = &mesh.positions[meshletVertices[meshlet.vertexOffset + i] * 3];
+			for (int axis = 0; axis < 3; axis++) {
+				minimum[axis] = i == 0 || position[axis] < minimum[axis] ? position[axis] : minimum[axis];
+				maximum[axis] = i == 0 || position[axis] > maximum[axis] ? position[axis] : maximum[axis];
+			}
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			result.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+		}
+		result.radius = 0.0f;
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++) {
+			const float *position = &mesh.positions[meshletVertices[meshlet.vertexOffset + i] * 3];
+			float dx = position[0] - result.center[0];
+			float dy = position[1] - result.center[1];
+			float dz = position[2] - result.center[2];
+			float radius = sqrtf(dx * dx + dy * dy + dz * dz);
+			result.radius = radius > result.radius ? radius : result.radius;
+		}
+
+		// Unit face normals, degenerate triangles have no facing and don't constrain the cone
+		std::vector<float> faceNormals(meshlet.triangleCount * 3, 0.0f);
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+		for (unsigned int triangle = 0; triangle < meshlet.triangleCount; triangle++) {
+			const unsigned char *local = &meshletTriangles[meshlet.triangleOffset + triangle * 3];
+			const float *a = &mesh.positions[meshletVertices[meshlet.vertexOffset + local[0]] * 3];
+			const float *b = &mesh.positions[meshletVertices[meshlet.vertexOffset + local[1]] * 3];
+			const float *c = &mesh.positions[meshletVertices[meshlet.vertexOffset + local[2]] * 3];
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float *normal = &faceNormals[triangle * 3];
+			normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+			normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+			normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+			float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length > 0.0f) {
+				for (int i = 0; i < 3; i++) {
+					normal[i] /= length;
+					axis[i] += normal[i];
+				}
+			}
+		}
+
+		float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		float minimumDot = 1.0f;
+		for (int i = 0; i < 3; i++) {
+			result.coneAxis[i] = axisLength > 0.0f ? axis[i] / axisLength : 0.0f;
+		}
+		for (unsigned int triangle = 0; triangle < meshlet.triangleCount && axisLength > 0.0f; triangle++) {
+			const float *normal = &faceNormals[triangle * 3];
+			if (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f) {
+				float dot = normal[0] * result.coneAxis[0] + normal[1] * result.coneAxis[1] + normal[2] * result.coneAxis[2];
+				minimumDot = dot < minimumDot ? dot : minimumDot;
+			}
+		}
+
+		// A cone of 90 degrees or more can always be seen from the front somewhere
+		result.coneCutoff = axisLength > 0.0f && minimumDot > 0.0f ? sqrtf(1.0f - minimumDot * minimumDot) : 1.0f;
+		bounds.push_back(result);
+	}
+
+	// Free the meshlets
+	void MeshletSet::release()
+	{
+		std::vector<Meshlet>().swap(meshlets);
+		std::vector<MeshletBounds>().swap(bounds);
+		std::vector<unsigned int>().swap(meshletVertices);
+		std::vector<unsigned char>().swap(meshletTriangles);
+	}
+
+	// Test every meshlet against the frustum, then against its normal cone. With the
+	// cone's half angle t, the triangles all face away when the view direction to the
+	// sphere is within 90 - t degrees of the axis, sphere included: dot >= sin(t) * d + r
+	MeshletCullStats MeshletSet::cull(const Frustum &frustum, const Vector<float> &eye, std::vector<unsigned int> &visible) const
+	{
+		MeshletCullStats stats = { 0, 0, 0 };
+		visible.clear();
+		for (size_t i = 0; i < bounds.size(); i++) {
+			const MeshletBounds &meshlet = bounds[i];
+			if (!frustum.isSphereVisible(meshlet.center, meshlet.radius)) {
+				stats.frustumCulledCount++;
+				continue;
+			}
+
+			if (meshlet.coneCutoff < 1.0f) {
+				float dx = meshlet.center[0] - eye.x;
+				float dy = meshlet.center[1] - eye.y;
+				float dz = meshlet.center[2] - eye.z;
+				float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+				float along = dx * meshlet.coneAxis[0] + dy * meshlet.coneAxis[1] + dz * meshlet.coneAxis[2];
+				if (along >= meshlet.coneCutoff * distance + meshlet.radius) {
+					stats.backfaceCulledCount++;
+					continue;
+				}
+			}
+
+			visible.push_back((unsigned int)i);
+		}
+		stats.visibleCount = (long)visible.size();
+		return stats;
+	}
+
+	// Turn meshlet triangles back into mesh vertex numbers
+	void MeshletSet::gatherIndices(const std::vector<unsigned int> &visible, std::vector<unsigned int> &indices) const
+	{
+		indices.clear();
+		for (size_t i = 0; i < visible.size(); i++) {
+			const Meshlet &meshlet = meshlets[visible[i]];
+			const unsigned char *local = &meshletTriangles[meshlet.triangleOffset];
+			const unsigned int *vertices = &meshletVertices[meshlet.vertexOffset];
+			for (unsigned int corner = 0; corner < meshlet.triangleCount * 3; corner++) {
+				indices.push_back(vertices[local[corner]]);
+			}
+		}
+	}
+
+	// Return the number of meshlets
+	long MeshletSet::getMeshletCount() const
+	{
+		return (long)meshlets.size();
+	}
+
+	// Return the bytes held by the meshlets
+	size_t MeshletSet::getSizeInBytes() const
+	{
+		return meshlets.size() * sizeof(Meshlet) + bounds.size() * sizeof(MeshletBounds) +
+			meshletVertices.size() * sizeof(unsigned int) + meshletTriangles.size();
+	}
+
+}	// namespace
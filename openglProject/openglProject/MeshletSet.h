@@ -0,0 +1,104 @@
+#pragma once
+// MeshletSet.h is the file that holds
+// an indexed mesh split into small clusters
+// that can be culled one by one.
+
+// Header guards
+#ifndef MESHLET_SET_H_
+#define MESHLET_SET_H_
+
+// Include headers
+#include <vector>
+
+#include "IndexedMesh.h"
+#include "Frustum.h"
+#include "Vector.h"
+
+namespace applicationFramework {
+
+	// Cluster sizes that suit mesh shader hardware, 124 keeps the triangles in 372 bytes
+	static const int MESHLET_MAX_VERTICES = 64;
+	static const int MESHLET_MAX_TRIANGLES = 124;
+
+	// Where a meshlet's data sits in the shared buffers
+	struct Meshlet
+	{
+		unsigned int vertexOffset;		// First entry in meshletVertices
+		unsigned int triangleOffset;	// First entry in meshletTriangles, 3 per triangle
+		unsigned int vertexCount;
+		unsigned int triangleCount;
+	};
+
+	// The culling data of a meshlet, kept apart from the topology so the cull loop reads 32 bytes each
+	struct MeshletBounds
+	{
+		float center[3];				// Bounding sphere
+		float radius;
+		float coneAxis[3];				// Average facing of the triangles
+		float coneCutoff;				// Sine of the cone's half angle, 1 if the triangles face too many ways to cull
+	};
+
+	// What a cull pass rejected
+	struct MeshletCullStats
+	{
+		long visibleCount;
+		long frustumCulledCount;		// Sphere outside a frustum plane
+		long backfaceCulledCount;		// Every triangle faces away from the eye
+	};
+
+	/* An indexed mesh split into meshlets of at most maxVertices vertices and
+	* maxTriangles triangles. Each meshlet lists the mesh vertices it uses and
+	* its triangles as 3 bytes into that list, like a mesh shader would read them.
+	*/
+	class MeshletSet
+	{
+	public:
+		// Class constructor/destructor
+		MeshletSet();
+		~MeshletSet();
+
+		/** Splits a mesh in index buffer order, run optimizeVertexCache first for tight clusters.
+		@param mesh - the mesh to split, its vertices must outlive any gatherIndices() use
+		@param maxVertices - the most vertices per meshlet, up to 256
+		@param maxTriangles - the most triangles per meshlet
+		@return false if the limits are out of range
+		*/
+		bool build(const IndexedMesh &mesh, int maxVertices = MESHLET_MAX_VERTICES, int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+		/** Frees the meshlets */
+		void release();
+
+		/** Finds the meshlets that may be seen from a camera. The back-facing test assumes
+		back faces are not drawn (closed meshes or GL_CULL_FACE).
+		@param frustum - the camera frustum, in the mesh's space
+		@param eye - the camera position, in the mesh's space
+		@param visible - filled with the numbers of the meshlets that passed
+		@return what was culled
+		*/
+		MeshletCullStats cull(const Frustum &frustum, const Vector<float> &eye, std::vector<unsigned int> &visible) const;
+
+		/** Expands meshlets back into mesh vertex numbers for glDrawElements.
+		@param visible - the meshlets to draw, as filled by cull()
+		@param indices - filled with 3 vertex numbers per triangle
+		*/
+		void gatherIndices(const std::vector<unsigned int> &visible, std::vector<unsigned int> &indices) const;
+
+		/** The number of meshlets, 0 before build() */
+		long getMeshletCount() const;
+
+		/** The bytes held by the meshlet buffers */
+		size_t getSizeInBytes() const;
+
+		std::vector<Meshlet> meshlets;
+		std::vector<MeshletBounds> bounds;			// One per meshlet
+		std::vector<unsigned int> meshletVertices;	// Mesh vertex numbers, in meshlet order
+		std::vector<unsigned char> meshletTriangles;	// 3 local vertex numbers per triangle
+
+	private:
+		/** Computes the sphere and cone of the last meshlet */
+		void computeBounds(const IndexedMesh &mesh);
+	};
+
+}	// namespace
+
+#endif
@@ -0,0 +1,394 @@
+// ObjStreamReader.cpp is the file that
+// holds the implementation for the
+// out-of-core obj reader.
+
+// Include headers
+#include <stdlib.h>
+#include <string.h>
+
+#include "ObjStreamReader.h"
+#include "ObjTokenizer.h"
+#include "MeshNormals.h"
+
+namespace applicationFramework {
+
+	// Vertices per page, the unit vertices are spilled and read back in
+	static const long VERTICES_PER_PAGE = 4096;
+	static const size_t PAGE_BYTES = VERTICES_PER_PAGE * 3 * sizeof(float);
+
+	// Fewest page slots, the page being filled is pinned and faces need a few more
+	static const int MIN_PAGE_SLOTS = 4;
+
+	// Budget kept back for the page table, which grows with the model (enough for about 16M vertices)
+	static const size_t PAGE_TABLE_RESERVE_BYTES = 16 << 10;
+
+	// Read buffer limits, it takes an eighth of the budget in between
+	static const size_t MIN_READ_BUFFER_BYTES = 64 << 10;
+	static const size_t MAX_READ_BUFFER_BYTES = 4 << 20;
+
+	// Seek in the spill file, which can outgrow a 32-bit long
+	static bool seekSpillFile(FILE *file, long page)
+	{
+#ifdef WIN32
+		return _fseeki64(file, (__int64)page * PAGE_BYTES, SEEK_SET) == 0;
+#else
+		return fseeko(file, (off_t)page * PAGE_BYTES, SEEK_SET) == 0;
+#endif
+	}
+
+	// Adapts a callback to the sink interface
+	class CallbackSink : public TriangleSink
+	{
+	public:
+		explicit CallbackSink(const ObjStreamReader::TriangleCallback &callback) : callback(callback) {}
+
+		bool consumeTriangles(const float *triangles, const float *normals, long triangleCount)
+		{
+			return callback(triangles, normals, triangleCount);
+		}
+
+	private:
+		const ObjStreamReader::TriangleCallback &callback;
+	};
+
+	// Class constructor
+	ObjStreamReader::ObjStreamReader(size_t memoryBudget, long batchTriangles)
+	{
+		this->memoryBudget = memoryBudget;
+		this->batchTriangles = batchTriangles > 0 ? batchTriangles : 1;
+		batchLimit = this->batchTriangles;
+		readBufferBytes = 0;
+		slotCount = 0;
+
+		readBuffer = NULL;
+		batchTriangleBuffer = NULL;
+		batchNormalBuffer = NULL;
+		pageSlots = NULL;
+		clockHand = 0;
+		spillFile = NULL;
+
+		batchCount = 0;
+		vertexCount = 0;
+		triangleCount = 0;
+		peakBytes = 0;
+		spilledBytes = 0;
+		pageReads = 0;
+	}
+
+	// Class destructor
+	ObjStreamReader::~ObjStreamReader()
+	{
+		release();
+	}
+
+	// Split the budget between the read buffer, the batch and the vertex pages
+	int ObjStreamReader::allocate()
+	{
+		readBufferBytes = memoryBudget / 8;
+		if (readBufferBytes < MIN_READ_BUFFER_BYTES) {
+			readBufferBytes = MIN_READ_BUFFER_BYTES;
+		}
+		else if (readBufferBytes > MAX_READ_BUFFER_BYTES) {
+			readBufferBytes = MAX_READ_BUFFER_BYTES;
+		}
+
+		// The batch shrinks to leave room for the fewest page slots, below one triangle the budget can't be kept
+		size_t triangleBytes = 9 * sizeof(float);
+		size_t minimumBytes = readBufferBytes + MIN_PAGE_SLOTS * PAGE_BYTES + PAGE_TABLE_RESERVE_BYTES;
+		if (memoryBudget < minimumBytes + 2 * triangleBytes) {
+			return -3;
+		}
+		long maxBatchTriangles = (long)((memoryBudget - minimumBytes) / (2 * triangleBytes));
+		batchLimit = batchTriangles < maxBatchTriangles ? batchTriangles : maxBatchTriangles;
+		size_t batchBytes = batchLimit * triangleBytes;
+
+		size_t fixedBytes = readBufferBytes + 2 * batchBytes;
+		slotCount = (int)((memoryBudget - fixedBytes - PAGE_TABLE_RESERVE_BYTES) / PAGE_BYTES);
+
+		readBuffer = (char*)malloc(readBufferBytes);
+		batchTriangleBuffer = (float*)malloc(batchBytes);
+		batchNormalBuffer = (float*)malloc(batchBytes);
+		pageSlots = (float*)malloc(slotCount * PAGE_BYTES);
+		if (readBuffer == NULL || batchTriangleBuffer == NULL || batchNormalBuffer == NULL || pageSlots == NULL) {
+			return -2;
+		}
+
+		slotPage.assign(slotCount, -1);
+		isSlotReferenced.assign(slotCount, false);
+		peakBytes = fixedBytes + slotCount * PAGE_BYTES;
+		return 0;
+	}
+
+	// Free the buffers and drop the spill file
+	void ObjStreamReader::release()
+	{
+		free(readBuffer);
+		free(batchTriangleBuffer);
+		free(batchNormalBuffer);
+		free(pageSlots);
+		if (spillFile != NULL) {
+			fclose(spillFile);									// tmpfile() deletes itself on close
+		}
+
+		readBuffer = NULL;
+		batchTriangleBuffer = NULL;
+		batchNormalBuffer = NULL;
+		pageSlots = NULL;
+		spillFile = NULL;
+
+		std::vector<int>().swap(pageSlot);
+		std::vector<bool>().swap(isPageOnDisk);
+		std::vector<int>().swap(slotPage);
+		std::vector<bool>().swap(isSlotReferenced);
+		clockHand = 0;
+	}
+
+	// Stream a model into a callback
+	int ObjStreamReader::read(const char *filename, const TriangleCallback &callback)
+	{
+		CallbackSink sink(callback);
+		return read(filename, sink);
+	}
+
+	// Stream a model into a sink
+	int ObjStreamReader::read(const char *filename, TriangleSink &sink)
+	{
+		release();
+		batchCount = 0;
+		vertexCount = 0;
+		triangleCount = 0;
+		peakBytes = 0;
+		spilledBytes = 0;
+		pageReads = 0;
+
+		FILE *file = fopen(filename, "rb");
+		if (file == NULL) {
+			return -1;
+		}
+		int allocateResult = allocate();
+		if (allocateResult != 0) {
+			fclose(file);
+			release();
+			return allocateResult;
+		}
+
+		int result = 0;
+		size_t used = 0;
+		bool isSkippingLine = false;
+		while (result == 0)
+		{
+			size_t readBytes = fread(readBuffer + used, 1, readBufferBytes - used, file);
+			used += readBytes;
+			bool isLastBlock = used < readBufferBytes;			// A short read means the end of the file
+
+			const char *begin = readBuffer;
+			const char *end = readBuffer + used;
+			if (isSkippingLine) {								// Drop the rest of a line longer than the buffer
+				const char *lineEnd = (const char*)memchr(begin, '\n', used);
+				if (lineEnd == NULL) {
+					used = 0;
+					if (isLastBlock) {
+						break;
+					}
+					continue;
+				}
+				begin = lineEnd + 1;
+				isSkippingLine = false;
+			}
+
+			const char *linesEnd = end;							// Only whole lines are parsed, the tail waits for more data
+			if (!isLastBlock) {
+				while (linesEnd > begin && linesEnd[-1] != '\n') {
+					--linesEnd;
+				}
+				if (linesEnd == begin && begin == readBuffer) {	// One line fills the buffer, it can't be a v or f record
+					isSkippingLine = true;
+					used = 0;
+					continue;
+				}
+			}
+
+			result = parseLines(begin, linesEnd, sink);
+
+			used = end - linesEnd;
+			memmove(readBuffer, linesEnd, used);
+			if (isLastBlock) {
+				break;
+			}
+		}
+
+		if (result == 0 && ferror(file)) {
+			result = -2;
+		}
+		if (result == 0 && batchCount > 0) {
+			result = flushBatch(sink);
+		}
+		fclose(file);
+
+		peakBytes += pageSlot.capacity() * sizeof(int) + isPageOnDisk.capacity() / 8;	// The page table grows with the model
+		release();
+		return result;
+	}
+
+	// Parse the whole lines in [cursor, end)
+	int ObjStreamReader::parseLines(const char *cursor, const char *end, TriangleSink &sink)
+	{
+		while (cursor < end)
+		{
+			if (objIsRecord(cursor, end, 'v'))									// v X Y Z
+			{
+				float vertex[3];
+				objParseVertexRecord(cursor + 1, end, vertex);
+				if (!appendVertex(vertex)) {
+					return -2;
+				}
+			}
+			else if (objIsRecord(cursor, end, 'f'))								// f 1 2 3 (or f 1/1/1 2/2/2 3/3/3)
+			{
+				int vertexNumber[3];
+				if (objParseFaceRecord(cursor + 1, end, vertexCount, vertexNumber)) {	// Skip faces that point at missing vertices
+					float *triangle = &batchTriangleBuffer[batchCount * 9];
+					for (int i = 0; i < 3; i++) {
+						const float *vertex = getVertex(vertexNumber[i]);		// Copied at once, the next call may evict it
+						if (vertex == NULL) {
+							return -2;
+						}
+						memcpy(&triangle[i * 3], vertex, 3 * sizeof(float));
+					}
+
+					if (++batchCount == batchLimit) {
+						int result = flushBatch(sink);
+						if (result != 0) {
+							return result;
+						}
+					}
+				}
+			}
+			cursor = objNextLine(cursor, end);
+		}
+		return 0;
+	}
+
+	// Fill in the normals and hand the batch over
+	int ObjStreamReader::flushBatch(TriangleSink &sink)
+	{
+		computeFaceNormals(batchTriangleBuffer, batchNormalBuffer, batchCount);
+		triangleCount += batchCount;
+
+		bool isContinuing = sink.consumeTriangles(batchTriangleBuffer, batchNormalBuffer, batchCount);
+		batchCount = 0;
+		return isContinuing ? 0 : 1;
+	}
+
+	// Append a vertex, starting a new page when the last one is full
+	bool ObjStreamReader::appendVertex(const float *vertex)
+	{
+		long page = vertexCount / VERTICES_PER_PAGE;
+		if (vertexCount % VERTICES_PER_PAGE == 0) {
+			int slot = acquireSlot();
+			if (slot < 0) {
+				return false;
+			}
+			pageSlot.push_back(slot);
+			isPageOnDisk.push_back(false);
+			slotPage[slot] = (int)page;
+		}
+
+		int slot = pageSlot[page];
+		memcpy(&pageSlots[slot * PAGE_BYTES / sizeof(float) + (vertexCount % VERTICES_PER_PAGE) * 3], vertex, 3 * sizeof(float));
+		isSlotReferenced[slot] = true;
+		vertexCount++;
+		return true;
+	}
+
+	// Return a vertex, reading its page back from the spill file if it was evicted
+	const float* ObjStreamReader::getVertex(long vertexNumber)
+	{
+		long page = vertexNumber / VERTICES_PER_PAGE;
+		int slot = pageSlot[page];
+		if (slot < 0) {
+			slot = acquireSlot();
+			if (slot < 0 ||
+				!seekSpillFile(spillFile, page) ||
+				fread(&pageSlots[slot * PAGE_BYTES / sizeof(float)], PAGE_BYTES, 1, spillFile) != 1) {
+				return NULL;
+			}
+			pageSlot[page] = slot;
+			slotPage[slot] = (int)page;
+			pageReads++;
+		}
+
+		isSlotReferenced[slot] = true;
+		return &pageSlots[slot * PAGE_BYTES / sizeof(float) + (vertexNumber % VERTICES_PER_PAGE) * 3];
+	}
+
+	// Find a slot with the clock algorithm, the page being filled is never evicted
+	int ObjStreamReader::acquireSlot()
+	{
+		long fillingPage = vertexCount % VERTICES_PER_PAGE != 0 ? vertexCount / VERTICES_PER_PAGE : -1;
+		for (;;)
+		{
+			int slot = clockHand;
+			clockHand = (clockHand + 1) % slotCount;
+
+			int page = slotPage[slot];
+			if (page < 0) {
+				return slot;
+			}
+			if (page == fillingPage) {							// Pinned
+				continue;
+			}
+			if (isSlotReferenced[slot]) {						// Second chance for recently used pages
+				isSlotReferenced[slot] = false;
+				continue;
+			}
+
+			if (!isPageOnDisk[page]) {							// Full pages never change, so each is written once
+				if (spillFile == NULL) {
+					spillFile = tmpfile();
+				}
+				if (spillFile == NULL ||
+					!seekSpillFile(spillFile, page) ||
+					fwrite(&pageSlots[slot * PAGE_BYTES / sizeof(float)], PAGE_BYTES, 1, spillFile) != 1) {
+					return -1;
+				}
+				isPageOnDisk[page] = true;
+				spilledBytes += PAGE_BYTES;
+			}
+			pageSlot[page] = -1;
+			slotPage[slot] = -1;
+			return slot;
+		}
+	}
+
+	// Vertices read
+	long ObjStreamReader::getVertexCount() const
+	{
+		return vertexCount;
+	}
+
+	// Triangles handed to the sink
+	long ObjStreamReader::getTriangleCount() const
+	{
+		return triangleCount;
+	}
+
+	// Most bytes held at once
+	size_t ObjStreamReader::getPeakBytes() const
+	{
+		return peakBytes;
+	}
+
+	// Bytes written to the spill file
+	size_t ObjStreamReader::getSpilledBytes() const
+	{
+		return spilledBytes;
+	}
+
+	// Pages read back from the spill file
+	long ObjStreamReader::getPageReads() const
+	{
+		return pageReads;
+	}
+
+}	// namespace
@@ -0,0 +1,108 @@
+#pragma once
+// ObjStreamReader.h is the file that reads
+// obj models too large to hold in memory,
+// handing their triangles out in batches.
+
+// Header guards
+#ifndef OBJ_STREAM_READER_H_
+#define OBJ_STREAM_READER_H_
+
+// Include headers
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+#include <functional>
+
+namespace applicationFramework {
+
+	// Receives the triangles of a streamed model, one batch at a time
+	class TriangleSink
+	{
+	public:
+		virtual ~TriangleSink() {}
+
+		/** Called for every batch, the buffers are reused once it returns.
+		@param triangles - 9 floats per triangle (3 corners of x,y,z), the layout of Obj_Loader::Faces_Triangles
+		@param normals - 9 floats per triangle, the face normal once per corner
+		@param triangleCount - the number of triangles in the batch
+		@return false to stop reading
+		*/
+		virtual bool consumeTriangles(const float *triangles, const float *normals, long triangleCount) = 0;
+	};
+
+	/* Reads an obj model front to back through a fixed read buffer. Vertices are
+	* kept in pages, and once the pages outgrow the budget the least recently used
+	* ones are spilled to a temporary file and paged back in when a face needs them.
+	* Memory use is fixed by the budget, whatever the size of the model.
+	*/
+	class ObjStreamReader
+	{
+	public:
+		// Callback form of TriangleSink::consumeTriangles
+		typedef std::function<bool(const float *triangles, const float *normals, long triangleCount)> TriangleCallback;
+
+		/** @param memoryBudget - bytes for the read buffer, the batch and the vertex pages,
+		reads fail if it can't hold the smallest workable layout (about 256 KB)
+		@param batchTriangles - triangles handed to the sink at a time, fewer if the budget needs it
+		*/
+		explicit ObjStreamReader(size_t memoryBudget = 64 << 20, long batchTriangles = 16384);
+		~ObjStreamReader();
+
+		/** Streams a model into a sink.
+		@return 0 when the whole file was read, 1 if the sink stopped it,
+		-1 if the file can't be opened, -2 if memory or the spill file failed,
+		-3 if the memory budget is too small
+		*/
+		int read(const char *filename, TriangleSink &sink);
+
+		/** Streams a model into a callback, same results as the sink form */
+		int read(const char *filename, const TriangleCallback &callback);
+
+		// Statistics of the last read
+		long getVertexCount() const;		// "v" records read
+		long getTriangleCount() const;		// Triangles handed to the sink
+		size_t getPeakBytes() const;		// Most bytes held at once
+		size_t getSpilledBytes() const;		// Vertex bytes written to the spill file
+		long getPageReads() const;			// Vertex pages read back from the spill file
+
+	private:
+		// The reader owns its buffers and spill file
+		ObjStreamReader(const ObjStreamReader &other);
+		ObjStreamReader& operator=(const ObjStreamReader &rhs);
+
+		int allocate();										// Allocate the fixed buffers within the budget, 0 or a read() error
+		void release();										// Free the buffers and close the spill file
+		int parseLines(const char *cursor, const char *end, TriangleSink &sink);	// Parse whole lines
+		int flushBatch(TriangleSink &sink);					// Hand the batch to the sink
+		bool appendVertex(const float *vertex);				// Store the next vertex
+		const float* getVertex(long vertexNumber);			// Page a vertex in, valid until the next call
+		int acquireSlot();									// Free a page slot, spilling its page if needed
+
+		size_t memoryBudget;
+		long batchTriangles;
+		long batchLimit;									// batchTriangles, lowered to fit the budget
+		size_t readBufferBytes;
+		int slotCount;
+
+		char *readBuffer;
+		float *batchTriangleBuffer;
+		float *batchNormalBuffer;
+		float *pageSlots;									// slotCount pages of vertices
+		std::vector<int> pageSlot;							// Slot of every page, -1 if it is on disk
+		std::vector<bool> isPageOnDisk;						// Pages already written to the spill file
+		std::vector<int> slotPage;							// Page in every slot, -1 if free
+		std::vector<bool> isSlotReferenced;					// Clock bits for page replacement
+		int clockHand;
+		FILE *spillFile;
+
+		long batchCount;
+		long vertexCount;
+		long triangleCount;
+		size_t peakBytes;
+		size_t spilledBytes;
+		long pageReads;
+	};
+
+}	// namespace
+
+#endif
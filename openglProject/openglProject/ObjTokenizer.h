@@ -0,0 +1,220 @@
+#pragma once
+// ObjTokenizer.h is the file that holds
+// the hand-written number parsers used to
+// read obj records in place, without
+// building a string per line.
+
+// Header guards
+#ifndef OBJ_TOKENIZER_H_
+#define OBJ_TOKENIZER_H_
+
+// Include headers
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+
+namespace applicationFramework {
+
+	// Powers of ten that are exactly representable as a double
+	static const double OBJ_POWERS_OF_TEN[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	/* Checks for a digit without going through the C locale */
+	inline bool objIsDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	/* Checks for the separators allowed inside an obj record */
+	inline bool objIsBlank(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	/* Moves the cursor past any separators on the current line */
+	inline void objSkipBlanks(const char *&cursor, const char *end) {
+		while (cursor < end && objIsBlank(*cursor)) {
+			++cursor;
+		}
+	}
+
+	/* Returns the first character of the next line (or end) */
+	inline const char* objNextLine(const char *cursor, const char *end) {
+		const char *lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+		return lineEnd != NULL ? lineEnd + 1 : end;
+	}
+
+	/* Checks if the line at the cursor starts with the given record tag,
+	* e.g. "v" matches "v 1 2 3" but not "vn 0 1 0".
+	*/
+	inline bool objIsRecord(const char *cursor, const char *end, char tag) {
+		return end - cursor >= 2 && cursor[0] == tag && objIsBlank(cursor[1]);
+	}
+
+	/* Parses a decimal floating point number ([+-]digits[.digits][(e|E)[+-]digits]).
+	* Up to 19 significant digits are kept, which is enough for a correctly
+	* rounded float in all but pathological inputs.
+	* @return false if there is no number at the cursor
+	*/
+	inline bool objParseFloat(const char *&cursor, const char *end, float &value) {
+		const char *p = cursor;
+		objSkipBlanks(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = (*p == '-');
+			++p;
+		}
+
+		unsigned long long mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+
+		while (p < end && objIsDigit(*p)) {				// Integer part
+			if (significantDigits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) {
+					++significantDigits;
+				}
+			}
+			else {
+				++exponent;								// Dropped digits still scale the value
+			}
+			anyDigits = true;
+			++p;
+		}
+
+		if (p < end && *p == '.') {						// Fractional part
+			++p;
+			while (p < end && objIsDigit(*p)) {
+				if (significantDigits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa != 0) {
+						++significantDigits;
+					}
+					--exponent;
+				}
+				anyDigits = true;
+				++p;
+			}
+		}
+
+		if (!anyDigits) {
+			return false;
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E')) {		// Exponent, only consumed if digits follow
+			const char *e = p + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+')) {
+				negativeExponent = (*e == '-');
+				++e;
+			}
+			if (e < end && objIsDigit(*e)) {
+				int explicitExponent = 0;
+				while (e < end && objIsDigit(*e)) {
+					if (explicitExponent < 10000) {
+						explicitExponent = explicitExponent * 10 + (*e - '0');
+					}
+					++e;
+				}
+				exponent += negativeExponent ? -explicitExponent : explicitExponent;
+				p = e;
+			}
+		}
+
+		double result = (double)mantissa;
+		if (mantissa != 0) {
+			if (exponent < 0) {
+				if (exponent >= -22) {
+					result /= OBJ_POWERS_OF_TEN[-exponent];
+				}
+				else {
+					result /= pow(10.0, -exponent);
+				}
+			}
+			else if (exponent > 0) {
+				if (exponent <= 22) {
+					result *= OBJ_POWERS_OF_TEN[exponent];
+				}
+				else {
+					result *= pow(10.0, exponent);
+				}
+			}
+		}
+
+		value = (float)(negative ? -result : result);
+		cursor = p;
+		return true;
+	}
+
+	/* Parses a face index ([+-]digits) and skips any "/texture/normal"
+	* references that follow it.
+	* @return false if there is no index at the cursor, or it does not fit a long
+	*/
+	inline bool objParseIndex(const char *&cursor, const char *end, long &value) {
+		const char *p = cursor;
+		objSkipBlanks(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = (*p == '-');
+			++p;
+		}
+
+		if (p >= end || !objIsDigit(*p)) {
+			return false;
+		}
+
+		long result = 0;
+		while (p < end && objIsDigit(*p)) {
+			if (result > (LONG_MAX - 9) / 10) {		// The next digit could overflow
+				return false;
+			}
+			result = result * 10 + (*p - '0');
+			++p;
+		}
+
+		while (p < end && !objIsBlank(*p) && *p != '\n') {	// Skip v/vt/vn references
+			++p;
+		}
+
+		value = negative ? -result : result;
+		cursor = p;
+		return true;
+	}
+
+	/* Reads "v X Y Z" (cursor after the tag), missing coordinates default to zero */
+	inline void objParseVertexRecord(const char *cursor, const char *end, float *vertex) {
+		vertex[0] = vertex[1] = vertex[2] = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			if (!objParseFloat(cursor, end, vertex[i])) {
+				break;
+			}
+		}
+	}
+
+	/* Reads "f 1 2 3" (or "f 1/1/1 2/2/2 3/3/3", cursor after the tag) into zero-based
+	* vertex numbers.
+	* @param vertexCount - the vertices read so far, negative numbers count back from it
+	* @return false if the face points at a vertex not read yet
+	*/
+	inline bool objParseFaceRecord(const char *cursor, const char *end, long vertexCount, int vertexNumber[3]) {
+		for (int i = 0; i < 3; i++) {
+			long index;
+			if (!objParseIndex(cursor, end, index)) {
+				return false;
+			}
+			index = index < 0 ? vertexCount + index : index - 1;
+			if (index < 0 || index >= vertexCount) {
+				return false;
+			}
+			vertexNumber[i] = (int)index;
+		}
+		return true;
+	}
+
+} // namespace
+
+#endif
@@ -3,12 +3,46 @@
 
 // Include headers
 #include "Obj_Loader.h"
+#include "MappedFile.h"
+#include "ObjTokenizer.h"
+#include "ThreadPool.h"
+#include "MeshNormals.h"
+#include "MeshOptimizer.h"
+#include "Logger.h"
+
+using namespace applicationFramework;
+
+// Files smaller than this per chunk are not worth splitting over threads
+static const long MIN_PARALLEL_CHUNK_BYTES = 1 << 20;
+
+// Chunks queued per thread, so uneven chunks still balance out
+static const long CHUNKS_PER_THREAD = 4;
+
+// A run of whole lines parsed by one task of the parallel loader
+struct ObjChunk
+{
+	const char *begin;
+	const char *end;
+	long vertexCount;		// "v" records in the chunk
+	long faceCount;			// "f" records in the chunk
+	long validFaceCount;	// "f" records that point at vertices read before them
+	long vertexBase;		// Vertices in all earlier chunks
+	long faceBase;			// Faces in all earlier chunks
+	long triangleBase;		// Valid faces in all earlier chunks
+};
 
 // Class constructor
 Obj_Loader::Obj_Loader()
 {
 	this->TotalConnectedTriangles = 0;
 	this->TotalConnectedPoints = 0;
+	this->normals = NULL;
+	this->Faces_Triangles = NULL;
+	this->vertexBuffer = NULL;
+	this->bufferBytes = 0;
+	this->residentBytes = 0;
+	this->peakBytes = 0;
+	this->loadProgress = NULL;
 }
 
 // Class destructor
@@ -16,53 +50,113 @@ Obj_Loader::~Obj_Loader()
 {
 }
 
-// calculate model normals
-float* Obj_Loader::calculateNormal(float *coord1, float *coord2, float *coord3)
+// calculate model normals, degenerate faces get a zero normal
+void Obj_Loader::calculateNormal(const float *coord1, const float *coord2, const float *coord3, float *norm)
 {
-	/* calculate Vector1 and Vector2 */
-	float va[3], vb[3], vr[3], val;
-	va[0] = coord1[0] - coord2[0];
-	va[1] = coord1[1] - coord2[1];
-	va[2] = coord1[2] - coord2[2];
+	computeFaceNormal(coord1, coord2, coord3, norm);
+}
 
-	vb[0] = coord1[0] - coord3[0];
-	vb[1] = coord1[1] - coord3[1];
-	vb[2] = coord1[2] - coord3[2];
+// Append a triangle built from three zero-based vertex numbers, its normal is filled in by calculateNormals
+void Obj_Loader::addTriangle(const int vertexNumber[3])
+{
+	writeTriangle(vertexNumber, &Faces_Triangles[TotalConnectedTriangles]);
+	TotalConnectedTriangles += TOTAL_FLOATS_IN_TRIANGLE;
+}
 
-	/* cross product */
-	vr[0] = va[1] * vb[2] - vb[1] * va[2];
-	vr[1] = vb[0] * va[2] - va[0] * vb[2];
-	vr[2] = va[0] * vb[1] - vb[0] * va[1];
+// Write the 9 floats of a triangle. Only reads vertexBuffer, so the parallel
+// loader calls it from many threads at once. Normals are generated afterwards
+// for all triangles in one pass (see computeFaceNormals).
+void Obj_Loader::writeTriangle(const int vertexNumber[3], float *triangle)
+{
+	/********************************************************************
+	* Create triangles (f 1 2 3) from points: (v X Y Z) (v X Y Z) (v X Y Z).
+	* The vertexBuffer contains all verteces
+	* The triangles will be created using the verteces we read previously
+	*/
+	int tCounter = 0;
+	for (int i = 0; i < POINTS_PER_VERTEX; i++)
+	{
+		triangle[tCounter] = vertexBuffer[3 * vertexNumber[i]];
+		triangle[tCounter + 1] = vertexBuffer[3 * vertexNumber[i] + 1];
+		triangle[tCounter + 2] = vertexBuffer[3 * vertexNumber[i] + 2];
+		tCounter += POINTS_PER_VERTEX;
+	}
+}
 
-	/* normalization factor */
-	val = sqrt(vr[0] * vr[0] + vr[1] * vr[1] + vr[2] * vr[2]);
+/*********************************************************************
+* Calculate all normals, used for lighting. Runs once over every triangle
+* after parsing, with the SIMD kernels picked for this CPU.
+*/
+void Obj_Loader::calculateNormals()
+{
+	computeFaceNormals(Faces_Triangles, normals, TotalConnectedTriangles / TOTAL_FLOATS_IN_TRIANGLE);
+}
 
-	float norm[3];
-	norm[0] = vr[0] / val;
-	norm[1] = vr[1] / val;
-	norm[2] = vr[2] / val;
+// Allocate the model buffers for the counted vertex and face records
+void Obj_Loader::allocateBuffers(long vertexCount, long faceCount)
+{
+	size_t vertexBytes = vertexCount * POINTS_PER_VERTEX * sizeof(float);
+	size_t triangleBytes = faceCount * TOTAL_FLOATS_IN_TRIANGLE * sizeof(float);
 
+	vertexBuffer = (float*)malloc(vertexBytes);						// Allocate memory for the verteces
+	Faces_Triangles = (float*)malloc(triangleBytes);					// Allocate memory for the triangles
+	normals = (float*)malloc(triangleBytes);							// Allocate memory for the normals
 
-	return norm;
+	bufferBytes = vertexBytes + 2 * triangleBytes;						// Sized for every counted record, some may be skipped while parsing
+	trackAllocation(bufferBytes);
+}
+
+// Record memory taken by the model
+void Obj_Loader::trackAllocation(size_t bytes)
+{
+	residentBytes += bytes;
+	if (residentBytes > peakBytes) {
+		peakBytes = residentBytes;
+	}
+}
+
+// Record memory given back by the model
+void Obj_Loader::trackRelease(size_t bytes)
+{
+	residentBytes -= bytes < residentBytes ? bytes : residentBytes;
+}
+
+// Return the bytes currently held by the model
+size_t Obj_Loader::getResidentBytes() const
+{
+	return residentBytes;
+}
+
+// Return the most bytes held at once since the model was loaded
+size_t Obj_Loader::getPeakBytes() const
+{
+	return peakBytes;
 }
 
 // Load the model
 int Obj_Loader::load(char* filename)
 {
+	PROFILE_ZONE("Obj_Loader::load");
 	string line;
 	ifstream objFile(filename);
 	if (objFile.is_open())													// If obj file is open, continue
 	{
-		objFile.seekg(0, ios::end);										// Go to end of the file, 
-		long fileSize = objFile.tellg();									// get file size
-		objFile.seekg(0, ios::beg);										// we'll use this to register memory for our 3d model
-
-		vertexBuffer = (float*)malloc(fileSize);							// Allocate memory for the verteces
-		Faces_Triangles = (float*)malloc(fileSize*sizeof(float));			// Allocate memory for the triangles
-		normals = (float*)malloc(fileSize*sizeof(float));					// Allocate memory for the normals
+		long vertexCount = 0;												// Count the records first,
+		long faceCount = 0;													// we'll use this to register memory for our 3d model
+		while (!objFile.eof())
+		{
+			getline(objFile, line);
+			if (line.c_str()[0] == 'v') {
+				vertexCount++;
+			}
+			if (line.c_str()[0] == 'f') {
+				faceCount++;
+			}
+		}
+		objFile.clear();													// Go back to the start of the file
+		objFile.seekg(0, ios::beg);
 
-		int triangle_index = 0;												// Set triangle index to zero
-		int normal_index = 0;												// Set normal index to zero
+		allocateBuffers(vertexCount, faceCount);							// Allocate memory for the verteces, triangles and normals
 
 		while (!objFile.eof())											// Start reading file data
 		{
@@ -93,69 +187,574 @@ int Obj_Loader::load(char* filename)
 				vertexNumber[1] -= 1;										// OBJ file starts counting from 1
 				vertexNumber[2] -= 1;										// OBJ file starts counting from 1
 
-
-																			/********************************************************************
-																			* Create triangles (f 1 2 3) from points: (v X Y Z) (v X Y Z) (v X Y Z).
-																			* The vertexBuffer contains all verteces
-																			* The triangles will be created using the verteces we read previously
-																			*/
-
-				int tCounter = 0;
+				bool isValid = true;										// Skip faces that point outside the vertex buffer
 				for (int i = 0; i < POINTS_PER_VERTEX; i++)
 				{
-					Faces_Triangles[triangle_index + tCounter] = vertexBuffer[3 * vertexNumber[i]];
-					Faces_Triangles[triangle_index + tCounter + 1] = vertexBuffer[3 * vertexNumber[i] + 1];
-					Faces_Triangles[triangle_index + tCounter + 2] = vertexBuffer[3 * vertexNumber[i] + 2];
-					tCounter += POINTS_PER_VERTEX;
+					isValid = isValid && vertexNumber[i] >= 0 && vertexNumber[i] < TotalConnectedPoints / POINTS_PER_VERTEX;
 				}
 
-				/*********************************************************************
-				* Calculate all normals, used for lighting
-				*/
-				float coord1[3] = { Faces_Triangles[triangle_index], Faces_Triangles[triangle_index + 1],Faces_Triangles[triangle_index + 2] };
-				float coord2[3] = { Faces_Triangles[triangle_index + 3],Faces_Triangles[triangle_index + 4],Faces_Triangles[triangle_index + 5] };
-				float coord3[3] = { Faces_Triangles[triangle_index + 6],Faces_Triangles[triangle_index + 7],Faces_Triangles[triangle_index + 8] };
-				float *norm = this->calculateNormal(coord1, coord2, coord3);
-
-				tCounter = 0;
-				for (int i = 0; i < POINTS_PER_VERTEX; i++)
-				{
-					normals[normal_index + tCounter] = norm[0];
-					normals[normal_index + tCounter + 1] = norm[1];
-					normals[normal_index + tCounter + 2] = norm[2];
-					tCounter += POINTS_PER_VERTEX;
+				if (isValid) {
+					addTriangle(vertexNumber);								// Create the triangle and its normals
 				}
-
-				triangle_index += TOTAL_FLOATS_IN_TRIANGLE;
-				normal_index += TOTAL_FLOATS_IN_TRIANGLE;
-				TotalConnectedTriangles += TOTAL_FLOATS_IN_TRIANGLE;
 			}
 		}
 		objFile.close();														// Close OBJ file
+		calculateNormals();
 	}
 	else
 	{
-		cout << "Unable to open file";
+		LOG_ERROR("Unable to open file %s", filename);
+	}
+	return 0;
+}
+
+// Load the model from a memory mapped file. Records are parsed in place,
+// so no line strings are built and the C locale is never consulted.
+int Obj_Loader::loadMapped(char* filename)
+{
+	PROFILE_ZONE("Obj_Loader::loadMapped");
+	MappedFile objFile;
+	if (!objFile.open(filename))											// If obj file can't be mapped, stop
+	{
+		LOG_ERROR("Unable to open file %s", filename);
+		return -1;
+	}
+
+	const char *begin = objFile.getData();
+	const char *end = begin + objFile.getSize();
+
+	long vertexCount = 0;													// Count the records first so the
+	long faceCount = 0;														// buffers are sized exactly
+	for (const char *cursor = begin; cursor < end; cursor = objNextLine(cursor, end))
+	{
+		if (objIsRecord(cursor, end, 'v')) {
+			vertexCount++;
+		}
+		else if (objIsRecord(cursor, end, 'f')) {
+			faceCount++;
+		}
+	}
+
+	allocateBuffers(vertexCount, faceCount);
+
+	const char *cursor = begin;
+	while (cursor < end)
+	{
+		if (objIsRecord(cursor, end, 'v'))									// v X Y Z
+		{
+			objParseVertexRecord(cursor + 1, end, &vertexBuffer[TotalConnectedPoints]);
+			TotalConnectedPoints += POINTS_PER_VERTEX;						// Always count it so face numbers stay aligned
+		}
+		else if (objIsRecord(cursor, end, 'f'))								// f 1 2 3 (or f 1/1/1 2/2/2 3/3/3)
+		{
+			int vertexNumber[3];
+			if (objParseFaceRecord(cursor + 1, end, TotalConnectedPoints / POINTS_PER_VERTEX, vertexNumber)) {
+				addTriangle(vertexNumber);									// Skip faces that point at missing vertices
+			}
+		}
+		cursor = objNextLine(cursor, end);
+	}
+
+	calculateNormals();
+	return 0;
+}
+
+// Load the model from a memory mapped file, parsing chunks of whole lines on a
+// thread pool. Per-chunk counts are stitched together with prefix sums, so vertex
+// numbers stay global and the output is bit-identical to loadMapped.
+int Obj_Loader::loadParallel(char* filename, unsigned int threadCount)
+{
+	PROFILE_ZONE("Obj_Loader::loadParallel");
+	MappedFile objFile;
+	if (!objFile.open(filename))											// If obj file can't be mapped, stop
+	{
+		LOG_ERROR("Unable to open file %s", filename);
+		return -1;
+	}
+
+	ThreadPool *localPool = threadCount != 0 ? new ThreadPool(threadCount) : NULL;
+	ThreadPool &pool = localPool != NULL ? *localPool : ThreadPool::getSharedPool();
+
+	const char *begin = objFile.getData();
+	const char *end = begin + objFile.getSize();
+	size_t fileSize = objFile.getSize();
+
+	/*********************************************************************
+	* Split the file at line boundaries
+	*/
+	size_t chunkCount = pool.getThreadCount() * CHUNKS_PER_THREAD;
+	size_t maxChunkCount = fileSize / MIN_PARALLEL_CHUNK_BYTES + 1;
+	if (chunkCount > maxChunkCount) {
+		chunkCount = maxChunkCount;
+	}
+
+	vector<ObjChunk> chunks(chunkCount);
+	chunks[0].begin = begin;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char *split = begin + (size_t)((double)fileSize * i / chunkCount);
+		if (split < chunks[i - 1].begin) {
+			split = chunks[i - 1].begin;
+		}
+		if (split > begin && split[-1] != '\n') {						// Move forward to the start of a line
+			split = objNextLine(split, end);
+		}
+		chunks[i].begin = split;
+		chunks[i - 1].end = split;
+	}
+	chunks[chunkCount - 1].end = end;
+
+	/*********************************************************************
+	* Count the records in each chunk and size the buffers exactly
+	*/
+	pool.parallelFor((long)chunkCount, [&](long i) {
+		ObjChunk &chunk = chunks[i];
+		chunk.vertexCount = 0;
+		chunk.faceCount = 0;
+		for (const char *cursor = chunk.begin; cursor < chunk.end; cursor = objNextLine(cursor, chunk.end))
+		{
+			if (objIsRecord(cursor, chunk.end, 'v')) {
+				chunk.vertexCount++;
+			}
+			else if (objIsRecord(cursor, chunk.end, 'f')) {
+				chunk.faceCount++;
+			}
+		}
+	});
+
+	if (isLoadCancelled()) {
+		delete localPool;
+		return LOAD_RESULT_CANCELLED;
+	}
+	reportProgress(0.1f);
+
+	long vertexCount = 0;
+	long faceCount = 0;
+	for (size_t i = 0; i < chunkCount; i++)									// Prefix sums give each chunk its global offsets
+	{
+		chunks[i].vertexBase = vertexCount;
+		chunks[i].faceBase = faceCount;
+		vertexCount += chunks[i].vertexCount;
+		faceCount += chunks[i].faceCount;
+	}
+
+	allocateBuffers(vertexCount, faceCount);
+
+	size_t faceNumberBytes = faceCount * POINTS_PER_VERTEX * sizeof(int);
+	int *faceNumbers = (int*)malloc(faceNumberBytes);						// Scratch: parsed vertex numbers of every face
+	trackAllocation(faceNumberBytes);
+
+	/*********************************************************************
+	* Parse the vertices in place and resolve the face vertex numbers
+	*/
+	std::atomic<long> finishedChunks(0);
+	pool.parallelFor((long)chunkCount, [&](long i) {
+		ObjChunk &chunk = chunks[i];
+		long vertexNumber = chunk.vertexBase;
+		int *faceNumber = &faceNumbers[chunk.faceBase * POINTS_PER_VERTEX];
+		chunk.validFaceCount = 0;
+		if (isLoadCancelled()) {												// Leave the chunk empty, the load is thrown away
+			return;
+		}
+		for (const char *cursor = chunk.begin; cursor < chunk.end; cursor = objNextLine(cursor, chunk.end))
+		{
+			if (objIsRecord(cursor, chunk.end, 'v'))
+			{
+				objParseVertexRecord(cursor + 1, chunk.end, &vertexBuffer[vertexNumber * POINTS_PER_VERTEX]);
+				vertexNumber++;
+			}
+			else if (objIsRecord(cursor, chunk.end, 'f'))
+			{
+				if (objParseFaceRecord(cursor + 1, chunk.end, vertexNumber, faceNumber)) {
+					faceNumber += POINTS_PER_VERTEX;						// Valid faces are packed at the front of the chunk
+					chunk.validFaceCount++;
+				}
+			}
+		}
+		reportProgress(0.1f + 0.5f * ++finishedChunks / chunkCount);
+	});
+
+	if (isLoadCancelled()) {
+		free(faceNumbers);
+		trackRelease(faceNumberBytes);
+		delete localPool;
+		release();
+		return LOAD_RESULT_CANCELLED;
+	}
+
+	long triangleCount = 0;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		chunks[i].triangleBase = triangleCount;
+		triangleCount += chunks[i].validFaceCount;
 	}
+
+	/*********************************************************************
+	* Build the triangles and normals now that every vertex is in place
+	*/
+	finishedChunks = 0;
+	pool.parallelFor((long)chunkCount, [&](long i) {
+		ObjChunk &chunk = chunks[i];
+		for (long face = 0; face < chunk.validFaceCount; face++)
+		{
+			writeTriangle(&faceNumbers[(chunk.faceBase + face) * POINTS_PER_VERTEX],
+				&Faces_Triangles[(chunk.triangleBase + face) * TOTAL_FLOATS_IN_TRIANGLE]);
+		}
+
+		long first = chunk.triangleBase * TOTAL_FLOATS_IN_TRIANGLE;
+		computeFaceNormals(&Faces_Triangles[first], &normals[first], chunk.validFaceCount);
+		reportProgress(0.6f + 0.3f * ++finishedChunks / chunkCount);
+	});
+
+	free(faceNumbers);
+	trackRelease(faceNumberBytes);
+	delete localPool;
+
+	TotalConnectedPoints = vertexCount * POINTS_PER_VERTEX;
+	TotalConnectedTriangles = triangleCount * TOTAL_FLOATS_IN_TRIANGLE;
 	return 0;
 }
 
+// Load the indexed mesh from its binary cache. A missing or stale cache is rebuilt
+// from the obj file, later loads map it straight into the render buffers.
+int Obj_Loader::loadCached(char* filename, NormalMode normalMode)
+{
+	PROFILE_ZONE("Obj_Loader::loadCached");
+	if (meshCache.open(filename, indexedMesh, normalMode))								// Valid cache, nothing to parse
+	{
+		trackAllocation(indexedMesh.getSizeInBytes());
+		reportProgress(1.0f);
+		return 0;
+	}
+
+	int result = loadParallel(filename);
+	if (result != 0) {
+		return result;
+	}
+
+	buildIndexedMesh(normalMode);
+	reportProgress(0.93f);
+	if (isLoadCancelled()) {
+		release();
+		return LOAD_RESULT_CANCELLED;
+	}
+	optimizeIndexedMesh();													// Saved optimized, so every later load gets it for free
+	releaseTriangles();														// Same state as a cache hit: only indexedMesh is kept
+	reportProgress(0.97f);
+	if (!MeshCache::write(filename, indexedMesh, normalMode)) {
+		LOG_WARNING("Unable to write mesh cache for %s", filename);
+	}
+	reportProgress(1.0f);
+	return 0;
+}
+
+// Report load progress to whoever is watching
+void Obj_Loader::setLoadProgress(LoadProgress *progress)
+{
+	loadProgress = progress;
+}
+
+// Forward progress, if anyone is watching
+void Obj_Loader::reportProgress(float fraction)
+{
+	if (loadProgress != NULL) {
+		loadProgress->report(fraction);
+	}
+}
+
+// Check if the load was cancelled
+bool Obj_Loader::isLoadCancelled() const
+{
+	return loadProgress != NULL && loadProgress->isCancelRequested();
+}
+
+// Weld the loaded triangles into an indexed mesh
+bool Obj_Loader::buildIndexedMesh(NormalMode normalMode)
+{
+	trackRelease(indexedMesh.getSizeInBytes());
+
+	long cornerCount = TotalConnectedTriangles / POINTS_PER_VERTEX;
+	size_t scratchBytes = cornerCount * (sizeof(unsigned int) * 3 + 6 * sizeof(float));	// Hash table, wide indices and worst case vertices
+	trackAllocation(scratchBytes);
+	bool isSmooth = normalMode != NORMALS_FLAT;
+	bool isBuilt = indexedMesh.build(Faces_Triangles, isSmooth ? NULL : normals, cornerCount);	// Smooth normals are shared, so weld on position
+	trackRelease(scratchBytes);
+
+	if (isBuilt && isSmooth) {
+		scratchBytes = getVertexNormalsScratchBytes(indexedMesh.vertexCount, indexedMesh.indexCount, normalMode);
+		trackAllocation(indexedMesh.getSizeInBytes() + scratchBytes);
+		isBuilt = computeVertexNormals(indexedMesh, normalMode, ThreadPool::getSharedPool());
+		trackRelease(indexedMesh.getSizeInBytes() + scratchBytes);
+	}
+
+	trackAllocation(indexedMesh.getSizeInBytes());
+	return isBuilt;
+}
+
+// Build the levels of detail, they index the vertices of indexedMesh
+bool Obj_Loader::buildLods(const float *ratios, int ratioCount)
+{
+	trackRelease(lodChain.getSizeInBytes());
+	bool isBuilt = lodChain.build(indexedMesh, ratios, ratioCount);
+	trackAllocation(lodChain.getSizeInBytes());
+	return isBuilt;
+}
+
+// Reorder the indexed mesh for the GPU, the triangles and vertices stay the same
+bool Obj_Loader::optimizeIndexedMesh()
+{
+	return optimizeVertexCache(indexedMesh) && optimizeVertexFetch(indexedMesh);
+}
+
+// Split the indexed mesh into meshlets, in its (cache optimized) triangle order
+bool Obj_Loader::buildMeshlets(int maxVertices, int maxTriangles)
+{
+	trackRelease(meshletSet.getSizeInBytes());
+	bool isBuilt = meshletSet.build(indexedMesh, maxVertices, maxTriangles);
+	trackAllocation(meshletSet.getSizeInBytes());
+	return isBuilt;
+}
+
+// Build the ray query tree, it keeps its own copy of the triangles
+bool Obj_Loader::buildBvh()
+{
+	trackRelease(bvh.getSizeInBytes());
+	size_t scratchBytes = TriangleBvh::getBuildScratchBytes(indexedMesh.indexCount / 3);
+	trackAllocation(scratchBytes);
+	bool isBuilt = bvh.build(indexedMesh, ThreadPool::getSharedPool());
+	trackRelease(scratchBytes);
+	trackAllocation(bvh.getSizeInBytes());
+	return isBuilt;
+}
+
+// Replace the float indexed mesh by its quantized copy, the LOD levels keep
+// indexing the same vertices
+bool Obj_Loader::quantizeIndexedMesh(NormalPrecision normalPrecision)
+{
+	trackRelease(quantizedMesh.getSizeInBytes());
+	bool isBuilt = quantizedMesh.build(indexedMesh, normalPrecision);
+	trackAllocation(quantizedMesh.getSizeInBytes());					// Both are held until the floats go
+	if (!isBuilt) {
+		return false;
+	}
+
+	trackRelease(indexedMesh.getSizeInBytes());
+	indexedMesh.release();
+	meshCache.close();													// Nothing points into the mapped cache anymore
+	return true;
+}
+
+// Find the box around the model from the buffers it still holds
+bool Obj_Loader::getBounds(float *boundsMin, float *boundsMax) const
+{
+	if (quantizedMesh.vertexCount > 0)
+	{
+		quantizedMesh.getBounds(boundsMin, boundsMax);
+		return true;
+	}
+
+	long vertexCount;
+	const float *positions = getResidentPositions(vertexCount);
+	if (positions == NULL) {
+		return false;
+	}
+
+	for (int axis = 0; axis < 3; axis++) {
+		boundsMin[axis] = boundsMax[axis] = positions[axis];
+	}
+	for (long vertex = 1; vertex < vertexCount; vertex++) {
+		for (int axis = 0; axis < 3; axis++) {
+			float value = positions[vertex * POINTS_PER_VERTEX + axis];
+			boundsMin[axis] = value < boundsMin[axis] ? value : boundsMin[axis];
+			boundsMax[axis] = value > boundsMax[axis] ? value : boundsMax[axis];
+		}
+	}
+	return true;
+}
+
+// The indexed positions, else the corners of the triangles
+const float* Obj_Loader::getResidentPositions(long &vertexCount) const
+{
+	const float *positions = indexedMesh.vertexCount > 0 ? indexedMesh.positions : Faces_Triangles;
+	vertexCount = indexedMesh.vertexCount > 0 ? indexedMesh.vertexCount : TotalConnectedTriangles / POINTS_PER_VERTEX;
+	if (positions == NULL || vertexCount == 0) {
+		vertexCount = 0;
+		return NULL;
+	}
+	return positions;
+}
+
+// The indexed normals, else the corner normals
+const float* Obj_Loader::getResidentNormals(long &vertexCount) const
+{
+	const float *vertexNormals = indexedMesh.vertexCount > 0 ? indexedMesh.normals : normals;
+	getResidentPositions(vertexCount);
+	if (vertexNormals == NULL) {
+		vertexCount = 0;
+	}
+	return vertexCount > 0 ? vertexNormals : NULL;
+}
+
+// Count the vertices the transforms write
+long Obj_Loader::getPositionCount() const
+{
+	long vertexCount;
+	getResidentPositions(vertexCount);
+	return vertexCount;
+}
+
+// Transform the positions into interleaved floats
+long Obj_Loader::transformPositions(const Mat4 &matrix, float *output, TransformMode mode) const
+{
+	PROFILE_ZONE("Obj_Loader::transformPositions");
+	long vertexCount;
+	const float *positions = getResidentPositions(vertexCount);
+	if (positions != NULL) {
+		transformInterleaved(matrix, positions, output, vertexCount, mode, ThreadPool::getSharedPool());
+	}
+	return vertexCount;
+}
+
+// Transform the positions into arrays
+long Obj_Loader::transformPositions(const Mat4 &matrix, const SoaSpan &output, TransformMode mode) const
+{
+	PROFILE_ZONE("Obj_Loader::transformPositions");
+	long vertexCount;
+	const float *positions = getResidentPositions(vertexCount);
+	if (positions != NULL) {
+		transformInterleavedToSoa(matrix, positions, output, vertexCount, mode, ThreadPool::getSharedPool());
+	}
+	return vertexCount;
+}
+
+// Transform the normals as directions
+long Obj_Loader::transformNormals(const Mat4 &matrix, float *output) const
+{
+	PROFILE_ZONE("Obj_Loader::transformNormals");
+	long vertexCount;
+	const float *vertexNormals = getResidentNormals(vertexCount);
+	if (vertexNormals != NULL) {
+		transformInterleaved(matrix, vertexNormals, output, vertexCount, TRANSFORM_VECTORS, ThreadPool::getSharedPool());
+	}
+	return vertexCount;
+}
+
+// Free the unindexed buffers, render() keeps drawing the indexed mesh
+void Obj_Loader::releaseTriangles()
+{
+	trackRelease(bufferBytes);
+	bufferBytes = 0;
+
+	free(this->Faces_Triangles);
+	free(this->normals);
+	free(this->vertexBuffer);
+
+	this->normals = NULL;
+	this->Faces_Triangles = NULL;
+	this->vertexBuffer = NULL;
+	this->TotalConnectedPoints = 0;
+	this->TotalConnectedTriangles = 0;
+}
+
 // Free the models memory
 void Obj_Loader::release()
 {
 	free(this->Faces_Triangles);
 	free(this->normals);
 	free(this->vertexBuffer);
+	this->lodChain.release();
+	this->indexedMesh.release();
+	this->quantizedMesh.release();
+	this->meshletSet.release();
+	this->bvh.release();
+	this->meshCache.close();
+
+	this->normals = NULL;
+	this->Faces_Triangles = NULL;
+	this->vertexBuffer = NULL;
+	this->TotalConnectedPoints = 0;
+	this->TotalConnectedTriangles = 0;
+	this->bufferBytes = 0;
+	this->residentBytes = 0;
+	this->peakBytes = 0;
 }
 
 // Render the model to the screen
+void Obj_Loader::renderLod(int lod)
+{
+	if (lod < 0 || lod >= lodChain.getLodCount())
+	{
+		render();
+		return;
+	}
+
+	drawIndices(lodChain.getIndices(lod));					// Every level shares the unique vertices
+}
+
+// Draw the meshlets that pass the frustum and back-face tests
+long Obj_Loader::renderMeshlets(const Frustum &frustum, const Vector<float> &eye)
+{
+	if (meshletSet.getMeshletCount() == 0)
+	{
+		render();
+		return 0;
+	}
+
+	meshletSet.cull(frustum, eye, visibleMeshlets);
+	meshletSet.gatherIndices(visibleMeshlets, visibleIndices);
+	if (!visibleIndices.empty()) {
+		drawIndices(visibleIndices);
+	}
+	return (long)visibleMeshlets.size();
+}
+
+// Draw an index list over whichever vertices the model keeps
+void Obj_Loader::drawIndices(const std::vector<unsigned int> &indices)
+{
+	if (indices.empty())										// e.g. a level simplified to nothing
+	{
+		return;
+	}
+	if (quantizedMesh.indexCount > 0)
+	{
+		size_t quantizedBytes = quantizedMesh.getSizeInBytes();		// The first draw expands the normals for fixed function
+		quantizedMesh.render(indices.data(), (long)indices.size(), GL_UNSIGNED_INT);
+		trackAllocation(quantizedMesh.getSizeInBytes() - quantizedBytes);
+		return;
+	}
+	glEnableClientState(GL_VERTEX_ARRAY);						// Enable vertex arrays
+	glEnableClientState(GL_NORMAL_ARRAY);						// Enable normal arrays
+	glVertexPointer(3, GL_FLOAT, 0, indexedMesh.positions);
+	glNormalPointer(GL_FLOAT, 0, indexedMesh.normals);
+	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, indices.data());
+	glDisableClientState(GL_VERTEX_ARRAY);						// Disable vertex arrays
+	glDisableClientState(GL_NORMAL_ARRAY);						// Disable normal arrays
+}
+
 void Obj_Loader::render()
 {
+	if (quantizedMesh.indexCount > 0)								// Compact vertices, dequantized by the modelview matrix
+	{
+		size_t quantizedBytes = quantizedMesh.getSizeInBytes();
+		quantizedMesh.render();
+		trackAllocation(quantizedMesh.getSizeInBytes() - quantizedBytes);
+		return;
+	}
 	glEnableClientState(GL_VERTEX_ARRAY);						// Enable vertex arrays
 	glEnableClientState(GL_NORMAL_ARRAY);						// Enable normal arrays
-	glVertexPointer(3, GL_FLOAT, 0, Faces_Triangles);			// Vertex Pointer to triangle array
-	glNormalPointer(GL_FLOAT, 0, normals);						// Normal pointer to normal array
-	glDrawArrays(GL_TRIANGLES, 0, TotalConnectedTriangles);		// Draw the triangles
+	if (indexedMesh.indexCount > 0)								// Prefer the indexed mesh, it reuses transformed vertices
+	{
+		glVertexPointer(3, GL_FLOAT, 0, indexedMesh.positions);	// Vertex Pointer to unique vertices
+		glNormalPointer(GL_FLOAT, 0, indexedMesh.normals);		// Normal pointer to unique normals
+		glDrawElements(GL_TRIANGLES, indexedMesh.indexCount,	// Draw the triangles
+			indexedMesh.uses16BitIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, indexedMesh.indices);
+	}
+	else
+	{
+		glVertexPointer(3, GL_FLOAT, 0, Faces_Triangles);			// Vertex Pointer to triangle array
+		glNormalPointer(GL_FLOAT, 0, normals);						// Normal pointer to normal array
+		glDrawArrays(GL_TRIANGLES, 0, TotalConnectedTriangles / POINTS_PER_VERTEX);	// Draw the triangles (three vertices each)
+	}
 	glDisableClientState(GL_VERTEX_ARRAY);						// Disable vertex arrays
 	glDisableClientState(GL_NORMAL_ARRAY);						// Disable normal arrays
 }
\ No newline at end of file
@@ -12,13 +12,29 @@
 #include <fstream>
 #include <stdio.h>
 #include <string.h>
-#include <GL/GL.h>
+#ifdef WIN32
+	#include <windows.h>
+	#include <GL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <cmath>
 
+#include "IndexedMesh.h"
+#include "MeshCache.h"
+#include "MeshNormals.h"
+#include "MeshLodChain.h"
+#include "QuantizedMesh.h"
+#include "MeshletSet.h"
+#include "TriangleBvh.h"
+#include "LoadProgress.h"
+#include "BatchTransform.h"
+#include "Profiler.h"
+
 #define KEY_ESCAPE 27
 
 #define POINTS_PER_VERTEX 3
@@ -34,16 +50,70 @@ class Obj_Loader
 		~Obj_Loader();
 
 		// Model Loader functions
-		float* calculateNormal(float* coord1, float* coord2, float* coord3);
+		void calculateNormal(const float* coord1, const float* coord2, const float* coord3, float* norm);	// Single face, zero normal if degenerate
 		int load(char *filename);	// Loads the model
+		int loadMapped(char *filename);	// Loads the model from a memory mapped file, returns -1 if it can't be opened
+		int loadParallel(char *filename, unsigned int threadCount = 0);	// Same as loadMapped, parsed on threadCount threads (0 = shared pool), LOAD_RESULT_CANCELLED if cancelled
+		int loadCached(char *filename, applicationFramework::NormalMode normalMode = applicationFramework::NORMALS_FLAT);	// Maps "<filename>.cache" into indexedMesh, parsing and writing it first if it is missing or stale
+		bool buildIndexedMesh(applicationFramework::NormalMode normalMode = applicationFramework::NORMALS_FLAT);	// Welds the loaded triangles into indexedMesh, smooth modes weld on position and generate vertex normals
+		bool optimizeIndexedMesh();	// Reorders indexedMesh for vertex cache reuse, then vertex fetch order
+		bool buildMeshlets(int maxVertices = applicationFramework::MESHLET_MAX_VERTICES, int maxTriangles = applicationFramework::MESHLET_MAX_TRIANGLES);	// Splits indexedMesh into meshletSet, before quantizing it
+		bool buildBvh();				// Builds bvh over indexedMesh's triangles on the shared pool, for picking and ray queries
+		bool quantizeIndexedMesh(applicationFramework::NormalPrecision normalPrecision = applicationFramework::NORMAL_OCT16);	// Moves indexedMesh into quantizedMesh (3x smaller vertices) and frees it, build the LODs first
+		void releaseTriangles();		// Frees vertexBuffer, Faces_Triangles and normals once indexedMesh is built
+		bool buildLods(const float *ratios, int ratioCount);	// Simplifies indexedMesh into lodChain, ratios of the full triangle count (flat normals make every edge a kept seam, build with a smooth mode)
 		void render();					// Draws the model on the screen
+		void renderLod(int lod);		// Draws one level of lodChain, or the model if there is no such level
+		long renderMeshlets(const applicationFramework::Frustum &frustum, const applicationFramework::Vector<float> &eye);	// Draws the meshlets the camera may see (model space), returns how many, or the model if there are none
 		void release();				// Release the model
 
+		// Progress and cancellation, followed from other threads while a load runs
+		void setLoadProgress(applicationFramework::LoadProgress *progress);	// NULL stops reporting, loadParallel and loadCached report into it
+
+		bool getBounds(float *boundsMin, float *boundsMax) const;	// Box around whichever vertices are resident, false if there are none
+
+		// Batch transforms of whichever vertices are resident (the indexed mesh, else the triangles' corners), on the shared pool
+		long getPositionCount() const;	// Vertices the transforms write, 0 if none or only the quantized mesh is resident
+		long transformPositions(const applicationFramework::Mat4 &matrix, float *output, applicationFramework::TransformMode mode = applicationFramework::TRANSFORM_POINTS_3X4) const;	// 3 floats per vertex (4 for TRANSFORM_POINTS_4X4), returns the vertex count
+		long transformPositions(const applicationFramework::Mat4 &matrix, const applicationFramework::SoaSpan &output, applicationFramework::TransformMode mode = applicationFramework::TRANSFORM_POINTS_3X4) const;	// Same, into a structure of arrays
+		long transformNormals(const applicationFramework::Mat4 &matrix, float *output) const;	// The normals as vectors, pass the inverse transpose for non-uniform scales (the results are not renormalized)
+
+		// Memory accounting, used to budget many resident models
+		size_t getResidentBytes() const;	// Bytes currently held by the model buffers
+		size_t getPeakBytes() const;		// Most bytes held at once, including load scratch
+
 		float* normals;							// Stores the normals
 		float* Faces_Triangles;					// Stores the triangles
 		float* vertexBuffer;					// Stores the points which make the object
 		long TotalConnectedPoints;				// Stores the total number of connected vertices
 		long TotalConnectedTriangles;			// Stores the total number of connected triangles
+		applicationFramework::IndexedMesh indexedMesh;	// Unique vertices and indices, drawn instead of the triangles when built
+		applicationFramework::MeshLodChain lodChain;	// Simplified index buffers over indexedMesh's vertices
+		applicationFramework::QuantizedMesh quantizedMesh;	// Compact copy of indexedMesh, drawn instead of it when built
+		applicationFramework::MeshletSet meshletSet;	// Clusters of indexedMesh's triangles with culling bounds
+		applicationFramework::TriangleBvh bvh;			// Ray queries over indexedMesh's triangles, numbered as in its index buffer
+
+	private:
+		void allocateBuffers(long vertexCount, long faceCount);	// Allocate exactly sized model buffers
+		void trackAllocation(size_t bytes);	// Record memory taken by the model
+		void trackRelease(size_t bytes);	// Record memory given back by the model
+		void addTriangle(const int vertexNumber[3]);	// Append a face and its normals
+		void writeTriangle(const int vertexNumber[3], float *triangle);	// Fill one face
+		void calculateNormals();				// Fill normals for every face in Faces_Triangles
+		void drawIndices(const std::vector<unsigned int> &indices);	// Draw 32-bit indices over the quantized or indexed vertices
+		void reportProgress(float fraction);	// Forward progress to loadProgress, if set
+		bool isLoadCancelled() const;			// Check if loadProgress asks the load to stop
+		const float* getResidentPositions(long &vertexCount) const;	// The positions getBounds() and the transforms read, NULL if there are none
+		const float* getResidentNormals(long &vertexCount) const;	// The normals matching getResidentPositions()
+
+		applicationFramework::MeshCache meshCache;	// Mapped cache file backing indexedMesh after loadCached
+		applicationFramework::LoadProgress *loadProgress;	// Where loads report to, may be NULL
+		std::vector<unsigned int> visibleMeshlets;	// Reused by renderMeshlets() every frame
+		std::vector<unsigned int> visibleIndices;
+
+		size_t bufferBytes;						// Bytes allocateBuffers() took for vertexBuffer, Faces_Triangles and normals
+		size_t residentBytes;					// Bytes currently held by the model
+		size_t peakBytes;						// Most bytes held at once
 
 };
 
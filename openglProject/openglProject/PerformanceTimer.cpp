@@ -3,97 +3,218 @@
 // application timer.
 
 // Include headers
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
 #include "PerformanceTimer.h"
+#include "CpuFeatures.h"
+
+#if defined(FRAMEWORK_X86)
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#endif
+
+// The raw clock is not slewed by NTP, older systems only have the slewed one
+#if !defined(WIN32) && !defined(CLOCK_MONOTONIC_RAW)
+	#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
 
 namespace applicationFramework {
 
-// Class constructor
-PerformanceTimer::PerformanceTimer() 
-{
+	// How long the TSC is counted against the OS clock, and how many reads bracket each end
+	static const int TSC_CALIBRATION_MILLISECONDS = 20;
+	static const int TSC_CALIBRATION_READS = 8;
+
+	static std::atomic<int> timerSource(TIMER_SOURCE_OS);
 
-#ifdef WIN32	
-		QueryPerformanceFrequency(&_freq);	// Retrieves the frequency of the high-resolution performance counter
-		_start.QuadPart = 0;
-		_end.QuadPart = 0;
+	// The TSC maps to nanoseconds as tscBaseNanoseconds + (ticks - tscBaseTicks) * tscNanosecondsPerTick
+	static std::once_flag tscCalibrated;
+	static double tscNanosecondsPerTick = 0.0;
+	static unsigned long long tscBaseTicks = 0;
+	static long long tscBaseNanoseconds = 0;
+
+	// Read the OS clock in nanoseconds
+	static long long readOsClock()
+	{
+#ifdef WIN32
+		static const long long frequency = []() {
+			LARGE_INTEGER value;
+			QueryPerformanceFrequency(&value);	// Retrieves the frequency of the high-resolution performance counter
+			return (long long)value.QuadPart;
+		}();
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);		// Retrieves the current value of the high-resolution performance counter
+		return counter.QuadPart / frequency * 1000000000LL + counter.QuadPart % frequency * 1000000000LL / frequency;
 #else
-		_start.tv_sec = 0;
-		_start.tv_usec = 0;
-		_end.tv_sec = 0;
-		_end.tv_usec = 0;
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+		return (long long)time.tv_sec * 1000000000LL + time.tv_nsec;
+#endif
+	}
 
+	// Read the time stamp counter
+	static unsigned long long readTsc()
+	{
+#if defined(FRAMEWORK_X86)
+		return __rdtsc();
+#else
+		return 0;
 #endif
+	}
 
+	// Read the TSC between two OS clock reads, keeping the tightest of a few tries
+	// so a preemption between the reads does not skew the pair
+	static void readClockPair(unsigned long long &ticks, long long &nanoseconds)
+	{
+		long long bestSpan = -1;
+		for (int read = 0; read < TSC_CALIBRATION_READS; read++) {
+			long long before = readOsClock();
+			unsigned long long tsc = readTsc();
+			long long after = readOsClock();
+			if (bestSpan < 0 || after - before < bestSpan) {
+				bestSpan = after - before;
+				ticks = tsc;
+				nanoseconds = before + (after - before) / 2;
+			}
+		}
+	}
+
+	// Count the TSC against the OS clock for a short sleep
+	static void calibrateTsc()
+	{
+		unsigned long long startTicks, endTicks;
+		long long startNanoseconds, endNanoseconds;
+		readClockPair(startTicks, startNanoseconds);
+		std::this_thread::sleep_for(std::chrono::milliseconds(TSC_CALIBRATION_MILLISECONDS));
+		readClockPair(endTicks, endNanoseconds);
+
+		if (endTicks > startTicks && endNanoseconds > startNanoseconds) {
+			tscNanosecondsPerTick = (double)(endNanoseconds - startNanoseconds) / (double)(endTicks - startTicks);
+			tscBaseTicks = endTicks;
+			tscBaseNanoseconds = endNanoseconds;
+		}
+	}
+
+	// Read the TSC in nanoseconds on the OS clock's epoch
+	static long long readTscClock()
+	{
+		return tscBaseNanoseconds + (long long)((double)(long long)(readTsc() - tscBaseTicks) * tscNanosecondsPerTick);
+	}
+
+	// Builds asking for the TSC select it before main()
+	static const bool isTscAtStartup = FRAMEWORK_TIMER_TSC != 0 && PerformanceTimer::setSource(TIMER_SOURCE_TSC);
+
+// Class constructor
+PerformanceTimer::PerformanceTimer()
+{
+		_start = 0;
+		_end = 0;
 		_isStopped = true;
 	}
 
 // Class destructor
-PerformanceTimer::~PerformanceTimer() 
+PerformanceTimer::~PerformanceTimer()
 {
 }
 
 // Start the timer
-void PerformanceTimer::start() 
+void PerformanceTimer::start()
 {
-#ifdef WIN32
-		QueryPerformanceCounter(&_start);	// Retrieves the current value of the high-resolution performance counter
-#else
-		gettimeofday(&_start, NULL);		// Get the starting time
-#endif
+		_start = getTimestamp();	// Get the starting time
 		_isStopped = false;
 	}
 
 // Stop the timer
-void PerformanceTimer::stop() 
+void PerformanceTimer::stop()
 {
-#ifdef WIN32
-		QueryPerformanceCounter(&_end);
-#else
-		gettimeofday(&_end, NULL);
-#endif
-
+		_end = getTimestamp();
 		_isStopped = true;
 	}
 
 // Check is timer is stopped
-bool PerformanceTimer::isStopped() const 
+bool PerformanceTimer::isStopped() const
 {
 		return _isStopped;
 }
 
-// return elapsed microseconds
-double PerformanceTimer::getElapsedMicroseconds()
+// Return elapsed nanoseconds
+long long PerformanceTimer::getElapsedNanoseconds()
 {
-		double microSecond = 0;
-
 		if (!_isStopped) {
-#ifdef WIN32
-			QueryPerformanceCounter(&_end);
-#else
-			gettimeofday(&_end, NULL);
-#endif
+			_end = getTimestamp();
 		}
 
-#ifdef WIN32
-		if (_start.QuadPart != 0 && _end.QuadPart != 0) {
-			microSecond = (_end.QuadPart - _start.QuadPart) * (1000000.0 / _freq.QuadPart);
-		}
-#else 
-		microSecond = (_end.tv_sec * 1000000.0 + _end.tv_usec) - (_start.tv_sec * 1000000.0 + _start.tv_usec);
-#endif
+		return _start != 0 ? _end - _start : 0;
+}
 
-		return microSecond;
-	}
+// return elapsed microseconds
+double PerformanceTimer::getElapsedMicroseconds()
+{
+		return getElapsedNanoseconds() / 1000.0;
+}
 
 // Return elapsed milliseconds
 double PerformanceTimer::getElapsedMilliseconds()
 {
-		return getElapsedMicroseconds() / 1000.0;
+		return getElapsedNanoseconds() / 1000000.0;
 }
 
 // Return elapsed seconds
-double PerformanceTimer::getElapsedSeconds() 
+double PerformanceTimer::getElapsedSeconds()
+{
+		return getElapsedNanoseconds() / 1000000000.0;
+}
+
+// Read the selected clock
+long long PerformanceTimer::getTimestamp()
+{
+		return timerSource.load(std::memory_order_relaxed) == TIMER_SOURCE_TSC ? readTscClock() : readOsClock();
+}
+
+// Select the clock
+bool PerformanceTimer::setSource(TimerSource source)
+{
+		if (source == TIMER_SOURCE_TSC) {
+			if (!CpuFeatures::hasInvariantTsc()) {
+				return false;
+			}
+			std::call_once(tscCalibrated, calibrateTsc);
+			if (tscNanosecondsPerTick <= 0.0) {
+				return false;
+			}
+		}
+		timerSource.store(source);
+		return true;
+}
+
+// Return the selected clock
+TimerSource PerformanceTimer::getSource()
+{
+		return (TimerSource)timerSource.load();
+}
+
+// Return the name of a clock
+const char* PerformanceTimer::getSourceName(TimerSource source)
+{
+		if (source == TIMER_SOURCE_TSC) {
+			return "tsc";
+		}
+#ifdef WIN32
+		return "qpc";
+#else
+		return "clock_monotonic_raw";
+#endif
+}
+
+// Return the TSC rate
+double PerformanceTimer::getTscFrequency()
 {
-		return getElapsedMicroseconds() / 1000000.0;
+		return tscNanosecondsPerTick > 0.0 ? 1e9 / tscNanosecondsPerTick : 0.0;
 }
 
 }
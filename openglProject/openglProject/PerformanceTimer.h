@@ -7,15 +7,33 @@
 #ifndef PERFORMANCE_TIMER_H
 #define PERFORMANCE_TIMER_H
 
-#ifdef WIN32			
-#include <windows.h>	// Windows 
-#else						
+#ifdef WIN32
+#include <windows.h>	// Windows
+#else
 #include <time.h>	// Mac/Unix
-#include <Winsock2.h>
+#endif
+
+// Builds that define FRAMEWORK_TIMER_TSC to 1 time with the TSC from startup
+// (when the CPU has an invariant one), otherwise it is opt-in through setSource()
+#ifndef FRAMEWORK_TIMER_TSC
+	#define FRAMEWORK_TIMER_TSC 0
 #endif
 
 namespace applicationFramework {
 
+	// Clocks the timers can read
+	enum TimerSource
+	{
+		TIMER_SOURCE_OS = 0,		// QueryPerformanceCounter on Windows, CLOCK_MONOTONIC_RAW elsewhere
+		TIMER_SOURCE_TSC = 1		// The CPU time stamp counter, calibrated against the OS clock
+	};
+
+	/* Times intervals on a monotonic clock with nanosecond resolution. Every timer
+	* reads the same clock, chosen for the whole program with setSource(). The TSC
+	* is read without a system call, it is calibrated against the OS clock the first
+	* time it is selected and shares its epoch, so timestamps taken on either clock
+	* can be compared.
+	*/
 	class PerformanceTimer
 	{
 	public:
@@ -39,20 +57,31 @@ namespace applicationFramework {
 		double getElapsedMilliseconds();
 		double getElapsedSeconds();
 
+		/** The elapsed time in whole nanoseconds, 0 if the timer was never started */
+		long long getElapsedNanoseconds();
+
+		/** Nanoseconds on the selected clock, from an arbitrary fixed origin */
+		static long long getTimestamp();
+
+		/** Selects the clock every timer reads. Selecting the TSC calibrates it
+		the first time, which takes about 20 ms.
+		@return false if the clock is not usable here (no invariant TSC), the clock is left as it was
+		*/
+		static bool setSource(TimerSource source);
+		static TimerSource getSource();
+
+		/** A readable name for a clock, e.g. "tsc" */
+		static const char* getSourceName(TimerSource source);
+
+		/** The calibrated TSC rate in ticks per second, 0 before it is calibrated */
+		static double getTscFrequency();
+
 	private:
 		bool _isStopped;
-
-#ifdef WIN32
-		LARGE_INTEGER _start;
-		LARGE_INTEGER _end;
-		LARGE_INTEGER _freq;
-#else
-		timeval _start;
-		timeval _end;
-#endif
+		long long _start;				// getTimestamp() at start(), 0 before the first start()
+		long long _end;
 
 	};
 }	// namespace
 
 #endif
-
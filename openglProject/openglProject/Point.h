@@ -8,6 +8,7 @@
 #include <string>
 #include <math.h>
 #include <stdio.h>
+#include <ostream>
 
 namespace applicationFramework {
 
@@ -0,0 +1,235 @@
+// Profiler.cpp is the file that holds
+// the implementation for the per-thread
+// zone buffers and the trace export.
+
+// Include headers
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "Profiler.h"
+#include "PerformanceTimer.h"
+
+namespace applicationFramework {
+
+#if FRAMEWORK_PROFILER
+	// One recorded zone, its fields are atomic so an export can read a ring
+	// while its thread writes it (relaxed stores are plain stores on x86)
+	struct ProfileEvent
+	{
+		std::atomic<const char*> name;
+		std::atomic<long long> start;
+		std::atomic<long long> end;
+	};
+
+	// The ring of one thread. Only that thread writes events and writeCount, it
+	// publishes an event by storing writeCount with release after filling it.
+	// clear() moves clearCount instead, the export skips the events before it.
+	struct ProfileThreadBuffer
+	{
+		ProfileEvent events[PROFILER_EVENTS_PER_THREAD];
+		std::atomic<unsigned long long> writeCount;
+		std::atomic<unsigned long long> clearCount;		// Written by clear() only
+		unsigned int threadId;
+		std::string threadName;			// Guarded by registryMutex
+	};
+
+	std::atomic<bool> Profiler::capturing(false);
+
+	// Every thread's ring, kept until the program ends so a trace can include threads that exited
+	static std::mutex registryMutex;
+	static std::vector<ProfileThreadBuffer*> registry;
+	static thread_local ProfileThreadBuffer *threadBuffer = NULL;
+	static thread_local const char *threadName = NULL;		// Given before the ring exists
+
+	// The calling thread's ring, created and registered the first time
+	static ProfileThreadBuffer* getThreadBuffer()
+	{
+		if (threadBuffer == NULL) {
+			ProfileThreadBuffer *buffer = new ProfileThreadBuffer();
+			buffer->writeCount.store(0);
+			buffer->clearCount.store(0);
+			std::lock_guard<std::mutex> lock(registryMutex);
+			buffer->threadId = (unsigned int)registry.size() + 1;
+			buffer->threadName = threadName != NULL ? threadName : "";
+			registry.push_back(buffer);
+			threadBuffer = buffer;
+		}
+		return threadBuffer;
+	}
+
+	// Start recording
+	void Profiler::startCapture()
+	{
+		capturing.store(true);
+	}
+
+	// Stop recording
+	void Profiler::stopCapture()
+	{
+		capturing.store(false);
+	}
+
+	// Drop the recorded zones, the owning threads keep counting where they were
+	void Profiler::clear()
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (size_t i = 0; i < registry.size(); i++) {
+			registry[i]->clearCount.store(registry[i]->writeCount.load(std::memory_order_acquire));
+		}
+	}
+
+	// Name the calling thread, its ring is only created once it records a zone
+	void Profiler::setThreadName(const char *name)
+	{
+		threadName = name;
+		if (threadBuffer != NULL) {
+			std::lock_guard<std::mutex> lock(registryMutex);
+			threadBuffer->threadName = name;
+		}
+	}
+
+	// Read the clock
+	long long Profiler::getTimestamp()
+	{
+		return PerformanceTimer::getTimestamp();
+	}
+
+	// Append a zone to the calling thread's ring
+	void Profiler::record(const char *name, long long start, long long end)
+	{
+		ProfileThreadBuffer *buffer = getThreadBuffer();
+		unsigned long long count = buffer->writeCount.load(std::memory_order_relaxed);
+		ProfileEvent &event = buffer->events[count % PROFILER_EVENTS_PER_THREAD];
+		event.name.store(name, std::memory_order_relaxed);
+		event.start.store(start, std::memory_order_relaxed);
+		event.end.store(end, std::memory_order_relaxed);
+		buffer->writeCount.store(count + 1, std::memory_order_release);
+	}
+
+	// Write a string with the characters JSON needs escaped
+	static void writeJsonString(FILE *file, const char *text)
+	{
+		fputc('"', file);
+		for (; *text != '\0'; text++) {
+			if (*text == '"' || *text == '\\') {
+				fputc('\\', file);
+			}
+			if ((unsigned char)*text >= 0x20) {
+				fputc(*text, file);
+			}
+		}
+		fputc('"', file);
+	}
+
+	// Write every ring as complete ("X") events, times in microseconds from the first zone
+	bool Profiler::exportChromeTrace(const char *filename)
+	{
+		struct ExportedEvent
+		{
+			const char *name;
+			long long start;
+			long long end;
+			unsigned int threadId;
+		};
+
+		std::vector<ExportedEvent> events;
+		std::vector<std::pair<unsigned int, std::string> > threadNames;
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			for (size_t i = 0; i < registry.size(); i++) {
+				ProfileThreadBuffer &buffer = *registry[i];
+				threadNames.push_back(std::make_pair(buffer.threadId, buffer.threadName));
+
+				unsigned long long last = buffer.writeCount.load(std::memory_order_acquire);
+				unsigned long long first = last > PROFILER_EVENTS_PER_THREAD ? last - PROFILER_EVENTS_PER_THREAD : 0;
+				unsigned long long cleared = buffer.clearCount.load();
+				first = cleared > first ? cleared : first;
+				size_t firstExported = events.size();
+				for (unsigned long long count = first; count < last; count++) {
+					const ProfileEvent &event = buffer.events[count % PROFILER_EVENTS_PER_THREAD];
+					ExportedEvent exported = { event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed),
+						event.end.load(std::memory_order_relaxed), buffer.threadId };
+					events.push_back(exported);
+				}
+
+				// Drop the events the thread overwrote (or is overwriting) while they were copied
+				unsigned long long written = buffer.writeCount.load(std::memory_order_acquire) + 1;
+				unsigned long long valid = written > PROFILER_EVENTS_PER_THREAD ? written - PROFILER_EVENTS_PER_THREAD : 0;
+				if (valid > first) {
+					size_t overwritten = (size_t)(valid - first) < events.size() - firstExported ? (size_t)(valid - first) : events.size() - firstExported;
+					events.erase(events.begin() + firstExported, events.begin() + firstExported + overwritten);
+				}
+			}
+		}
+
+		FILE *file = fopen(filename, "w");
+		if (file == NULL) {
+			return false;
+		}
+		long long origin = 0;
+		for (size_t i = 0; i < events.size(); i++) {
+			origin = i == 0 || events[i].start < origin ? events[i].start : origin;
+		}
+
+		fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+		for (size_t i = 0; i < threadNames.size(); i++) {
+			fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ", threadNames[i].first);
+			if (threadNames[i].second.empty()) {
+				fprintf(file, "\"Thread %u\"", threadNames[i].first);
+			}
+			else {
+				writeJsonString(file, threadNames[i].second.c_str());
+			}
+			fprintf(file, "}},\n");
+		}
+		for (size_t i = 0; i < events.size(); i++) {
+			fprintf(file, "{\"name\": ");
+			writeJsonString(file, events[i].name);
+			fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f},\n", events[i].threadId,
+				(events[i].start - origin) / 1000.0, (events[i].end - events[i].start) / 1000.0);
+		}
+		fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"openglProject\"}}\n]}\n");
+		return fclose(file) == 0;
+	}
+#else
+	// Profiling is compiled out, nothing is recorded
+
+	void Profiler::startCapture()
+	{
+	}
+
+	void Profiler::stopCapture()
+	{
+	}
+
+	void Profiler::clear()
+	{
+	}
+
+	void Profiler::setThreadName(const char *name)
+	{
+		(void)name;
+	}
+
+	bool Profiler::exportChromeTrace(const char *filename)
+	{
+		(void)filename;
+		return false;
+	}
+
+	long long Profiler::getTimestamp()
+	{
+		return 0;
+	}
+
+	void Profiler::record(const char *name, long long start, long long end)
+	{
+		(void)name;
+		(void)start;
+		(void)end;
+	}
+#endif
+
+}	// namespace
@@ -0,0 +1,123 @@
+#pragma once
+// Profiler.h is the file that holds the
+// scoped CPU zones recorded per thread
+// and exported as a Chrome trace.
+
+// Header guards
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+// Profiling is compiled in unless the build defines FRAMEWORK_PROFILER to 0,
+// then the zone macros expand to nothing and the Profiler functions do nothing
+#ifndef FRAMEWORK_PROFILER
+	#define FRAMEWORK_PROFILER 1
+#endif
+
+// Include headers
+#if FRAMEWORK_PROFILER
+	#include <atomic>
+#endif
+
+namespace applicationFramework {
+
+	// Zones each thread keeps, the oldest are overwritten once a thread records more
+	static const unsigned int PROFILER_EVENTS_PER_THREAD = 1 << 16;
+
+	/* Records named zones into a ring buffer per thread. Only the recording thread
+	* writes its ring, so recording takes no lock: two clock reads and three stores.
+	* Zones nest by time, a trace viewer (chrome://tracing or ui.perfetto.dev) shows
+	* the zones inside each other. Zones are only recorded between startCapture()
+	* and stopCapture(), otherwise a zone costs one atomic load.
+	*/
+	class Profiler
+	{
+	public:
+		/** Starts recording zones */
+		static void startCapture();
+
+		/** Stops recording zones, the recorded ones are kept for export */
+		static void stopCapture();
+
+		/** Checks if zones are being recorded */
+		static bool isCapturing();
+
+		/** Forgets the recorded zones. Zones finishing on other threads while it runs may be kept. */
+		static void clear();
+
+		/** Names the calling thread in the trace, the name must outlive the thread (e.g. a literal) */
+		static void setThreadName(const char *name);
+
+		/** Writes the recorded zones as Chrome trace event JSON. Threads may keep recording
+		while it runs, zones overwritten during the export are left out.
+		@param filename - the file to write
+		@return false if it could not be written or profiling is compiled out
+		*/
+		static bool exportChromeTrace(const char *filename);
+
+		/** Nanoseconds on the clock the zones are timed with */
+		static long long getTimestamp();
+
+		/** Records a finished zone on the calling thread.
+		@param name - a string that lives as long as the program, e.g. a literal
+		@param start, end - getTimestamp() at the start and end of the zone
+		*/
+		static void record(const char *name, long long start, long long end);
+
+#if FRAMEWORK_PROFILER
+	private:
+		static std::atomic<bool> capturing;
+#endif
+	};
+
+#if FRAMEWORK_PROFILER
+	// Times the scope it is declared in, use PROFILE_ZONE instead of declaring it
+	class ProfileZone
+	{
+	public:
+		explicit ProfileZone(const char *name)
+			: name(name), start(Profiler::isCapturing() ? Profiler::getTimestamp() : -1)
+		{
+		}
+
+		~ProfileZone()
+		{
+			if (start >= 0) {
+				Profiler::record(name, start, Profiler::getTimestamp());
+			}
+		}
+
+	private:
+		// A zone belongs to its scope
+		ProfileZone(const ProfileZone &other);
+		ProfileZone& operator=(const ProfileZone &rhs);
+
+		const char *name;
+		long long start;				// -1 when not capturing at the start of the zone
+	};
+
+	inline bool Profiler::isCapturing()
+	{
+		return capturing.load(std::memory_order_relaxed);
+	}
+
+	#define PROFILE_ZONE_NAME_CONCAT(a, b) a##b
+	#define PROFILE_ZONE_NAME(line) PROFILE_ZONE_NAME_CONCAT(profileZone, line)
+
+	/** Times the rest of the enclosing scope under a name (a string literal) */
+	#define PROFILE_ZONE(name) applicationFramework::ProfileZone PROFILE_ZONE_NAME(__LINE__)(name)
+
+	/** Times the rest of the enclosing function under its name */
+	#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#else
+	inline bool Profiler::isCapturing()
+	{
+		return false;
+	}
+
+	#define PROFILE_ZONE(name)
+	#define PROFILE_FUNCTION()
+#endif
+
+}	// namespace
+
+#endif
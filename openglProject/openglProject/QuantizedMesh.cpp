@@ -0,0 +1,431 @@
+// QuantizedMesh.cpp is the file that
+// holds the implementation for the
+// quantized vertex storage.
+
+// Include headers
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "QuantizedMesh.h"
+
+#ifndef WIN32
+	#include <GL/glx.h>
+#endif
+
+namespace applicationFramework {
+
+	// Largest magnitude of an 8-bit normalized component
+	static const int QUANTIZED_BYTE_RANGE = 127;
+
+	// The generic attribute entry points, GL 2.0 and later only
+#ifdef WIN32
+	typedef void (APIENTRY *VertexAttribPointerFunction)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+	typedef void (APIENTRY *VertexAttribArrayFunction)(GLuint);
+#else
+	typedef void (GLAPIENTRY *VertexAttribPointerFunction)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+	typedef void (GLAPIENTRY *VertexAttribArrayFunction)(GLuint);
+#endif
+
+	struct VertexAttribFunctions
+	{
+		VertexAttribPointerFunction vertexAttribPointer;
+		VertexAttribArrayFunction enableVertexAttribArray;
+		VertexAttribArrayFunction disableVertexAttribArray;
+	};
+
+	// Look up a GL entry point that gl.h does not declare
+	static void* getGlFunction(const char *name)
+	{
+#ifdef WIN32
+		return (void*)wglGetProcAddress(name);
+#else
+		return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+	}
+
+	// The generic attribute functions, looked up on first use (needs a current context)
+	static const VertexAttribFunctions& getVertexAttribFunctions()
+	{
+		static VertexAttribFunctions functions = {
+			(VertexAttribPointerFunction)getGlFunction("glVertexAttribPointer"),
+			(VertexAttribArrayFunction)getGlFunction("glEnableVertexAttribArray"),
+			(VertexAttribArrayFunction)getGlFunction("glDisableVertexAttribArray")
+		};
+		return functions;
+	}
+
+	// Sign that treats zero as positive, as the octahedral fold expects
+	static float signNotZero(float value)
+	{
+		return value < 0.0f ? -1.0f : 1.0f;
+	}
+
+	// Unfold an octahedral normal, components -range..range, into a unit vector
+	static void decodeOctahedral(int u, int v, int range, float *normal)
+	{
+		float x = (float)u / range;
+		float y = (float)v / range;
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		if (z < 0.0f) {										// Lower hemisphere, folded over the diagonals
+			float foldedX = (1.0f - fabsf(y)) * signNotZero(x);
+			y = (1.0f - fabsf(x)) * signNotZero(y);
+			x = foldedX;
+		}
+
+		float length = sqrtf(x * x + y * y + z * z);
+		normal[0] = x / length;
+		normal[1] = y / length;
+		normal[2] = z / length;
+	}
+
+	// Project a normal onto the octahedron and keep the closest of the four
+	// surrounding grid points, rounding alone loses up to twice the precision
+	static void encodeOctahedral(const float *normal, int range, int *encoded)
+	{
+		float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+		if (length == 0.0f) {								// Degenerate normal, decodes as +z
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+
+		float u = normal[0] / length;
+		float v = normal[1] / length;
+		if (normal[2] < 0.0f) {
+			float foldedU = (1.0f - fabsf(v)) * signNotZero(u);
+			v = (1.0f - fabsf(u)) * signNotZero(v);
+			u = foldedU;
+		}
+
+		float unitLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		int baseU = (int)floorf(u * range);
+		int baseV = (int)floorf(v * range);
+		float bestDot = -2.0f;
+		for (int corner = 0; corner < 4; corner++) {
+			int candidateU = baseU + (corner & 1);
+			int candidateV = baseV + (corner >> 1);
+			candidateU = candidateU > range ? range : (candidateU < -range ? -range : candidateU);
+			candidateV = candidateV > range ? range : (candidateV < -range ? -range : candidateV);
+
+			float decoded[3];
+			decodeOctahedral(candidateU, candidateV, range, decoded);
+			float dot = (decoded[0] * normal[0] + decoded[1] * normal[1] + decoded[2] * normal[2]) / unitLength;
+			if (dot > bestDot) {
+				bestDot = dot;
+				encoded[0] = candidateU;
+				encoded[1] = candidateV;
+			}
+		}
+	}
+
+	// Class constructor
+	QuantizedMesh::QuantizedMesh()
+	{
+		positions = NULL;
+		normals = NULL;
+		indices = NULL;
+		vertexCount = 0;
+		indexCount = 0;
+		indexSize = sizeof(unsigned int);
+		normalPrecision = NORMAL_OCT16;
+		fixedFunctionNormals = NULL;
+		for (int axis = 0; axis < 3; axis++) {
+			center[axis] = 0.0f;
+			step[axis] = 0.0f;
+		}
+	}
+
+	// Class destructor
+	QuantizedMesh::~QuantizedMesh()
+	{
+		release();
+	}
+
+	// Quantize the vertices of a mesh and copy its indices
+	bool QuantizedMesh::build(const IndexedMesh &mesh, NormalPrecision normalPrecision)
+	{
+		release();
+		this->normalPrecision = normalPrecision;
+		if (mesh.vertexCount == 0) {
+			return true;
+		}
+
+		positions = (short*)malloc(mesh.vertexCount * 3 * sizeof(short));
+		normals = malloc(mesh.vertexCount * 2 * normalPrecision);
+		indices = malloc(mesh.indexCount * mesh.indexSize);
+		if (positions == NULL || normals == NULL || (indices == NULL && mesh.indexCount > 0)) {
+			release();
+			return false;
+		}
+		vertexCount = mesh.vertexCount;
+		indexCount = mesh.indexCount;
+		indexSize = mesh.indexSize;
+		memcpy(indices, mesh.indices, indexCount * indexSize);
+
+		// Bounding box, quantized around its middle so the range is symmetric
+		float minimum[3] = { mesh.positions[0], mesh.positions[1], mesh.positions[2] };
+		float maximum[3] = { mesh.positions[0], mesh.positions[1], mesh.positions[2] };
+		for (long vertex = 1; vertex < vertexCount; vertex++) {
+			for (int axis = 0; axis < 3; axis++) {
+				float value = mesh.positions[vertex * 3 + axis];
+				minimum[axis] = value < minimum[axis] ? value : minimum[axis];
+				maximum[axis] = value > maximum[axis] ? value : maximum[axis];
+			}
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+			step[axis] = (maximum[axis] - minimum[axis]) * 0.5f / QUANTIZED_POSITION_RANGE;	// 0 for a flat axis, every vertex sits on the center
+		}
+
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			for (int axis = 0; axis < 3; axis++) {
+				float offset = mesh.positions[vertex * 3 + axis] - center[axis];
+				long quantized = step[axis] > 0.0f ? lroundf(offset / step[axis]) : 0;
+				quantized = quantized > QUANTIZED_POSITION_RANGE ? QUANTIZED_POSITION_RANGE : quantized;
+				quantized = quantized < -QUANTIZED_POSITION_RANGE ? -QUANTIZED_POSITION_RANGE : quantized;
+				positions[vertex * 3 + axis] = (short)quantized;
+			}
+
+			int encoded[2];
+			if (normalPrecision == NORMAL_OCT8) {
+				encodeOctahedral(&mesh.normals[vertex * 3], QUANTIZED_BYTE_RANGE, encoded);
+				((signed char*)normals)[vertex * 2] = (signed char)encoded[0];
+				((signed char*)normals)[vertex * 2 + 1] = (signed char)encoded[1];
+			}
+			else {
+				encodeOctahedral(&mesh.normals[vertex * 3], QUANTIZED_POSITION_RANGE, encoded);
+				((short*)normals)[vertex * 2] = (short)encoded[0];
+				((short*)normals)[vertex * 2 + 1] = (short)encoded[1];
+			}
+		}
+		return true;
+	}
+
+	// Free the mesh buffers
+	void QuantizedMesh::release()
+	{
+		free(positions);
+		free(normals);
+		free(indices);
+		free(fixedFunctionNormals);
+
+		positions = NULL;
+		normals = NULL;
+		indices = NULL;
+		fixedFunctionNormals = NULL;
+		vertexCount = 0;
+		indexCount = 0;
+		indexSize = sizeof(unsigned int);
+	}
+
+	// Decode one position
+	void QuantizedMesh::decodePosition(long vertex, float *position) const
+	{
+		for (int axis = 0; axis < 3; axis++) {
+			position[axis] = center[axis] + positions[vertex * 3 + axis] * step[axis];
+		}
+	}
+
+	// Decode one normal
+	void QuantizedMesh::decodeNormal(long vertex, float *normal) const
+	{
+		if (normalPrecision == NORMAL_OCT8) {
+			const signed char *encoded = &((const signed char*)normals)[vertex * 2];
+			decodeOctahedral(encoded[0], encoded[1], QUANTIZED_BYTE_RANGE, normal);
+		}
+		else {
+			const short *encoded = &((const short*)normals)[vertex * 2];
+			decodeOctahedral(encoded[0], encoded[1], QUANTIZED_POSITION_RANGE, normal);
+		}
+	}
+
+	// Decode the whole mesh back into floats
+	bool QuantizedMesh::decode(IndexedMesh &mesh) const
+	{
+		mesh.release();
+		if (vertexCount == 0) {
+			return true;
+		}
+
+		mesh.positions = (float*)malloc(vertexCount * 3 * sizeof(float));
+		mesh.normals = (float*)malloc(vertexCount * 3 * sizeof(float));
+		mesh.indices = malloc(indexCount * indexSize);
+		if (mesh.positions == NULL || mesh.normals == NULL || (mesh.indices == NULL && indexCount > 0)) {
+			mesh.release();
+			return false;
+		}
+
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			decodePosition(vertex, &mesh.positions[vertex * 3]);
+			decodeNormal(vertex, &mesh.normals[vertex * 3]);
+		}
+		memcpy(mesh.indices, indices, indexCount * indexSize);
+		mesh.vertexCount = vertexCount;
+		mesh.indexCount = indexCount;
+		mesh.indexSize = indexSize;
+		return true;
+	}
+
+	// Compare every decoded vertex with the original
+	QuantizationError QuantizedMesh::measureError(const IndexedMesh &mesh) const
+	{
+		QuantizationError error;
+		error.maxPositionError = 0.0f;
+		error.maxNormalDegrees = 0.0f;
+
+		// Rounding to the grid is off by half a step at most, the float decode adds an ulp of the coordinates
+		float boundSquared = 0.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			float axisBound = step[axis] * 0.5f + FLT_EPSILON * (fabsf(center[axis]) + step[axis] * QUANTIZED_POSITION_RANGE);
+			boundSquared += axisBound * axisBound;
+		}
+		error.positionErrorBound = sqrtf(boundSquared);
+
+		double minimumDot = 1.0;
+		for (long vertex = 0; vertex < vertexCount && vertex < mesh.vertexCount; vertex++) {
+			float position[3];
+			decodePosition(vertex, position);
+			float dx = position[0] - mesh.positions[vertex * 3];
+			float dy = position[1] - mesh.positions[vertex * 3 + 1];
+			float dz = position[2] - mesh.positions[vertex * 3 + 2];
+			float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+			error.maxPositionError = distance > error.maxPositionError ? distance : error.maxPositionError;
+
+			const float *original = &mesh.normals[vertex * 3];
+			double length = sqrt((double)original[0] * original[0] + (double)original[1] * original[1] + (double)original[2] * original[2]);
+			if (length == 0.0) {
+				continue;										// Degenerate normals have no direction to keep
+			}
+			float normal[3];
+			decodeNormal(vertex, normal);
+			double dot = (normal[0] * original[0] + normal[1] * original[1] + normal[2] * original[2]) / length;
+			minimumDot = dot < minimumDot ? dot : minimumDot;
+		}
+		minimumDot = minimumDot < -1.0 ? -1.0 : minimumDot;
+		error.maxNormalDegrees = (float)(acos(minimumDot) * 180.0 / 3.14159265358979);
+		return error;
+	}
+
+	// Return the quantization box
+	void QuantizedMesh::getBounds(float *boundsMin, float *boundsMax) const
+	{
+		for (int axis = 0; axis < 3; axis++) {
+			boundsMin[axis] = center[axis] - step[axis] * QUANTIZED_POSITION_RANGE;
+			boundsMax[axis] = center[axis] + step[axis] * QUANTIZED_POSITION_RANGE;
+		}
+	}
+
+	// Return the normalized position to model space transform
+	void QuantizedMesh::getDequantization(float *scale, float *offset) const
+	{
+		for (int axis = 0; axis < 3; axis++) {
+			scale[axis] = step[axis] * QUANTIZED_POSITION_RANGE;
+			offset[axis] = center[axis];
+		}
+	}
+
+	// Point generic attributes at the quantized buffers. GL 4.2 maps a normalized short c
+	// to c / 32767, which is how it was quantized; older GLs use (2c + 1) / 65535, half a step off.
+	bool QuantizedMesh::bindAttributes(GLuint positionAttribute, GLuint normalAttribute) const
+	{
+		const VertexAttribFunctions &functions = getVertexAttribFunctions();
+		if (functions.vertexAttribPointer == NULL || functions.enableVertexAttribArray == NULL) {
+			return false;
+		}
+
+		functions.enableVertexAttribArray(positionAttribute);
+		functions.enableVertexAttribArray(normalAttribute);
+		functions.vertexAttribPointer(positionAttribute, 3, GL_SHORT, GL_TRUE, 0, positions);
+		functions.vertexAttribPointer(normalAttribute, 2, normalPrecision == NORMAL_OCT8 ? GL_BYTE : GL_SHORT, GL_TRUE, 0, normals);
+		return true;
+	}
+
+	// Stop reading the quantized buffers
+	void QuantizedMesh::unbindAttributes(GLuint positionAttribute, GLuint normalAttribute) const
+	{
+		const VertexAttribFunctions &functions = getVertexAttribFunctions();
+		if (functions.disableVertexAttribArray != NULL) {
+			functions.disableVertexAttribArray(positionAttribute);
+			functions.disableVertexAttribArray(normalAttribute);
+		}
+	}
+
+	// Expand the normals for glNormalPointer. The modelview scale that dequantizes the
+	// positions also reaches the normals (by its inverse), so they are stored pre-scaled.
+	bool QuantizedMesh::buildFixedFunctionNormals() const
+	{
+		if (fixedFunctionNormals != NULL) {
+			return true;
+		}
+		fixedFunctionNormals = (signed char*)malloc(vertexCount * 3);
+		if (fixedFunctionNormals == NULL) {
+			return false;
+		}
+
+		for (long vertex = 0; vertex < vertexCount; vertex++) {
+			float normal[3];
+			decodeNormal(vertex, normal);
+			float length = 0.0f;
+			for (int axis = 0; axis < 3; axis++) {
+				normal[axis] *= step[axis] > 0.0f ? step[axis] : 1.0f;
+				length += normal[axis] * normal[axis];
+			}
+			length = sqrtf(length);
+			for (int axis = 0; axis < 3; axis++) {
+				fixedFunctionNormals[vertex * 3 + axis] = (signed char)lroundf(normal[axis] / length * QUANTIZED_BYTE_RANGE);
+			}
+		}
+		return true;
+	}
+
+	// Draw through the fixed function pipeline, the modelview matrix dequantizes the positions
+	void QuantizedMesh::render(const void *indices, long indexCount, GLenum indexType) const
+	{
+		if (vertexCount == 0 || !buildFixedFunctionNormals()) {
+			return;
+		}
+		if (indices == NULL) {
+			render();
+			return;
+		}
+
+		glPushAttrib(GL_ENABLE_BIT);
+		glEnable(GL_NORMALIZE);										// Byte normals through a scaled matrix
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glTranslatef(center[0], center[1], center[2]);
+		glScalef(step[0] > 0.0f ? step[0] : 1.0f, step[1] > 0.0f ? step[1] : 1.0f, step[2] > 0.0f ? step[2] : 1.0f);
+
+		glEnableClientState(GL_VERTEX_ARRAY);						// Enable vertex arrays
+		glEnableClientState(GL_NORMAL_ARRAY);						// Enable normal arrays
+		glVertexPointer(3, GL_SHORT, 0, positions);
+		glNormalPointer(GL_BYTE, 0, fixedFunctionNormals);
+		glDrawElements(GL_TRIANGLES, (GLsizei)indexCount, indexType, indices);
+		glDisableClientState(GL_VERTEX_ARRAY);						// Disable vertex arrays
+		glDisableClientState(GL_NORMAL_ARRAY);						// Disable normal arrays
+
+		glPopMatrix();
+		glPopAttrib();
+	}
+
+	// Draw the mesh's own triangles
+	void QuantizedMesh::render() const
+	{
+		if (indices == NULL) {
+			return;
+		}
+		render(indices, indexCount, indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+	}
+
+	// Return the bytes held by the mesh
+	size_t QuantizedMesh::getSizeInBytes() const
+	{
+		size_t bytes = vertexCount * (3 * sizeof(short) + 2 * normalPrecision) + indexCount * indexSize;
+		if (fixedFunctionNormals != NULL) {
+			bytes += vertexCount * 3;
+		}
+		return bytes;
+	}
+
+}	// namespace
@@ -0,0 +1,132 @@
+#pragma once
+// QuantizedMesh.h is the file that holds
+// a compact copy of an indexed mesh, with
+// 16-bit positions and octahedral normals.
+
+// Header guards
+#ifndef QUANTIZED_MESH_H_
+#define QUANTIZED_MESH_H_
+
+// Include headers
+#include <stddef.h>
+#ifdef WIN32
+	#include <windows.h>
+	#include <GL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include "IndexedMesh.h"
+
+namespace applicationFramework {
+
+	// Largest magnitude of a quantized position or normal component
+	static const int QUANTIZED_POSITION_RANGE = 32767;
+
+	// Bytes per octahedral normal component
+	enum NormalPrecision {
+		NORMAL_OCT8 = 1,		// 2 bytes per normal, under a degree of error
+		NORMAL_OCT16 = 2		// 4 bytes per normal, a few hundredths of a degree
+	};
+
+	// The largest errors of a quantized mesh, measured against the mesh it was built from
+	struct QuantizationError
+	{
+		float maxPositionError;			// Largest distance between a position and its decoded value
+		float positionErrorBound;		// Half a quantization step on every axis, maxPositionError never exceeds it
+		float maxNormalDegrees;			// Largest angle between a unit normal and its decoded value
+	};
+
+	/* An indexed mesh stored for residency rather than editing. Positions are
+	* quantized to 3 shorts over the mesh's bounding box, normals are octahedral
+	* encoded into 2 bytes or 2 shorts. A float vertex takes 24 bytes, a quantized
+	* one 8 (NORMAL_OCT8) or 10 (NORMAL_OCT16). The indices are copied as they are.
+	*/
+	class QuantizedMesh
+	{
+	public:
+		// Class constructor/destructor
+		QuantizedMesh();
+		~QuantizedMesh();
+
+		/** Quantizes a mesh, it can be released afterwards.
+		@param mesh - the mesh to quantize, zero normals decode as +z
+		@param normalPrecision - the size of the encoded normals
+		@return false if the buffers could not be allocated
+		*/
+		bool build(const IndexedMesh &mesh, NormalPrecision normalPrecision = NORMAL_OCT16);
+
+		/** Frees the buffers */
+		void release();
+
+		/** Decodes the position of one vertex */
+		void decodePosition(long vertex, float *position) const;
+
+		/** Decodes the normal of one vertex, unit length */
+		void decodeNormal(long vertex, float *normal) const;
+
+		/** Decodes every vertex back into a float indexed mesh.
+		@return false if the buffers could not be allocated
+		*/
+		bool decode(IndexedMesh &mesh) const;
+
+		/** Measures the error of the quantized vertices against the mesh they were built from */
+		QuantizationError measureError(const IndexedMesh &mesh) const;
+
+		/** The bounding box the positions were quantized over */
+		void getBounds(float *boundsMin, float *boundsMax) const;
+
+		/** The transform from the normalized positions (-1 to 1) to model space,
+		position = offset + scale * normalized, for a vertex shader to apply.
+		*/
+		void getDequantization(float *scale, float *offset) const;
+
+		/** Points two generic vertex attributes at the buffers as normalized shorts/bytes,
+		the shader applies getDequantization() and decodes the octahedral normal (2 components).
+		@param positionAttribute - 3 components, -1 to 1
+		@param normalAttribute - 2 components, -1 to 1
+		@return false if the GL does not have generic vertex attributes (before 2.0)
+		*/
+		bool bindAttributes(GLuint positionAttribute, GLuint normalAttribute) const;
+
+		/** Disables the attributes enabled by bindAttributes() */
+		void unbindAttributes(GLuint positionAttribute, GLuint normalAttribute) const;
+
+		/** Draws the mesh through the fixed function pipeline. It can't decode
+		octahedral normals, so the first call expands them to 3 bytes per vertex.
+		@param indices - the indices to draw, NULL for the mesh's own
+		@param indexCount - the number of indices
+		@param indexType - GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		*/
+		void render(const void *indices, long indexCount, GLenum indexType) const;
+
+		/** Draws the mesh's own indices through the fixed function pipeline */
+		void render() const;
+
+		/** The bytes held by the vertex and index buffers (and the fixed function normals once drawn) */
+		size_t getSizeInBytes() const;
+
+		short *positions;				// 3 shorts per vertex, over the bounding box
+		void *normals;					// 2 signed chars or shorts per vertex, octahedral
+		void *indices;					// One unsigned short or unsigned int per corner
+		long vertexCount;				// Number of vertices
+		long indexCount;				// Number of indices (3 per triangle)
+		int indexSize;					// Bytes per index, 2 or 4
+		NormalPrecision normalPrecision;	// Bytes per normal component
+
+	private:
+		// The buffers are owned by the mesh and cannot be copied
+		QuantizedMesh(const QuantizedMesh &other);
+		QuantizedMesh& operator=(const QuantizedMesh &rhs);
+
+		/** Expands the octahedral normals for glNormalPointer, in quantized space */
+		bool buildFixedFunctionNormals() const;
+
+		float center[3];				// Middle of the bounding box
+		float step[3];					// Model units per quantized unit on each axis
+		mutable signed char *fixedFunctionNormals;	// 3 bytes per vertex, built by the first render()
+	};
+
+}	// namespace
+
+#endif
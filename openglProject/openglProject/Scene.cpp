@@ -0,0 +1,286 @@
+// Scene.cpp is the file that holds
+// the implementation for the scene
+// instances and their culling.
+
+// Include headers
+#include <math.h>
+#include <string.h>
+
+#include "Scene.h"
+
+namespace applicationFramework {
+
+	// A frustum plane ready for the box test. The corner of a box furthest along the
+	// plane normal (its "positive vertex") takes the max on axes where the normal is
+	// positive and the min elsewhere, so the plane picks one array per axis up front.
+	struct CullPlane
+	{
+		const float *x;
+		const float *y;
+		const float *z;
+		float a, b, c, d;
+	};
+
+	// Scalar kernel, a box is visible when its positive vertex is inside every plane.
+	// The SIMD kernels do the same operations in the same order, so they agree bit for bit.
+	// Every kernel writes each number and only advances past the visible ones, which
+	// avoids a branch the predictor can't learn, visible must hold count numbers.
+	static long cullScalar(const CullPlane *planes, long first, long count, unsigned int *visible, long visibleCount)
+	{
+		for (long i = first; i < count; i++) {
+			bool isVisible = true;
+			for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+				const CullPlane &p = planes[plane];
+				float distance = ((p.a * p.x[i] + p.b * p.y[i]) + p.c * p.z[i]) + p.d;
+				isVisible = isVisible && distance >= 0.0f;
+			}
+			visible[visibleCount] = (unsigned int)i;
+			visibleCount += isVisible ? 1 : 0;
+		}
+		return visibleCount;
+	}
+
+#if defined(FRAMEWORK_X86)
+	// SSE2 kernel, 4 boxes per block, the rest go to the scalar kernel
+	static long cullSse2(const CullPlane *planes, long count, unsigned int *visible)
+	{
+		const long BLOCK = 4;
+		__m128 a[FRUSTUM_PLANE_COUNT], b[FRUSTUM_PLANE_COUNT], c[FRUSTUM_PLANE_COUNT], d[FRUSTUM_PLANE_COUNT];
+		const float *x[FRUSTUM_PLANE_COUNT], *y[FRUSTUM_PLANE_COUNT], *z[FRUSTUM_PLANE_COUNT];
+		for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+			a[plane] = _mm_set1_ps(planes[plane].a);
+			b[plane] = _mm_set1_ps(planes[plane].b);
+			c[plane] = _mm_set1_ps(planes[plane].c);
+			d[plane] = _mm_set1_ps(planes[plane].d);
+			x[plane] = planes[plane].x;
+			y[plane] = planes[plane].y;
+			z[plane] = planes[plane].z;
+		}
+
+		long visibleCount = 0;
+		long i = 0;
+		for (; i + BLOCK <= count; i += BLOCK) {
+			__m128 isVisible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+				__m128 distance = _mm_add_ps(_mm_mul_ps(a[plane], _mm_loadu_ps(x[plane] + i)),
+					_mm_mul_ps(b[plane], _mm_loadu_ps(y[plane] + i)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(c[plane], _mm_loadu_ps(z[plane] + i)));
+				distance = _mm_add_ps(distance, d[plane]);
+				isVisible = _mm_and_ps(isVisible, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+			}
+
+			int mask = _mm_movemask_ps(isVisible);
+			for (long k = 0; k < BLOCK; k++) {
+				visible[visibleCount] = (unsigned int)(i + k);
+				visibleCount += (mask >> k) & 1;
+			}
+		}
+		return cullScalar(planes, i, count, visible, visibleCount);
+	}
+
+	// AVX2 kernel, 8 boxes per block
+	FRAMEWORK_TARGET_AVX2 static long cullAvx2(const CullPlane *planes, long count, unsigned int *visible)
+	{
+		const long BLOCK = 8;
+		__m256 a[FRUSTUM_PLANE_COUNT], b[FRUSTUM_PLANE_COUNT], c[FRUSTUM_PLANE_COUNT], d[FRUSTUM_PLANE_COUNT];
+		const float *x[FRUSTUM_PLANE_COUNT], *y[FRUSTUM_PLANE_COUNT], *z[FRUSTUM_PLANE_COUNT];
+		for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+			a[plane] = _mm256_set1_ps(planes[plane].a);
+			b[plane] = _mm256_set1_ps(planes[plane].b);
+			c[plane] = _mm256_set1_ps(planes[plane].c);
+			d[plane] = _mm256_set1_ps(planes[plane].d);
+			x[plane] = planes[plane].x;
+			y[plane] = planes[plane].y;
+			z[plane] = planes[plane].z;
+		}
+
+		long visibleCount = 0;
+		long i = 0;
+		for (; i + BLOCK <= count; i += BLOCK) {
+			__m256 isVisible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(a[plane], _mm256_loadu_ps(x[plane] + i)),
+					_mm256_mul_ps(b[plane], _mm256_loadu_ps(y[plane] + i)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(c[plane], _mm256_loadu_ps(z[plane] + i)));
+				distance = _mm256_add_ps(distance, d[plane]);
+				isVisible = _mm256_and_ps(isVisible, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(isVisible);
+			for (long k = 0; k < BLOCK; k++) {
+				visible[visibleCount] = (unsigned int)(i + k);
+				visibleCount += (mask >> k) & 1;
+			}
+		}
+		return cullScalar(planes, i, count, visible, visibleCount);
+	}
+#endif
+
+	// Class constructor
+	Scene::Scene()
+	{
+	}
+
+	// Class destructor
+	Scene::~Scene()
+	{
+	}
+
+	// Add a model with the box around its vertices
+	unsigned int Scene::addInstance(Obj_Loader *model, const float *transform)
+	{
+		float localMin[3] = { 0.0f, 0.0f, 0.0f };
+		float localMax[3] = { 0.0f, 0.0f, 0.0f };
+		if (model != NULL) {
+			model->getBounds(localMin, localMax);
+		}
+		return addInstance(model, localMin, localMax, transform);
+	}
+
+	// Add a model with a known box
+	unsigned int Scene::addInstance(Obj_Loader *model, const float *localMin, const float *localMax, const float *transform)
+	{
+		SceneInstance instance;
+		instance.model = model;
+		memcpy(instance.localMin, localMin, sizeof(instance.localMin));
+		memcpy(instance.localMax, localMax, sizeof(instance.localMax));
+		instances.push_back(instance);
+		for (int axis = 0; axis < 3; axis++) {
+			worldMin[axis].push_back(0.0f);
+			worldMax[axis].push_back(0.0f);
+		}
+
+		unsigned int number = (unsigned int)(instances.size() - 1);
+		setTransform(number, transform);
+		return number;
+	}
+
+	// Move an instance
+	void Scene::setTransform(unsigned int instance, const float *transform)
+	{
+		static const float IDENTITY[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		memcpy(instances[instance].transform, transform != NULL ? transform : IDENTITY, sizeof(IDENTITY));
+		updateWorldBounds(instance);
+	}
+
+	// Transform the box's center, and its half extents by the absolute matrix (Arvo),
+	// which gives the tightest box around the transformed box
+	void Scene::updateWorldBounds(unsigned int instance)
+	{
+		const SceneInstance &current = instances[instance];
+		const float *m = current.transform;
+		float center[3], extent[3];
+		for (int axis = 0; axis < 3; axis++) {
+			center[axis] = (current.localMin[axis] + current.localMax[axis]) * 0.5f;
+			extent[axis] = (current.localMax[axis] - current.localMin[axis]) * 0.5f;
+		}
+
+		for (int row = 0; row < 3; row++) {
+			float worldCenter = m[12 + row];
+			float worldExtent = 0.0f;
+			for (int column = 0; column < 3; column++) {
+				worldCenter += m[column * 4 + row] * center[column];
+				worldExtent += fabsf(m[column * 4 + row]) * extent[column];
+			}
+			worldMin[row][instance] = worldCenter - worldExtent;
+			worldMax[row][instance] = worldCenter + worldExtent;
+		}
+	}
+
+	// Remove every instance
+	void Scene::clear()
+	{
+		instances.clear();
+		for (int axis = 0; axis < 3; axis++) {
+			worldMin[axis].clear();
+			worldMax[axis].clear();
+		}
+	}
+
+	// Return the number of instances
+	long Scene::getInstanceCount() const
+	{
+		return (long)instances.size();
+	}
+
+	// Return one instance
+	const SceneInstance& Scene::getInstance(unsigned int instance) const
+	{
+		return instances[instance];
+	}
+
+	// Return the world box of an instance
+	void Scene::getWorldBounds(unsigned int instance, float *boundsMin, float *boundsMax) const
+	{
+		for (int axis = 0; axis < 3; axis++) {
+			boundsMin[axis] = worldMin[axis][instance];
+			boundsMax[axis] = worldMax[axis][instance];
+		}
+	}
+
+	// Test every world box against the frustum with a chosen kernel
+	long Scene::cull(const Frustum &frustum, std::vector<unsigned int> &visible, SimdLevel level) const
+	{
+		long count = (long)instances.size();
+		visible.resize(count);
+		if (count == 0) {
+			return 0;
+		}
+
+		CullPlane planes[FRUSTUM_PLANE_COUNT];
+		for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+			const float *p = frustum.getPlane(plane);
+			planes[plane].a = p[0];
+			planes[plane].b = p[1];
+			planes[plane].c = p[2];
+			planes[plane].d = p[3];
+			planes[plane].x = p[0] >= 0.0f ? &worldMax[0][0] : &worldMin[0][0];
+			planes[plane].y = p[1] >= 0.0f ? &worldMax[1][0] : &worldMin[1][0];
+			planes[plane].z = p[2] >= 0.0f ? &worldMax[2][0] : &worldMin[2][0];
+		}
+
+		SimdLevel bestLevel = CpuFeatures::getSimdLevel();
+		if (level > bestLevel) {
+			level = bestLevel;
+		}
+
+		long visibleCount;
+#if defined(FRAMEWORK_X86)
+		if (level == SIMD_AVX2) {
+			visibleCount = cullAvx2(planes, count, &visible[0]);
+		}
+		else if (level == SIMD_SSE2) {
+			visibleCount = cullSse2(planes, count, &visible[0]);
+		}
+		else
+#endif
+		{
+			visibleCount = cullScalar(planes, 0, count, &visible[0], 0);
+		}
+		visible.resize(visibleCount);
+		return visibleCount;
+	}
+
+	// Draw what the camera may see
+	long Scene::render(const Frustum &frustum)
+	{
+		PROFILE_ZONE("Scene::render");
+		cull(frustum, visibleInstances);
+
+		long drawnCount = 0;
+		glMatrixMode(GL_MODELVIEW);
+		for (size_t i = 0; i < visibleInstances.size(); i++) {
+			SceneInstance &instance = instances[visibleInstances[i]];
+			if (instance.model == NULL) {
+				continue;
+			}
+			glPushMatrix();
+			glMultMatrixf(instance.transform);
+			instance.model->render();
+			glPopMatrix();
+			drawnCount++;
+		}
+		return drawnCount;
+	}
+
+}	// namespace
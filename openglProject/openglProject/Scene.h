@@ -0,0 +1,95 @@
+#pragma once
+// Scene.h is the file that holds the
+// model instances drawn every frame and
+// culls them against the camera.
+
+// Header guards
+#ifndef SCENE_H_
+#define SCENE_H_
+
+// Include headers
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "Frustum.h"
+#include "Obj_Loader.h"
+#include "Profiler.h"
+
+namespace applicationFramework {
+
+	// One model placed in the world
+	struct SceneInstance
+	{
+		Obj_Loader *model;			// Drawn with its own render(), NULL for bounds only
+		float transform[16];		// Model to world, column major as glMultMatrixf takes it
+		float localMin[3];			// Box around the model in its own space
+		float localMax[3];
+	};
+
+	/* Model instances with their world bounding boxes. The boxes are kept in
+	* structure-of-arrays form so cull() tests 4 (SSE2) or 8 (AVX2) of them
+	* against each frustum plane at once.
+	*/
+	class Scene
+	{
+	public:
+		// Class constructor/destructor
+		Scene();
+		~Scene();
+
+		/** Adds an instance of a model, its box comes from the model's resident vertices.
+		@param model - the model to draw, it must outlive the instance
+		@param transform - 16 floats, column major, NULL for identity
+		@return the instance number
+		*/
+		unsigned int addInstance(Obj_Loader *model, const float *transform = NULL);
+
+		/** Adds an instance with a box given in model space.
+		@param model - the model to draw, may be NULL to only take part in culling
+		@param localMin, localMax - the box around the model
+		@param transform - 16 floats, column major, NULL for identity
+		@return the instance number
+		*/
+		unsigned int addInstance(Obj_Loader *model, const float *localMin, const float *localMax, const float *transform = NULL);
+
+		/** Moves an instance and updates its world box */
+		void setTransform(unsigned int instance, const float *transform);
+
+		/** Removes every instance */
+		void clear();
+
+		/** The number of instances */
+		long getInstanceCount() const;
+
+		/** One instance, as added */
+		const SceneInstance& getInstance(unsigned int instance) const;
+
+		/** The box around an instance in world space */
+		void getWorldBounds(unsigned int instance, float *boundsMin, float *boundsMax) const;
+
+		/** Finds the instances whose world box is not entirely behind a frustum plane.
+		@param frustum - the camera frustum in world space (Application::getFrustum)
+		@param visible - filled with the visible instance numbers, in increasing order
+		@param level - the widest instruction set to use, the result is the same for all of them
+		@return the number of visible instances
+		*/
+		long cull(const Frustum &frustum, std::vector<unsigned int> &visible, SimdLevel level = SIMD_AVX2) const;
+
+		/** Culls the instances, then draws the visible ones under the current modelview matrix.
+		@return the number of instances drawn
+		*/
+		long render(const Frustum &frustum);
+
+	private:
+		/** Transforms an instance's box into the world arrays */
+		void updateWorldBounds(unsigned int instance);
+
+		std::vector<SceneInstance> instances;
+		std::vector<float> worldMin[3];			// World boxes, one array per axis
+		std::vector<float> worldMax[3];
+		std::vector<unsigned int> visibleInstances;	// Reused by render() every frame
+	};
+
+}	// namespace
+
+#endif
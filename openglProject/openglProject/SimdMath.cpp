@@ -0,0 +1,131 @@
+// SimdMath.cpp is the file that holds
+// the implementation for the matrix
+// conversions, inverse and cameras.
+
+// Include headers
+#include "SimdMath.h"
+
+namespace applicationFramework {
+
+	// Read a column major array
+	Mat4::Mat4(const float *columnMajor)
+	{
+		for (int column = 0; column < 4; column++) {
+			columns[column] = Vec4::load(columnMajor + column * 4);
+		}
+	}
+
+	// Read the rows, then transpose them into columns
+	Mat4 Mat4::fromRowMajor(const float matrix[4][4])
+	{
+		Mat4 rows(matrix[0]);
+		return rows.transposed();
+	}
+
+	// Write a column major array
+	void Mat4::store(float *columnMajor) const
+	{
+		for (int column = 0; column < 4; column++) {
+			columns[column].store(columnMajor + column * 4);
+		}
+	}
+
+	// Write the rows
+	void Mat4::toRowMajor(float matrix[4][4]) const
+	{
+		transposed().store(matrix[0]);
+	}
+
+	// Swap rows and columns
+	Mat4 Mat4::transposed() const
+	{
+		SimdFloat4 column0 = columns[0].getValue();
+		SimdFloat4 column1 = columns[1].getValue();
+		SimdFloat4 column2 = columns[2].getValue();
+		SimdFloat4 column3 = columns[3].getValue();
+		simdTranspose(column0, column1, column2, column3);
+		return Mat4(Vec4(column0), Vec4(column1), Vec4(column2), Vec4(column3));
+	}
+
+	// With a, b, c, d the top three rows of the columns and x, y, z, w the bottom row,
+	// the determinant is (a x b) . (c w - d z) + (c x d) . (a y - b x)
+	float Mat4::determinant() const
+	{
+		const Vec4 &a = columns[0], &b = columns[1], &c = columns[2], &d = columns[3];
+		float x = a.getW(), y = b.getW(), z = c.getW(), w = d.getW();
+		Vec4 s = a.cross3(b);
+		Vec4 t = c.cross3(d);
+		Vec4 u = a * y - b * x;
+		Vec4 v = c * w - d * z;
+		return s.dot3(v) + t.dot3(u);
+	}
+
+	// The rows of the inverse are cross products of the same terms as the determinant
+	// (Lengyel, Foundations of Game Engine Development, vol. 1), built four lanes at a time
+	Mat4 Mat4::inverse() const
+	{
+		const Vec4 &a = columns[0], &b = columns[1], &c = columns[2], &d = columns[3];
+		float x = a.getW(), y = b.getW(), z = c.getW(), w = d.getW();
+		Vec4 s = a.cross3(b);
+		Vec4 t = c.cross3(d);
+		Vec4 u = a * y - b * x;						// The w lanes cancel to 0
+		Vec4 v = c * w - d * z;
+
+		float determinant = s.dot3(v) + t.dot3(u);
+		if (determinant == 0.0f) {
+			return Mat4();
+		}
+		float inverseDeterminant = 1.0f / determinant;
+		s = s * inverseDeterminant;
+		t = t * inverseDeterminant;
+		u = u * inverseDeterminant;
+		v = v * inverseDeterminant;
+
+		// The rows' x, y, z, their w lanes are 0 so they transpose into a zero last column
+		SimdFloat4 row0 = (b.cross3(v) + t * y).getValue();
+		SimdFloat4 row1 = (v.cross3(a) - t * x).getValue();
+		SimdFloat4 row2 = (d.cross3(u) + s * w).getValue();
+		SimdFloat4 row3 = (u.cross3(c) - s * z).getValue();
+		simdTranspose(row0, row1, row2, row3);
+		return Mat4(Vec4(row0), Vec4(row1), Vec4(row2), Vec4(-b.dot3(t), a.dot3(t), -d.dot3(s), c.dot3(s)));
+	}
+
+	// The camera basis as rows, with the eye moved to the origin
+	Mat4 Mat4::lookAt(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &up)
+	{
+		Vec4 eyePosition(eye, 0.0f);
+		Vec4 forward = (Vec4(center, 0.0f) - eyePosition).normalized3();
+		Vec4 side = forward.cross3(Vec4(up, 0.0f)).normalized3();
+		Vec4 cameraUp = side.cross3(forward);
+
+		Mat4 rows(side, cameraUp, -forward, Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		Mat4 view = rows.transposed();
+		view.columns[3] = Vec4(-side.dot3(eyePosition), -cameraUp.dot3(eyePosition), forward.dot3(eyePosition), 1.0f);
+		return view;
+	}
+
+	// The projection
+	Mat4 Mat4::perspective(float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
+	{
+		float f = 1.0f / tanf(fieldOfView * 0.5f * 3.14159265f / 180.0f);
+		return Mat4(Vec4(f / aspectRatio, 0.0f, 0.0f, 0.0f),
+			Vec4(0.0f, f, 0.0f, 0.0f),
+			Vec4(0.0f, 0.0f, (farPlane + nearPlane) / (nearPlane - farPlane), -1.0f),
+			Vec4(0.0f, 0.0f, 2.0f * farPlane * nearPlane / (nearPlane - farPlane), 0.0f));
+	}
+
+	// Move by an offset
+	Mat4 Mat4::translation(const Vector<float> &offset)
+	{
+		Mat4 result;
+		result.columns[3] = Vec4(offset, 1.0f);
+		return result;
+	}
+
+	// Scale each axis
+	Mat4 Mat4::scale(float x, float y, float z)
+	{
+		return Mat4(Vec4(x, 0.0f, 0.0f, 0.0f), Vec4(0.0f, y, 0.0f, 0.0f), Vec4(0.0f, 0.0f, z, 0.0f), Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+}	// namespace
@@ -0,0 +1,460 @@
+#pragma once
+// SimdMath.h is the file that holds the
+// 4 wide vector and 4x4 matrix types kept
+// in SIMD registers.
+
+// Header guards
+#ifndef SIMD_MATH_H_
+#define SIMD_MATH_H_
+
+// Include headers
+#include <math.h>
+
+#include "CpuFeatures.h"
+#include "Vector.h"
+#include "Point.h"
+
+// The registers the types are kept in, picked at compile time since every operation
+// is inlined: SSE on x86 (SSE2 is part of x64), NEON on ARM, plain floats elsewhere
+#if defined(FRAMEWORK_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define FRAMEWORK_SIMD_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM) || defined(_M_ARM64)
+	#define FRAMEWORK_SIMD_NEON 1
+	#include <arm_neon.h>
+#endif
+
+namespace applicationFramework {
+
+#if defined(FRAMEWORK_SIMD_SSE)
+	typedef __m128 SimdFloat4;
+#elif defined(FRAMEWORK_SIMD_NEON)
+	typedef float32x4_t SimdFloat4;
+#else
+	struct SimdFloat4
+	{
+		float lanes[4];
+	};
+#endif
+
+	/* Four floats in one register. As a position or direction the w lane is the
+	* homogeneous coordinate, the 3 component operations (dot3, cross3, length3)
+	* ignore it, so it also stands in for a 3 component vector.
+	*/
+	class Vec4
+	{
+	public:
+		/** Creates (0, 0, 0, 0) */
+		Vec4();
+
+		/** Creates (x, y, z, w) */
+		Vec4(float x, float y, float z, float w);
+
+		/** Creates a vector with every lane set to a value */
+		explicit Vec4(float value);
+
+		/** Converts a Vector, w is 0 for a direction */
+		explicit Vec4(const Vector<float> &vector, float w = 0.0f);
+
+		/** Converts a Point, w is kept */
+		explicit Vec4(const Point<float> &point);
+
+		explicit Vec4(SimdFloat4 value);
+
+		/** Reads four floats, load() takes any address, loadAligned() a 16 byte aligned one */
+		static Vec4 load(const float *values);
+		static Vec4 loadAligned(const float *values);
+
+		/** Writes four floats, the same alignment rules as load */
+		void store(float *values) const;
+		void storeAligned(float *values) const;
+
+		float getX() const;
+		float getY() const;
+		float getZ() const;
+		float getW() const;
+
+		/** Converts back, dropping w for a Vector */
+		Vector<float> toVector() const;
+		Point<float> toPoint() const;
+
+		/** Per lane arithmetic */
+		Vec4 operator+(const Vec4 &other) const;
+		Vec4 operator-(const Vec4 &other) const;
+		Vec4 operator*(const Vec4 &other) const;
+		Vec4 operator*(float scaleFactor) const;
+		Vec4 operator-() const;
+
+		/** The dot product of x, y, z, or of all four lanes */
+		float dot3(const Vec4 &other) const;
+		float dot4(const Vec4 &other) const;
+
+		/** The cross product of x, y, z, w is 0 */
+		Vec4 cross3(const Vec4 &other) const;
+
+		/** The length of x, y, z */
+		float length3() const;
+
+		/** x, y, z scaled to unit length (w is scaled along), unchanged if the length is 0 */
+		Vec4 normalized3() const;
+
+		/** The register, for writing kernels on top of the type */
+		SimdFloat4 getValue() const;
+
+	private:
+		SimdFloat4 value;
+	};
+
+	/* A 4x4 matrix of floats stored as four Vec4 columns, column major as OpenGL
+	* (glMultMatrixf, SceneInstance::transform) lays it out. Transforms multiply
+	* column vectors, so a * b applies b first.
+	*/
+	class Mat4
+	{
+	public:
+		/** Creates the identity */
+		Mat4();
+
+		/** Creates a matrix from its columns */
+		Mat4(const Vec4 &column0, const Vec4 &column1, const Vec4 &column2, const Vec4 &column3);
+
+		/** Reads 16 floats, column major */
+		explicit Mat4(const float *columnMajor);
+
+		/** Converts the row major matrix Vector<T>::transform and Point<T>::transform take */
+		static Mat4 fromRowMajor(const float matrix[4][4]);
+
+		/** Writes 16 floats, column major */
+		void store(float *columnMajor) const;
+
+		/** Writes the row major matrix Vector<T>::transform and Point<T>::transform take */
+		void toRowMajor(float matrix[4][4]) const;
+
+		const Vec4& getColumn(int column) const;
+		void setColumn(int column, const Vec4 &value);
+
+		/** The product, applying other first */
+		Mat4 operator*(const Mat4 &other) const;
+
+		/** Transforms a column vector */
+		Vec4 operator*(const Vec4 &vector) const;
+
+		/** Transforms a point (w included, no divide) and a direction (the upper 3x3 only) */
+		Point<float> transformPoint(const Point<float> &point) const;
+		Vector<float> transformVector(const Vector<float> &vector) const;
+
+		Mat4 transposed() const;
+
+		/** The inverse by cofactors, computed with 3 component cross products.
+		A singular matrix (determinant 0) gives the identity.
+		*/
+		Mat4 inverse() const;
+
+		/** The determinant */
+		float determinant() const;
+
+		/** The view matrix gluLookAt builds.
+		@param eye, center, up - the camera, as Application::setLookAt takes it
+		*/
+		static Mat4 lookAt(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &up);
+
+		/** The projection matrix gluPerspective builds.
+		@param fieldOfView - vertical field of view in degrees
+		@param aspectRatio - width over height
+		@param nearPlane, farPlane - the distances to the clipping planes
+		*/
+		static Mat4 perspective(float fieldOfView, float aspectRatio, float nearPlane, float farPlane);
+
+		/** A translation and a scale */
+		static Mat4 translation(const Vector<float> &offset);
+		static Mat4 scale(float x, float y, float z);
+
+	private:
+		Vec4 columns[4];
+	};
+
+	// ******************************************************************
+	// ** The register operations each backend implements              **
+	// ******************************************************************
+
+#if defined(FRAMEWORK_SIMD_SSE)
+	inline SimdFloat4 simdSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+	inline SimdFloat4 simdSplat(float value) { return _mm_set1_ps(value); }
+	inline SimdFloat4 simdLoad(const float *values) { return _mm_loadu_ps(values); }
+	inline SimdFloat4 simdLoadAligned(const float *values) { return _mm_load_ps(values); }
+	inline void simdStore(float *values, SimdFloat4 value) { _mm_storeu_ps(values, value); }
+	inline void simdStoreAligned(float *values, SimdFloat4 value) { _mm_store_ps(values, value); }
+	inline SimdFloat4 simdAdd(SimdFloat4 a, SimdFloat4 b) { return _mm_add_ps(a, b); }
+	inline SimdFloat4 simdSub(SimdFloat4 a, SimdFloat4 b) { return _mm_sub_ps(a, b); }
+	inline SimdFloat4 simdMul(SimdFloat4 a, SimdFloat4 b) { return _mm_mul_ps(a, b); }
+	inline float simdGetX(SimdFloat4 value) { return _mm_cvtss_f32(value); }
+	inline float simdGetY(SimdFloat4 value) { return _mm_cvtss_f32(_mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1))); }
+	inline float simdGetZ(SimdFloat4 value) { return _mm_cvtss_f32(_mm_movehl_ps(value, value)); }
+	inline float simdGetW(SimdFloat4 value) { return _mm_cvtss_f32(_mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3))); }
+	inline SimdFloat4 simdSplatX(SimdFloat4 value) { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(0, 0, 0, 0)); }
+	inline SimdFloat4 simdSplatY(SimdFloat4 value) { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1)); }
+	inline SimdFloat4 simdSplatZ(SimdFloat4 value) { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 2, 2, 2)); }
+	inline SimdFloat4 simdSplatW(SimdFloat4 value) { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+	// (y, z, x, w), the rotation a cross product is built from
+	inline SimdFloat4 simdRotateYzx(SimdFloat4 value) { return _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 0, 2, 1)); }
+
+	// x + y + z and x + y + z + w, horizontal sums without SSE3
+	inline float simdSum3(SimdFloat4 value)
+	{
+		SimdFloat4 sum = _mm_add_ss(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(value, value)));
+	}
+	inline float simdSum4(SimdFloat4 value)
+	{
+		SimdFloat4 pairs = _mm_add_ps(value, _mm_movehl_ps(value, value));
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+
+	inline void simdTranspose(SimdFloat4 &row0, SimdFloat4 &row1, SimdFloat4 &row2, SimdFloat4 &row3)
+	{
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	}
+#elif defined(FRAMEWORK_SIMD_NEON)
+	inline SimdFloat4 simdSet(float x, float y, float z, float w) { float values[4] = { x, y, z, w }; return vld1q_f32(values); }
+	inline SimdFloat4 simdSplat(float value) { return vdupq_n_f32(value); }
+	inline SimdFloat4 simdLoad(const float *values) { return vld1q_f32(values); }
+	inline SimdFloat4 simdLoadAligned(const float *values) { return vld1q_f32(values); }
+	inline void simdStore(float *values, SimdFloat4 value) { vst1q_f32(values, value); }
+	inline void simdStoreAligned(float *values, SimdFloat4 value) { vst1q_f32(values, value); }
+	inline SimdFloat4 simdAdd(SimdFloat4 a, SimdFloat4 b) { return vaddq_f32(a, b); }
+	inline SimdFloat4 simdSub(SimdFloat4 a, SimdFloat4 b) { return vsubq_f32(a, b); }
+	inline SimdFloat4 simdMul(SimdFloat4 a, SimdFloat4 b) { return vmulq_f32(a, b); }
+	inline float simdGetX(SimdFloat4 value) { return vgetq_lane_f32(value, 0); }
+	inline float simdGetY(SimdFloat4 value) { return vgetq_lane_f32(value, 1); }
+	inline float simdGetZ(SimdFloat4 value) { return vgetq_lane_f32(value, 2); }
+	inline float simdGetW(SimdFloat4 value) { return vgetq_lane_f32(value, 3); }
+	inline SimdFloat4 simdSplatX(SimdFloat4 value) { return vdupq_lane_f32(vget_low_f32(value), 0); }
+	inline SimdFloat4 simdSplatY(SimdFloat4 value) { return vdupq_lane_f32(vget_low_f32(value), 1); }
+	inline SimdFloat4 simdSplatZ(SimdFloat4 value) { return vdupq_lane_f32(vget_high_f32(value), 0); }
+	inline SimdFloat4 simdSplatW(SimdFloat4 value) { return vdupq_lane_f32(vget_high_f32(value), 1); }
+
+	// (y, z, x, w): (y, z) from one extract, then (x, w) from the ends
+	inline SimdFloat4 simdRotateYzx(SimdFloat4 value)
+	{
+		float32x2_t yz = vget_low_f32(vextq_f32(value, value, 1));
+		float32x2_t xw = vset_lane_f32(vgetq_lane_f32(value, 3), vget_low_f32(value), 1);
+		return vcombine_f32(yz, xw);
+	}
+
+	inline float simdSum3(SimdFloat4 value)
+	{
+		float32x2_t pair = vpadd_f32(vget_low_f32(value), vget_low_f32(value));
+		return vget_lane_f32(pair, 0) + vgetq_lane_f32(value, 2);
+	}
+	inline float simdSum4(SimdFloat4 value)
+	{
+		float32x2_t pair = vadd_f32(vget_low_f32(value), vget_high_f32(value));
+		return vget_lane_f32(vpadd_f32(pair, pair), 0);
+	}
+
+	inline void simdTranspose(SimdFloat4 &row0, SimdFloat4 &row1, SimdFloat4 &row2, SimdFloat4 &row3)
+	{
+		float32x4x2_t first = vtrnq_f32(row0, row1);
+		float32x4x2_t second = vtrnq_f32(row2, row3);
+		row0 = vcombine_f32(vget_low_f32(first.val[0]), vget_low_f32(second.val[0]));
+		row1 = vcombine_f32(vget_low_f32(first.val[1]), vget_low_f32(second.val[1]));
+		row2 = vcombine_f32(vget_high_f32(first.val[0]), vget_high_f32(second.val[0]));
+		row3 = vcombine_f32(vget_high_f32(first.val[1]), vget_high_f32(second.val[1]));
+	}
+#else
+	inline SimdFloat4 simdSet(float x, float y, float z, float w) { SimdFloat4 result = { { x, y, z, w } }; return result; }
+	inline SimdFloat4 simdSplat(float value) { return simdSet(value, value, value, value); }
+	inline SimdFloat4 simdLoad(const float *values) { return simdSet(values[0], values[1], values[2], values[3]); }
+	inline SimdFloat4 simdLoadAligned(const float *values) { return simdLoad(values); }
+	inline void simdStore(float *values, SimdFloat4 value) { for (int i = 0; i < 4; i++) { values[i] = value.lanes[i]; } }
+	inline void simdStoreAligned(float *values, SimdFloat4 value) { simdStore(values, value); }
+	inline SimdFloat4 simdAdd(SimdFloat4 a, SimdFloat4 b) { return simdSet(a.lanes[0] + b.lanes[0], a.lanes[1] + b.lanes[1], a.lanes[2] + b.lanes[2], a.lanes[3] + b.lanes[3]); }
+	inline SimdFloat4 simdSub(SimdFloat4 a, SimdFloat4 b) { return simdSet(a.lanes[0] - b.lanes[0], a.lanes[1] - b.lanes[1], a.lanes[2] - b.lanes[2], a.lanes[3] - b.lanes[3]); }
+	inline SimdFloat4 simdMul(SimdFloat4 a, SimdFloat4 b) { return simdSet(a.lanes[0] * b.lanes[0], a.lanes[1] * b.lanes[1], a.lanes[2] * b.lanes[2], a.lanes[3] * b.lanes[3]); }
+	inline float simdGetX(SimdFloat4 value) { return value.lanes[0]; }
+	inline float simdGetY(SimdFloat4 value) { return value.lanes[1]; }
+	inline float simdGetZ(SimdFloat4 value) { return value.lanes[2]; }
+	inline float simdGetW(SimdFloat4 value) { return value.lanes[3]; }
+	inline SimdFloat4 simdSplatX(SimdFloat4 value) { return simdSplat(value.lanes[0]); }
+	inline SimdFloat4 simdSplatY(SimdFloat4 value) { return simdSplat(value.lanes[1]); }
+	inline SimdFloat4 simdSplatZ(SimdFloat4 value) { return simdSplat(value.lanes[2]); }
+	inline SimdFloat4 simdSplatW(SimdFloat4 value) { return simdSplat(value.lanes[3]); }
+	inline SimdFloat4 simdRotateYzx(SimdFloat4 value) { return simdSet(value.lanes[1], value.lanes[2], value.lanes[0], value.lanes[3]); }
+	inline float simdSum3(SimdFloat4 value) { return value.lanes[0] + value.lanes[1] + value.lanes[2]; }
+	inline float simdSum4(SimdFloat4 value) { return (value.lanes[0] + value.lanes[2]) + (value.lanes[1] + value.lanes[3]); }
+
+	inline void simdTranspose(SimdFloat4 &row0, SimdFloat4 &row1, SimdFloat4 &row2, SimdFloat4 &row3)
+	{
+		SimdFloat4 rows[4] = { row0, row1, row2, row3 };
+		row0 = simdSet(rows[0].lanes[0], rows[1].lanes[0], rows[2].lanes[0], rows[3].lanes[0]);
+		row1 = simdSet(rows[0].lanes[1], rows[1].lanes[1], rows[2].lanes[1], rows[3].lanes[1]);
+		row2 = simdSet(rows[0].lanes[2], rows[1].lanes[2], rows[2].lanes[2], rows[3].lanes[2]);
+		row3 = simdSet(rows[0].lanes[3], rows[1].lanes[3], rows[2].lanes[3], rows[3].lanes[3]);
+	}
+#endif
+
+	// ******************************************************************
+	// ** Vec4, inlined so chains of operations stay in registers      **
+	// ******************************************************************
+
+	inline Vec4::Vec4()
+		: value(simdSplat(0.0f)) {
+	}
+
+	inline Vec4::Vec4(float x, float y, float z, float w)
+		: value(simdSet(x, y, z, w)) {
+	}
+
+	inline Vec4::Vec4(float value)
+		: value(simdSplat(value)) {
+	}
+
+	inline Vec4::Vec4(const Vector<float> &vector, float w)
+		: value(simdSet(vector.x, vector.y, vector.z, w)) {
+	}
+
+	inline Vec4::Vec4(const Point<float> &point)
+		: value(simdSet(point.x, point.y, point.z, point.w)) {
+	}
+
+	inline Vec4::Vec4(SimdFloat4 value)
+		: value(value) {
+	}
+
+	inline Vec4 Vec4::load(const float *values) {
+		return Vec4(simdLoad(values));
+	}
+
+	inline Vec4 Vec4::loadAligned(const float *values) {
+		return Vec4(simdLoadAligned(values));
+	}
+
+	inline void Vec4::store(float *values) const {
+		simdStore(values, value);
+	}
+
+	inline void Vec4::storeAligned(float *values) const {
+		simdStoreAligned(values, value);
+	}
+
+	inline float Vec4::getX() const {
+		return simdGetX(value);
+	}
+
+	inline float Vec4::getY() const {
+		return simdGetY(value);
+	}
+
+	inline float Vec4::getZ() const {
+		return simdGetZ(value);
+	}
+
+	inline float Vec4::getW() const {
+		return simdGetW(value);
+	}
+
+	inline Vector<float> Vec4::toVector() const {
+		return Vector<float>(getX(), getY(), getZ());
+	}
+
+	inline Point<float> Vec4::toPoint() const {
+		return Point<float>(getX(), getY(), getZ(), getW());
+	}
+
+	inline Vec4 Vec4::operator+(const Vec4 &other) const {
+		return Vec4(simdAdd(value, other.value));
+	}
+
+	inline Vec4 Vec4::operator-(const Vec4 &other) const {
+		return Vec4(simdSub(value, other.value));
+	}
+
+	inline Vec4 Vec4::operator*(const Vec4 &other) const {
+		return Vec4(simdMul(value, other.value));
+	}
+
+	inline Vec4 Vec4::operator*(float scaleFactor) const {
+		return Vec4(simdMul(value, simdSplat(scaleFactor)));
+	}
+
+	inline Vec4 Vec4::operator-() const {
+		return Vec4(simdSub(simdSplat(0.0f), value));
+	}
+
+	inline float Vec4::dot3(const Vec4 &other) const {
+		return simdSum3(simdMul(value, other.value));
+	}
+
+	inline float Vec4::dot4(const Vec4 &other) const {
+		return simdSum4(simdMul(value, other.value));
+	}
+
+	// a * b.yzx - a.yzx * b is the cross product in (z, x, y) order, rotating it once more puts it back
+	inline Vec4 Vec4::cross3(const Vec4 &other) const {
+		SimdFloat4 rotated = simdSub(simdMul(value, simdRotateYzx(other.value)), simdMul(simdRotateYzx(value), other.value));
+		return Vec4(simdRotateYzx(rotated));
+	}
+
+	inline float Vec4::length3() const {
+		return sqrtf(dot3(*this));
+	}
+
+	inline Vec4 Vec4::normalized3() const {
+		float length = length3();
+		return length > 0.0f ? *this * (1.0f / length) : *this;
+	}
+
+	inline SimdFloat4 Vec4::getValue() const {
+		return value;
+	}
+
+	// ******************************************************************
+	// ** Mat4 constructors and products, inlined for the same reason  **
+	// ******************************************************************
+
+	inline Mat4::Mat4() {
+		columns[0] = Vec4(1.0f, 0.0f, 0.0f, 0.0f);
+		columns[1] = Vec4(0.0f, 1.0f, 0.0f, 0.0f);
+		columns[2] = Vec4(0.0f, 0.0f, 1.0f, 0.0f);
+		columns[3] = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline Mat4::Mat4(const Vec4 &column0, const Vec4 &column1, const Vec4 &column2, const Vec4 &column3) {
+		columns[0] = column0;
+		columns[1] = column1;
+		columns[2] = column2;
+		columns[3] = column3;
+	}
+
+	inline const Vec4& Mat4::getColumn(int column) const {
+		return columns[column];
+	}
+
+	inline void Mat4::setColumn(int column, const Vec4 &value) {
+		columns[column] = value;
+	}
+
+	// M * v = column0 * x + column1 * y + column2 * z + column3 * w
+	inline Vec4 Mat4::operator*(const Vec4 &vector) const {
+		SimdFloat4 v = vector.getValue();
+		SimdFloat4 xy = simdAdd(simdMul(columns[0].getValue(), simdSplatX(v)), simdMul(columns[1].getValue(), simdSplatY(v)));
+		SimdFloat4 zw = simdAdd(simdMul(columns[2].getValue(), simdSplatZ(v)), simdMul(columns[3].getValue(), simdSplatW(v)));
+		return Vec4(simdAdd(xy, zw));
+	}
+
+	// Each column of the product is this matrix times a column of the other
+	inline Mat4 Mat4::operator*(const Mat4 &other) const {
+		return Mat4(*this * other.columns[0], *this * other.columns[1], *this * other.columns[2], *this * other.columns[3]);
+	}
+
+	inline Point<float> Mat4::transformPoint(const Point<float> &point) const {
+		return (*this * Vec4(point)).toPoint();
+	}
+
+	inline Vector<float> Mat4::transformVector(const Vector<float> &vector) const {
+		return (*this * Vec4(vector, 0.0f)).toVector();
+	}
+
+}	// namespace
+
+#endif
@@ -0,0 +1,751 @@
+// SoftwareRasterizer.cpp is the file that
+// holds the implementation of the CPU
+// rasterizer and its row kernels.
+
+// Include headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SoftwareRasterizer.h"
+
+namespace applicationFramework {
+
+	// Fixed point steps per pixel, snapping corners to them makes the edge functions exact
+	static const int SUBPIXEL_BITS = 4;
+	static const int SUBPIXEL_STEPS = 1 << SUBPIXEL_BITS;
+
+	// Screen coordinates are kept within this many pixels of the origin, so corner
+	// differences take 18 bits and an edge changes by less than 2^29 across a tile
+	static const float GUARD_BAND_PIXELS = 8000.0f;
+	static const long long EDGE_CLAMP = 1 << 29;
+
+	// Vertices per vertex stage task
+	static const long VERTICES_PER_TASK = 4096;
+
+	// A polygon clipped against the near plane and the four guard band planes
+	static const int CLIP_PLANE_COUNT = 5;
+	static const int MAX_CLIPPED_CORNERS = 3 + CLIP_PLANE_COUNT;
+
+	// Row kernel: fills the covered pixels from x to xEnd of one row of one tile
+	typedef void(*RasterRowFunction)(const RasterTriangle &triangle, int x, int xEnd, const int *edges,
+		const int *edgeStepX, float rowZ, float rowIntensity, float *depth, unsigned int *color);
+
+	// Rounds down, unlike the / operator for negative numbers
+	static int floorDivide(int value, int divisor)
+	{
+		return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+	}
+
+	// Column major c = a * b
+	static void multiplyMatrices(const float *a, const float *b, float *c)
+	{
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++) {
+					sum += a[k * 4 + row] * b[column * 4 + k];
+				}
+				c[column * 4 + row] = sum;
+			}
+		}
+	}
+
+	// Scalar row kernel, a pixel is drawn when all three edge functions are not negative
+	// and it is nearer than the depth buffer. The SIMD kernels compute the same values
+	// in the same order, so every level writes the same bits.
+	static void rasterizeRowScalar(const RasterTriangle &triangle, int x, int xEnd, const int *edges,
+		const int *edgeStepX, float rowZ, float rowIntensity, float *depth, unsigned int *color)
+	{
+		int e0 = edges[0], e1 = edges[1], e2 = edges[2];
+		for (; x <= xEnd; x++) {
+			if ((e0 | e1 | e2) >= 0) {
+				float dx = ((float)x + 0.5f) - triangle.originX;
+				float z = rowZ + triangle.dzdx * dx;
+				if (z < depth[x]) {
+					float intensity = rowIntensity + triangle.didx * dx;
+					intensity = intensity > 0.0f ? intensity : 0.0f;
+					intensity = intensity < 1.0f ? intensity : 1.0f;
+					unsigned int grey = (unsigned int)(int)(intensity * 255.0f + 0.5f);
+					depth[x] = z;
+					color[x] = 0xFF000000u | grey | (grey << 8) | (grey << 16);
+				}
+			}
+			e0 += edgeStepX[0];
+			e1 += edgeStepX[1];
+			e2 += edgeStepX[2];
+		}
+	}
+
+#if defined(FRAMEWORK_X86)
+	// SSE2 row kernel, 4 pixels per group. x starts on a multiple of 4 from the tile's
+	// edge and rows are padded, so a group never reaches into another tile.
+	static void rasterizeRowSse2(const RasterTriangle &triangle, int x, int xEnd, const int *edges,
+		const int *edgeStepX, float rowZ, float rowIntensity, float *depth, unsigned int *color)
+	{
+		const int WIDTH = 4;
+		__m128i e0 = _mm_setr_epi32(edges[0], edges[0] + edgeStepX[0], edges[0] + edgeStepX[0] * 2, edges[0] + edgeStepX[0] * 3);
+		__m128i e1 = _mm_setr_epi32(edges[1], edges[1] + edgeStepX[1], edges[1] + edgeStepX[1] * 2, edges[1] + edgeStepX[1] * 3);
+		__m128i e2 = _mm_setr_epi32(edges[2], edges[2] + edgeStepX[2], edges[2] + edgeStepX[2] * 2, edges[2] + edgeStepX[2] * 3);
+		__m128i step0 = _mm_set1_epi32(edgeStepX[0] * WIDTH);
+		__m128i step1 = _mm_set1_epi32(edgeStepX[1] * WIDTH);
+		__m128i step2 = _mm_set1_epi32(edgeStepX[2] * WIDTH);
+		__m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+		__m128 dzdx = _mm_set1_ps(triangle.dzdx);
+		__m128 didx = _mm_set1_ps(triangle.didx);
+		__m128 originX = _mm_set1_ps(triangle.originX);
+		__m128 z0 = _mm_set1_ps(rowZ);
+		__m128 intensity0 = _mm_set1_ps(rowIntensity);
+
+		for (; x <= xEnd; x += WIDTH) {
+			__m128i covered = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), _mm_set1_epi32(-1));
+			covered = _mm_and_si128(covered, _mm_cmplt_epi32(lanes, _mm_set1_epi32(xEnd - x + 1)));
+			e0 = _mm_add_epi32(e0, step0);
+			e1 = _mm_add_epi32(e1, step1);
+			e2 = _mm_add_epi32(e2, step2);
+			if (_mm_movemask_epi8(covered) == 0) {
+				continue;
+			}
+
+			__m128 dx = _mm_sub_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), lanes)), _mm_set1_ps(0.5f)), originX);
+			__m128 z = _mm_add_ps(z0, _mm_mul_ps(dzdx, dx));
+			__m128 oldDepth = _mm_loadu_ps(depth + x);
+			__m128 pass = _mm_and_ps(_mm_castsi128_ps(covered), _mm_cmplt_ps(z, oldDepth));
+			if (_mm_movemask_ps(pass) == 0) {
+				continue;
+			}
+
+			__m128 intensity = _mm_add_ps(intensity0, _mm_mul_ps(didx, dx));
+			intensity = _mm_min_ps(_mm_max_ps(intensity, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			__m128i grey = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(intensity, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+			__m128i pixel = _mm_or_si128(_mm_or_si128(grey, _mm_slli_epi32(grey, 8)), _mm_slli_epi32(grey, 16));
+			pixel = _mm_or_si128(pixel, _mm_set1_epi32((int)0xFF000000u));
+
+			__m128i passMask = _mm_castps_si128(pass);
+			__m128i oldColor = _mm_loadu_si128((const __m128i*)(color + x));
+			_mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, oldDepth)));
+			_mm_storeu_si128((__m128i*)(color + x), _mm_or_si128(_mm_and_si128(passMask, pixel), _mm_andnot_si128(passMask, oldColor)));
+		}
+	}
+
+	// AVX2 row kernel, 8 pixels per group
+	FRAMEWORK_TARGET_AVX2 static void rasterizeRowAvx2(const RasterTriangle &triangle, int x, int xEnd, const int *edges,
+		const int *edgeStepX, float rowZ, float rowIntensity, float *depth, unsigned int *color)
+	{
+		const int WIDTH = 8;
+		__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256i e0 = _mm256_add_epi32(_mm256_set1_epi32(edges[0]), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(edgeStepX[0])));
+		__m256i e1 = _mm256_add_epi32(_mm256_set1_epi32(edges[1]), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(edgeStepX[1])));
+		__m256i e2 = _mm256_add_epi32(_mm256_set1_epi32(edges[2]), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(edgeStepX[2])));
+		__m256i step0 = _mm256_set1_epi32(edgeStepX[0] * WIDTH);
+		__m256i step1 = _mm256_set1_epi32(edgeStepX[1] * WIDTH);
+		__m256i step2 = _mm256_set1_epi32(edgeStepX[2] * WIDTH);
+		__m256 dzdx = _mm256_set1_ps(triangle.dzdx);
+		__m256 didx = _mm256_set1_ps(triangle.didx);
+		__m256 originX = _mm256_set1_ps(triangle.originX);
+		__m256 z0 = _mm256_set1_ps(rowZ);
+		__m256 intensity0 = _mm256_set1_ps(rowIntensity);
+
+		for (; x <= xEnd; x += WIDTH) {
+			__m256i covered = _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(e0, e1), e2), _mm256_set1_epi32(-1));
+			covered = _mm256_and_si256(covered, _mm256_cmpgt_epi32(_mm256_set1_epi32(xEnd - x + 1), lanes));
+			e0 = _mm256_add_epi32(e0, step0);
+			e1 = _mm256_add_epi32(e1, step1);
+			e2 = _mm256_add_epi32(e2, step2);
+			if (_mm256_movemask_epi8(covered) == 0) {
+				continue;
+			}
+
+			__m256 dx = _mm256_sub_ps(_mm256_add_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x), lanes)), _mm256_set1_ps(0.5f)), originX);
+			__m256 z = _mm256_add_ps(z0, _mm256_mul_ps(dzdx, dx));
+			__m256 oldDepth = _mm256_loadu_ps(depth + x);
+			__m256 pass = _mm256_and_ps(_mm256_castsi256_ps(covered), _mm256_cmp_ps(z, oldDepth, _CMP_LT_OQ));
+			if (_mm256_movemask_ps(pass) == 0) {
+				continue;
+			}
+
+			__m256 intensity = _mm256_add_ps(intensity0, _mm256_mul_ps(didx, dx));
+			intensity = _mm256_min_ps(_mm256_max_ps(intensity, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+			__m256i grey = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(intensity, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+			__m256i pixel = _mm256_or_si256(_mm256_or_si256(grey, _mm256_slli_epi32(grey, 8)), _mm256_slli_epi32(grey, 16));
+			pixel = _mm256_or_si256(pixel, _mm256_set1_epi32((int)0xFF000000u));
+
+			__m256i passMask = _mm256_castps_si256(pass);
+			_mm256_maskstore_ps(depth + x, passMask, z);
+			_mm256_maskstore_epi32((int*)(color + x), passMask, pixel);
+		}
+	}
+#endif
+
+	// Class constructor
+	SoftwareRasterizer::SoftwareRasterizer(ThreadPool &pool)
+		: pool(pool), simdLevel(CpuFeatures::getSimdLevel()), colorBuffer(NULL), depthBuffer(NULL),
+		width(0), height(0), stride(0), tileColumns(0), tileRows(0),
+		guardBandX(1.0f), guardBandY(1.0f), chunkCount(0)
+	{
+		setCamera(Vector<float>(0.0f, 0.0f, 1.0f), Vector<float>(0.0f, 0.0f, 0.0f), Vector<float>(0.0f, 1.0f, 0.0f),
+			60.0f, 1.0f, 1.0f, 100.0f);
+		setLight(Vector<float>(0.0f, 1.0f, 1.0f), (0.8f + 0.4f) * 0.2f, 1.0f * 0.8f);
+	}
+
+	// Class destructor
+	SoftwareRasterizer::~SoftwareRasterizer()
+	{
+		release();
+	}
+
+	// Allocate the framebuffer, rows padded to the AVX2 group width
+	bool SoftwareRasterizer::resize(int width, int height)
+	{
+		release();
+		if (width <= 0 || height <= 0 || width > RASTER_MAX_SIZE || height > RASTER_MAX_SIZE) {
+			return false;
+		}
+
+		stride = (width + 7) & ~7;
+		colorBuffer = (unsigned int*)malloc((size_t)stride * height * sizeof(unsigned int));
+		depthBuffer = (float*)malloc((size_t)stride * height * sizeof(float));
+		if (colorBuffer == NULL || depthBuffer == NULL) {
+			release();
+			return false;
+		}
+
+		this->width = width;
+		this->height = height;
+		tileColumns = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+		tileRows = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+		guardBandX = GUARD_BAND_PIXELS * 2.0f / width - 1.0f;
+		guardBandY = GUARD_BAND_PIXELS * 2.0f / height - 1.0f;
+		clear();
+		return true;
+	}
+
+	// Free the framebuffer and scratch
+	void SoftwareRasterizer::release()
+	{
+		free(colorBuffer);
+		free(depthBuffer);
+		colorBuffer = NULL;
+		depthBuffer = NULL;
+		width = 0;
+		height = 0;
+		stride = 0;
+		tileColumns = 0;
+		tileRows = 0;
+
+		std::vector<ClipVertex>().swap(clipVertices);
+		std::vector<std::vector<RasterTriangle> >().swap(chunkTriangles);
+		std::vector<std::vector<unsigned int> >().swap(chunkBins);
+		chunkCount = 0;
+	}
+
+	// Fill the color and depth buffers
+	void SoftwareRasterizer::clear(float grey)
+	{
+		grey = grey > 0.0f ? (grey < 1.0f ? grey : 1.0f) : 0.0f;
+		unsigned int level = (unsigned int)(int)(grey * 255.0f + 0.5f);
+		unsigned int pixel = 0xFF000000u | level | (level << 8) | (level << 16);
+		size_t pixelCount = (size_t)stride * height;
+		for (size_t i = 0; i < pixelCount; i++) {
+			colorBuffer[i] = pixel;
+			depthBuffer[i] = 1.0f;
+		}
+	}
+
+	// Build the view projection matrix as gluLookAt followed by gluPerspective
+	void SoftwareRasterizer::setCamera(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &up,
+		float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
+	{
+		Vector<float> forward = center - eye;
+		forward.normalize();
+		Vector<float> side = forward.cross(up);
+		side.normalize();
+		Vector<float> cameraUp = side.cross(forward);
+
+		float view[16] = {
+			side.x, cameraUp.x, -forward.x, 0.0f,
+			side.y, cameraUp.y, -forward.y, 0.0f,
+			side.z, cameraUp.z, -forward.z, 0.0f,
+			-side.dot(eye), -cameraUp.dot(eye), forward.dot(eye), 1.0f };
+
+		float f = 1.0f / tanf(fieldOfView * 0.5f * 3.14159265f / 180.0f);
+		float projection[16] = {
+			f / aspectRatio, 0.0f, 0.0f, 0.0f,
+			0.0f, f, 0.0f, 0.0f,
+			0.0f, 0.0f, (farPlane + nearPlane) / (nearPlane - farPlane), -1.0f,
+			0.0f, 0.0f, 2.0f * farPlane * nearPlane / (nearPlane - farPlane), 0.0f };
+
+		multiplyMatrices(projection, view, viewProjection);
+	}
+
+	// Set the directional light
+	void SoftwareRasterizer::setLight(const Vector<float> &direction, float ambient, float diffuse)
+	{
+		Vector<float> unit = direction;
+		unit.normalize();
+		lightDirection[0] = unit.x;
+		lightDirection[1] = unit.y;
+		lightDirection[2] = unit.z;
+		lightAmbient = ambient;
+		lightDiffuse = diffuse;
+	}
+
+	// Pick the row kernel
+	void SoftwareRasterizer::setSimdLevel(SimdLevel level)
+	{
+		simdLevel = level;
+	}
+
+	// Draw whichever mesh Obj_Loader::render() would
+	long SoftwareRasterizer::draw(const Obj_Loader &model, const float *transform)
+	{
+		if (model.quantizedMesh.indexCount > 0) {
+			return draw(model.quantizedMesh, transform);
+		}
+		if (model.indexedMesh.indexCount > 0) {
+			return draw(model.indexedMesh, transform);
+		}
+		return drawTriangles(model.Faces_Triangles, model.normals, model.TotalConnectedTriangles / POINTS_PER_VERTEX, transform);
+	}
+
+	// Draw an indexed mesh
+	long SoftwareRasterizer::draw(const IndexedMesh &mesh, const float *transform)
+	{
+		VertexSource source = { mesh.positions, mesh.normals, NULL, mesh.vertexCount, mesh.indices, mesh.indexSize, mesh.indexCount };
+		return drawVertices(source, transform);
+	}
+
+	// Draw a quantized mesh
+	long SoftwareRasterizer::draw(const QuantizedMesh &mesh, const float *transform)
+	{
+		VertexSource source = { NULL, NULL, &mesh, mesh.vertexCount, mesh.indices, mesh.indexSize, mesh.indexCount };
+		return drawVertices(source, transform);
+	}
+
+	// Draw a triangle list
+	long SoftwareRasterizer::drawTriangles(const float *positions, const float *normals, long cornerCount, const float *transform)
+	{
+		VertexSource source = { positions, normals, NULL, cornerCount, NULL, 0, cornerCount };
+		return drawVertices(source, transform);
+	}
+
+	// Run the three stages, each one on the pool
+	long SoftwareRasterizer::drawVertices(const VertexSource &source, const float *transform)
+	{
+		if (colorBuffer == NULL || source.cornerCount < 3 || (source.positions == NULL && source.quantized == NULL)) {
+			return 0;
+		}
+
+		// Model view projection, and the model's inverse transpose for the normals
+		// (its cofactors, the normals are normalized after)
+		float modelViewProjection[16];
+		float normalMatrix[9] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		if (transform != NULL) {
+			multiplyMatrices(viewProjection, transform, modelViewProjection);
+			Vector<float> a(transform[0], transform[1], transform[2]);
+			Vector<float> b(transform[4], transform[5], transform[6]);
+			Vector<float> c(transform[8], transform[9], transform[10]);
+			Vector<float> columns[3] = { b.cross(c), c.cross(a), a.cross(b) };
+			float sign = a.dot(columns[0]) < 0.0f ? -1.0f : 1.0f;
+			for (int column = 0; column < 3; column++) {
+				normalMatrix[column * 3] = columns[column].x * sign;
+				normalMatrix[column * 3 + 1] = columns[column].y * sign;
+				normalMatrix[column * 3 + 2] = columns[column].z * sign;
+			}
+		}
+		else {
+			memcpy(modelViewProjection, viewProjection, sizeof(modelViewProjection));
+		}
+
+		// Vertex stage
+		clipVertices.resize(source.vertexCount);
+		long vertexTaskCount = (source.vertexCount + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+		pool.parallelFor(vertexTaskCount, [&](long task) {
+			long first = task * VERTICES_PER_TASK;
+			long last = first + VERTICES_PER_TASK < source.vertexCount ? first + VERTICES_PER_TASK : source.vertexCount;
+			shadeVertices(source, modelViewProjection, normalMatrix, first, last);
+		});
+
+		// Setup and binning, each chunk into its own lists so no locks are needed
+		long tileCount = (long)tileColumns * tileRows;
+		long triangleCount = source.cornerCount / 3;
+		chunkCount = (triangleCount + RASTER_TRIANGLES_PER_CHUNK - 1) / RASTER_TRIANGLES_PER_CHUNK;
+		if ((long)chunkTriangles.size() < chunkCount) {
+			chunkTriangles.resize(chunkCount);
+		}
+		if ((long)chunkBins.size() < chunkCount * tileCount) {
+			chunkBins.resize(chunkCount * tileCount);
+		}
+		pool.parallelFor(chunkCount, [&](long chunk) {
+			setupChunk(source, chunk);
+		});
+
+		// Tiles, each one walks the chunks in order so triangles land in submission order
+		pool.parallelFor(tileCount, [&](long tile) {
+			rasterizeTile(tile);
+		});
+
+		long rasterizedCount = 0;
+		for (long chunk = 0; chunk < chunkCount; chunk++) {
+			rasterizedCount += (long)chunkTriangles[chunk].size();
+		}
+		return rasterizedCount;
+	}
+
+	// Transform a range of vertices to clip space and light them as OpenGL does per vertex
+	void SoftwareRasterizer::shadeVertices(const VertexSource &source, const float *modelViewProjection,
+		const float *normalMatrix, long first, long last)
+	{
+		const float *m = modelViewProjection;
+		const float *n = normalMatrix;
+		for (long vertex = first; vertex < last; vertex++) {
+			float position[3], normal[3];
+			bool hasNormal = true;
+			if (source.quantized != NULL) {
+				source.quantized->decodePosition(vertex, position);
+				source.quantized->decodeNormal(vertex, normal);
+			}
+			else {
+				memcpy(position, &source.positions[vertex * 3], sizeof(position));
+				hasNormal = source.normals != NULL;
+				if (hasNormal) {
+					memcpy(normal, &source.normals[vertex * 3], sizeof(normal));
+				}
+			}
+
+			ClipVertex &out = clipVertices[vertex];
+			out.x = m[0] * position[0] + m[4] * position[1] + m[8] * position[2] + m[12];
+			out.y = m[1] * position[0] + m[5] * position[1] + m[9] * position[2] + m[13];
+			out.z = m[2] * position[0] + m[6] * position[1] + m[10] * position[2] + m[14];
+			out.w = m[3] * position[0] + m[7] * position[1] + m[11] * position[2] + m[15];
+
+			float intensity = lightAmbient;
+			if (hasNormal) {
+				float worldNormal[3];
+				for (int axis = 0; axis < 3; axis++) {
+					worldNormal[axis] = n[axis] * normal[0] + n[3 + axis] * normal[1] + n[6 + axis] * normal[2];
+				}
+				float length = sqrtf(worldNormal[0] * worldNormal[0] + worldNormal[1] * worldNormal[1] + worldNormal[2] * worldNormal[2]);
+				float cosine = worldNormal[0] * lightDirection[0] + worldNormal[1] * lightDirection[1] + worldNormal[2] * lightDirection[2];
+				if (length > 0.0f && cosine > 0.0f) {
+					intensity += lightDiffuse * cosine / length;
+				}
+			}
+			out.intensity = intensity < 1.0f ? intensity : 1.0f;
+		}
+	}
+
+	// Distance of a clip space vertex inside one of the clipping planes
+	static float getClipDistance(const ClipVertex &v, int plane, float guardBandX, float guardBandY)
+	{
+		switch (plane) {
+		case 0: return v.z + v.w;					// Near
+		case 1: return guardBandX * v.w - v.x;
+		case 2: return guardBandX * v.w + v.x;
+		case 3: return guardBandY * v.w - v.y;
+		default: return guardBandY * v.w + v.y;
+		}
+	}
+
+	// Bit per clipping plane the vertex is outside of
+	static int getClipCode(const ClipVertex &v, float guardBandX, float guardBandY)
+	{
+		int code = 0;
+		for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++) {
+			code |= getClipDistance(v, plane, guardBandX, guardBandY) < 0.0f ? 1 << plane : 0;
+		}
+		return code;
+	}
+
+	// Bit per view volume plane the vertex is outside of
+	static int getFrustumCode(const ClipVertex &v)
+	{
+		return (v.x < -v.w ? 1 : 0) | (v.x > v.w ? 2 : 0) | (v.y < -v.w ? 4 : 0) |
+			(v.y > v.w ? 8 : 0) | (v.z < -v.w ? 16 : 0) | (v.z > v.w ? 32 : 0);
+	}
+
+	// Vertex number of a corner
+	static long getCornerVertex(const void *indices, int indexSize, long corner)
+	{
+		if (indices == NULL) {
+			return corner;
+		}
+		return indexSize == 2 ? ((const unsigned short*)indices)[corner] : ((const unsigned int*)indices)[corner];
+	}
+
+	// Reject, clip and set up the triangles of one chunk
+	void SoftwareRasterizer::setupChunk(const VertexSource &source, long chunk)
+	{
+		long tileCount = (long)tileColumns * tileRows;
+		chunkTriangles[chunk].clear();
+		for (long tile = 0; tile < tileCount; tile++) {
+			chunkBins[chunk * tileCount + tile].clear();
+		}
+
+		long first = chunk * RASTER_TRIANGLES_PER_CHUNK;
+		long last = first + RASTER_TRIANGLES_PER_CHUNK;
+		last = last < source.cornerCount / 3 ? last : source.cornerCount / 3;
+		for (long triangle = first; triangle < last; triangle++) {
+			const ClipVertex *corners[3];
+			for (int corner = 0; corner < 3; corner++) {
+				corners[corner] = &clipVertices[getCornerVertex(source.indices, source.indexSize, triangle * 3 + corner)];
+			}
+			if ((getFrustumCode(*corners[0]) & getFrustumCode(*corners[1]) & getFrustumCode(*corners[2])) != 0) {
+				continue;			// Entirely outside one side of the view volume
+			}
+
+			int clipCodes = getClipCode(*corners[0], guardBandX, guardBandY) | getClipCode(*corners[1], guardBandX, guardBandY) |
+				getClipCode(*corners[2], guardBandX, guardBandY);
+			if (clipCodes == 0) {
+				setupTriangle(*corners[0], *corners[1], *corners[2], chunk);
+				continue;
+			}
+
+			// Clip the polygon against each plane it crosses (Sutherland-Hodgman), then fan it out
+			ClipVertex polygon[2][MAX_CLIPPED_CORNERS];
+			int cornerCount = 3;
+			int current = 0;
+			for (int corner = 0; corner < 3; corner++) {
+				polygon[0][corner] = *corners[corner];
+			}
+			for (int plane = 0; plane < CLIP_PLANE_COUNT && cornerCount >= 3; plane++) {
+				if ((clipCodes & (1 << plane)) == 0) {
+					continue;
+				}
+				const ClipVertex *in = polygon[current];
+				ClipVertex *out = polygon[1 - current];
+				int outCount = 0;
+				for (int corner = 0; corner < cornerCount; corner++) {
+					const ClipVertex &a = in[corner];
+					const ClipVertex &b = in[(corner + 1) % cornerCount];
+					float distanceA = getClipDistance(a, plane, guardBandX, guardBandY);
+					float distanceB = getClipDistance(b, plane, guardBandX, guardBandY);
+					if (distanceA >= 0.0f) {
+						out[outCount++] = a;
+					}
+					if ((distanceA >= 0.0f) != (distanceB >= 0.0f)) {
+						float t = distanceA / (distanceA - distanceB);
+						ClipVertex &v = out[outCount++];
+						v.x = a.x + (b.x - a.x) * t;
+						v.y = a.y + (b.y - a.y) * t;
+						v.z = a.z + (b.z - a.z) * t;
+						v.w = a.w + (b.w - a.w) * t;
+						v.intensity = a.intensity + (b.intensity - a.intensity) * t;
+					}
+				}
+				cornerCount = outCount;
+				current = 1 - current;
+			}
+			for (int corner = 2; corner < cornerCount; corner++) {
+				setupTriangle(polygon[current][0], polygon[current][corner - 1], polygon[current][corner], chunk);
+			}
+		}
+	}
+
+	// Project and snap the corners, build the edge functions and attribute planes, then bin
+	bool SoftwareRasterizer::setupTriangle(const ClipVertex &v0, const ClipVertex &v1, const ClipVertex &v2, long chunk)
+	{
+		const ClipVertex *corners[3] = { &v0, &v1, &v2 };
+		int x[3], y[3];
+		float depth[3];
+		for (int corner = 0; corner < 3; corner++) {
+			const ClipVertex &v = *corners[corner];
+			float inverseW = 1.0f / v.w;
+			float screenX = (v.x * inverseW * 0.5f + 0.5f) * width;
+			float screenY = (0.5f - v.y * inverseW * 0.5f) * height;
+			x[corner] = (int)floorf(screenX * SUBPIXEL_STEPS + 0.5f);
+			y[corner] = (int)floorf(screenY * SUBPIXEL_STEPS + 0.5f);
+			depth[corner] = v.z * inverseW * 0.5f + 0.5f;
+		}
+
+		// Both windings are drawn (OpenGL's face culling is off), turn them all one way
+		long long area = (long long)(x[1] - x[0]) * (y[2] - y[0]) - (long long)(x[2] - x[0]) * (y[1] - y[0]);
+		if (area == 0) {
+			return false;
+		}
+		float intensity[3] = { v0.intensity, v1.intensity, v2.intensity };
+		if (area < 0) {
+			int swap = x[1]; x[1] = x[2]; x[2] = swap;
+			swap = y[1]; y[1] = y[2]; y[2] = swap;
+			float swapValue = depth[1]; depth[1] = depth[2]; depth[2] = swapValue;
+			swapValue = intensity[1]; intensity[1] = intensity[2]; intensity[2] = swapValue;
+		}
+
+		// Pixels whose centers (at 8/16) fall inside the corners' box
+		int minX = x[0] < x[1] ? (x[0] < x[2] ? x[0] : x[2]) : (x[1] < x[2] ? x[1] : x[2]);
+		int maxX = x[0] > x[1] ? (x[0] > x[2] ? x[0] : x[2]) : (x[1] > x[2] ? x[1] : x[2]);
+		int minY = y[0] < y[1] ? (y[0] < y[2] ? y[0] : y[2]) : (y[1] < y[2] ? y[1] : y[2]);
+		int maxY = y[0] > y[1] ? (y[0] > y[2] ? y[0] : y[2]) : (y[1] > y[2] ? y[1] : y[2]);
+		RasterTriangle triangle;
+		triangle.minX = -floorDivide(-(minX - SUBPIXEL_STEPS / 2), SUBPIXEL_STEPS);
+		triangle.maxX = floorDivide(maxX - SUBPIXEL_STEPS / 2, SUBPIXEL_STEPS);
+		triangle.minY = -floorDivide(-(minY - SUBPIXEL_STEPS / 2), SUBPIXEL_STEPS);
+		triangle.maxY = floorDivide(maxY - SUBPIXEL_STEPS / 2, SUBPIXEL_STEPS);
+		triangle.minX = triangle.minX > 0 ? triangle.minX : 0;
+		triangle.minY = triangle.minY > 0 ? triangle.minY : 0;
+		triangle.maxX = triangle.maxX < width - 1 ? triangle.maxX : width - 1;
+		triangle.maxY = triangle.maxY < height - 1 ? triangle.maxY : height - 1;
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+			return false;
+		}
+
+		// Edge i runs from corner i to the next, A*x + B*y is positive on the inside.
+		// The top-left rule draws pixels exactly on an edge only for left and top edges,
+		// so pixels on an edge shared by two triangles are drawn once.
+		triangle.cornerX = x[0];
+		triangle.cornerY = y[0];
+		for (int edge = 0; edge < 3; edge++) {
+			int next = (edge + 1) % 3;
+			int a = y[edge] - y[next];
+			int b = x[next] - x[edge];
+			bool isTopLeft = a > 0 || (a == 0 && b > 0);
+			triangle.edgeA[edge] = a;
+			triangle.edgeB[edge] = b;
+			triangle.edgeC[edge] = (long long)a * (x[0] - x[edge]) + (long long)b * (y[0] - y[edge]) + (isTopLeft ? 0 : -1);
+		}
+
+		// Depth and grey level planes over the snapped corners, in pixels from corner 0
+		float x0 = x[0] / (float)SUBPIXEL_STEPS, y0 = y[0] / (float)SUBPIXEL_STEPS;
+		float dx1 = x[1] / (float)SUBPIXEL_STEPS - x0, dy1 = y[1] / (float)SUBPIXEL_STEPS - y0;
+		float dx2 = x[2] / (float)SUBPIXEL_STEPS - x0, dy2 = y[2] / (float)SUBPIXEL_STEPS - y0;
+		float inverseDeterminant = 1.0f / (dx1 * dy2 - dx2 * dy1);
+		triangle.originX = x0;
+		triangle.originY = y0;
+		triangle.z = depth[0];
+		triangle.dzdx = ((depth[1] - depth[0]) * dy2 - (depth[2] - depth[0]) * dy1) * inverseDeterminant;
+		triangle.dzdy = ((depth[2] - depth[0]) * dx1 - (depth[1] - depth[0]) * dx2) * inverseDeterminant;
+		triangle.intensity = intensity[0];
+		triangle.didx = ((intensity[1] - intensity[0]) * dy2 - (intensity[2] - intensity[0]) * dy1) * inverseDeterminant;
+		triangle.didy = ((intensity[2] - intensity[0]) * dx1 - (intensity[1] - intensity[0]) * dx2) * inverseDeterminant;
+
+		std::vector<RasterTriangle> &triangles = chunkTriangles[chunk];
+		unsigned int number = (unsigned int)triangles.size();
+		triangles.push_back(triangle);
+		long tileCount = (long)tileColumns * tileRows;
+		for (int tileY = triangle.minY / RASTER_TILE_SIZE; tileY <= triangle.maxY / RASTER_TILE_SIZE; tileY++) {
+			for (int tileX = triangle.minX / RASTER_TILE_SIZE; tileX <= triangle.maxX / RASTER_TILE_SIZE; tileX++) {
+				chunkBins[chunk * tileCount + tileY * tileColumns + tileX].push_back(number);
+			}
+		}
+		return true;
+	}
+
+	// Draw every triangle binned into one tile
+	void SoftwareRasterizer::rasterizeTile(long tile)
+	{
+		RasterRowFunction rasterizeRow = rasterizeRowScalar;
+		SimdLevel level = simdLevel < CpuFeatures::getSimdLevel() ? simdLevel : CpuFeatures::getSimdLevel();
+#if defined(FRAMEWORK_X86)
+		if (level == SIMD_AVX2) {
+			rasterizeRow = rasterizeRowAvx2;
+		}
+		else if (level == SIMD_SSE2) {
+			rasterizeRow = rasterizeRowSse2;
+		}
+#endif
+
+		long tileCount = (long)tileColumns * tileRows;
+		int tileMinX = (int)(tile % tileColumns) * RASTER_TILE_SIZE;
+		int tileMinY = (int)(tile / tileColumns) * RASTER_TILE_SIZE;
+		int tileMaxX = tileMinX + RASTER_TILE_SIZE - 1 < width - 1 ? tileMinX + RASTER_TILE_SIZE - 1 : width - 1;
+		int tileMaxY = tileMinY + RASTER_TILE_SIZE - 1 < height - 1 ? tileMinY + RASTER_TILE_SIZE - 1 : height - 1;
+
+		for (long chunk = 0; chunk < chunkCount; chunk++) {
+			const std::vector<unsigned int> &bin = chunkBins[chunk * tileCount + tile];
+			const std::vector<RasterTriangle> &triangles = chunkTriangles[chunk];
+			for (size_t i = 0; i < bin.size(); i++) {
+				const RasterTriangle &triangle = triangles[bin[i]];
+				int minY = triangle.minY > tileMinY ? triangle.minY : tileMinY;
+				int maxY = triangle.maxY < tileMaxY ? triangle.maxY : tileMaxY;
+				int minX = triangle.minX > tileMinX ? triangle.minX : tileMinX;
+				int maxX = triangle.maxX < tileMaxX ? triangle.maxX : tileMaxX;
+				minX = tileMinX + ((minX - tileMinX) & ~7);		// Groups start on the same pixels at every level
+
+				// Edge values at the first pixel center, the tile is skipped if an edge is
+				// negative over all of it, then clamped to 32 bits without changing any sign
+				int edges[3], edgeStepX[3], edgeStepY[3];
+				bool isOutside = false;
+				long long pixelX = (long long)minX * SUBPIXEL_STEPS + SUBPIXEL_STEPS / 2 - triangle.cornerX;
+				long long pixelY = (long long)minY * SUBPIXEL_STEPS + SUBPIXEL_STEPS / 2 - triangle.cornerY;
+				for (int edge = 0; edge < 3; edge++) {
+					long long value = triangle.edgeA[edge] * pixelX + triangle.edgeB[edge] * pixelY + triangle.edgeC[edge];
+					edgeStepX[edge] = triangle.edgeA[edge] * SUBPIXEL_STEPS;
+					edgeStepY[edge] = triangle.edgeB[edge] * SUBPIXEL_STEPS;
+					long long largest = value + (edgeStepX[edge] > 0 ? (long long)edgeStepX[edge] * (maxX - minX) : 0) +
+						(edgeStepY[edge] > 0 ? (long long)edgeStepY[edge] * (maxY - minY) : 0);
+					isOutside = isOutside || largest < 0;
+					value = value < EDGE_CLAMP ? value : EDGE_CLAMP;
+					value = value > -EDGE_CLAMP ? value : -EDGE_CLAMP;
+					edges[edge] = (int)value;
+				}
+				if (isOutside) {
+					continue;
+				}
+
+				for (int y = minY; y <= maxY; y++) {
+					float dy = ((float)y + 0.5f) - triangle.originY;
+					float rowZ = triangle.z + triangle.dzdy * dy;
+					float rowIntensity = triangle.intensity + triangle.didy * dy;
+					size_t row = (size_t)y * stride;
+					rasterizeRow(triangle, minX, maxX, edges, edgeStepX, rowZ, rowIntensity, depthBuffer + row, colorBuffer + row);
+					for (int edge = 0; edge < 3; edge++) {
+						edges[edge] += edgeStepY[edge];
+					}
+				}
+			}
+		}
+	}
+
+	// Write the colors as a binary PPM
+	bool SoftwareRasterizer::writePpm(const char *filename) const
+	{
+		FILE *file = fopen(filename, "wb");
+		if (file == NULL) {
+			return false;
+		}
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+		std::vector<unsigned char> row(width * 3);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				unsigned int pixel = colorBuffer[(size_t)y * stride + x];
+				row[x * 3] = (unsigned char)(pixel & 0xFF);
+				row[x * 3 + 1] = (unsigned char)((pixel >> 8) & 0xFF);
+				row[x * 3 + 2] = (unsigned char)((pixel >> 16) & 0xFF);
+			}
+			fwrite(&row[0], 1, row.size(), file);
+		}
+		return fclose(file) == 0;
+	}
+
+	// Return the color buffer
+	const unsigned int* SoftwareRasterizer::getColorBuffer() const
+	{
+		return colorBuffer;
+	}
+
+	// Return the depth buffer
+	const float* SoftwareRasterizer::getDepthBuffer() const
+	{
+		return depthBuffer;
+	}
+
+	// Return the width
+	int SoftwareRasterizer::getWidth() const
+	{
+		return width;
+	}
+
+	// Return the height
+	int SoftwareRasterizer::getHeight() const
+	{
+		return height;
+	}
+
+	// Return the row pitch
+	int SoftwareRasterizer::getStride() const
+	{
+		return stride;
+	}
+
+}	// namespace
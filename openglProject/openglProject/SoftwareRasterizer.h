@@ -0,0 +1,186 @@
+#pragma once
+// SoftwareRasterizer.h is the file that
+// draws models on the CPU into a framebuffer
+// in memory, for machines without a GPU.
+
+// Header guards
+#ifndef SOFTWARE_RASTERIZER_H_
+#define SOFTWARE_RASTERIZER_H_
+
+// Include headers
+#include <stddef.h>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include "Vector.h"
+#include "IndexedMesh.h"
+#include "QuantizedMesh.h"
+#include "Obj_Loader.h"
+
+namespace applicationFramework {
+
+	// Pixels along each side of a tile, tiles are rasterized in parallel
+	static const int RASTER_TILE_SIZE = 64;
+
+	// Largest framebuffer side, keeps the fixed point edge functions in 32 bits
+	static const int RASTER_MAX_SIZE = 4096;
+
+	// Triangles set up and binned per task
+	static const long RASTER_TRIANGLES_PER_CHUNK = 4096;
+
+	// A vertex after the vertex stage
+	struct ClipVertex
+	{
+		float x, y, z, w;				// Clip space position
+		float intensity;				// Lit grey level, 0 to 1
+	};
+
+	// A triangle ready to rasterize, in screen space with y down
+	struct RasterTriangle
+	{
+		int edgeA[3], edgeB[3];			// Edge functions A*x + B*y + C, positive inside, in 1/16 pixels
+		long long edgeC[3];				// At the triangle's first corner, with the top-left fill rule bias
+		int cornerX, cornerY;			// The first corner, in 1/16 pixels
+		int minX, minY, maxX, maxY;		// Pixels whose centers may be covered, inside the framebuffer
+		float originX, originY;			// The first corner in pixels, the attribute planes are relative to it
+		float z, dzdx, dzdy;			// Window depth plane
+		float intensity, didx, didy;	// Grey level plane
+	};
+
+	/* Draws meshes with the same camera and single light as the OpenGL path,
+	* into a color and depth buffer in memory. Triangles are transformed and lit
+	* per vertex, clipped, set up and binned into 64x64 tiles in chunks, then each
+	* tile runs the chunks' triangles in submission order on the pool. Rows are
+	* filled 4 (SSE2) or 8 (AVX2) pixels at a time and every level draws the same
+	* pixels, whatever the number of threads.
+	*/
+	class SoftwareRasterizer
+	{
+	public:
+		// Class constructor/destructor
+		explicit SoftwareRasterizer(ThreadPool &pool = ThreadPool::getSharedPool());
+		~SoftwareRasterizer();
+
+		/** Allocates the color and depth buffers.
+		@param width, height - the size in pixels, up to RASTER_MAX_SIZE
+		@return false if the size is out of range or the buffers could not be allocated
+		*/
+		bool resize(int width, int height);
+
+		/** Frees the framebuffer and the scratch buffers */
+		void release();
+
+		/** Fills the color buffer with a grey level and the depth buffer with the far plane */
+		void clear(float grey = 0.0f);
+
+		/** Sets the view and projection as gluLookAt and gluPerspective do */
+		void setCamera(const Vector<float> &eye, const Vector<float> &center, const Vector<float> &up,
+			float fieldOfView, float aspectRatio, float nearPlane, float farPlane);
+
+		/** Sets the directional light. The defaults are what Application::setupLights()
+		gives the default OpenGL material: light (0.8) plus scene (0.4) ambient times the
+		material's 0.2, and white diffuse times the material's 0.8, from (0, 1, 1).
+		@param direction - towards the light, in world space
+		@param ambient - the grey level of unlit faces
+		@param diffuse - added in proportion to the cosine to the light
+		*/
+		void setLight(const Vector<float> &direction, float ambient, float diffuse);
+
+		/** Picks the widest row kernel to use, the result is the same for all of them */
+		void setSimdLevel(SimdLevel level);
+
+		/** Draws a model the way Obj_Loader::render() does: the quantized mesh,
+		else the indexed mesh, else the loaded triangles.
+		@param model - the model to draw
+		@param transform - model to world, 16 floats column major, NULL for identity
+		@return the number of triangles rasterized after clipping
+		*/
+		long draw(const Obj_Loader &model, const float *transform = NULL);
+
+		/** Draws an indexed mesh */
+		long draw(const IndexedMesh &mesh, const float *transform = NULL);
+
+		/** Draws a quantized mesh, decoding its vertices in the vertex stage */
+		long draw(const QuantizedMesh &mesh, const float *transform = NULL);
+
+		/** Draws a triangle list, 3 corners per triangle, e.g. Obj_Loader::Faces_Triangles.
+		NULL normals draw the triangles with the ambient level alone. */
+		long drawTriangles(const float *positions, const float *normals, long cornerCount, const float *transform = NULL);
+
+		/** Writes the color buffer as a binary PPM image */
+		bool writePpm(const char *filename) const;
+
+		/** The color buffer, one RGBA8 pixel per unsigned int (R in the lowest byte),
+		top row first, getStride() pixels apart */
+		const unsigned int* getColorBuffer() const;
+
+		/** The depth buffer, 0 at the near plane and 1 at the far plane, laid out like the colors */
+		const float* getDepthBuffer() const;
+
+		/** The framebuffer size in pixels */
+		int getWidth() const;
+		int getHeight() const;
+
+		/** The number of pixels from one row to the next */
+		int getStride() const;
+
+	private:
+		// The framebuffer is owned by the rasterizer
+		SoftwareRasterizer(const SoftwareRasterizer &other);
+		SoftwareRasterizer& operator=(const SoftwareRasterizer &rhs);
+
+		// Where the vertex stage reads from, exactly one of positions or quantized is set
+		struct VertexSource
+		{
+			const float *positions;
+			const float *normals;
+			const QuantizedMesh *quantized;
+			long vertexCount;
+			const void *indices;		// NULL draws the vertices in order
+			int indexSize;
+			long cornerCount;
+		};
+
+		/** Runs the vertex, setup and binning, and tile stages */
+		long drawVertices(const VertexSource &source, const float *transform);
+
+		/** Transforms and lights one range of vertices */
+		void shadeVertices(const VertexSource &source, const float *modelViewProjection,
+			const float *normalMatrix, long first, long last);
+
+		/** Clips, sets up and bins one chunk of triangles */
+		void setupChunk(const VertexSource &source, long chunk);
+
+		/** Appends a clipped triangle to a chunk and its tiles, false if it covers no pixel center */
+		bool setupTriangle(const ClipVertex &v0, const ClipVertex &v1, const ClipVertex &v2, long chunk);
+
+		/** Draws the binned triangles of one tile */
+		void rasterizeTile(long tile);
+
+		ThreadPool &pool;
+		SimdLevel simdLevel;
+
+		unsigned int *colorBuffer;
+		float *depthBuffer;
+		int width;
+		int height;
+		int stride;						// Rows are padded to 8 pixels so a SIMD group never leaves its tile
+		int tileColumns;
+		int tileRows;
+
+		float viewProjection[16];		// Column major, as OpenGL keeps it
+		float lightDirection[3];		// Unit length
+		float lightAmbient;
+		float lightDiffuse;
+		float guardBandX, guardBandY;	// Clip space limits that keep the fixed point coordinates in range
+
+		std::vector<ClipVertex> clipVertices;		// Reused by every draw
+		std::vector<std::vector<RasterTriangle> > chunkTriangles;
+		std::vector<std::vector<unsigned int> > chunkBins;	// chunk * tile count + tile, triangles of the chunk in that tile
+		long chunkCount;
+	};
+
+}	// namespace
+
+#endif
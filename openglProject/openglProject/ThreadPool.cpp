@@ -0,0 +1,161 @@
+// ThreadPool.cpp is the file that
+// holds the implementation for the
+// worker thread pool.
+
+// Include headers
+#include <chrono>
+
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+namespace applicationFramework {
+
+	// Class constructor
+	ThreadPool::ThreadPool(unsigned int threadCount)
+	{
+		isStopping = false;
+
+		if (threadCount == 0) {
+			threadCount = std::thread::hardware_concurrency();
+		}
+		if (threadCount == 0) {				// hardware_concurrency may not know
+			threadCount = 1;
+		}
+
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+		}
+	}
+
+	// Class destructor
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			isStopping = true;
+		}
+		taskAvailable.notify_all();
+
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	// Queue a task for the workers
+	void ThreadPool::enqueue(const std::function<void()> &task)
+	{
+		enqueue(task, NULL);
+	}
+
+	// Queue a task of a parallelFor call for the workers
+	void ThreadPool::enqueue(const std::function<void()> &task, const void *group)
+	{
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			PendingTask pending;
+			pending.run = task;
+			pending.group = group;
+			tasks.push_back(pending);
+		}
+		taskAvailable.notify_one();
+	}
+
+	// Run a loop body over the workers and wait for it
+	void ThreadPool::parallelFor(long count, const std::function<void(long)> &body)
+	{
+		if (count <= 0) {
+			return;
+		}
+		if (count == 1) {
+			body(0);
+			return;
+		}
+
+		long remaining = count;
+		std::mutex doneMutex;
+		std::condition_variable done;
+		const void *group = &remaining;		// Unique while this call runs
+
+		for (long i = 0; i < count; i++) {
+			enqueue([&, i]() {
+				body(i);
+
+				// Signal under the lock, so the caller can't return (and destroy
+				// the mutex) between the last decrement and the notify
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if (--remaining == 0) {
+					done.notify_all();
+				}
+			}, group);
+		}
+
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if (remaining == 0) {
+					break;
+				}
+			}
+
+			if (!runPendingTask(group)) {		// Nothing left to help with, wait for the workers
+				std::unique_lock<std::mutex> lock(doneMutex);
+				done.wait_for(lock, std::chrono::milliseconds(1), [&]() { return remaining == 0; });
+			}
+		}
+	}
+
+	// Return the number of workers
+	unsigned int ThreadPool::getThreadCount() const
+	{
+		return (unsigned int)workers.size();
+	}
+
+	// Return the framework's shared pool
+	ThreadPool& ThreadPool::getSharedPool()
+	{
+		static ThreadPool sharedPool;
+		return sharedPool;
+	}
+
+	// Run one queued task of a group on the calling thread
+	bool ThreadPool::runPendingTask(const void *group)
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			std::deque<PendingTask>::iterator pending = tasks.begin();
+			while (pending != tasks.end() && pending->group != group) {
+				++pending;
+			}
+			if (pending == tasks.end()) {
+				return false;
+			}
+			task = pending->run;
+			tasks.erase(pending);
+		}
+
+		task();
+		return true;
+	}
+
+	// Worker thread loop
+	void ThreadPool::workerLoop()
+	{
+		Profiler::setThreadName("ThreadPool worker");
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(tasksMutex);
+				taskAvailable.wait(lock, [this]() { return isStopping || !tasks.empty(); });
+				if (tasks.empty()) {		// Only empty here when stopping
+					return;
+				}
+				task = tasks.front().run;
+				tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+}	// namespace
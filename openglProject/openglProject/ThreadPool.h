@@ -0,0 +1,78 @@
+#pragma once
+// ThreadPool.h is the file that holds
+// the worker threads used to spread
+// loading and processing work over
+// all cores.
+
+// Header guards
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+// Include headers
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace applicationFramework {
+
+	class ThreadPool
+	{
+	public:
+		/** Starts the worker threads.
+		@param threadCount - the number of workers, 0 uses one per hardware thread
+		*/
+		explicit ThreadPool(unsigned int threadCount = 0);
+
+		/** Finishes the queued tasks and joins the workers */
+		~ThreadPool();
+
+		/** Queues a task to run on one of the workers */
+		void enqueue(const std::function<void()> &task);
+
+		/** Runs body(0) .. body(count - 1) on the workers and returns once all
+		of them finished. The calling thread helps run the bodies of this call while
+		it waits (never other queued tasks, so a frame can't pick up a long load),
+		which makes it safe to call from inside another task.
+		*/
+		void parallelFor(long count, const std::function<void(long)> &body);
+
+		/** The number of worker threads */
+		unsigned int getThreadCount() const;
+
+		/** A pool with one worker per hardware thread, shared by the framework */
+		static ThreadPool& getSharedPool();
+
+	private:
+		// Threads can't be copied
+		ThreadPool(const ThreadPool &other);
+		ThreadPool& operator=(const ThreadPool &rhs);
+
+		// A queued task and the parallelFor call it belongs to, NULL for enqueue()
+		struct PendingTask
+		{
+			std::function<void()> run;
+			const void *group;
+		};
+
+		/** Queues a task of a group */
+		void enqueue(const std::function<void()> &task, const void *group);
+
+		/** Runs one queued task of a group on the calling thread, returns false if there was none */
+		bool runPendingTask(const void *group);
+
+		/** The loop each worker runs until the pool is destroyed */
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::deque<PendingTask> tasks;
+		std::mutex tasksMutex;
+		std::condition_variable taskAvailable;
+		bool isStopping;
+	};
+
+}	// namespace
+
+#endif
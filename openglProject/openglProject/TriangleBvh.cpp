@@ -0,0 +1,467 @@
+// TriangleBvh.cpp is the file that
+// holds the implementation for the
+// triangle BVH build and ray queries.
+
+// Include headers
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "TriangleBvh.h"
+
+namespace applicationFramework {
+
+	// Buckets the centroids are sorted into when looking for a split
+	static const int BIN_COUNT = 16;
+
+	// Cost of visiting a node relative to testing one triangle
+	static const float TRAVERSAL_COST = 1.0f;
+
+	// Subtrees larger than this build their two halves as separate tasks
+	static const long PARALLEL_BUILD_TRIANGLES = 16384;
+
+	// Triangles per task when gathering the triangle data
+	static const long TRIANGLES_PER_TASK = 65536;
+
+	// Sibling pairs share this many bytes
+	static const size_t NODE_PAIR_ALIGNMENT = 64;
+
+	// A triangle while the tree is built
+	struct BuildTriangle
+	{
+		float boundsMin[3];
+		float boundsMax[3];
+		float centroid[3];
+		unsigned int triangle;
+	};
+
+	// A box, empty until grown
+	struct BuildBounds
+	{
+		float boundsMin[3];
+		float boundsMax[3];
+
+		BuildBounds() {
+			for (int axis = 0; axis < 3; axis++) {
+				boundsMin[axis] = FLT_MAX;
+				boundsMax[axis] = -FLT_MAX;
+			}
+		}
+
+		void grow(const float *minimum, const float *maximum) {
+			for (int axis = 0; axis < 3; axis++) {
+				boundsMin[axis] = minimum[axis] < boundsMin[axis] ? minimum[axis] : boundsMin[axis];
+				boundsMax[axis] = maximum[axis] > boundsMax[axis] ? maximum[axis] : boundsMax[axis];
+			}
+		}
+
+		float getArea() const {
+			float dx = boundsMax[0] - boundsMin[0];
+			float dy = boundsMax[1] - boundsMin[1];
+			float dz = boundsMax[2] - boundsMin[2];
+			return dx < 0.0f ? 0.0f : 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+	};
+
+	// What the recursive build shares. Nodes go into a sparse array first: a subtree over
+	// n triangles takes at most 2n - 1 slots, so both halves know where to write without locking.
+	struct BuildContext
+	{
+		std::vector<BuildTriangle> buildTriangles;
+		std::vector<BvhNode> sparseNodes;
+		ThreadPool *pool;
+	};
+
+	// Split or close one node, then its children
+	static void buildNode(BuildContext &context, long nodeIndex, long first, long count, int depth)
+	{
+		BuildTriangle *buildTriangles = &context.buildTriangles[first];
+		BuildBounds bounds, centroidBounds;
+		for (long i = 0; i < count; i++) {
+			bounds.grow(buildTriangles[i].boundsMin, buildTriangles[i].boundsMax);
+			centroidBounds.grow(buildTriangles[i].centroid, buildTriangles[i].centroid);
+		}
+
+		BvhNode &node = context.sparseNodes[nodeIndex];
+		memcpy(node.boundsMin, bounds.boundsMin, sizeof(node.boundsMin));
+		memcpy(node.boundsMax, bounds.boundsMax, sizeof(node.boundsMax));
+		node.leftFirst = (unsigned int)first;
+		node.triangleCount = (unsigned int)count;
+		if (count <= 1 || depth >= BVH_MAX_DEPTH - 1) {
+			return;
+		}
+
+		// Bin the centroids on all three axes in one pass, then sweep each axis for the cheapest split.
+		// Small nodes use fewer bins, setting up and sweeping 16 would outweigh binning a few triangles.
+		int binCount = count < BIN_COUNT ? (int)count : BIN_COUNT;
+		float binScales[3];
+		for (int axis = 0; axis < 3; axis++) {
+			float extent = centroidBounds.boundsMax[axis] - centroidBounds.boundsMin[axis];
+			binScales[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+		}
+		BuildBounds binBounds[3][BIN_COUNT];
+		long binCounts[3][BIN_COUNT] = { { 0 } };
+		for (long i = 0; i < count; i++) {
+			const BuildTriangle &triangle = buildTriangles[i];
+			for (int axis = 0; axis < 3; axis++) {
+				int bin = (int)((triangle.centroid[axis] - centroidBounds.boundsMin[axis]) * binScales[axis]);
+				bin = bin < binCount - 1 ? bin : binCount - 1;
+				binCounts[axis][bin]++;
+				binBounds[axis][bin].grow(triangle.boundsMin, triangle.boundsMax);
+			}
+		}
+
+		int bestAxis = -1;
+		int bestSplit = 0;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++) {
+			if (binScales[axis] == 0.0f) {
+				continue;											// Every centroid in one plane on this axis
+			}
+
+			float leftCosts[BIN_COUNT - 1];
+			BuildBounds sweep;
+			long sweepCount = 0;
+			for (int split = 0; split < binCount - 1; split++) {
+				sweep.grow(binBounds[axis][split].boundsMin, binBounds[axis][split].boundsMax);
+				sweepCount += binCounts[axis][split];
+				leftCosts[split] = sweep.getArea() * sweepCount;
+			}
+			sweep = BuildBounds();
+			sweepCount = 0;
+			for (int split = binCount - 1; split > 0; split--) {
+				sweep.grow(binBounds[axis][split].boundsMin, binBounds[axis][split].boundsMax);
+				sweepCount += binCounts[axis][split];
+				float cost = leftCosts[split - 1] + sweep.getArea() * sweepCount;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		// Keep a leaf when splitting costs more than testing every triangle
+		float area = bounds.getArea();
+		float splitCost = area > 0.0f ? TRAVERSAL_COST + bestCost / area : TRAVERSAL_COST;
+		if (count <= BVH_MAX_LEAF_TRIANGLES && (bestAxis < 0 || splitCost >= (float)count)) {
+			return;
+		}
+
+		long leftCount = count / 2;										// Identical centroids can only be split by position
+		if (bestAxis >= 0) {
+			float binScale = binScales[bestAxis];
+			float minimum = centroidBounds.boundsMin[bestAxis];
+			BuildTriangle *middle = std::partition(buildTriangles, buildTriangles + count,
+				[bestAxis, bestSplit, binScale, minimum, binCount](const BuildTriangle &triangle) {
+				int bin = (int)((triangle.centroid[bestAxis] - minimum) * binScale);
+				return (bin < binCount - 1 ? bin : binCount - 1) < bestSplit;
+			});
+			if (middle != buildTriangles && middle != buildTriangles + count) {
+				leftCount = (long)(middle - buildTriangles);
+			}
+		}
+
+		long leftIndex = nodeIndex + 1;
+		long rightIndex = nodeIndex + 2 * leftCount;
+		node.leftFirst = (unsigned int)rightIndex;						// The left child is always nodeIndex + 1 here
+		node.triangleCount = 0;
+
+		if (count > PARALLEL_BUILD_TRIANGLES) {
+			context.pool->parallelFor(2, [&context, leftIndex, rightIndex, first, leftCount, count, depth](long half) {
+				if (half == 0) {
+					buildNode(context, leftIndex, first, leftCount, depth + 1);
+				}
+				else {
+					buildNode(context, rightIndex, first + leftCount, count - leftCount, depth + 1);
+				}
+			});
+		}
+		else {
+			buildNode(context, leftIndex, first, leftCount, depth + 1);
+			buildNode(context, rightIndex, first + leftCount, count - leftCount, depth + 1);
+		}
+	}
+
+	// Class constructor
+	TriangleBvh::TriangleBvh()
+	{
+		nodes = NULL;
+		nodeAllocation = NULL;
+		nodeCount = 0;
+		triangles = NULL;
+		triangleIds = NULL;
+		triangleCount = 0;
+	}
+
+	// Class destructor
+	TriangleBvh::~TriangleBvh()
+	{
+		release();
+	}
+
+	// Build the tree over the mesh's triangles
+	bool TriangleBvh::build(const IndexedMesh &mesh, ThreadPool &pool)
+	{
+		release();
+		long meshTriangleCount = mesh.indexCount / 3;
+		if (meshTriangleCount == 0) {
+			return true;
+		}
+
+		BuildContext context;
+		context.pool = &pool;
+		context.buildTriangles.resize(meshTriangleCount);
+		context.sparseNodes.resize(2 * meshTriangleCount - 1);
+
+		// Bounds and centroids, one block of triangles per task
+		long taskCount = (meshTriangleCount + TRIANGLES_PER_TASK - 1) / TRIANGLES_PER_TASK;
+		pool.parallelFor(taskCount, [&mesh, &context, meshTriangleCount](long task) {
+			long end = (task + 1) * TRIANGLES_PER_TASK < meshTriangleCount ? (task + 1) * TRIANGLES_PER_TASK : meshTriangleCount;
+			for (long triangle = task * TRIANGLES_PER_TASK; triangle < end; triangle++) {
+				BuildTriangle &buildTriangle = context.buildTriangles[triangle];
+				for (int corner = 0; corner < 3; corner++) {
+					const float *position = &mesh.positions[mesh.getIndex(triangle * 3 + corner) * 3];
+					for (int axis = 0; axis < 3; axis++) {
+						buildTriangle.boundsMin[axis] = corner == 0 || position[axis] < buildTriangle.boundsMin[axis] ? position[axis] : buildTriangle.boundsMin[axis];
+						buildTriangle.boundsMax[axis] = corner == 0 || position[axis] > buildTriangle.boundsMax[axis] ? position[axis] : buildTriangle.boundsMax[axis];
+					}
+				}
+				for (int axis = 0; axis < 3; axis++) {
+					buildTriangle.centroid[axis] = (buildTriangle.boundsMin[axis] + buildTriangle.boundsMax[axis]) * 0.5f;
+				}
+				buildTriangle.triangle = (unsigned int)triangle;
+			}
+		});
+
+		buildNode(context, 0, 0, meshTriangleCount, 0);
+
+		// Count the nodes that were used, then lay them out depth first with siblings in pairs
+		long usedCount = 0;
+		std::vector<long> stack(1, 0);
+		while (!stack.empty()) {
+			long sparse = stack.back();
+			stack.pop_back();
+			usedCount++;
+			if (context.sparseNodes[sparse].triangleCount == 0) {
+				stack.push_back(context.sparseNodes[sparse].leftFirst);
+				stack.push_back(sparse + 1);
+			}
+		}
+
+		size_t nodeBytes = (usedCount + 1) * sizeof(BvhNode);
+		nodeAllocation = malloc(nodeBytes + NODE_PAIR_ALIGNMENT);
+		triangles = (float*)malloc(meshTriangleCount * 9 * sizeof(float));
+		triangleIds = (unsigned int*)malloc(meshTriangleCount * sizeof(unsigned int));
+		if (nodeAllocation == NULL || triangles == NULL || triangleIds == NULL) {
+			release();
+			return false;
+		}
+		nodes = (BvhNode*)(((size_t)nodeAllocation + NODE_PAIR_ALIGNMENT - 1) & ~(NODE_PAIR_ALIGNMENT - 1));
+		memset(&nodes[1], 0, sizeof(BvhNode));
+
+		std::vector<std::pair<long, long> > pending(1, std::make_pair(0L, 0L));		// Sparse slot, final slot
+		long nextSlot = 2;
+		while (!pending.empty()) {
+			long sparse = pending.back().first;
+			long slot = pending.back().second;
+			pending.pop_back();
+
+			nodes[slot] = context.sparseNodes[sparse];
+			if (nodes[slot].triangleCount == 0) {
+				pending.push_back(std::make_pair((long)context.sparseNodes[sparse].leftFirst, nextSlot + 1));
+				pending.push_back(std::make_pair(sparse + 1, nextSlot));
+				nodes[slot].leftFirst = (unsigned int)nextSlot;
+				nextSlot += 2;
+			}
+		}
+		nodeCount = nextSlot;
+		std::vector<BvhNode>().swap(context.sparseNodes);
+
+		// The leaves point into the build order, copy the triangles in that order
+		pool.parallelFor(taskCount, [this, &mesh, &context, meshTriangleCount](long task) {
+			long end = (task + 1) * TRIANGLES_PER_TASK < meshTriangleCount ? (task + 1) * TRIANGLES_PER_TASK : meshTriangleCount;
+			for (long i = task * TRIANGLES_PER_TASK; i < end; i++) {
+				unsigned int triangle = context.buildTriangles[i].triangle;
+				const float *a = &mesh.positions[mesh.getIndex(triangle * 3) * 3];
+				const float *b = &mesh.positions[mesh.getIndex(triangle * 3 + 1) * 3];
+				const float *c = &mesh.positions[mesh.getIndex(triangle * 3 + 2) * 3];
+				float *data = &triangles[i * 9];
+				for (int axis = 0; axis < 3; axis++) {
+					data[axis] = a[axis];
+					data[3 + axis] = b[axis] - a[axis];
+					data[6 + axis] = c[axis] - a[axis];
+				}
+				triangleIds[i] = triangle;
+			}
+		});
+		triangleCount = meshTriangleCount;
+		return true;
+	}
+
+	// Free the tree
+	void TriangleBvh::release()
+	{
+		free(nodeAllocation);
+		free(triangles);
+		free(triangleIds);
+
+		nodes = NULL;
+		nodeAllocation = NULL;
+		nodeCount = 0;
+		triangles = NULL;
+		triangleIds = NULL;
+		triangleCount = 0;
+	}
+
+	// Distance to where a ray enters a box, FLT_MAX if it misses or enters past maxDistance
+	static inline float intersectBounds(const BvhNode &node, const float *origin, const float *inverseDirection, float maxDistance)
+	{
+		float nearest = 0.0f;
+		float farthest = maxDistance;
+		for (int axis = 0; axis < 3; axis++) {
+			float t1 = (node.boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			float t2 = (node.boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+			float entry = t1 < t2 ? t1 : t2;
+			float exit = t1 < t2 ? t2 : t1;
+			nearest = entry > nearest ? entry : nearest;
+			farthest = exit < farthest ? exit : farthest;
+		}
+		return nearest <= farthest ? nearest : FLT_MAX;
+	}
+
+	// Walk the tree front to back, skipping boxes that start behind the closest hit so far
+	bool TriangleBvh::intersect(const float *origin, const float *direction, RayHit &hit, float maxDistance) const
+	{
+		if (nodeCount == 0) {
+			return false;
+		}
+
+		float inverseDirection[3];
+		for (int axis = 0; axis < 3; axis++) {
+			inverseDirection[axis] = 1.0f / direction[axis];				// Infinite along an axis the ray doesn't move on
+		}
+
+		float closest = maxDistance;
+		long closestTriangle = -1;
+		float closestU = 0.0f, closestV = 0.0f;
+
+		unsigned int stack[BVH_MAX_DEPTH];
+		int stackSize = 0;
+		const BvhNode *node = &nodes[0];
+		if (intersectBounds(*node, origin, inverseDirection, closest) == FLT_MAX) {
+			return false;
+		}
+
+		for (;;)
+		{
+			if (node->triangleCount > 0)
+			{
+				// Moller-Trumbore against each triangle of the leaf, both sides
+				for (unsigned int i = node->leftFirst; i < node->leftFirst + node->triangleCount; i++) {
+					const float *data = &triangles[i * 9];
+					const float *edge1 = data + 3;
+					const float *edge2 = data + 6;
+					float p[3] = { direction[1] * edge2[2] - direction[2] * edge2[1],
+						direction[2] * edge2[0] - direction[0] * edge2[2],
+						direction[0] * edge2[1] - direction[1] * edge2[0] };
+					float determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+					if (determinant == 0.0f) {
+						continue;											// Parallel to the triangle
+					}
+					float inverseDeterminant = 1.0f / determinant;
+					float t[3] = { origin[0] - data[0], origin[1] - data[1], origin[2] - data[2] };
+					float u = (t[0] * p[0] + t[1] * p[1] + t[2] * p[2]) * inverseDeterminant;
+					if (u < 0.0f || u > 1.0f) {
+						continue;
+					}
+					float q[3] = { t[1] * edge1[2] - t[2] * edge1[1],
+						t[2] * edge1[0] - t[0] * edge1[2],
+						t[0] * edge1[1] - t[1] * edge1[0] };
+					float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDeterminant;
+					if (v < 0.0f || u + v > 1.0f) {
+						continue;
+					}
+					float distance = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverseDeterminant;
+					if (distance >= 0.0f && distance < closest) {
+						closest = distance;
+						closestTriangle = triangleIds[i];
+						closestU = u;
+						closestV = v;
+					}
+				}
+			}
+			else
+			{
+				// Visit the nearer child first, the farther one waits on the stack
+				unsigned int nearChild = node->leftFirst;
+				unsigned int farChild = nearChild + 1;
+				float nearDistance = intersectBounds(nodes[nearChild], origin, inverseDirection, closest);
+				float farDistance = intersectBounds(nodes[farChild], origin, inverseDirection, closest);
+				if (farDistance < nearDistance) {
+					unsigned int swapped = nearChild;
+					nearChild = farChild;
+					farChild = swapped;
+					float swappedDistance = nearDistance;
+					nearDistance = farDistance;
+					farDistance = swappedDistance;
+				}
+				if (nearDistance != FLT_MAX) {
+					if (farDistance != FLT_MAX) {
+						stack[stackSize++] = farChild;
+					}
+					node = &nodes[nearChild];
+					continue;
+				}
+			}
+
+			// Pop the next box that can still beat the closest hit
+			node = NULL;
+			while (stackSize > 0 && node == NULL) {
+				const BvhNode *candidate = &nodes[stack[--stackSize]];
+				if (intersectBounds(*candidate, origin, inverseDirection, closest) != FLT_MAX) {
+					node = candidate;
+				}
+			}
+			if (node == NULL) {
+				break;
+			}
+		}
+
+		if (closestTriangle < 0) {
+			return false;
+		}
+		hit.triangle = closestTriangle;
+		hit.distance = closest;
+		hit.u = closestU;
+		hit.v = closestV;
+		return true;
+	}
+
+	// Return the build triangles and the sparse node array
+	size_t TriangleBvh::getBuildScratchBytes(long triangleCount)
+	{
+		return triangleCount * (sizeof(BuildTriangle) + 2 * sizeof(BvhNode));
+	}
+
+	// Return the number of nodes
+	long TriangleBvh::getNodeCount() const
+	{
+		return nodeCount;
+	}
+
+	// Return the number of triangles
+	long TriangleBvh::getTriangleCount() const
+	{
+		return triangleCount;
+	}
+
+	// Return the bytes held by the tree
+	size_t TriangleBvh::getSizeInBytes() const
+	{
+		return nodeCount > 0 ? nodeCount * sizeof(BvhNode) + NODE_PAIR_ALIGNMENT + triangleCount * (9 * sizeof(float) + sizeof(unsigned int)) : 0;
+	}
+
+}	// namespace
@@ -0,0 +1,101 @@
+#pragma once
+// TriangleBvh.h is the file that holds
+// a bounding volume hierarchy over the
+// triangles of a mesh for ray queries.
+
+// Header guards
+#ifndef TRIANGLE_BVH_H_
+#define TRIANGLE_BVH_H_
+
+// Include headers
+#include <stddef.h>
+#include <float.h>
+
+#include "IndexedMesh.h"
+#include "ThreadPool.h"
+
+namespace applicationFramework {
+
+	// Triangles a leaf may hold when splitting it would cost more
+	static const int BVH_MAX_LEAF_TRIANGLES = 8;
+
+	// Deepest the tree is built, also the traversal stack size
+	static const int BVH_MAX_DEPTH = 64;
+
+	/* One node, 32 bytes. Siblings are stored next to each other and start on
+	* a 64 byte boundary, so a traversal step reads both children from one cache line.
+	*/
+	struct BvhNode
+	{
+		float boundsMin[3];
+		unsigned int leftFirst;			// Interior: the left child (the right one follows). Leaf: the first triangle
+		float boundsMax[3];
+		unsigned int triangleCount;		// 0 for an interior node
+	};
+
+	// The closest triangle a ray hit
+	struct RayHit
+	{
+		long triangle;					// Triangle number in the mesh's index buffer (index / 3), -1 for no hit
+		float distance;					// Along the ray, in units of the direction's length
+		float u, v;						// Barycentric coordinates of the hit on the triangle's second and third corners
+	};
+
+	/* A BVH over the triangles of an indexed mesh, built with the surface area
+	* heuristic. The triangles are copied in leaf order (first corner and two
+	* edges), so the mesh may be released or quantized afterwards.
+	*/
+	class TriangleBvh
+	{
+	public:
+		// Class constructor/destructor
+		TriangleBvh();
+		~TriangleBvh();
+
+		/** Builds the tree, subtrees are split in parallel on the pool.
+		@param mesh - the triangles to build over
+		@param pool - the threads to build with
+		@return false if the buffers could not be allocated
+		*/
+		bool build(const IndexedMesh &mesh, ThreadPool &pool);
+
+		/** Frees the tree */
+		void release();
+
+		/** Finds the closest triangle a ray hits, from either side.
+		@param origin - the start of the ray
+		@param direction - the direction of the ray, any length
+		@param hit - the closest hit, left alone when nothing is hit
+		@param maxDistance - hits further than this are ignored
+		@return true if a triangle was hit
+		*/
+		bool intersect(const float *origin, const float *direction, RayHit &hit, float maxDistance = FLT_MAX) const;
+
+		/** The bytes build() needs on top of the finished tree */
+		static size_t getBuildScratchBytes(long triangleCount);
+
+		/** The number of nodes, 0 before build() */
+		long getNodeCount() const;
+
+		/** The number of triangles in the tree */
+		long getTriangleCount() const;
+
+		/** The bytes held by the nodes and triangles */
+		size_t getSizeInBytes() const;
+
+	private:
+		// The tree owns its buffers
+		TriangleBvh(const TriangleBvh &other);
+		TriangleBvh& operator=(const TriangleBvh &rhs);
+
+		BvhNode *nodes;					// Root at 0, slot 1 unused so sibling pairs are cache line aligned
+		void *nodeAllocation;			// What nodes was carved from
+		long nodeCount;
+		float *triangles;				// 9 floats per triangle in leaf order: first corner, edge 1, edge 2
+		unsigned int *triangleIds;		// The mesh triangle of each of them
+		long triangleCount;
+	};
+
+}	// namespace
+
+#endif
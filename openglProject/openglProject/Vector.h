@@ -9,6 +9,7 @@
 #include <math.h>
 #include <string>
 #include <stdio.h>
+#include <ostream>
 
 #include "Point.h"
 
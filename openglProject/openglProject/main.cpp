@@ -3,16 +3,56 @@
 
 // Include headers
 #include "Application.h"
+#include "Benchmark.h"
 
 // namespace declaration
 using namespace applicationFramework;
 
+// Where --trace writes the recorded zones when the program exits
+static const char *traceFilename = NULL;
+
+// Write the trace, GLUT leaves its main loop through exit()
+static void exportTrace()
+{
+	Profiler::stopCapture();
+	if (Profiler::exportChromeTrace(traceFilename)) {
+		LOG_INFO("Trace written to %s", traceFilename);
+	}
+	else {
+		LOG_ERROR("Could not write the trace to %s", traceFilename);
+	}
+}
+
 // Main function to the application
 int main(int argc, char *argv[])
 {
+	// Record profiler zones for the whole run when the last two arguments ask to,
+	// e.g. openglProject --headless 600 0.0166667 frames.json --trace trace.json
+	if (argc >= 3 && strcmp(argv[argc - 2], "--trace") == 0) {
+		traceFilename = argv[argc - 1];
+		argc -= 2;
+		Profiler::setThreadName("Main");
+		Profiler::startCapture();
+		atexit(exportTrace);
+	}
+
+	// Run a benchmark instead of the application when asked to,
+	// e.g. openglProject --benchmark obj model.obj
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+		return runBenchmark(argc - 2, argv + 2);
+	}
+
 	// Create application instance
 	Application application;
 	application.setLookAt(0.0, 2.0, 10.0, 0.0, 2.0, 0.0, 0.0, 1.0, 0.0);
+
+	// Run a fixed number of frames without a window instead, e.g.
+	// openglProject --headless 600 0.0166667 frames.json
+	if (argc > 1 && strcmp(argv[1], "--headless") == 0) {
+		return application.runHeadless(argc > 2 ? atoi(argv[2]) : 600,
+			argc > 3 ? (float)atof(argv[3]) : (float)(Application::FRAME_TIME / 1000.0),
+			argc > 4 ? argv[4] : "frames.json");
+	}
 	application.startApplication(argc, argv);
 
 	// **Note** No code below startFramework() will get executed 